@@ -34,8 +34,8 @@
 /**
  * @brief Initialize AWS IoT connection.
  *
- * Sets up WiFi connection and configures TLS certificates for AWS IoT Core.
- * Must be called before any publish operations.
+ * Configures TLS certificates and the broker for AWS IoT Core; does not
+ * touch the network. Must be called before any publish operations.
  */
 void begin();
 
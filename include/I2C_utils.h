@@ -27,7 +27,8 @@ bool initI2C();
 /**
  * @brief Scan for I2C devices
  * 
- * Scans the I2C bus and prints addresses of found devices
+ * Probes every address, prints the devices found and updates the device
+ * registry (i2c_registry.h). Blocks; boot uses i2c_registry_begin() instead.
  */
 void scanI2CDevices();
 
@@ -30,6 +30,7 @@
 #include <vector>
 #include <string>
 #include <stdint.h>
+#include "entry_store.h"
 
 // Global SD card instance (extern to avoid multiple definitions)
 extern SdFat sd;
@@ -53,12 +54,56 @@ struct FileInfo {
 /**
  * @brief Initialize SD card interface.
  *
+ * Called by the mount task (sd_mount.h); screens check sd_mounted() instead.
+ *
  * @return true if successful, false on error.
  * @note Implements hardware fault recovery.
  * @warning Blocking operation (max 2s timeout).
  */
 bool init_sd_card();
 
+/**
+ * @brief (Re)mount the card at @p mhz with the shared sector cache.
+ *
+ * Dirty cached sectors are written back before the old mount goes away,
+ * unless the card no longer answers with the CID the cache was started on;
+ * then they are dropped so they cannot land on another card.
+ * @return true if the card and volume came up.
+ */
+bool sd_remount(uint8_t mhz);
+
+/**
+ * @brief Write back and drop the sector cache before raw card access.
+ *
+ * The volume must be remounted with sd_remount() afterwards.
+ */
+void sd_cache_detach();
+
+/**
+ * @brief Drop the sector cache without writing back: the card was pulled or swapped.
+ *
+ * The volume must be remounted with sd_remount() afterwards.
+ */
+void sd_cache_drop();
+
+/**
+ * @brief Write back dirty cached sectors without unmounting.
+ */
+bool sd_cache_flush();
+
+/**
+ * @brief Print sector cache hit and write-back counters.
+ */
+void sd_cache_print_stats();
+
+/**
+ * @brief Block device the volume is mounted on (the cache, or the card).
+ *
+ * Use this instead of sd.card() for raw reads of file system structures so
+ * sectors still dirty in the cache are seen.
+ */
+FsBlockDevice *sd_block_device();
+
 /**
  * @brief Verify or create a directory path.
  *
@@ -83,10 +128,103 @@ bool open_dir(SdFile &dir, const char *path);
  *
  * @param dir Valid directory handle.
  * @return Vector of FileInfo structures for each entry in the directory.
- * @note Memory-efficient implementation.
+ * @note Materializes the whole directory; prefer dir_enumerate() or
+ *       list_files_page() for anything shown in the UI.
  */
 std::vector<FileInfo> list_files_in_dir(SdFile &dir);
 
+/**
+ * @brief List directory contents into a compact entry store.
+ *
+ * @param dir Valid directory handle.
+ * @param[out] out Store to fill (cleared first).
+ * @return Number of entries stored.
+ * @note Preferred over the vector overload for UI lists; names are packed
+ *       into one arena outside the LVGL heap.
+ */
+size_t list_files_in_dir(SdFile &dir, EntryStore &out);
+
+#define DIR_WANT_TYPE   0x01  ///< dir_enumerate(): fill DirEntryInfo::flags
+#define DIR_WANT_MTIME  0x02  ///< dir_enumerate(): fill DirEntryInfo::date/time
+
+/**
+ * @struct DirCursor
+ * @brief Resume point for paged directory enumeration.
+ *
+ * A default-constructed cursor starts at the first entry. After each page
+ * it holds the index of the next entry and the directory byte position to
+ * seek to, so resuming never rescans earlier entries.
+ */
+struct DirCursor {
+    uint32_t index = 0;     ///< Index of the next entry to deliver
+    uint32_t position = 0;  ///< Directory byte position of that entry
+    bool done = false;      ///< End of directory reached
+};
+
+/**
+ * @struct DirEntryInfo
+ * @brief Entry handed to a dir_enumerate() callback.
+ *
+ * @var DirEntryInfo::name Only valid for the duration of the callback.
+ */
+struct DirEntryInfo {
+    const char *name;   ///< Entry name
+    uint32_t size;      ///< File size in bytes (0 for directories)
+    uint32_t index;     ///< Position of the entry in the directory
+    uint16_t date;      ///< Modify date (FAT format), if DIR_WANT_MTIME
+    uint16_t time;      ///< Modify time (FAT format), if DIR_WANT_MTIME
+    uint8_t flags;      ///< ENTRY_* bits, if DIR_WANT_TYPE
+};
+
+/**
+ * @brief Directory entry callback.
+ *
+ * @return false to stop the enumeration after this entry.
+ */
+typedef bool (*dir_entry_cb_t)(const DirEntryInfo &info, void *ctx);
+
+/**
+ * @brief Stream directory entries starting at @p cursor.
+ *
+ * @param dir Valid directory handle.
+ * @param[in,out] cursor Resume point; advanced past every delivered entry.
+ * @param maxEntries Page size (UINT32_MAX for the whole directory).
+ * @param want DIR_WANT_* bits for the optional fields.
+ * @param cb Callback invoked once per entry.
+ * @param ctx User pointer passed to @p cb.
+ * @return Number of entries delivered, or -1 if the cursor could not be resumed.
+ * @note Type and modify time come from the same handle used for the name;
+ *       entries are never reopened.
+ */
+int dir_enumerate(SdFile &dir, DirCursor &cursor, uint32_t maxEntries, uint8_t want,
+                  dir_entry_cb_t cb, void *ctx);
+
+/**
+ * @brief Position @p cursor at entry @p index.
+ *
+ * Moves forward from the cursor when possible, otherwise restarts from the
+ * beginning of the directory. Skipped entries are opened but not read.
+ *
+ * @return false if the directory has fewer than @p index entries.
+ */
+bool dir_cursor_seek(SdFile &dir, DirCursor &cursor, uint32_t index);
+
+/**
+ * @brief Append the page of entries starting at entry @p first to an entry store.
+ *
+ * Sequential pages resume from @p cursor without rescanning; any other
+ * @p first is reached with dir_cursor_seek().
+ *
+ * @param dir Valid directory handle.
+ * @param[in,out] cursor Resume point.
+ * @param first Index of the first entry of the page.
+ * @param maxEntries Page size.
+ * @param[out] out Store to append to (not cleared).
+ * @return Number of entries appended; check cursor.done for the end.
+ */
+size_t list_files_page(SdFile &dir, DirCursor &cursor, uint32_t first, uint32_t maxEntries,
+                       EntryStore &out);
+
 /**
  * @brief Create a new directory.
  *
@@ -97,4 +235,30 @@ std::vector<FileInfo> list_files_in_dir(SdFile &dir);
  */
 bool create_directory(const char *path, const char *dirName);
 
+/**
+ * @brief Take the SD bus lock (recursive).
+ *
+ * SdFat is not thread-safe. Any task other than the LVGL task that touches
+ * the card, and LVGL-side code that can run while such a task is active,
+ * must hold this lock around SdFat calls.
+ */
+void sd_lock();
+
+/**
+ * @brief Release the SD bus lock taken with sd_lock().
+ */
+void sd_unlock();
+
+/**
+ * @class SdLock
+ * @brief Scoped holder for the SD bus lock.
+ */
+class SdLock {
+public:
+    SdLock() { sd_lock(); }
+    ~SdLock() { sd_unlock(); }
+    SdLock(const SdLock &) = delete;
+    SdLock &operator=(const SdLock &) = delete;
+};
+
 #endif // SD_UTILS_H
@@ -77,19 +77,74 @@ String getCurrentNetworkInfo();
  */
 uint8_t scanNetworks(String networks[], uint8_t maxNetworks);
 
+#define WIFI_SCAN_MAX         32     ///< Scan results considered by connectToBestNetwork()
+#define WIFI_FAST_TIMEOUT_MS  2000   ///< Directed reconnect budget before falling back to a scan
+
+/**
+ * @struct WifiConnectStats
+ * @brief How the last connection was made.
+ */
+struct WifiConnectStats {
+    uint32_t count;         ///< Successful connections since boot
+    uint32_t ms;            ///< Last connect time, from begin to IP address
+    bool cached;            ///< Joined from the saved BSSID/channel (wifi_lease.h)
+    bool staticIp;          ///< Reused the saved lease instead of DHCP
+};
+
 /**
  * @brief Connect to specified WiFi network.
  *
  * @param ssid Network SSID.
  * @param password Network password.
+ * @param channel Channel to join on (0: scan all channels).
+ * @param bssid Access point to join (nullptr: any AP with this SSID).
  * @return true if connection succeeded, false otherwise.
  * @note Prints SSID/password to Serial for debugging special characters.
  */
-bool connectToNetwork(const char* ssid, const char* password);
+bool connectToNetwork(const char* ssid, const char* password, int32_t channel = 0, const uint8_t* bssid = nullptr);
+
+/**
+ * @brief Rejoin the last good access point without scanning.
+ *
+ * Associates directly with the saved BSSID on its channel and, if the
+ * WIFI_LEASE_STATIC_KEY setting is on, configures the saved lease instead
+ * of waiting for DHCP.
+ *
+ * @return false (within WIFI_FAST_TIMEOUT_MS) if there is no saved AP or it
+ *         does not answer; fall back to connectToBestNetwork().
+ */
+bool connectToLastNetwork();
+
+/**
+ * @brief Move to another access point of the connected network.
+ *
+ * Joins @p bssid directly on @p channel with the saved password, without
+ * dropping to a scan. Used by the roaming monitor (wifi_roam.h).
+ *
+ * @return false if it is not associated within WIFI_FAST_TIMEOUT_MS.
+ */
+bool roamToAccessPoint(const uint8_t *bssid, int32_t channel);
+
+/**
+ * @brief Connect time and path of the last successful connection.
+ */
+WifiConnectStats getLastConnectStats();
+
+/**
+ * @brief Scan and join the strongest access point of any known network.
+ *
+ * The scan is matched against the credential store (wifi_creds.h) and the
+ * chosen AP is joined by BSSID and channel.
+ *
+ * @return false if no known network is in range or the connection failed.
+ */
+bool connectToBestNetwork();
 
 /**
  * @brief Save WiFi credentials to persistent storage.
  *
+ * Adds the network to the credential store or updates its password.
+ *
  * @param ssid Network SSID to save.
  * @param password Network password to save.
  */
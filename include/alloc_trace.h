@@ -0,0 +1,150 @@
+/**
+ * @file alloc_trace.h
+ * @brief Heap allocation tracer that attributes live memory to subsystems.
+ *
+ * Built only with -DALLOC_TRACE=1 (the esp32-2432S028Rv3-trace env). The
+ * linker then routes malloc, calloc, realloc and free, and newlib's
+ * reentrant _malloc_r family that strdup() and String use, through
+ * --wrap hooks. Each hook records the block in a fixed-size table, so the
+ * tracer never allocates itself.
+ *
+ * Each block is charged to a site: the innermost ALLOC_SCOPE() of the
+ * calling task (a subsystem tag plus the enclosing function name) and the
+ * return address of the allocation call. Per tag, the tracer keeps live
+ * bytes, live blocks, the live high-water mark and the number of
+ * allocations, from which the report derives allocations per second.
+ * Memory allocated outside any scope is charged to ALLOC_TAG_OTHER, as is
+ * anything allocated before the scheduler starts or from an interrupt.
+ * heap_caps_malloc() is not wrapped; code that takes long-lived regions
+ * from it reports them with alloc_trace_note_alloc().
+ *
+ * On the device, alloc_trace_begin() prints a report to Serial every
+ * ALLOC_TRACE_REPORT_MS and appends it to ALLOC_TRACE_SD_PATH while a
+ * card is mounted. The same source builds on Linux for leak hunting:
+ * link the modules under test with
+ *   -DALLOC_TRACE=1 -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc,--wrap=strdup
+ * call alloc_trace_mark() after warm-up, replay the session, then call
+ * alloc_trace_report(..., true). It lists only blocks still live from
+ * after the mark. test/host/alloc_trace_replay.cpp does exactly that
+ * (make -C test/host run).
+ *
+ * Without ALLOC_TRACE, ALLOC_SCOPE() expands to nothing and
+ * alloc_trace_begin() is an empty inline.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef ALLOC_TRACE_H
+#define ALLOC_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef ALLOC_TRACE_MAX_LIVE
+#define ALLOC_TRACE_MAX_LIVE   2048     ///< Live blocks tracked (power of two); 12 bytes each
+#endif
+#define ALLOC_TRACE_MAX_TASKS  16       ///< Tasks inside a scope at once (device only)
+#define ALLOC_TRACE_MAX_SITES  128      ///< Distinct call sites; later ones are pooled in slot 0
+#define ALLOC_TRACE_TOP_SITES  16       ///< Sites listed in a report
+#define ALLOC_TRACE_REPORT_MS  60000
+#define ALLOC_TRACE_SD_PATH    "/alloc_trace.log"
+
+/**
+ * @enum AllocTag
+ * @brief Subsystem an allocation is charged to.
+ */
+enum AllocTag : uint8_t {
+    ALLOC_TAG_OTHER = 0,    ///< No scope active
+    ALLOC_TAG_UI,
+    ALLOC_TAG_WIFI,
+    ALLOC_TAG_MQTT,
+    ALLOC_TAG_SD,
+    ALLOC_TAG_EXPLORER,
+    ALLOC_TAG_LAUNCHER,
+    ALLOC_TAG_COUNT
+};
+
+#ifdef ALLOC_TRACE
+
+/**
+ * @struct AllocTagStats
+ * @brief Counters of one tag since boot.
+ */
+struct AllocTagStats {
+    uint32_t liveBytes;
+    uint32_t liveBlocks;
+    uint32_t peakBytes;     ///< High-water mark of liveBytes
+    uint32_t allocs;        ///< Allocations, reallocs included
+    uint32_t frees;
+};
+
+/**
+ * @class AllocScope
+ * @brief Charges allocations made by this task to @p tag until it goes out of scope.
+ *
+ * Scopes nest; the innermost wins. Use ALLOC_SCOPE() rather than naming one.
+ */
+class AllocScope {
+public:
+    AllocScope(AllocTag tag, const char *label);
+    ~AllocScope();
+    AllocScope(const AllocScope &) = delete;
+    AllocScope &operator=(const AllocScope &) = delete;
+
+private:
+    uint8_t m_prevTag;
+    const char *m_prevLabel;
+};
+
+#define ALLOC_SCOPE(tag) AllocScope alloc_scope_(tag, __func__)
+
+/// Receives the report one line at a time
+typedef void (*AllocTraceWrite)(const char *line, void *ctx);
+
+/**
+ * @brief Start a new epoch; a later report can list only what was allocated since.
+ */
+void alloc_trace_mark();
+
+/**
+ * @brief Write the per-tag counters and the top sites by live bytes.
+ *
+ * With @p sinceMark, sites count only blocks allocated after the last
+ * alloc_trace_mark() that are still live: the leak candidates. Reports
+ * share static buffers, so only one may run at a time.
+ */
+void alloc_trace_report(AllocTraceWrite write, void *ctx, bool sinceMark);
+
+AllocTagStats alloc_trace_tag_stats(AllocTag tag);
+
+/**
+ * @brief Record a block the hooks do not see, such as a heap_caps region.
+ *
+ * It is charged to the caller's scope like a malloc() at the call site.
+ */
+void alloc_trace_note_alloc(void *ptr, size_t size);
+
+/**
+ * @brief Forget a block recorded with alloc_trace_note_alloc().
+ */
+void alloc_trace_note_free(void *ptr);
+
+const char *alloc_trace_tag_name(AllocTag tag);
+
+/**
+ * @brief Start the periodic Serial and SD report (device only).
+ */
+bool alloc_trace_begin();
+
+#else
+
+#define ALLOC_SCOPE(tag) ((void)0)
+
+static inline bool alloc_trace_begin() { return true; }
+static inline void alloc_trace_note_alloc(void *, size_t) {}
+static inline void alloc_trace_note_free(void *) {}
+
+#endif // ALLOC_TRACE
+
+#endif // ALLOC_TRACE_H
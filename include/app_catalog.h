@@ -0,0 +1,149 @@
+/**
+ * @file app_catalog.h
+ * @brief Persistent app catalog index for the launcher.
+ *
+ * Keeps a compact binary index of every app directory under /apps in
+ * /apps/.index so the launcher can be populated from a single sequential
+ * read instead of walking the card on every visit.
+ *
+ * Key Features:
+ * - One-read load of the whole catalog
+ * - Incremental, budgeted revalidation (only changed apps are rescanned)
+ * - Per-app firmware size, version string and CRC32 hash
+ *
+ * @note All functions must be called from the LVGL task.
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef APP_CATALOG_H
+#define APP_CATALOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define APP_CATALOG_ROOT      "/apps"      ///< Default app directory
+#define APP_CATALOG_FILE      ".index"     ///< Index file name inside the root
+#define APP_NAME_LEN          40           ///< Max app directory name (incl. NUL)
+#define APP_VERSION_LEN       12           ///< Max version string (incl. NUL)
+#define APP_BENCH_ROOT        "/bench"     ///< Synthetic trees of the launcher benchmark
+
+// AppInfo::flags
+#define APP_HAS_FIRMWARE      0x01  ///< firmware.bin present
+#define APP_HAS_BOOTLOADER    0x02  ///< bootloader.bin present
+#define APP_HAS_BOOT_APP0     0x04  ///< boot_app0.bin present
+#define APP_HAS_ICON          0x08  ///< icon.jpg present
+#define APP_HASH_VALID        0x10  ///< hash covers the current firmware.bin
+#define APP_STALE             0x80  ///< Not seen during the current revalidation pass
+
+/**
+ * @struct AppInfo
+ * @brief One catalog record, stored verbatim in the index file.
+ */
+struct AppInfo {
+    char name[APP_NAME_LEN];        ///< App directory name
+    char version[APP_VERSION_LEN];  ///< Contents of version.txt (first line), or empty
+    uint32_t fwSize;                ///< firmware.bin size in bytes
+    uint32_t totalSize;             ///< Sum of all file sizes in the app directory
+    uint32_t hash;                  ///< CRC32 of firmware.bin, if APP_HASH_VALID
+    uint16_t dirDate;               ///< App directory modify date (FAT format)
+    uint16_t dirTime;               ///< App directory modify time (FAT format)
+    uint16_t fwDate;                ///< firmware.bin modify date (FAT format)
+    uint16_t fwTime;                ///< firmware.bin modify time (FAT format)
+    uint8_t flags;                  ///< APP_HAS_* bits
+    uint8_t reserved[3];            ///< Padding, keeps records 4-byte aligned
+};
+
+/**
+ * @brief Load the catalog for @p root from its index file.
+ *
+ * Falls back to an empty catalog (and marks it for a full rebuild) when the
+ * index is missing, truncated or fails its CRC.
+ *
+ * @param root App directory (e.g. "/apps").
+ * @return true if an index file was loaded, false if the catalog is empty.
+ */
+bool app_catalog_load(const char *root = APP_CATALOG_ROOT);
+
+/**
+ * @brief Rebuild the whole catalog synchronously and save it.
+ *
+ * @param root App directory.
+ * @return true on success.
+ * @warning Blocking; scales with the number of apps. Use the budgeted
+ *          revalidation from UI code.
+ */
+bool app_catalog_rebuild(const char *root = APP_CATALOG_ROOT);
+
+/**
+ * @brief Begin a budgeted revalidation pass against the card.
+ *
+ * Must be followed by app_catalog_revalidate_step() calls until it returns true.
+ */
+void app_catalog_revalidate_begin();
+
+/**
+ * @brief Advance the current revalidation pass.
+ *
+ * Visits at most @p budget directory entries. Apps whose directory or
+ * firmware timestamps did not change are kept as-is; only new or changed
+ * apps are rescanned and rehashed.
+ *
+ * @param budget Maximum number of /apps entries to inspect in this step.
+ * @param[out] changed Set to true if the catalog contents changed (only
+ *             meaningful once the pass is finished).
+ * @return true when the pass is finished (index saved if changed).
+ */
+bool app_catalog_revalidate_step(uint16_t budget, bool *changed);
+
+/**
+ * @brief Number of apps in the catalog.
+ */
+uint16_t app_catalog_count();
+
+/**
+ * @brief Access a catalog record by position.
+ *
+ * @return Pointer to the record, or nullptr if out of range. Valid until the
+ *         next load, rebuild or finished revalidation pass.
+ */
+const AppInfo *app_catalog_get(uint16_t index);
+
+/**
+ * @brief Look up a catalog record by app directory name.
+ *
+ * @return Pointer to the record, or nullptr if not found.
+ */
+const AppInfo *app_catalog_find(const char *name);
+
+/**
+ * @struct AppCatalogBench
+ * @brief Launcher open times for one synthetic catalog size.
+ */
+struct AppCatalogBench {
+    uint16_t apps;          ///< App directories in the tree
+    uint16_t indexed;       ///< Apps the rebuilt index holds
+    uint32_t legacyMs;      ///< openNext walk of the tree, as the launcher did before the index
+    uint32_t coldMs;        ///< Index rebuild: scan and hash every app
+    uint32_t warmMs;        ///< Index load: one read
+};
+
+/**
+ * @brief Create up to @p budget missing apps of the @p apps-app benchmark tree.
+ *
+ * The tree is APP_BENCH_ROOT/apps<N>, one directory with a 4 KB
+ * firmware.bin per app, and is kept between runs. Call until it returns 0.
+ *
+ * @return Apps still to create or check, or -1 on a card error.
+ */
+int app_catalog_bench_prepare(uint16_t apps, uint16_t budget);
+
+/**
+ * @brief Time the launcher paths on the prepared @p apps-app tree.
+ *
+ * Logs the result and reloads the APP_CATALOG_ROOT catalog afterwards.
+ * @warning Blocking; the 500-app tree takes seconds.
+ */
+bool app_catalog_bench_run(uint16_t apps, AppCatalogBench &out);
+
+#endif // APP_CATALOG_H
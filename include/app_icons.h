@@ -0,0 +1,81 @@
+/**
+ * @file app_icons.h
+ * @brief Lazy, cached launcher icons decoded from icon.jpg with JPEGDEC.
+ *
+ * Icons are decoded on a background task at thumbnail scale, converted to
+ * RGB565 once and kept in a small size-bounded LRU cache. Optionally the
+ * converted pixels are written next to the app as icon.565 so later boots
+ * skip the JPEG decode entirely.
+ *
+ * @note app_icon_bind(), app_icons_poll() and app_icons_unbind_all() must be
+ *       called from the LVGL task.
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef APP_ICONS_H
+#define APP_ICONS_H
+
+#include <lvgl.h>
+#include <stdint.h>
+
+#define APP_ICON_SIZE        32                 ///< Icon edge in pixels
+#define APP_ICON_CACHE_BYTES (24U * 1024U)      ///< Pixel budget for the LRU cache
+#define APP_ICON_PERSIST     1                  ///< Write icon.565 next to the app after decoding
+
+/**
+ * @struct AppIconStats
+ * @brief Decode and cache counters.
+ */
+struct AppIconStats {
+    uint32_t hits;            ///< Binds served from the cache
+    uint32_t misses;          ///< Binds that needed a load
+    uint32_t decodes;         ///< JPEG decodes performed
+    uint32_t persistedLoads;  ///< Loads served from icon.565
+    uint32_t failures;        ///< Missing or undecodable icons
+    uint32_t decodeUsTotal;   ///< Sum of JPEG decode times
+    uint32_t decodeUsMax;     ///< Slowest JPEG decode
+};
+
+/**
+ * @brief Show the icon of @p appName on @p img, loading it if needed.
+ *
+ * On a cache hit the image source is set immediately. On a miss a background
+ * load is queued and @p img keeps its current (symbol) source until
+ * app_icons_poll() binds the result.
+ *
+ * @param appName App directory name under /apps.
+ * @param img LVGL image object (e.g. the icon of an lv_list button).
+ */
+void app_icon_bind(const char *appName, lv_obj_t *img);
+
+/**
+ * @brief Detach @p img from any icon it shows or waits for.
+ *
+ * Call when a recycled row is rebound to an app without an icon.
+ */
+void app_icon_unbind(lv_obj_t *img);
+
+/**
+ * @brief Bind icons that finished loading since the last call.
+ *
+ * @return true if any load is still in flight.
+ */
+bool app_icons_poll();
+
+/**
+ * @brief Forget every image binding (call before the owning list is cleaned).
+ */
+void app_icons_unbind_all();
+
+/**
+ * @brief Get a snapshot of the decode and cache counters.
+ */
+AppIconStats app_icons_stats();
+
+/**
+ * @brief Print decode time and cache hit rate to Serial.
+ */
+void app_icons_print_stats();
+
+#endif // APP_ICONS_H
@@ -0,0 +1,95 @@
+/**
+ * @file backup.h
+ * @brief Device backup and restore through one compressed archive on SD.
+ *
+ * A backup holds every entry of the NVS namespaces the firmware owns
+ * (settings, the device config and the saved WiFi networks) plus the
+ * configuration files listed in backup.cpp. Records are LZSS-compressed
+ * as they are produced and written straight to BACKUP_FILE, so no copy of
+ * the archive is ever held in RAM. Each record carries its own CRC32 and the
+ * end record carries the CRC32 of the whole stream.
+ *
+ * Restore reads the archive twice. The verify pass checks every CRC and
+ * notes which records differ from what the device holds now; only if the
+ * archive is intact does the second pass write those records, leaving
+ * matching ones untouched.
+ *
+ * Both operations run on a background task; poll backup_status().
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include <stdint.h>
+#include "vfs.h"
+
+#define BACKUP_DIR          VFS_SD_PREFIX "/backup"
+#define BACKUP_FILE         BACKUP_DIR "/device.bak"
+#define BACKUP_MAX_RECORDS  64      ///< Records per archive (restore tracks them in a bitmap)
+#define BACKUP_VALUE_MAX    1024    ///< Largest NVS string or blob backed up
+#define BACKUP_CHUNK        512     ///< File data moved per step
+
+/**
+ * @enum BackupOp
+ * @brief Operation of the current (or last) run.
+ */
+enum BackupOp : uint8_t {
+    BACKUP_OP_NONE = 0,
+    BACKUP_OP_CREATE,
+    BACKUP_OP_RESTORE
+};
+
+/**
+ * @enum BackupState
+ * @brief Life cycle of a run.
+ */
+enum BackupState : uint8_t {
+    BACKUP_IDLE = 0,
+    BACKUP_VERIFYING,   ///< Restore: checking the archive, nothing written yet
+    BACKUP_RUNNING,
+    BACKUP_DONE,
+    BACKUP_FAILED
+};
+
+/**
+ * @struct BackupStatus
+ * @brief Snapshot of the run for the UI.
+ */
+struct BackupStatus {
+    BackupOp op;
+    BackupState state;
+    uint16_t records;       ///< Records written (create) or found (restore)
+    uint16_t changed;       ///< Restore: records that differed and were written
+    uint32_t rawBytes;      ///< Uncompressed stream size
+    uint32_t archiveBytes;  ///< Compressed size on SD
+    uint32_t verifyMs;      ///< Restore: duration of the verify pass
+    uint32_t elapsedMs;
+    char error[48];         ///< Reason for BACKUP_FAILED
+    uint32_t generation;    ///< Changes on every update
+};
+
+/**
+ * @brief Start writing a new archive to BACKUP_FILE.
+ *
+ * The previous archive is only replaced once the new one is complete.
+ *
+ * @return false if a run is already in progress or the task can't start.
+ */
+bool backup_create_start();
+
+/**
+ * @brief Start restoring from BACKUP_FILE.
+ */
+bool backup_restore_start();
+
+bool backup_busy();
+
+/**
+ * @brief Current snapshot; never blocks.
+ */
+BackupStatus backup_status();
+
+#endif // BACKUP_H
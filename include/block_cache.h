@@ -0,0 +1,136 @@
+/**
+ * @file block_cache.h
+ * @brief Sector cache with read-ahead and write-behind between SdFat and the card.
+ *
+ * BlockCache is itself an FsBlockDevice, so the SdFat volume is mounted on
+ * top of it and every file system layer above (SD_utils, VFS, catalog,
+ * explorer) shares one cache without knowing about it.
+ *
+ * - Reads: LRU cache of whole sectors. Two consecutive sector reads arm a
+ *   sequential detector; the next miss then fetches SD_CACHE_READAHEAD
+ *   sectors in one multi-block transfer.
+ * - Writes: single-sector writes stay dirty in the cache and are written
+ *   back in sorted, coalesced multi-block runs when SD_CACHE_WRITE_BATCH
+ *   sectors are dirty, when a dirty line is evicted, or at a flush point.
+ * - Flush points: syncDevice(), which SdFat calls from file sync/close and
+ *   volume cache syncs, so a file is as durable after close() as before.
+ *
+ * Large transfers (at least SD_CACHE_BYPASS sectors) go straight to the
+ * card after dirty lines in their range are written back or dropped.
+ *
+ * Requires USE_BLOCK_DEVICE_INTERFACE=1 so FsBlockDevice is virtual.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <SdFat.h>
+
+#ifndef SD_CACHE_SECTORS
+#define SD_CACHE_SECTORS      32   ///< Cache lines (512 bytes each)
+#endif
+#define SD_CACHE_READAHEAD    8    ///< Sectors fetched on a sequential miss
+#define SD_CACHE_WRITE_BATCH  8    ///< Dirty sectors that trigger write-back
+#define SD_CACHE_BYPASS       8    ///< Transfers this large skip the cache
+
+/**
+ * @struct BlockCacheStats
+ * @brief Counters since begin() or resetStats().
+ */
+struct BlockCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t readAheadSectors;   ///< Sectors fetched speculatively
+    uint32_t readAheadHits;      ///< Of those, sectors later read
+    uint32_t writesAbsorbed;     ///< Sector writes that stayed in the cache
+    uint32_t writeBacks;         ///< Multi-block runs written to the card
+    uint32_t sectorsWritten;     ///< Sectors written to the card by write-back
+    uint32_t bypassReads;
+    uint32_t bypassWrites;
+    uint32_t flushes;            ///< Explicit or sync-triggered flushes
+};
+
+/**
+ * @class BlockCache
+ * @brief Write-back sector cache wrapping another block device.
+ */
+class BlockCache : public FsBlockDeviceInterface {
+public:
+    BlockCache() = default;
+    ~BlockCache() override { end(); }
+    BlockCache(const BlockCache &) = delete;
+    BlockCache &operator=(const BlockCache &) = delete;
+
+    /**
+     * @brief Start caching @p dev with @p lines sectors of memory.
+     */
+    bool begin(FsBlockDevice *dev, uint16_t lines = SD_CACHE_SECTORS);
+
+    /**
+     * @brief Write back all dirty sectors.
+     */
+    bool flush();
+
+    /**
+     * @brief Flush, then forget every cached sector (e.g. after raw card I/O).
+     */
+    bool invalidate();
+
+    /**
+     * @brief Forget every cached sector without writing anything back, then end().
+     *
+     * For a card that was pulled or swapped: its dirty sectors belong to a
+     * file system that is no longer there.
+     * @return Number of dirty sectors dropped.
+     */
+    uint16_t discard();
+
+    bool active() const { return m_dev != nullptr; }
+    FsBlockDevice *device() const { return m_dev; }
+    const BlockCacheStats &stats() const { return m_stats; }
+    void resetStats() { m_stats = BlockCacheStats(); }
+
+    // FsBlockDeviceInterface
+    void end() override;
+    bool isBusy() override { return m_dev && m_dev->isBusy(); }
+    bool readSector(uint32_t sector, uint8_t *dst) override;
+    bool readSectors(uint32_t sector, uint8_t *dst, size_t ns) override;
+    uint32_t sectorCount() override { return m_dev ? m_dev->sectorCount() : 0; }
+    bool syncDevice() override;
+    bool writeSector(uint32_t sector, const uint8_t *src) override;
+    bool writeSectors(uint32_t sector, const uint8_t *src, size_t ns) override;
+
+private:
+    struct Line {
+        uint32_t sector;
+        uint32_t lastUse;
+        bool valid;
+        bool dirty;
+        bool prefetched;   ///< Filled by read-ahead and not read yet
+    };
+
+    int find(uint32_t sector);
+    int victim();
+    uint8_t *data(int line) { return m_data + (size_t)line * 512; }
+    bool fetch(uint32_t sector, uint32_t count);
+    bool writeBack();
+    bool flushRange(uint32_t sector, size_t ns, bool drop);
+
+    FsBlockDevice *m_dev = nullptr;
+    Line *m_lines = nullptr;
+    uint8_t *m_data = nullptr;
+    uint8_t *m_stage = nullptr;   ///< Read-ahead / write-back staging buffer
+    uint16_t m_count = 0;
+    uint16_t m_dirty = 0;
+    uint32_t m_clock = 0;
+    uint32_t m_nextSeq = UINT32_MAX;  ///< Sector that would continue the last read
+    uint8_t m_seqRun = 0;
+    BlockCacheStats m_stats = {};
+};
+
+#endif // BLOCK_CACHE_H
@@ -0,0 +1,62 @@
+/**
+ * @file boot.h
+ * @brief Dependency-ordered, concurrent start-up and the boot timeline.
+ *
+ * setup() describes start-up as a table of stages, each naming the stages
+ * it depends on. boot_run() gives every stage its own short-lived task that
+ * waits for its dependencies, so independent stages (NVS config, the I2C
+ * bus, the display) overlap and the UI can draw its first frame while
+ * networking is still coming up.
+ *
+ * Every stage's start and end, plus milestones reported with boot_mark()
+ * (first frame, WiFi, NTP), are recorded against the time since reset and
+ * printed once by boot_print_timeline().
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BOOT_MAX_STAGES        16
+#define BOOT_MAX_EVENTS        24     ///< Stages plus milestones kept in the timeline
+#define BOOT_STAGE_STACK       4096   ///< Stack of a stage task unless the stage asks for more
+
+#define BOOT_DEP(id)           (1UL << (id))
+
+/**
+ * @struct BootStage
+ * @brief One step of start-up.
+ */
+struct BootStage {
+    const char *name;
+    bool (*run)();          ///< false is recorded in the timeline; dependents still run
+    uint32_t deps;          ///< BOOT_DEP() of every stage that must finish first
+    uint8_t core;
+    uint16_t stack;         ///< 0: BOOT_STAGE_STACK
+};
+
+/**
+ * @brief Run @p count stages and return when all of them have finished.
+ *
+ * Dependencies are indices into @p stages. The table must outlive the call.
+ *
+ * @return false if a stage failed or its task could not be started.
+ */
+bool boot_run(const BootStage *stages, size_t count);
+
+/**
+ * @brief Record a milestone at the current time; safe from any task.
+ */
+void boot_mark(const char *name);
+
+/**
+ * @brief Print the timeline to Serial; only the first call prints.
+ */
+void boot_print_timeline();
+
+#endif // BOOT_H
@@ -1,15 +1,53 @@
+/**
+ * @file config.h
+ * @brief Typed device configuration stored in NVS.
+ *
+ * The configuration is one fixed-size struct kept as a single NVS blob next
+ * to a schema version. Loading it is one blob read into g_config; nothing
+ * is allocated and every field is a plain NUL-terminated char array, so
+ * any task can read it without touching the heap.
+ *
+ * On the first boot without an NVS copy the legacy JSON file is imported
+ * once and saved to NVS; the file is not read again after that.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
 #pragma once
 #include <Arduino.h>
 
+#define CONFIG_SCHEMA_VERSION 1
+#define CONFIG_NAMESPACE      "config"
+#define CONFIG_LEGACY_JSON    "/flash/config/device_config.json"
+
+#define CONFIG_SSID_LEN       33    ///< 32 bytes per 802.11 + NUL
+#define CONFIG_PASSWORD_LEN   65    ///< 64 hex characters for a raw PSK + NUL
+#define CONFIG_ID_LEN         32
+#define CONFIG_NAME_LEN       64
+#define CONFIG_VERSION_LEN    16
+
 struct DeviceConfig {
-    String wifi_ssid;
-    String wifi_password;
-    String deviceId;
-    String department;
-    String stationId;
-    String location;
-    String firmwareVersion;
+    char wifi_ssid[CONFIG_SSID_LEN];
+    char wifi_password[CONFIG_PASSWORD_LEN];
+    char deviceId[CONFIG_ID_LEN];
+    char department[CONFIG_NAME_LEN];
+    char stationId[CONFIG_ID_LEN];
+    char location[CONFIG_NAME_LEN];
+    char firmwareVersion[CONFIG_VERSION_LEN];
 };
 
 extern DeviceConfig g_config;
-bool loadConfig(const char* path = "/config/device_config.json"); 
\ No newline at end of file
+
+/**
+ * @brief Load g_config from NVS, importing @p legacyPath on first boot.
+ *
+ * @param legacyPath JSON file to import when NVS holds no configuration.
+ * @return true if a configuration was loaded or imported; g_config is all
+ *         empty strings otherwise.
+ */
+bool loadConfig(const char *legacyPath = CONFIG_LEGACY_JSON);
+
+/**
+ * @brief Write g_config to NVS.
+ */
+bool saveConfig();
@@ -0,0 +1,121 @@
+/**
+ * @file dir_cache.h
+ * @brief In-memory LRU cache of directory listings for the file explorer.
+ *
+ * Listings are kept as EntryStore copies keyed by normalized path and bounded
+ * both by slot count and by total bytes. A cached listing is revalidated on
+ * lookup against a cheap signature of the directory itself (first sector,
+ * size and modify time), so a hit costs one path open instead of a full
+ * enumeration.
+ *
+ * FAT does not reliably touch a directory's metadata when entries inside it
+ * change, so anything that creates, deletes or renames entries must call
+ * dir_cache_invalidate() or dir_cache_note_write() as well.
+ *
+ * A background task prefetches the child directory the user is most likely
+ * to open next: the one last opened from the same parent, otherwise the
+ * first subdirectory of the listing.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef DIR_CACHE_H
+#define DIR_CACHE_H
+
+#include <stdint.h>
+#include "SD_utils.h"
+#include "entry_store.h"
+
+#define DIR_CACHE_SLOTS        8             ///< Maximum cached listings
+#define DIR_CACHE_BYTES        (48 * 1024)   ///< Budget for all cached listings
+#define DIR_CACHE_PATH_LEN     128           ///< Longest cacheable path
+#define DIR_CACHE_PREFETCH_MAX 512           ///< Larger directories are not prefetched
+
+/**
+ * @struct DirSig
+ * @brief Cheap identity of a directory's current state.
+ */
+struct DirSig {
+    uint32_t firstSector;
+    uint32_t size;
+    uint16_t date;
+    uint16_t time;
+};
+
+/**
+ * @struct DirCacheStats
+ * @brief Counters since boot.
+ */
+struct DirCacheStats {
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t stale;          ///< Entries dropped because the signature changed
+    uint32_t evictions;
+    uint32_t prefetches;     ///< Listings loaded by the prefetch task
+    uint32_t prefetchHits;   ///< Hits served by a prefetched listing
+};
+
+/**
+ * @brief Read the signature of an open directory.
+ */
+bool dir_cache_signature(SdFile &dir, DirSig &sig);
+
+/**
+ * @brief Look up the listing of @p path.
+ *
+ * @param path Directory path.
+ * @param dir The same directory, already open (used for revalidation).
+ * @param[out] out Receives a copy of the listing on a hit.
+ * @return true on a fresh hit.
+ */
+bool dir_cache_get(const char *path, SdFile &dir, EntryStore &out);
+
+/**
+ * @brief Store a complete listing of @p path.
+ *
+ * @param sig Signature taken when the directory was opened for listing.
+ */
+void dir_cache_put(const char *path, const DirSig &sig, const EntryStore &listing);
+
+/**
+ * @brief Drop the cached listing of @p path, if any.
+ */
+void dir_cache_invalidate(const char *path);
+
+/**
+ * @brief Drop the listing of the directory containing @p filePath.
+ *
+ * For modules that create or remove files on the card.
+ */
+void dir_cache_note_write(const char *filePath);
+
+/**
+ * @brief Drop every cached listing (e.g. after the card was remounted).
+ */
+void dir_cache_invalidate_all();
+
+/**
+ * @brief Record that the user opened @p child from @p parent.
+ */
+void dir_cache_note_visit(const char *parent, const char *child);
+
+/**
+ * @brief Queue a background prefetch of the likely next child of @p path.
+ *
+ * @param path Directory currently shown.
+ * @param listing Its complete listing.
+ */
+void dir_cache_prefetch_next(const char *path, const EntryStore &listing);
+
+/**
+ * @brief Snapshot of the cache counters.
+ */
+DirCacheStats dir_cache_stats();
+
+/**
+ * @brief Print hit rate and memory use to Serial.
+ */
+void dir_cache_print_stats();
+
+#endif // DIR_CACHE_H
@@ -0,0 +1,106 @@
+/**
+ * @file entry_store.h
+ * @brief Compact directory entry store kept outside the LVGL heap.
+ *
+ * Names live back-to-back in a single string arena and each entry is a fixed
+ * 16-byte record, so a 1,000-entry directory costs roughly 16 KB plus the
+ * name bytes instead of 68 bytes per FileInfo.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef ENTRY_STORE_H
+#define ENTRY_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ENTRY_DIR       0x01  ///< Entry is a directory
+#define ENTRY_HIDDEN    0x02  ///< Entry has the hidden attribute
+
+/**
+ * @struct EntryRec
+ * @brief Fixed-size record describing one directory entry.
+ */
+struct EntryRec {
+    uint32_t nameOff;   ///< Offset of the NUL-terminated name in the arena
+    uint32_t size;      ///< File size in bytes (0 for directories)
+    uint16_t date;      ///< Modify date (FAT format)
+    uint16_t time;      ///< Modify time (FAT format)
+    uint8_t nameLen;    ///< Name length without the NUL
+    uint8_t flags;      ///< ENTRY_* bits
+    uint16_t reserved;  ///< Padding
+};
+
+/**
+ * @class EntryStore
+ * @brief Growable arena + record array for directory listings.
+ *
+ * Memory comes from the system heap (malloc), never from the LVGL pool.
+ */
+class EntryStore {
+public:
+    EntryStore() = default;
+    ~EntryStore();
+    EntryStore(const EntryStore &) = delete;
+    EntryStore &operator=(const EntryStore &) = delete;
+
+    /**
+     * @brief Append an entry.
+     * @return false if out of memory (the store is left unchanged).
+     */
+    bool add(const char *name, uint32_t size, uint8_t flags, uint16_t date = 0, uint16_t time = 0);
+
+    /**
+     * @brief Replace the contents with a copy of @p other.
+     * @return false if out of memory (the store is left empty).
+     */
+    bool assign(const EntryStore &other);
+
+    /**
+     * @brief Exchange contents with @p other without copying.
+     */
+    void swap(EntryStore &other);
+
+    /**
+     * @brief Drop all entries but keep the allocated buffers for reuse.
+     */
+    void clear();
+
+    /**
+     * @brief Release all memory.
+     */
+    void release();
+
+    /**
+     * @brief Pre-allocate room for @p entries entries and @p nameBytes name bytes.
+     */
+    bool reserve(uint32_t entries, uint32_t nameBytes);
+
+    uint32_t count() const { return m_count; }
+    const EntryRec &rec(uint32_t i) const { return m_recs[i]; }
+    const char *name(uint32_t i) const { return m_arena + m_recs[i].nameOff; }
+    uint32_t size(uint32_t i) const { return m_recs[i].size; }
+    bool isDir(uint32_t i) const { return m_recs[i].flags & ENTRY_DIR; }
+
+    /**
+     * @brief Bytes of heap currently held by the store.
+     */
+    size_t footprint() const { return m_arenaCap + m_cap * sizeof(EntryRec); }
+
+    /**
+     * @brief Bytes actually used by names and records (ignores spare capacity).
+     */
+    size_t usedBytes() const { return m_arenaUsed + m_count * sizeof(EntryRec); }
+
+private:
+    char *m_arena = nullptr;
+    uint32_t m_arenaUsed = 0;
+    uint32_t m_arenaCap = 0;
+    EntryRec *m_recs = nullptr;
+    uint32_t m_count = 0;
+    uint32_t m_cap = 0;
+};
+
+#endif // ENTRY_STORE_H
@@ -0,0 +1,105 @@
+/**
+ * @file entry_view.h
+ * @brief Sorted and filtered view over an EntryStore.
+ *
+ * The view is a permutation of 16-bit entry indices, so sorting or filtering
+ * a listing never moves or copies names. The store is the compact name
+ * index (one string arena plus fixed records); the view costs 4 bytes per
+ * entry on top of it.
+ *
+ * Entries appended to the store after the last sort are picked up by sync()
+ * and shown at the end in directory order until the next sort().
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef ENTRY_VIEW_H
+#define ENTRY_VIEW_H
+
+#include <stdint.h>
+#include "entry_store.h"
+
+#define ENTRY_VIEW_MAX        65535  ///< Entries beyond this are not shown
+#define ENTRY_VIEW_FILTER_LEN 32     ///< Longest filter prefix
+
+/**
+ * @enum EntrySortKey
+ * @brief Sort orders. Directories always come first except for ENTRY_SORT_NONE.
+ */
+enum EntrySortKey {
+    ENTRY_SORT_NONE = 0,  ///< Directory (FAT) order
+    ENTRY_SORT_NAME,      ///< Name, case-insensitive, ascending
+    ENTRY_SORT_SIZE,      ///< Size, largest first
+    ENTRY_SORT_DATE,      ///< Modify time, newest first
+    ENTRY_SORT_COUNT
+};
+
+/**
+ * @class EntryView
+ * @brief Permutation index with sort and incremental prefix filter.
+ *
+ * Memory comes from the system heap (malloc), never from the LVGL pool.
+ */
+class EntryView {
+public:
+    EntryView() = default;
+    ~EntryView();
+    EntryView(const EntryView &) = delete;
+    EntryView &operator=(const EntryView &) = delete;
+
+    /**
+     * @brief Point the view at @p store and drop all indices (keeps the filter).
+     */
+    void reset(const EntryStore *store);
+
+    /**
+     * @brief Pick up entries appended to the store since the last call.
+     * @return false if the view is truncated: some store entries are not
+     *         indexed (out of memory, or more than ENTRY_VIEW_MAX).
+     */
+    bool sync();
+
+    /**
+     * @brief Reorder all entries by @p key and reapply the filter.
+     */
+    void sort(EntrySortKey key);
+
+    /**
+     * @brief Show only entries whose name starts with @p prefix (case-insensitive).
+     *
+     * When @p prefix extends the current filter only the visible entries are
+     * rescanned, so typing one character at a time stays cheap.
+     */
+    void setFilter(const char *prefix);
+
+    uint32_t count() const { return m_visibleCount; }
+    uint32_t total() const { return m_count; }
+    uint32_t at(uint32_t i) const { return m_visible[i]; }
+    EntrySortKey sortKey() const { return m_key; }
+    const char *filter() const { return m_filter; }
+    bool truncated() const { return m_truncated; }     ///< Since the last reset()
+
+    /**
+     * @brief Release all memory.
+     */
+    void release();
+
+private:
+    bool grow(uint32_t entries);
+    bool matches(uint32_t index) const;
+    void refilter(bool narrow);
+
+    const EntryStore *m_store = nullptr;
+    uint16_t *m_order = nullptr;    ///< All entries in sort order
+    uint16_t *m_visible = nullptr;  ///< Entries of m_order that match the filter
+    uint32_t m_count = 0;
+    uint32_t m_visibleCount = 0;
+    uint32_t m_cap = 0;
+    EntrySortKey m_key = ENTRY_SORT_NONE;
+    char m_filter[ENTRY_VIEW_FILTER_LEN + 1] = "";
+    uint8_t m_filterLen = 0;
+    bool m_truncated = false;
+};
+
+#endif // ENTRY_VIEW_H
@@ -18,8 +18,6 @@ typedef struct _lv_event_t lv_event_t;
 
 extern TFT_eSPI tft;
 extern SdFat sd;
-static bool is_initialized = false;
-static char current_path[128] = "/"; // We all start at the root, if you know what I mean
 /**
  * @brief Shows an error message on the display.
  * @param msg The error message to display.
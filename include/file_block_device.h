@@ -0,0 +1,121 @@
+/**
+ * @file file_block_device.h
+ * @brief SdFat block device backed by a card image file (host builds only).
+ *
+ * Lets the SdFat-based code in SD_utils, vfs, explorer and OTA_utils mount
+ * a FAT32 image on Linux instead of a card on SPI, so directory walks and
+ * file streaming can be profiled off-device. Each command and each sector
+ * can be delayed to mimic a slow card.
+ *
+ * Host builds must define USE_BLOCK_DEVICE_INTERFACE=1 so that SdFat's
+ * FsBlockDevice is the virtual interface rather than the SPI card class.
+ * Tests that only move sectors build against test/host/stubs/SdFat.h,
+ * which declares that interface and nothing else.
+ *
+ * @code
+ *   FileBlockDevice dev;
+ *   dev.open("card.img");
+ *   dev.setLatency(FILE_BLOCK_LATENCY_SPI_20MHZ);
+ *   file_block_device_mount(&dev);   // Global `sd` now reads the image
+ *   list_files_in_dir(...);
+ * @endcode
+ *
+ * test/host/file_block_device_test.cpp and sd_image_test.cpp drive it
+ * (make -C test/host run).
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef FILE_BLOCK_DEVICE_H
+#define FILE_BLOCK_DEVICE_H
+
+#if !defined(ARDUINO)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <SdFat.h>
+
+/**
+ * @struct BlockLatency
+ * @brief Delays added to every transfer, in microseconds.
+ */
+struct BlockLatency {
+    uint32_t commandUs;      ///< Per read/write call (command + card busy)
+    uint32_t readSectorUs;   ///< Per sector read
+    uint32_t writeSectorUs;  ///< Per sector written
+    uint32_t syncUs;         ///< Per syncDevice()
+};
+
+/// No added delay
+#define FILE_BLOCK_LATENCY_NONE         BlockLatency{0, 0, 0, 0}
+/// Roughly a budget card on a 20 MHz SPI bus
+#define FILE_BLOCK_LATENCY_SPI_20MHZ    BlockLatency{150, 210, 240, 2000}
+/// A worn card with slow programming
+#define FILE_BLOCK_LATENCY_SLOW_CARD    BlockLatency{800, 260, 900, 25000}
+
+/**
+ * @struct BlockDeviceStats
+ * @brief Transfer counters since open() or resetStats().
+ */
+struct BlockDeviceStats {
+    uint32_t readCalls;
+    uint32_t writeCalls;
+    uint32_t syncCalls;
+    uint64_t sectorsRead;
+    uint64_t sectorsWritten;
+    uint64_t injectedUs;     ///< Total delay added by the latency model
+};
+
+/**
+ * @class FileBlockDevice
+ * @brief FsBlockDeviceInterface over a raw image file.
+ */
+class FileBlockDevice : public FsBlockDeviceInterface {
+public:
+    FileBlockDevice() = default;
+    ~FileBlockDevice() override;
+    FileBlockDevice(const FileBlockDevice &) = delete;
+    FileBlockDevice &operator=(const FileBlockDevice &) = delete;
+
+    /**
+     * @brief Open an image file (size must be a multiple of 512).
+     * @param readOnly Reject writes instead of modifying the image.
+     */
+    bool open(const char *path, bool readOnly = false);
+
+    void setLatency(const BlockLatency &latency) { m_latency = latency; }
+    const BlockDeviceStats &stats() const { return m_stats; }
+    void resetStats();
+
+    // FsBlockDeviceInterface
+    void end() override;
+    bool isBusy() override { return false; }
+    bool readSector(uint32_t sector, uint8_t *dst) override;
+    bool readSectors(uint32_t sector, uint8_t *dst, size_t ns) override;
+    uint32_t sectorCount() override { return m_sectors; }
+    bool syncDevice() override;
+    bool writeSector(uint32_t sector, const uint8_t *src) override;
+    bool writeSectors(uint32_t sector, const uint8_t *src, size_t ns) override;
+
+private:
+    void delay(uint32_t us);
+
+    int m_fd = -1;
+    bool m_readOnly = false;
+    uint32_t m_sectors = 0;
+    BlockLatency m_latency = FILE_BLOCK_LATENCY_NONE;
+    BlockDeviceStats m_stats = {};
+};
+
+/**
+ * @brief Mount @p dev (the image, or a BlockCache over it) as the global `sd` volume.
+ *
+ * sd.card() stays null, so nothing that needs the SPI card (CID, clock
+ * tuning) applies. Only defined when the real SdFat is linked.
+ */
+bool file_block_device_mount(FsBlockDevice *dev);
+
+#endif // !ARDUINO
+
+#endif // FILE_BLOCK_DEVICE_H
@@ -0,0 +1,135 @@
+/**
+ * @file file_jobs.h
+ * @brief Background copy, move and recursive delete jobs on the SD card.
+ *
+ * One job runs at a time on its own task. File data moves in large,
+ * sector-aligned chunks into a pre-allocated (contiguous where possible)
+ * destination, and the SD lock is released between chunks so the explorer
+ * and other SD users stay responsive.
+ *
+ * Jobs are journaled in FILE_JOB_JOURNAL: the operation, its paths, how many
+ * files of the walk are finished and how far the current file got. A job
+ * interrupted by a reset resumes from its last checkpoint on the next mount
+ * (file_job_resume()). Cancelling removes the partly copied file and the
+ * journal; finished files stay.
+ *
+ * Paths are SdFat paths on the mounted card ("/dir/file").
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef FILE_JOBS_H
+#define FILE_JOBS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FILE_JOB_JOURNAL      "/.filejob.jnl"
+#define FILE_JOB_PATH_LEN     192
+#define FILE_JOB_MAX_DEPTH    8                    ///< Directory levels below the source
+#define FILE_JOB_CHUNK        (32UL * 1024)        ///< Bytes per transfer (64 sectors)
+#define FILE_JOB_CHECKPOINT   (256UL * 1024)       ///< Journal interval within a file
+#define FILE_JOB_BENCH_BYTES  (2UL * 1024 * 1024)  ///< Size of the copy benchmark file
+
+/**
+ * @enum FileJobOp
+ * @brief What a job does.
+ */
+enum FileJobOp : uint8_t {
+    FILE_JOB_NONE = 0,
+    FILE_JOB_COPY,      ///< Copy a file or tree into a directory
+    FILE_JOB_MOVE,      ///< Rename, or copy + delete if the rename fails
+    FILE_JOB_DELETE,    ///< Remove a file or tree
+    FILE_JOB_BENCH      ///< Copy throughput against raw card rates
+};
+
+/**
+ * @enum FileJobState
+ * @brief Life cycle of the current (or last) job.
+ */
+enum FileJobState : uint8_t {
+    FILE_JOB_IDLE = 0,
+    FILE_JOB_SCANNING,  ///< Counting files and bytes
+    FILE_JOB_RUNNING,
+    FILE_JOB_DONE,
+    FILE_JOB_FAILED,
+    FILE_JOB_CANCELLED
+};
+
+/**
+ * @struct FileJobStatus
+ * @brief Snapshot of the job for the UI.
+ */
+struct FileJobStatus {
+    FileJobOp op;
+    FileJobState state;
+    bool resumed;           ///< Picked up from the journal after a reset
+    char name[64];          ///< File being processed
+    uint32_t filesDone;
+    uint32_t filesTotal;
+    uint64_t bytesDone;
+    uint64_t bytesTotal;
+    uint32_t kbPerSec;      ///< Recent throughput (0 until measurable)
+    uint32_t etaSec;        ///< Estimated remaining time (0 if unknown)
+    uint32_t elapsedMs;
+    uint32_t generation;    ///< Changes on every update
+};
+
+/**
+ * @struct FileJobBench
+ * @brief Result of the copy benchmark.
+ */
+struct FileJobBench {
+    bool valid;
+    uint32_t rawReadKBs;    ///< Sequential read rate of the card
+    uint32_t rawWriteKBs;   ///< Sequential write rate of the card
+    uint32_t boundKBs;      ///< Best possible copy rate: every byte read and written once
+    uint32_t copyKBs;       ///< Measured copy job rate
+};
+
+/**
+ * @brief Start a job.
+ *
+ * @param op FILE_JOB_COPY, FILE_JOB_MOVE or FILE_JOB_DELETE.
+ * @param src File or directory to act on.
+ * @param dstDir Directory to copy or move into (ignored for delete).
+ * @return false if a job is running or the paths are invalid.
+ */
+bool file_job_start(FileJobOp op, const char *src, const char *dstDir);
+
+/**
+ * @brief Resume a job left in the journal. Call after the card is mounted.
+ * @return true if a job was resumed.
+ */
+bool file_job_resume();
+
+/**
+ * @brief Ask the running job to stop at the next chunk.
+ */
+void file_job_cancel();
+
+/**
+ * @brief True while a job (or the benchmark) is running.
+ */
+bool file_job_busy();
+
+/**
+ * @brief Current snapshot; never touches the card.
+ */
+FileJobStatus file_job_status();
+
+/**
+ * @brief Start the copy benchmark as a job.
+ *
+ * Measures raw sequential rates on a scratch file, then copies that file
+ * with the job's own copy path and reports both.
+ */
+bool file_job_bench_start();
+
+/**
+ * @brief Result of the last completed benchmark.
+ */
+FileJobBench file_job_bench_result();
+
+#endif // FILE_JOBS_H
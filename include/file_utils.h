@@ -1,44 +1,49 @@
 /**
  * @file file_utils.h
- * @brief File utility class for reading and writing files on SD card.
+ * @brief File utility class for reading and writing whole files.
  *
- * Provides static methods for reading and writing files using Arduino SD library.
+ * Provides static methods on top of the VFS layer, so paths use the common
+ * namespace: /sd/... for the SD card, /flash/... for internal flash.
  */
 #ifndef FILE_UTILS_H
 #define FILE_UTILS_H
 
 #include <Arduino.h>
-#include <FS.h>
-#include <SD.h>
+#include "vfs.h"
 
 class FileUtils {
 public:
     /**
-     * @brief Reads the contents of a file from the SD card.
-     * @param path Path to the file to read.
+     * @brief Reads the contents of a file.
+     * @param path VFS path of the file to read.
      * @return The file contents as a String, or an empty String if the file cannot be opened.
      */
     static String readFile(const char* path) {
-        File file = SD.open(path, FILE_READ);
-        if (!file) return "";
-        String content = file.readString();
-        file.close();
+        VfsFile file;
+        if (!file.open(path, VFS_READ)) return "";
+        String content;
+        content.reserve(file.size());
+        char buf[128];
+        int n;
+        while ((n = file.read(buf, sizeof(buf) - 1)) > 0) {
+            buf[n] = '\0';
+            content += buf;
+        }
         return content;
     }
     /**
-     * @brief Writes data to a file on the SD card.
-     * @param path Path to the file to write.
+     * @brief Writes data to a file.
+     * @param path VFS path of the file to write.
      * @param data Data to write to the file.
      * @param overwrite If true, overwrites the file; if false, appends to the file.
      * @return True if the write was successful, false otherwise.
      */
     static bool writeFile(const char* path, const char* data, bool overwrite = true) {
-        File file = SD.open(path, overwrite ? FILE_WRITE : FILE_APPEND);
-        if (!file) return false;
-        file.print(data);
-        file.close();
-        return true;
+        VfsFile file;
+        if (!file.open(path, overwrite ? VFS_WRITE : VFS_APPEND)) return false;
+        bool ok = file.print(data) == strlen(data);
+        return file.close() && ok;
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,42 @@
+/**
+ * @file file_viewer.h
+ * @brief Streaming viewer for text and JPEG files on the SD card.
+ *
+ * Text is paged through a fixed window of seeked reads, so opening a file
+ * costs one small read whatever its size. JPEGs are decoded with JPEGDEC
+ * and every MCU strip is pushed straight to the panel; there is no frame
+ * buffer. Both paths log time-to-first-pixel and peak heap use.
+ *
+ * @note Must be called from the LVGL task.
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef FILE_VIEWER_H
+#define FILE_VIEWER_H
+
+#include <stdint.h>
+
+#define VIEWER_TEXT_COLS    29      ///< Characters per row (8 px monospace font)
+#define VIEWER_TEXT_ROWS    24      ///< Rows per page
+#define VIEWER_TEXT_WINDOW  1024    ///< Bytes read per page; covers a full page of wrapped rows
+
+/**
+ * @brief Open @p path in the viewer matching its extension.
+ *
+ * .jpg/.jpeg files are shown as images, anything else as text. Closing the
+ * viewer returns to the file explorer.
+ *
+ * @param path SD path of the file.
+ */
+void file_viewer_open(const char *path);
+
+/**
+ * @brief Close the file the text viewer pages through, if any.
+ *
+ * Called by the mount task before it unmounts; the pager then shows empty
+ * pages until it is closed. Safe from any task.
+ */
+void file_viewer_close_file();
+
+#endif // FILE_VIEWER_H
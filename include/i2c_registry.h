@@ -0,0 +1,75 @@
+/**
+ * @file i2c_registry.h
+ * @brief Registry of the devices on the I2C bus, remembered in NVS.
+ *
+ * Boot no longer probes all 126 addresses. i2c_registry_begin() probes only
+ * the addresses found by the last full scan, which NVS keeps as a 128-bit
+ * map, and a full scan then runs on a background task a few seconds later
+ * to pick up devices that were added or removed. The map is only rewritten
+ * when the full scan finds something different.
+ *
+ * Other modules ask i2c_registry_present() instead of probing the bus
+ * themselves.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef I2C_REGISTRY_H
+#define I2C_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define I2C_REGISTRY_NAMESPACE      "i2c"
+#define I2C_REGISTRY_ADDR_FIRST     1
+#define I2C_REGISTRY_ADDR_LAST      126
+#define I2C_REGISTRY_SCAN_DELAY_MS  5000    ///< Background full scan starts this long after begin
+
+/**
+ * @struct I2cRegistryStatus
+ * @brief Snapshot of the registry.
+ */
+struct I2cRegistryStatus {
+    uint8_t count;              ///< Devices currently known to answer
+    bool scanning;              ///< A full scan is running
+    bool scanned;               ///< A full scan has completed since boot
+    uint8_t knownAtBoot;        ///< Addresses in the stored map
+    uint32_t quickProbeUs;      ///< Time to probe the stored addresses at boot
+    uint32_t fullScanMs;        ///< Duration of the last full scan
+    uint32_t generation;        ///< Changes whenever the device map changes
+};
+
+/**
+ * @brief Probe the stored addresses and schedule a background full scan.
+ *
+ * Call once after Wire is started (initI2C()).
+ *
+ * @return false if the background scan can't be started; the quick probe
+ *         result is still available.
+ */
+bool i2c_registry_begin();
+
+/**
+ * @brief Run a full scan of every address.
+ *
+ * @param wait true: scan on the calling task and return when done.
+ *             false: scan on a background task.
+ * @return false if a scan is already running or the task can't start.
+ */
+bool i2c_registry_scan(bool wait);
+
+/**
+ * @brief true if a device answered at @p addr in the latest probe or scan.
+ */
+bool i2c_registry_present(uint8_t addr);
+
+/**
+ * @brief Copy the addresses of present devices, lowest first.
+ * @return Number of addresses copied.
+ */
+size_t i2c_registry_devices(uint8_t *out, size_t max);
+
+I2cRegistryStatus i2c_registry_status();
+
+#endif // I2C_REGISTRY_H
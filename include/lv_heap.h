@@ -0,0 +1,87 @@
+/**
+ * @file lv_heap.h
+ * @brief LVGL heap: a TLSF allocator that grows into the internal heap.
+ *
+ * LVGL allocates through lv_heap_malloc/free/realloc (LV_MEM_CUSTOM in
+ * lv_conf.h). The heap starts with a static pool of LV_HEAP_INITIAL_SIZE
+ * bytes, the size of LVGL's old built-in pool. When a request does not fit,
+ * another region of at least LV_HEAP_GROW_BYTES is taken from heap_caps
+ * with LV_HEAP_CAPS and kept for the rest of the run, so a heavy screen no
+ * longer fails outright.
+ *
+ * Screens call lv_heap_screen() before they build. That closes the previous
+ * screen's window and logs its high-water mark, largest free block and
+ * fragmentation, and keeps the worst figures per screen name.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef LV_HEAP_H
+#define LV_HEAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LV_HEAP_INITIAL_SIZE  (48U * 1024U)   ///< Static pool used before any growth
+#define LV_HEAP_GROW_BYTES    (16U * 1024U)   ///< Minimum size of a grown region
+#define LV_HEAP_MAX_SCREENS   16              ///< Screen names tracked
+
+#ifndef LV_HEAP_CAPS
+#define LV_HEAP_CAPS  (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)   ///< heap_caps for grown regions
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *lv_heap_malloc(size_t size);
+void lv_heap_free(void *ptr);
+void *lv_heap_realloc(void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+
+#include "tlsf.h"
+
+/**
+ * @struct LvHeapScreenStats
+ * @brief Heap figures of one screen, over all its visits.
+ */
+struct LvHeapScreenStats {
+    const char *name;
+    uint32_t visits;
+    size_t peakUsed;        ///< Highest usedBytes while the screen was shown
+    size_t largestFree;     ///< Largest free block when it was last left
+    uint8_t fragPct;        ///< Fragmentation when it was last left
+    uint8_t worstFragPct;
+};
+
+/**
+ * @struct LvHeapStats
+ * @brief Heap snapshot.
+ */
+struct LvHeapStats {
+    TlsfStats heap;
+    uint32_t grows;         ///< Regions taken from heap_caps
+    uint32_t failures;      ///< Requests that failed even after growing
+};
+
+/**
+ * @brief Mark the start of screen @p name and report the one before it.
+ *
+ * @p name must be a string literal; it is kept, not copied.
+ */
+void lv_heap_screen(const char *name);
+
+LvHeapStats lv_heap_stats();
+
+/**
+ * @brief Copy the per-screen figures into @p out.
+ * @return Number of entries copied.
+ */
+size_t lv_heap_screens(LvHeapScreenStats *out, size_t max);
+
+#endif // __cplusplus
+
+#endif // LV_HEAP_H
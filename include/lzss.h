@@ -0,0 +1,103 @@
+/**
+ * @file lzss.h
+ * @brief Streaming LZSS compressor and decompressor.
+ *
+ * Data is pushed through the encoder and pulled out of the decoder in
+ * pieces of any size; neither side ever holds more than its window, so
+ * archives of any length stream to and from a file.
+ *
+ * Stream format: a flag byte precedes every group of up to eight items, one
+ * bit per item, least significant first. A clear bit is a literal byte, a
+ * set bit a two-byte back reference: 12-bit distance (1..4095) and 4-bit
+ * length - LZSS_MIN_MATCH. Distance 0 marks the end of the stream.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LZSS_WINDOW      4096    ///< History size; distances are 12 bits
+#define LZSS_MIN_MATCH   3
+#define LZSS_MAX_MATCH   18      ///< LZSS_MIN_MATCH + 15
+#define LZSS_HASH_BITS   10
+#define LZSS_MAX_CHAIN   32      ///< Candidates tried per position
+
+/**
+ * @brief Receives compressed bytes; returns false to abort.
+ */
+typedef bool (*LzssSink)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Supplies compressed bytes.
+ * @return Bytes read, 0 at end of input, -1 on error.
+ */
+typedef int (*LzssSource)(void *ctx, uint8_t *data, size_t len);
+
+/**
+ * @struct LzssEncoder
+ * @brief Encoder state (about 18 KB; allocate it, don't put it on a task stack).
+ */
+struct LzssEncoder {
+    uint8_t buf[2 * LZSS_WINDOW];           ///< History followed by look-ahead
+    uint16_t head[1 << LZSS_HASH_BITS];     ///< Newest position per hash
+    uint16_t prev[LZSS_WINDOW];             ///< Older position with the same hash
+    uint16_t len;                           ///< Bytes in buf
+    uint16_t pos;                           ///< Next byte to encode
+    uint8_t out[1 + 8 * 2];                 ///< Flag byte and its items
+    uint8_t outLen;
+    uint8_t flagBit;
+    bool error;
+    LzssSink sink;
+    void *ctx;
+    uint32_t inBytes;
+    uint32_t outBytes;
+};
+
+/**
+ * @struct LzssDecoder
+ * @brief Decoder state (about 4.5 KB).
+ */
+struct LzssDecoder {
+    uint8_t window[LZSS_WINDOW];
+    uint16_t wpos;
+    uint8_t in[256];
+    uint16_t inPos;
+    uint16_t inLen;
+    uint8_t flags;
+    uint8_t flagBits;       ///< Items left in the current group
+    uint16_t matchDist;
+    uint8_t matchLeft;      ///< Bytes of the current back reference still to copy
+    bool done;
+    bool error;
+    LzssSource source;
+    void *ctx;
+};
+
+void lzss_encoder_init(LzssEncoder *enc, LzssSink sink, void *ctx);
+
+/**
+ * @brief Compress @p len bytes; output reaches the sink in small pieces.
+ * @return false once the sink has failed.
+ */
+bool lzss_encode(LzssEncoder *enc, const void *data, size_t len);
+
+/**
+ * @brief Encode the buffered tail and the end marker.
+ */
+bool lzss_encoder_finish(LzssEncoder *enc);
+
+void lzss_decoder_init(LzssDecoder *dec, LzssSource source, void *ctx);
+
+/**
+ * @brief Decompress up to @p len bytes.
+ * @return Bytes produced, 0 after the end marker, -1 on a read error or a
+ *         stream that ends without its end marker.
+ */
+int lzss_decode(LzssDecoder *dec, void *out, size_t len);
+
+#endif // LZSS_H
@@ -0,0 +1,152 @@
+/**
+ * @file sd_bench.h
+ * @brief SD card throughput benchmark and SPI clock tuning.
+ *
+ * The measurement core works on any SdBenchIo: it issues multi-block
+ * sequential transfers and random 4 KB transfers inside a sector range,
+ * verifies every sector it wrote and reports KB/s. On the device the range
+ * is a contiguous, pre-allocated temp file on the card, so the file system
+ * is never touched outside it. Off-device, test/host/sd_bench_host.cpp runs
+ * the same core against an image file (make -C test/host run).
+ *
+ * The on-device sweep repeats the run at several SPI clocks and stores the
+ * fastest clock that completed without errors, tagged with the card's CID,
+ * so init_sd_card() can start the same card at that clock next time.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef SD_BENCH_H
+#define SD_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SD_BENCH_FILE         "/.sdbench.tmp"
+#define SD_BENCH_FILE_BYTES   (4UL * 1024 * 1024)  ///< Size of the scratch area
+#define SD_BENCH_SEQ_SECTORS  32                   ///< 16 KB per sequential transfer
+#define SD_BENCH_RND_SECTORS  8                    ///< 4 KB per random transfer
+#define SD_BENCH_RND_OPS      128                  ///< Random transfers per direction
+
+#define SD_CLOCK_DEFAULT_MHZ  32   ///< Clock used until a benchmark has run
+#define SD_CLOCK_SAFE_MHZ     16   ///< Fallback when the saved clock fails
+#define SD_BENCH_MAX_CLOCKS   6
+
+/**
+ * @struct SdBenchResult
+ * @brief Result of one benchmark run.
+ */
+struct SdBenchResult {
+    uint8_t clockMhz;       ///< SPI clock (0 when run on a non-SPI device)
+    bool ok;                ///< Every transfer succeeded and verified
+    uint32_t errors;        ///< Failed transfers plus transfers with bad data
+    uint32_t seqWriteKBs;
+    uint32_t seqReadKBs;
+    uint32_t rndWriteKBs;
+    uint32_t rndReadKBs;
+};
+
+/**
+ * @class SdBenchIo
+ * @brief The sector transfers the benchmark needs; SdFat's FsBlockDevice on the device.
+ */
+class SdBenchIo {
+public:
+    virtual ~SdBenchIo() = default;
+    virtual bool readSectors(uint32_t sector, uint8_t *dst, size_t ns) = 0;
+    virtual bool writeSectors(uint32_t sector, const uint8_t *src, size_t ns) = 0;
+    virtual bool syncDevice() = 0;
+};
+
+/**
+ * @brief Benchmark a sector range of a block device.
+ *
+ * Destroys the contents of the range.
+ *
+ * @param dev Block device.
+ * @param firstSector First sector of the scratch range.
+ * @param sectorCount Sectors in the range (at least SD_BENCH_SEQ_SECTORS).
+ * @param[out] out Result; clockMhz is left untouched.
+ * @return out.ok
+ */
+bool sd_bench_device(SdBenchIo *dev, uint32_t firstSector, uint32_t sectorCount,
+                     SdBenchResult &out);
+
+/**
+ * @brief Print one result line to the log.
+ */
+void sd_bench_print(const SdBenchResult &r);
+
+// Firmware only; host tests that link SD_utils.cpp supply their own
+
+/**
+ * @brief Saved SPI clock and the card it was measured on.
+ *
+ * @param[out] cidHash CRC32 of that card's CID register.
+ * @return Saved clock in MHz, or 0 if none was saved.
+ */
+uint8_t sd_clock_load(uint32_t *cidHash);
+
+/**
+ * @brief Save the SPI clock for the card with CID hash @p cidHash.
+ */
+void sd_clock_save(uint32_t cidHash, uint8_t mhz);
+
+/**
+ * @brief CRC32 of the mounted card's CID register (0 on failure).
+ */
+uint32_t sd_card_cid_hash();
+
+#ifdef ARDUINO
+
+#include <SdFat.h>
+
+/**
+ * @class SdBenchBlockIo
+ * @brief SdBenchIo over an SdFat block device (the card, or the sector cache).
+ */
+class SdBenchBlockIo : public SdBenchIo {
+public:
+    explicit SdBenchBlockIo(FsBlockDevice *dev) : m_dev(dev) {}
+    bool readSectors(uint32_t sector, uint8_t *dst, size_t ns) override {
+        return m_dev && m_dev->readSectors(sector, dst, ns);
+    }
+    bool writeSectors(uint32_t sector, const uint8_t *src, size_t ns) override {
+        return m_dev && m_dev->writeSectors(sector, src, ns);
+    }
+    bool syncDevice() override { return m_dev && m_dev->syncDevice(); }
+
+private:
+    FsBlockDevice *m_dev;
+};
+
+/**
+ * @brief Start the clock sweep on a background task.
+ *
+ * Takes the SD lock once per phase: creating the scratch file, each clock
+ * (a few seconds: remount at that clock, then measure) and the final
+ * remount. Other tasks can use the card between phases, uncached and at
+ * whichever clock was measured last.
+ *
+ * @return false if a sweep is already running.
+ */
+bool sd_bench_start();
+
+/**
+ * @brief Progress of the last sweep.
+ *
+ * @param[out] results Points at the results so far.
+ * @param[out] running true while the sweep is still going.
+ * @return Number of valid entries in @p results.
+ */
+size_t sd_bench_progress(const SdBenchResult **results, bool *running);
+
+/**
+ * @brief Clock chosen by the last sweep, or 0 if none was stable.
+ */
+uint8_t sd_bench_best_clock();
+
+#endif // ARDUINO
+
+#endif // SD_BENCH_H
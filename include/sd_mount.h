@@ -0,0 +1,96 @@
+/**
+ * @file sd_mount.h
+ * @brief Single owner of the SD card mount, with hot-plug detection.
+ *
+ * The card is mounted once, by a background task, instead of by every
+ * screen that needs it. The CYD has no card-detect pin, so while mounted the
+ * task reads the card's CID register every SD_MOUNT_POLL_MS: a 16-byte
+ * command that fails once the card is pulled and returns a different
+ * identity if it was swapped. A missing card is retried every
+ * SD_MOUNT_RETRY_MS.
+ *
+ * Before a pulled or swapped card is unmounted, a running file job is
+ * cancelled and waited for, the viewer's file is closed and the sector
+ * cache is dropped without writing back.
+ *
+ * Every mount and unmount bumps the generation; code that caches anything
+ * read from the card compares it to know when to drop the cache. So do
+ * sd_mount_suspend() and sd_mount_resume(), which bracket code that
+ * remounts the card itself.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef SD_MOUNT_H
+#define SD_MOUNT_H
+
+#include <stdint.h>
+
+#define SD_MOUNT_POLL_MS    2000    ///< CID check period while mounted
+#define SD_MOUNT_RETRY_MS   5000    ///< Mount retry period while there is no card
+
+/**
+ * @enum SdMountState
+ * @brief Where the card is in its life cycle.
+ */
+enum SdMountState : uint8_t {
+    SD_MOUNT_IDLE = 0,      ///< sd_mount_begin() not called yet
+    SD_MOUNT_MOUNTING,
+    SD_MOUNT_MOUNTED,
+    SD_MOUNT_NO_CARD,       ///< No card, or it did not mount; retried
+    SD_MOUNT_SUSPENDED      ///< Remounted by someone else (SD benchmark); not polled
+};
+
+/**
+ * @struct SdMountStatus
+ * @brief Snapshot of the mount.
+ */
+struct SdMountStatus {
+    SdMountState state;
+    uint32_t cid;           ///< Identity of the mounted card (sd_card_cid_hash())
+    uint32_t mounts;        ///< Successful mounts since boot
+    uint32_t removals;      ///< Cards pulled or swapped while mounted
+    uint32_t mountMs;       ///< Duration of the last mount
+    uint32_t generation;    ///< Changes on every mount and unmount
+};
+
+/**
+ * @brief Start the mount task; the first mount happens on it.
+ */
+bool sd_mount_begin();
+
+/**
+ * @brief true if a card is mounted; cheap, for UI checks.
+ */
+bool sd_mounted();
+
+uint32_t sd_mount_generation();
+
+SdMountStatus sd_mount_status();
+
+/**
+ * @brief Take the mounted card out of service for code that remounts it itself.
+ *
+ * sd_mounted() is false until sd_mount_resume(), so screens do not open
+ * files on a volume that is about to go away, and the task stops polling.
+ * @return false if no card is mounted (or it is already suspended).
+ */
+bool sd_mount_suspend();
+
+/**
+ * @brief Put the card back in service after sd_mount_suspend().
+ *
+ * Does nothing if the card was unmounted in between.
+ */
+void sd_mount_resume();
+
+/**
+ * @brief Check the card now instead of at the next poll.
+ *
+ * For screens that found no card: a card just inserted mounts without
+ * waiting out SD_MOUNT_RETRY_MS.
+ */
+void sd_mount_request();
+
+#endif // SD_MOUNT_H
@@ -0,0 +1,66 @@
+/**
+ * @file sd_space.h
+ * @brief Background, cached SD free-space tracker.
+ *
+ * Counting free clusters means reading the whole FAT, which takes seconds on
+ * a large FAT32 card. The tracker does it once per mounted card on a
+ * background task, a few FAT sectors per SD lock hold, and afterwards keeps
+ * the count current from the allocation changes our own code reports.
+ * Changes made elsewhere (another device, a PC) are only picked up by the
+ * next scan.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef SD_SPACE_H
+#define SD_SPACE_H
+
+#include <stdint.h>
+
+/**
+ * @struct SdSpaceInfo
+ * @brief Snapshot of the tracker state.
+ */
+struct SdSpaceInfo {
+    bool valid;             ///< A scan completed for the mounted card
+    bool scanning;          ///< A scan is in progress
+    uint64_t totalBytes;    ///< Data area size
+    uint64_t freeBytes;
+    uint32_t scanMs;        ///< Duration of the last scan
+    uint32_t generation;    ///< Changes whenever totalBytes/freeBytes change
+};
+
+/**
+ * @brief Tell the tracker a card was mounted.
+ *
+ * Keeps the cached count if @p cidHash matches the card it was computed
+ * for, otherwise drops it and starts a background scan.
+ *
+ * @param cidHash Identity of the mounted card (0 if unknown: always rescans).
+ */
+void sd_space_mounted(uint32_t cidHash);
+
+/**
+ * @brief Start a background rescan (no-op while one is running).
+ */
+void sd_space_rescan();
+
+/**
+ * @brief Current snapshot; never touches the card.
+ */
+SdSpaceInfo sd_space_get();
+
+/**
+ * @brief Report clusters allocated (positive) or freed (negative) by our code.
+ */
+void sd_space_note_clusters(int32_t delta);
+
+/**
+ * @brief Report a file whose size changed from @p oldSize to @p newSize bytes.
+ *
+ * Use 0 for a created or deleted file.
+ */
+void sd_space_note_file(uint64_t oldSize, uint64_t newSize);
+
+#endif // SD_SPACE_H
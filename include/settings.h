@@ -42,6 +42,9 @@ void showSettings(lv_event_t *e = nullptr);
 /**
  * @brief Save display brightness setting.
  *
+ * Updates the settings cache only; the NVS commit is deferred until the
+ * value stops changing (see settings_store.h).
+ *
  * @param brightness Brightness value to save (0-255).
  */
 void saveBrightness(int brightness);
@@ -49,6 +52,8 @@ void saveBrightness(int brightness);
 /**
  * @brief Load display brightness setting.
  *
+ * Served from the settings cache after the first read.
+ *
  * @return The saved brightness value (0-255).
  */
 int loadBrightness();
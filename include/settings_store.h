@@ -0,0 +1,80 @@
+/**
+ * @file settings_store.h
+ * @brief Write-behind RAM cache for small integer settings kept in NVS.
+ *
+ * Each key is read from NVS once and then served from RAM. Writes only
+ * update the cache and re-arm a quiet-period timer; when no key has changed
+ * for SETTINGS_STORE_QUIET_MS the dirty keys are written in one NVS commit.
+ * A slider drag therefore costs one commit instead of one per step.
+ * settings_store_flush() commits immediately, for the end of an
+ * interaction or before a restart.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <stdint.h>
+
+#define SETTINGS_STORE_NAMESPACE  "storage"
+#define SETTINGS_STORE_MAX_KEYS   8
+#define SETTINGS_STORE_KEY_LEN    16      ///< NVS key limit: 15 characters + NUL
+#define SETTINGS_STORE_QUIET_MS   1500    ///< Commit after this long without a change
+
+/**
+ * @struct SettingsStoreStats
+ * @brief Commit instrumentation snapshot.
+ */
+struct SettingsStoreStats {
+    uint32_t sets;              ///< settings_store_set_i32() calls that changed a value
+    uint32_t commits;           ///< NVS commits performed
+    uint32_t keysWritten;       ///< Keys written across all commits
+    uint32_t failures;          ///< Commits that returned an NVS error
+    uint32_t lastCommitUs;      ///< Duration of the last commit (open to close)
+    uint32_t maxCommitUs;
+    uint8_t dirty;              ///< Keys waiting for the next commit
+    uint32_t generation;        ///< Changes whenever any field above changes
+};
+
+/**
+ * @brief Value of @p key, reading NVS on first use only.
+ *
+ * @param key NVS key in SETTINGS_STORE_NAMESPACE.
+ * @param def Returned (and cached) when the key is not in NVS.
+ */
+int32_t settings_store_get_i32(const char *key, int32_t def);
+
+/**
+ * @brief Update @p key in RAM and schedule a deferred commit.
+ *
+ * Never touches flash. Setting the value NVS already holds is a no-op; a key
+ * that is not in NVS yet is always written, even with its default.
+ *
+ * @return false if the key table is full.
+ */
+bool settings_store_set_i32(const char *key, int32_t value);
+
+/**
+ * @brief Commit all dirty keys now.
+ *
+ * @return false if an NVS call failed; the keys stay dirty and are retried
+ *         on the next commit.
+ */
+bool settings_store_flush();
+
+/**
+ * @brief Forget every cached value, dirty or not.
+ *
+ * For code that rewrote the namespace directly (backup restore); flush
+ * first if pending changes should survive.
+ */
+void settings_store_invalidate();
+
+/**
+ * @brief Current instrumentation snapshot.
+ */
+SettingsStoreStats settings_store_stats();
+
+#endif // SETTINGS_STORE_H
@@ -0,0 +1,138 @@
+/**
+ * @file tlsf.h
+ * @brief Two-Level Segregated Fit allocator over caller-supplied pools.
+ *
+ * Free blocks are kept in size classes indexed by a first level (power of
+ * two) and a second level (TLSF_SL_COUNT linear steps within it), with a
+ * bitmap per level, so malloc and free are O(1): a couple of find-first-set
+ * operations and list splices, no walking. Neighbouring free blocks are
+ * merged on free. More pools can be added at any time; blocks never span
+ * pools.
+ *
+ * Block layout: an 8-byte header (size with a free bit, pointer to the
+ * physically previous block) followed by the payload. Free blocks keep
+ * their free-list links in the payload. Each pool ends in a zero-size used
+ * sentinel so merging never runs past it.
+ *
+ * The class is not thread-safe and has no platform dependencies.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef TLSF_H
+#define TLSF_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TLSF_ALIGN_LOG2   3
+#define TLSF_ALIGN        (1U << TLSF_ALIGN_LOG2)     ///< Payload alignment
+#define TLSF_SL_LOG2      4
+#define TLSF_SL_COUNT     (1U << TLSF_SL_LOG2)        ///< Second-level classes per first level
+#define TLSF_FL_MAX       24                          ///< Blocks stay below 16 MB
+#define TLSF_FL_COUNT     (TLSF_FL_MAX - TLSF_SL_LOG2 - TLSF_ALIGN_LOG2 + 1)
+#define TLSF_MAX_POOLS    8
+
+/**
+ * @struct TlsfStats
+ * @brief Heap figures; fragmentation as LVGL's lv_mem_monitor() defines it.
+ */
+struct TlsfStats {
+    size_t totalBytes;      ///< Payload bytes across all pools
+    size_t usedBytes;       ///< Payload bytes of allocated blocks
+    size_t freeBytes;
+    size_t largestFree;     ///< Largest free block
+    size_t peakUsed;        ///< High-water mark of usedBytes since resetPeak()
+    uint32_t freeBlocks;
+    uint32_t usedBlocks;
+    uint8_t pools;
+    uint8_t fragPct;        ///< 100 - 100 * largestFree / freeBytes
+};
+
+/**
+ * @class Tlsf
+ * @brief O(1) allocator over one or more memory pools.
+ */
+class Tlsf {
+public:
+    Tlsf();
+    Tlsf(const Tlsf &) = delete;
+    Tlsf &operator=(const Tlsf &) = delete;
+
+    /**
+     * @brief Hand @p bytes at @p mem to the allocator.
+     * @return false if the region is too small or TLSF_MAX_POOLS are in use.
+     */
+    bool addPool(void *mem, size_t bytes);
+
+    void *malloc(size_t size);
+    void free(void *ptr);
+    void *realloc(void *ptr, size_t size);
+
+    /**
+     * @brief Pool bytes needed so that a fresh pool can satisfy malloc(@p size).
+     */
+    static size_t poolBytesFor(size_t size);
+
+    /**
+     * @brief Exact figures from counters the allocator keeps.
+     *
+     * Only the largest free block needs a walk, of the one free list in the
+     * highest non-empty size class, so this is cheap enough to call with
+     * interrupts off.
+     */
+    TlsfStats stats() const;
+
+    size_t largestFree() const;
+
+    size_t usedBytes() const { return m_used; }
+    size_t peakUsed() const { return m_peak; }
+    void resetPeak() { m_peak = m_used; }
+
+    /**
+     * @brief Check block links, the free lists and the bitmaps.
+     * @return false on the first inconsistency (for tests).
+     */
+    bool check() const;
+
+private:
+    struct Block {
+        size_t size;            ///< Payload bytes; bit 0 set when free
+        Block *prevPhys;        ///< Physically previous block, nullptr for a pool's first
+        // Free blocks only, overlaying the payload
+        Block *nextFree;
+        Block *prevFree;
+    };
+
+    struct Pool {
+        Block *first;
+        size_t bytes;
+    };
+
+    static size_t blockSize(const Block *b) { return b->size & ~(size_t)1; }
+    static bool isFree(const Block *b) { return b->size & 1; }
+    static Block *nextPhys(const Block *b);
+    static void mapping(size_t size, int *fl, int *sl);
+
+    void insert(Block *b);
+    void remove(Block *b);
+    Block *find(size_t size);
+    void split(Block *b, size_t size);
+    Block *mergePrev(Block *b);
+    void mergeNext(Block *b);
+
+    uint32_t m_flMap = 0;
+    uint32_t m_slMap[TLSF_FL_COUNT];
+    Block *m_heads[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    Pool m_pools[TLSF_MAX_POOLS];
+    uint8_t m_poolCount = 0;
+    size_t m_total = 0;         ///< Payload bytes of the pools as added
+    size_t m_used = 0;
+    size_t m_peak = 0;
+    size_t m_free = 0;          ///< Payload bytes on the free lists
+    uint32_t m_freeBlocks = 0;
+    uint32_t m_blocks = 0;      ///< Free and used, sentinels excluded
+};
+
+#endif // TLSF_H
@@ -0,0 +1,148 @@
+/**
+ * @file vfs.h
+ * @brief Unified, buffered file access over the SD card and internal flash.
+ *
+ * One driver per medium and one path namespace:
+ * - `/sd/...`    SD card through SdFat (the same `sd` volume SD_utils mounts)
+ * - `/flash/...` the "storage" flash partition through LittleFS
+ *
+ * Every open file carries a small buffer, so line-by-line parsing and small
+ * writes do not turn into one driver call each. SD calls take the SD lock,
+ * and files written on the card keep the directory cache and free-space
+ * tracker current.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef VFS_H
+#define VFS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <FS.h>
+#include "SD_utils.h"
+
+#define VFS_SD_PREFIX     "/sd"
+#define VFS_FLASH_PREFIX  "/flash"
+#define VFS_FLASH_LABEL   "storage"   ///< Partition label in partitions.csv
+#define VFS_BUF_SIZE      512
+#define VFS_PATH_LEN      128
+
+#define VFS_READ    0x01  ///< Open for reading
+#define VFS_WRITE   0x02  ///< Create or truncate for writing
+#define VFS_APPEND  0x04  ///< Create or append
+
+/**
+ * @enum VfsMedium
+ * @brief Backing store of a path.
+ */
+enum VfsMedium {
+    VFS_NONE = 0,
+    VFS_SD,
+    VFS_FLASH
+};
+
+/**
+ * @brief Mount the flash file system (done lazily on first use).
+ *
+ * Formats the partition if it does not hold a valid file system.
+ */
+bool vfs_mount_flash();
+
+/**
+ * @brief Split a VFS path into medium and driver-local path.
+ *
+ * @param path Path starting with /sd or /flash.
+ * @param[out] local Driver path, at least VFS_PATH_LEN bytes ("/" for the root).
+ * @return Medium, or VFS_NONE for a path outside both mounts.
+ */
+VfsMedium vfs_resolve(const char *path, char *local);
+
+/**
+ * @class VfsFile
+ * @brief Buffered file on either medium. Read-only or write-only per open.
+ */
+class VfsFile {
+public:
+    VfsFile() = default;
+    ~VfsFile() { close(); }
+    VfsFile(const VfsFile &) = delete;
+    VfsFile &operator=(const VfsFile &) = delete;
+
+    /**
+     * @brief Open @p path with one of VFS_READ, VFS_WRITE or VFS_APPEND.
+     */
+    bool open(const char *path, uint8_t mode);
+
+    /**
+     * @brief Flush pending writes and close.
+     * @return false if a buffered write failed.
+     */
+    bool close();
+
+    bool isOpen() const { return m_medium != VFS_NONE; }
+
+    /**
+     * @brief Read up to @p len bytes.
+     * @return Bytes read, 0 at end of file, -1 on error.
+     */
+    int read(void *buf, size_t len);
+
+    /**
+     * @brief Read one line without the trailing "\n" or "\r\n".
+     * @return Line length, or -1 at end of file. Longer lines are truncated.
+     */
+    int readLine(char *line, size_t maxLen);
+
+    /**
+     * @brief Buffer @p len bytes for writing.
+     * @return Bytes accepted (less than @p len only on a driver error).
+     */
+    size_t write(const void *buf, size_t len);
+    size_t print(const char *text);
+
+    /**
+     * @brief Push buffered data to the driver.
+     */
+    bool flush();
+
+    uint32_t size();
+
+private:
+    bool fill();
+    bool drain();
+
+    VfsMedium m_medium = VFS_NONE;
+    uint8_t m_mode = 0;
+    bool m_error = false;
+    SdFile m_sd;
+    fs::File m_flash;
+    char m_path[VFS_PATH_LEN];   ///< Driver path (for cache notifications)
+    uint32_t m_startSize = 0;    ///< SD size at open, for free-space accounting
+    uint8_t m_buf[VFS_BUF_SIZE];
+    uint16_t m_pos = 0;          ///< Next byte to read / bytes buffered for writing
+    uint16_t m_len = 0;          ///< Valid bytes in the read buffer
+};
+
+/**
+ * @brief Read a whole file into @p buf (NUL-terminated).
+ * @return Bytes read, or -1 if the file can't be opened or is larger than @p maxLen - 1.
+ */
+int vfs_read_all(const char *path, char *buf, size_t maxLen);
+
+/**
+ * @brief Replace a file with @p len bytes of @p data.
+ */
+bool vfs_write_all(const char *path, const void *data, size_t len);
+
+bool vfs_exists(const char *path);
+bool vfs_remove(const char *path);
+bool vfs_mkdir(const char *path);
+
+/**
+ * @brief Rename within one medium.
+ */
+bool vfs_rename(const char *from, const char *to);
+
+#endif // VFS_H
@@ -0,0 +1,88 @@
+/**
+ * @file vlist.h
+ * @brief Virtualized, recycled list widget for long LVGL lists.
+ *
+ * Only the rows that fit in the viewport plus a small margin exist as LVGL
+ * objects. While scrolling, rows are repositioned and rebound to the entry
+ * index they now cover, so LVGL memory and build time do not depend on the
+ * number of entries.
+ *
+ * Rows look like lv_list buttons: child 0 is the icon image, child 1 the label.
+ *
+ * @note All functions must be called from the LVGL task.
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef VLIST_H
+#define VLIST_H
+
+#include <lvgl.h>
+#include <stdint.h>
+
+#define VLIST_MARGIN_ROWS 2   ///< Extra rows kept above and below the viewport
+
+/**
+ * @brief Row bind callback.
+ *
+ * Called whenever @p row starts showing entry @p index. Set the row icon and
+ * label here; never cache @p row beyond the call.
+ *
+ * @param row Row button (child 0: icon image, child 1: label).
+ * @param index Entry index the row now shows.
+ * @param user User pointer given to vlist_create().
+ */
+typedef void (*vlist_bind_cb_t)(lv_obj_t *row, uint32_t index, void *user);
+
+/**
+ * @brief Create a virtualized list.
+ *
+ * @param parent Parent object.
+ * @param w Width of the list.
+ * @param h Height of the list (determines the row pool size).
+ * @param row_h Fixed height of each row.
+ * @param bind Row bind callback.
+ * @param click_cb LVGL event callback for row clicks; use vlist_row_index()
+ *                 on the event target to get the entry index.
+ * @param user User pointer passed to @p bind and as event user data to @p click_cb.
+ * @return The list container.
+ */
+lv_obj_t *vlist_create(lv_obj_t *parent, lv_coord_t w, lv_coord_t h, lv_coord_t row_h,
+                       vlist_bind_cb_t bind, lv_event_cb_t click_cb, void *user);
+
+/**
+ * @brief Set the number of entries and bind rows that became visible.
+ *
+ * Rows already showing a valid index are left alone, so this is cheap to
+ * call while a listing grows. Call vlist_refresh() if existing entries changed.
+ *
+ * @param list List returned by vlist_create().
+ * @param count Total number of entries.
+ */
+void vlist_set_count(lv_obj_t *list, uint32_t count);
+
+/**
+ * @brief Rebind all visible rows (e.g. after the backing data changed).
+ */
+void vlist_refresh(lv_obj_t *list);
+
+/**
+ * @brief Entry index currently shown by a row.
+ *
+ * @param row Row object (e.g. the target of a click event).
+ * @return Entry index, or UINT32_MAX if the row is unbound.
+ */
+uint32_t vlist_row_index(lv_obj_t *row);
+
+/**
+ * @brief Add a long-press callback to every row.
+ *
+ * Rows still send LV_EVENT_CLICKED on release after a long press; call
+ * lv_indev_wait_release() in @p cb to suppress it.
+ *
+ * @param list List returned by vlist_create().
+ * @param cb LVGL event callback; use vlist_row_index() on the event target.
+ */
+void vlist_set_long_press_cb(lv_obj_t *list, lv_event_cb_t cb);
+
+#endif // VLIST_H
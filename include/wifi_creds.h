@@ -0,0 +1,85 @@
+/**
+ * @file wifi_creds.h
+ * @brief Indexed store of known WiFi networks in NVS.
+ *
+ * Each network is one fixed-size NVS blob. A small index of
+ * (SSID hash, slot) pairs sorted by hash stays in RAM, so a lookup is a
+ * binary search plus one blob read, and deciding whether a scanned SSID is
+ * known needs no NVS access at all.
+ *
+ * The legacy WIFI_CREDS_LEGACY_CSV ("ssid,password" lines) is imported once.
+ * The card usually mounts after the WiFi task starts, so the import waits
+ * for a mount and is retried on each new one until it succeeds; networks
+ * saved in the meantime keep their password.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef WIFI_CREDS_H
+#define WIFI_CREDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "vfs.h"
+
+#define WIFI_CREDS_NAMESPACE   "wifi"
+#define WIFI_CREDS_MAX         48
+#define WIFI_CREDS_SSID_LEN    33      ///< 32 bytes per 802.11 + NUL
+#define WIFI_CREDS_PASS_LEN    65      ///< 64 hex characters for a raw PSK + NUL
+#define WIFI_CREDS_LEGACY_CSV  VFS_SD_PREFIX "/config/wifi.csv"
+
+/**
+ * @struct WifiScanEntry
+ * @brief One access point from a scan, as wifi_creds_pick() needs it.
+ */
+struct WifiScanEntry {
+    const char *ssid;
+    int32_t rssi;
+};
+
+/**
+ * @brief Load the index, and import the legacy CSV if a card has mounted since.
+ *
+ * Called lazily by every other function. The WiFi task also calls it
+ * periodically so the import runs soon after the card mounts.
+ */
+bool wifi_creds_begin();
+
+/**
+ * @brief Password stored for @p ssid.
+ *
+ * @param[out] password Buffer for the NUL-terminated password.
+ * @return false if the network is unknown.
+ */
+bool wifi_creds_lookup(const char *ssid, char *password, size_t maxLen);
+
+/**
+ * @brief Add @p ssid or replace its password.
+ *
+ * @return false if the store is full or NVS fails.
+ */
+bool wifi_creds_save(const char *ssid, const char *password);
+
+bool wifi_creds_forget(const char *ssid);
+
+/**
+ * @brief Drop the RAM index so the next call reloads it from NVS.
+ *
+ * For code that rewrote the namespace directly (backup restore).
+ */
+void wifi_creds_invalidate();
+
+/**
+ * @brief Number of known networks.
+ */
+uint8_t wifi_creds_count();
+
+/**
+ * @brief Strongest access point in @p aps whose SSID is known.
+ *
+ * @return Index into @p aps, or -1 if none is known.
+ */
+int wifi_creds_pick(const WifiScanEntry *aps, int count);
+
+#endif // WIFI_CREDS_H
@@ -0,0 +1,49 @@
+/**
+ * @file wifi_lease.h
+ * @brief Last good access point and IP configuration, kept for fast reconnects.
+ *
+ * After every successful connection the access point (BSSID, channel) and
+ * the DHCP lease are saved in RTC memory, which survives software resets
+ * and OTA restarts, and in NVS for power cycles. NVS is only written when
+ * something changed, so reconnecting to the same AP costs no flash wear.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef WIFI_LEASE_H
+#define WIFI_LEASE_H
+
+#include <stdint.h>
+#include "wifi_creds.h"
+
+#define WIFI_LEASE_NAMESPACE  "wifi_last"
+#define WIFI_LEASE_STATIC_KEY "wifi_static"   ///< settings_store key: reuse the lease as a static IP
+
+/**
+ * @struct WifiLease
+ * @brief What a directed reconnect needs.
+ */
+struct WifiLease {
+    char ssid[WIFI_CREDS_SSID_LEN];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t ip;            ///< IPv4 addresses as IPAddress converts them to uint32_t
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+/**
+ * @brief Last saved lease: the RTC copy if valid, else the NVS copy.
+ * @return false if neither exists.
+ */
+bool wifi_lease_load(WifiLease *lease);
+
+/**
+ * @brief Save @p lease to RTC memory, and to NVS if it differs from the stored copy.
+ */
+void wifi_lease_store(const WifiLease &lease);
+
+#endif // WIFI_LEASE_H
@@ -0,0 +1,83 @@
+/**
+ * @file wifi_roam.h
+ * @brief Roaming between access points of the connected network.
+ *
+ * Once associated, the ESP32 stays with its access point until the link
+ * drops, even when another AP of the same network is much closer. The
+ * roaming monitor keeps smoothed RSSI and MQTT publish latency figures for
+ * the current AP. When either degrades, it scans only the channels the
+ * network has been seen on and moves to another BSSID of the same SSID,
+ * but only if that AP is at least WIFI_ROAM_MARGIN_DB stronger. After a
+ * scan or a roam the monitor waits WIFI_ROAM_HOLDOFF_MS before trying
+ * again, so a station between two APs does not flap.
+ *
+ * wifi_roam_poll() is driven by the WiFi task, so roams never race with
+ * reconnects.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef WIFI_ROAM_H
+#define WIFI_ROAM_H
+
+#include <stdint.h>
+
+#define WIFI_ROAM_SAMPLE_MS           2000    ///< Poll period expected from the caller
+#define WIFI_ROAM_RSSI_TRIGGER        -72     ///< Smoothed RSSI (dBm) below which a better AP is sought
+#define WIFI_ROAM_LATENCY_TRIGGER_MS  1500    ///< Smoothed publish latency above which a better AP is sought
+#define WIFI_ROAM_MARGIN_DB           8       ///< How much stronger a candidate must be
+#define WIFI_ROAM_HOLDOFF_MS          60000   ///< Minimum time between roam scans
+#define WIFI_ROAM_MAX_CHANNELS        4       ///< Channels remembered per network
+
+/**
+ * @struct WifiRoamStats
+ * @brief Link quality and roaming metrics since boot.
+ */
+struct WifiRoamStats {
+    int8_t rssi;                ///< Smoothed RSSI of the current AP (0: not connected)
+    uint8_t channels;           ///< Known channels of the current network
+    uint32_t publishMs;         ///< Smoothed publish latency
+    uint32_t publishes;
+    uint32_t publishFailures;
+    uint32_t connects;          ///< MQTT (TLS) connection attempts
+    uint32_t connectFailures;
+    uint32_t lastConnectMs;     ///< Duration of the last connection attempt
+    uint32_t disconnects;       ///< Link losses
+    uint32_t scans;             ///< Roam scans started
+    uint32_t roams;             ///< Successful moves to another AP
+    uint32_t roamFailures;
+    uint32_t lastRoamMs;        ///< Duration of the last roam
+    int8_t lastRoamFrom;        ///< RSSI before and after the last roam
+    int8_t lastRoamTo;
+    uint32_t generation;        ///< Changes on every update
+};
+
+/**
+ * @brief Sample the link and roam if needed.
+ *
+ * Call every WIFI_ROAM_SAMPLE_MS from the task that owns the connection.
+ * May block for a roam scan (about WIFI_SCAN_MS_PER_CHANNEL per known
+ * channel) and a directed join (up to WIFI_FAST_TIMEOUT_MS).
+ */
+void wifi_roam_poll();
+
+/**
+ * @brief Report one publish attempt; safe from any task.
+ *
+ * @param ms Time spent in the publish call alone, without connecting.
+ * @param ok Whether it succeeded.
+ */
+void wifi_roam_note_publish(uint32_t ms, bool ok);
+
+/**
+ * @brief Report one MQTT connection attempt; kept out of the publish latency.
+ */
+void wifi_roam_note_connect(uint32_t ms, bool ok);
+
+/**
+ * @brief Current snapshot; never blocks.
+ */
+WifiRoamStats wifi_roam_stats();
+
+#endif // WIFI_ROAM_H
@@ -0,0 +1,113 @@
+/**
+ * @file wifi_scan.h
+ * @brief Background, channel-by-channel WiFi scan with a result cache.
+ *
+ * A scan runs on its own task one channel at a time, so results appear
+ * within a few hundred milliseconds and keep filling in while the rest of
+ * the band is scanned. Results are deduplicated by SSID, keeping the
+ * strongest access point of each network, and stay valid for the cache TTL:
+ * opening the WiFi list twice in a row shows the cached list at once and
+ * does not rescan.
+ *
+ * Callers poll wifi_scan_generation() (e.g. from an lv_timer) and re-read
+ * the results when it changes.
+ *
+ * The driver keeps a single result list, so every WiFi.scanNetworks() ...
+ * WiFi.scanDelete() sequence in the firmware (this task, the connect scan,
+ * the roam scan) runs under the scan lock, held as a WifiScanLock.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef WIFI_SCAN_H
+#define WIFI_SCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "wifi_creds.h"
+
+#define WIFI_SCAN_MAX_RESULTS      32
+#define WIFI_SCAN_CHANNELS         13
+#define WIFI_SCAN_MS_PER_CHANNEL   120
+#define WIFI_SCAN_DEFAULT_TTL_MS   30000
+#define WIFI_SCAN_LOCK_FOREVER     UINT32_MAX
+
+/**
+ * @struct WifiScanResult
+ * @brief One network: its strongest access point.
+ */
+struct WifiScanResult {
+    char ssid[WIFI_CREDS_SSID_LEN];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t bssid[6];
+    bool secure;
+};
+
+/**
+ * @brief Start a background scan.
+ *
+ * @param force Rescan even if the cached results are younger than the TTL.
+ * @return true if a scan is now running (or the cache is fresh), false if
+ *         WiFi is off or the task can't start.
+ */
+bool wifi_scan_start(bool force = false);
+
+bool wifi_scan_busy();
+
+/**
+ * @brief Changes whenever the result list changes or a scan finishes.
+ */
+uint32_t wifi_scan_generation();
+
+/**
+ * @brief Copy the results, strongest first.
+ *
+ * Returns whatever is cached, including results from an older scan while a
+ * new one is running.
+ *
+ * @return Number of results copied.
+ */
+size_t wifi_scan_results(WifiScanResult *out, size_t max);
+
+/**
+ * @brief true if a scan finished less than the TTL ago.
+ */
+bool wifi_scan_fresh();
+
+/**
+ * @brief Change how long results stay fresh.
+ */
+void wifi_scan_set_ttl(uint32_t ms);
+
+/**
+ * @brief Take the scan lock.
+ *
+ * @param timeoutMs How long to wait for another scan; 0 only tries.
+ * @return false if it was not free in time.
+ */
+bool wifi_scan_lock(uint32_t timeoutMs = WIFI_SCAN_LOCK_FOREVER);
+
+void wifi_scan_unlock();
+
+/**
+ * @class WifiScanLock
+ * @brief RAII holder of the scan lock; check held() when a timeout is given.
+ */
+class WifiScanLock {
+public:
+    explicit WifiScanLock(uint32_t timeoutMs = WIFI_SCAN_LOCK_FOREVER) : m_held(wifi_scan_lock(timeoutMs)) {}
+    ~WifiScanLock() {
+        if (m_held) wifi_scan_unlock();
+    }
+    WifiScanLock(const WifiScanLock &) = delete;
+    WifiScanLock &operator=(const WifiScanLock &) = delete;
+
+    bool held() const { return m_held; }
+
+private:
+    bool m_held;
+};
+
+#endif // WIFI_SCAN_H
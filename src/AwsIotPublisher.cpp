@@ -10,14 +10,21 @@
 #include <ArduinoJson.h>
 #include "AwsIotPublisher.h"
 #include "config.h"
+#include "wifi_roam.h"
+#include "alloc_trace.h"
 
 WiFiClientSecure net;
 PubSubClient client(net);
 
 // Helper to ensure MQTT connection is alive
 bool ensureMqttConnected() {
+    ALLOC_SCOPE(ALLOC_TAG_MQTT);
     if (!client.connected()) {
-        if (!client.connect(THINGNAME)) {
+        // Timed apart from publishes: a TLS handshake is not publish latency
+        uint32_t startMs = millis();
+        bool ok = client.connect(THINGNAME);
+        wifi_roam_note_connect(millis() - startMs, ok);
+        if (!ok) {
             Serial.println("TLS connection failed! Cannot publish event.");
             Serial.print("MQTT connect state: ");
             Serial.println(client.state());
@@ -28,26 +35,8 @@ bool ensureMqttConnected() {
 }
 
 void begin() {
-    Serial.begin(115200);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    Serial.print("Connecting to WiFi");
-
-    int timeout = 0;
-    while (WiFi.status() != WL_CONNECTED && timeout < 20) {
-        delay(500);
-        Serial.print(".");
-        timeout++;
-    }
-    Serial.println();
-
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("WiFi connection failed!");
-        return;
-    }
-
-    Serial.print("WiFi connected. IP: ");
-    Serial.println(WiFi.localIP());
-
+    // Only configures TLS and the broker; the WiFi task brings the link up
+    // and ensureMqttConnected() connects on the first publish
     net.setCACert(SIMPLE_IOT_ROOT_CA);
     net.setCertificate(SIMPLE_IOT_DEVICE_CERT);
     net.setPrivateKey(SIMPLE_IOT_DEVICE_PRIVATE_KEY);
@@ -69,7 +58,7 @@ String currentTimestamp() {
 }
 
 String buildTopic() {
-    return "iot/" + g_config.department + "/" + g_config.stationId + "/" + g_config.deviceId;
+    return String("iot/") + g_config.department + "/" + g_config.stationId + "/" + g_config.deviceId;
 }
 
 /**
@@ -91,9 +80,8 @@ String buildTopic() {
  * @return true if publish was successful, false otherwise
  */
 bool publishEvent(const char* functionName, JsonObject& extras) {
-    if (!ensureMqttConnected()) {
-        return false;
-    }
+    ALLOC_SCOPE(ALLOC_TAG_MQTT);
+    if (!ensureMqttConnected()) return false;
 
     // Create JSON document with device information
     JsonDocument doc;
@@ -128,7 +116,9 @@ bool publishEvent(const char* functionName, JsonObject& extras) {
     Serial.println(strlen(jsonBuffer));
     
     // Attempt to publish and handle result
+    uint32_t startMs = millis();
     bool success = client.publish(topic.c_str(), jsonBuffer);
+    wifi_roam_note_publish(millis() - startMs, success);
     Serial.print("Publish result: ");
     Serial.println(success ? "success" : "failure");
     if (!success) {
@@ -152,9 +142,7 @@ bool publishEvent(const String& label,
 {
     Serial.print("MQTT client state before connect: ");
     Serial.println(client.state());
-    if (!ensureMqttConnected()) {
-        return false;
-    }
+    if (!ensureMqttConnected()) return false;
     Serial.print("MQTT client state after connect: ");
     Serial.println(client.state());
 
@@ -175,12 +163,14 @@ bool publishEvent(const String& label,
     Serial.print("Payload length: ");
     Serial.println(payload.length());
 
-    String topic = "bhs/events/" + g_config.location + "/" + department + "/" + String(stationId);
+    String topic = String("bhs/events/") + g_config.location + "/" + department + "/" + String(stationId);
     Serial.print("Publishing to topic: ");
     Serial.println(topic);
     Serial.print("Payload: ");
     Serial.println(payload);
+    uint32_t startMs = millis();
     bool success = client.publish(topic.c_str(), payload.c_str());
+    wifi_roam_note_publish(millis() - startMs, success);
     Serial.print("Publish result: ");
     Serial.println(success ? "success" : "failure");
     Serial.print("MQTT client state after publish: ");
@@ -203,9 +193,10 @@ bool publishEvent(const String& label,
 }
 
 bool publishHeartbeat() {
+    ALLOC_SCOPE(ALLOC_TAG_MQTT);
     if (WiFi.status() != WL_CONNECTED) {
         Serial.println("WiFi not connected, attempting to connect before heartbeat publish...");
-        WiFi.begin(g_config.wifi_ssid.c_str(), g_config.wifi_password.c_str());
+        WiFi.begin(g_config.wifi_ssid, g_config.wifi_password);
         unsigned long startAttemptTime = millis();
         while (WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < 10000) { // 10s timeout
             delay(500);
@@ -219,12 +210,11 @@ bool publishHeartbeat() {
             Serial.println("WiFi connected for heartbeat publish.");
         }
     }
-    if (!ensureMqttConnected()) {
-        return false;
-    }
+    if (!ensureMqttConnected()) return false;
     Serial.print("MQTT client state after connect: ");
     Serial.println(client.state());
     
+    WifiRoamStats roam = wifi_roam_stats();
     JsonDocument doc;
     doc["deviceId"] = g_config.deviceId;
     doc["timestamp"] = currentTimestamp();
@@ -232,17 +222,25 @@ bool publishHeartbeat() {
     doc["status"] = "online";
     doc["rssi"] = WiFi.RSSI();
     doc["uptime"] = millis() / 1000;
+    doc["roams"] = roam.roams;
+    doc["roamFailures"] = roam.roamFailures;
+    doc["disconnects"] = roam.disconnects;
+    doc["publishMs"] = roam.publishMs;
+    doc["mqttConnects"] = roam.connects;
+    doc["mqttConnectFailures"] = roam.connectFailures;
 
     String payload;
     serializeJson(doc, payload);
 
-    String topic = "bhs/heartbeat/" + g_config.deviceId;
+    String topic = String("bhs/heartbeat/") + g_config.deviceId;
     Serial.print("Publishing heartbeat to topic: ");
     Serial.println(topic);
     Serial.print("Payload: ");
     Serial.println(payload);
 
+    uint32_t startMs = millis();
     bool success = client.publish(topic.c_str(), payload.c_str());
+    wifi_roam_note_publish(millis() - startMs, success);
     if (success) {
         Serial.println("Heartbeat published successfully");
     } else {
@@ -253,5 +251,6 @@ bool publishHeartbeat() {
 
 // Add this function for use in main loop or a task
 void mqttLoop() {
+    ALLOC_SCOPE(ALLOC_TAG_MQTT);
     client.loop();
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
  */
 
 #include "I2C_utils.h"
+#include "i2c_registry.h"
 
 bool initI2C() {
     Wire.begin(I2C_SDA, I2C_SCL, I2C_FREQ);
@@ -11,31 +12,7 @@ bool initI2C() {
 }
 
 void scanI2CDevices() {
-    Serial.println("Scanning I2C bus...");
-    byte error, address;
-    int deviceCount = 0;
-
-    for(address = 1; address < 127; address++) {
-        Wire.beginTransmission(address);
-        error = Wire.endTransmission();
-
-        if (error == 0) {
-            Serial.print("I2C device found at address 0x");
-            if (address < 16) {
-                Serial.print("0");
-            }
-            Serial.println(address, HEX);
-            deviceCount++;
-        }
-    }
-
-    if (deviceCount == 0) {
-        Serial.println("No I2C devices found");
-    } else {
-        Serial.print("Found ");
-        Serial.print(deviceCount);
-        Serial.println(" device(s)");
-    }
+    i2c_registry_scan(true);
 }
 
 bool writeI2C(uint8_t address, const uint8_t* data, size_t length) {
@@ -6,6 +6,7 @@
  */
 #include "OTA_utils.h"
 #include "SD_utils.h"
+#include "settings_store.h"
 #include "lvgl.h"
 
 extern SdFat sd;
@@ -75,6 +76,7 @@ void ota_task(void *pvParameter) {
     }
 
     ESP_LOGI("OTA", "OTA update complete, restarting...");
+    settings_store_flush();
     esp_restart();
 }
 
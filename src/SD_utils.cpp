@@ -7,18 +7,105 @@
 #include <SdFat.h>
 #include <TFT_eSPI.h>
 #include "SD_utils.h"
+#include "dir_cache.h"
+#include "sd_bench.h"
+#include "sd_space.h"
+#include "block_cache.h"
+#include "file_jobs.h"
+#include "alloc_trace.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 // External declaration of tft object
 extern TFT_eSPI tft;
 
 SdFat sd;
+static BlockCache sd_cache;
+static uint32_t sd_cache_cid = 0;  // Card the cache was started on
+
+void sd_cache_detach() {
+    SdLock lock;
+    sd_cache.end();  // Writes back anything still dirty
+}
+
+void sd_cache_drop() {
+    SdLock lock;
+    if (!sd_cache.active()) return;
+    uint16_t dropped = sd_cache.discard();
+    if (dropped) Serial.printf("[SdCache] Dropped %u dirty sectors of the old card\n", dropped);
+}
+
+bool sd_remount(uint8_t mhz) {
+    SdLock lock;
+    // A card that no longer answers with the same CID is not the one the
+    // dirty sectors came from
+    if (sd_cache.active() && sd_card_cid_hash() != sd_cache_cid) {
+        sd_cache_drop();
+    } else {
+        sd_cache_detach();
+    }
+    sd.end();
+    if (!sd.begin(SS, SD_SCK_MHZ(mhz))) return false;
+    // Remount the volume on top of the cache; without memory for it, run uncached
+    if (sd_cache.begin(sd.card()) && !sd.FsVolume::begin(&sd_cache)) {
+        sd_cache.end();
+        return sd.FsVolume::begin(sd.card());
+    }
+    sd_cache_cid = sd_card_cid_hash();
+    return true;
+}
+
+FsBlockDevice *sd_block_device() {
+    return sd_cache.active() ? (FsBlockDevice *)&sd_cache : (FsBlockDevice *)sd.card();
+}
+
+bool sd_cache_flush() {
+    SdLock lock;
+    return !sd_cache.active() || sd_cache.flush();
+}
+
+void sd_cache_print_stats() {
+    BlockCacheStats st;
+    {
+        SdLock lock;
+        if (!sd_cache.active()) return;
+        st = sd_cache.stats();
+    }
+    uint32_t reads = st.hits + st.misses;
+    Serial.printf("[SdCache] %lu/%lu hits (%lu%%), read-ahead %lu/%lu used, %lu writes -> %lu runs "
+                  "(%lu sectors), %lu bypass R / %lu W\n",
+                  (unsigned long)st.hits, (unsigned long)reads,
+                  (unsigned long)(reads ? st.hits * 100 / reads : 0),
+                  (unsigned long)st.readAheadHits, (unsigned long)st.readAheadSectors,
+                  (unsigned long)st.writesAbsorbed, (unsigned long)st.writeBacks,
+                  (unsigned long)st.sectorsWritten, (unsigned long)st.bypassReads,
+                  (unsigned long)st.bypassWrites);
+}
 
 bool init_sd_card() {
-    if (!sd.begin(SS, SD_SCK_MHZ(32))) {
+    SdLock lock;
+    dir_cache_invalidate_all();  // The card may have been swapped
+
+    // Start at the clock the benchmark picked for this card, if any
+    uint32_t savedCid = 0;
+    uint8_t mhz = sd_clock_load(&savedCid);
+    if (mhz == 0) mhz = SD_CLOCK_DEFAULT_MHZ;
+    bool ok = sd_remount(mhz);
+    if (ok && mhz != SD_CLOCK_DEFAULT_MHZ && sd_card_cid_hash() != savedCid) {
+        mhz = SD_CLOCK_DEFAULT_MHZ;  // Different card: its tuned clock is unknown
+        ok = sd_remount(mhz);
+    }
+    if (!ok && mhz != SD_CLOCK_SAFE_MHZ) {
+        mhz = SD_CLOCK_SAFE_MHZ;
+        ok = sd_remount(mhz);
+    }
+    if (!ok) {
         Serial.println("Failed to initialize SD card");
         return false;
     }
-    Serial.println("SD card initialized successfully");
+    Serial.printf("SD card initialized successfully at %u MHz\n", mhz);
+    sd_space_mounted(sd_card_cid_hash());
+    file_job_resume();
     return true;
 }
 
@@ -46,28 +133,130 @@ bool open_dir(SdFile &dir, const char *path) {
     return true;
 }
 
-std::vector<FileInfo> list_files_in_dir(SdFile &dir) {
-    std::vector<FileInfo> files;
-    dir.rewind();
+int dir_enumerate(SdFile &dir, DirCursor &cursor, uint32_t maxEntries, uint8_t want,
+                  dir_entry_cb_t cb, void *ctx) {
+    if (cursor.done) return 0;
+    if (cursor.position == 0 && cursor.index == 0) {
+        dir.rewind();
+    } else if (!dir.seekSet(cursor.position)) {
+        cursor.done = true;
+        return -1;
+    }
+
     SdFile entry;
-    while (entry.openNext(&dir, O_RDONLY)) {
-        FileInfo info;
-        entry.getName(info.name, sizeof(info.name));
-        info.size = entry.fileSize();
-        files.push_back(info);
+    DirEntryInfo info;
+    char name[64];
+    info.name = name;
+    int delivered = 0;
+    while ((uint32_t)delivered < maxEntries) {
+        if (!entry.openNext(&dir, O_RDONLY)) {
+            cursor.done = true;
+            break;
+        }
+        // Everything comes from the handle openNext already has; no second open per entry
+        entry.getName(name, sizeof(name));
+        bool isDir = entry.isDir();
+        info.size = isDir ? 0 : entry.fileSize();
+        info.flags = 0;
+        info.date = info.time = 0;
+        if (want & DIR_WANT_TYPE) {
+            info.flags = (isDir ? ENTRY_DIR : 0) | (entry.isHidden() ? ENTRY_HIDDEN : 0);
+        }
+        if (want & DIR_WANT_MTIME) entry.getModifyDateTime(&info.date, &info.time);
         entry.close();
+
+        info.index = cursor.index++;
+        cursor.position = dir.curPosition();
+        delivered++;
+        if (!cb(info, ctx)) break;
     }
+    return delivered;
+}
+
+bool dir_cursor_seek(SdFile &dir, DirCursor &cursor, uint32_t index) {
+    if (index == cursor.index) return true;
+    if (cursor.done && index > cursor.index) return false;  // Already at the end
+    if (index < cursor.index) {
+        cursor = DirCursor();
+        dir.rewind();
+    } else if (!dir.seekSet(cursor.position)) {
+        return false;
+    }
+    SdFile entry;
+    while (cursor.index < index) {
+        if (!entry.openNext(&dir, O_RDONLY)) {
+            cursor.done = true;
+            return false;
+        }
+        entry.close();
+        cursor.index++;
+        cursor.position = dir.curPosition();
+    }
+    return true;
+}
+
+static bool collect_file_info(const DirEntryInfo &info, void *ctx) {
+    FileInfo fi;
+    strncpy(fi.name, info.name, sizeof(fi.name) - 1);
+    fi.name[sizeof(fi.name) - 1] = '\0';
+    fi.size = info.size;
+    ((std::vector<FileInfo> *)ctx)->push_back(fi);
+    return true;
+}
+
+static bool collect_entry(const DirEntryInfo &info, void *ctx) {
+    if (((EntryStore *)ctx)->add(info.name, info.size, info.flags, info.date, info.time)) return true;
+    Serial.println("Out of memory while listing directory");
+    return false;
+}
+
+std::vector<FileInfo> list_files_in_dir(SdFile &dir) {
+    ALLOC_SCOPE(ALLOC_TAG_SD);
+    std::vector<FileInfo> files;
+    files.reserve(16);
+    DirCursor cursor;
+    dir_enumerate(dir, cursor, UINT32_MAX, 0, collect_file_info, &files);
     return files;
 }
 
+size_t list_files_in_dir(SdFile &dir, EntryStore &out) {
+    ALLOC_SCOPE(ALLOC_TAG_SD);
+    out.clear();
+    DirCursor cursor;
+    dir_enumerate(dir, cursor, UINT32_MAX, DIR_WANT_TYPE | DIR_WANT_MTIME, collect_entry, &out);
+    return out.count();
+}
+
+size_t list_files_page(SdFile &dir, DirCursor &cursor, uint32_t first, uint32_t maxEntries,
+                       EntryStore &out) {
+    ALLOC_SCOPE(ALLOC_TAG_SD);
+    if (!dir_cursor_seek(dir, cursor, first)) return 0;
+    int n = dir_enumerate(dir, cursor, maxEntries, DIR_WANT_TYPE | DIR_WANT_MTIME, collect_entry, &out);
+    return n > 0 ? (size_t)n : 0;
+}
+
 bool create_directory(const char *path, const char *dirName) {
     char full_path[128];
     snprintf(full_path, sizeof(full_path), "%s/%s", path, dirName);
     if (sd.mkdir(full_path)) {
         Serial.printf("Directory %s created\n", full_path);
+        sd_space_note_clusters(1);  // A new directory takes one cluster
         return true;
     } else {
         Serial.printf("Failed to create directory %s\n", full_path);
         return false;
     }
-}
\ No newline at end of file
+}
+
+static SemaphoreHandle_t sd_mutex() {
+    static SemaphoreHandle_t mutex = xSemaphoreCreateRecursiveMutex();
+    return mutex;
+}
+
+void sd_lock() {
+    xSemaphoreTakeRecursive(sd_mutex(), portMAX_DELAY);
+}
+
+void sd_unlock() {
+    xSemaphoreGiveRecursive(sd_mutex());
+}
@@ -5,7 +5,11 @@
  * Provides functions for WiFi initialization, connection, scanning, and credential management.
  */
 #include <WIFI_utils.h>
-#include "file_utils.h"
+#include "wifi_creds.h"
+#include "wifi_lease.h"
+#include "wifi_scan.h"
+#include "settings_store.h"
+#include "alloc_trace.h"
 #include <SdFat.h>
 #include <vector>
 #include <WiFi.h>
@@ -19,6 +23,33 @@ using std::min;
 
 extern SdFat sd;
 
+static WifiConnectStats s_connect = {};
+static portMUX_TYPE s_connect_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Record how long the connection took and keep the AP and lease for next time
+static void connected(const char *ssid, uint32_t startMs, bool cached, bool staticIp) {
+    uint32_t ms = millis() - startMs;
+    portENTER_CRITICAL(&s_connect_mux);
+    s_connect.count++;
+    s_connect.ms = ms;
+    s_connect.cached = cached;
+    s_connect.staticIp = staticIp;
+    portEXIT_CRITICAL(&s_connect_mux);
+    Serial.printf("[WiFi] Connected to %s in %lu ms (%s%s)\n", ssid, (unsigned long)ms,
+                  cached ? "cached AP" : "scan", staticIp ? ", static IP" : "");
+
+    WifiLease lease;
+    memset(&lease, 0, sizeof(lease));
+    strlcpy(lease.ssid, ssid, sizeof(lease.ssid));
+    memcpy(lease.bssid, WiFi.BSSID(), sizeof(lease.bssid));
+    lease.channel = WiFi.channel();
+    lease.ip = WiFi.localIP();
+    lease.gateway = WiFi.gatewayIP();
+    lease.subnet = WiFi.subnetMask();
+    lease.dns = WiFi.dnsIP();
+    wifi_lease_store(lease);
+}
+
 void initWiFi() {
     WiFi.mode(WIFI_MODE_STA);
     WiFi.disconnect();
@@ -39,6 +70,7 @@ bool isWiFiEnabled() {
 }
 
 String getCurrentNetworkInfo() {
+    ALLOC_SCOPE(ALLOC_TAG_WIFI);
     if (WiFi.status() != WL_CONNECTED) {
         return "Not connected";
     }
@@ -46,11 +78,15 @@ String getCurrentNetworkInfo() {
     info += "IP Address: " + WiFi.localIP().toString() + "\n";
     info += "Gateway: " + WiFi.gatewayIP().toString() + "\n";
     info += "Subnet: " + WiFi.subnetMask().toString() + "\n";
-    info += "RSSI: " + String(WiFi.RSSI()) + " dBm";
+    info += "RSSI: " + String(WiFi.RSSI()) + " dBm\n";
+    WifiConnectStats st = getLastConnectStats();
+    info += "Connect: " + String(st.ms) + " ms (" + (st.cached ? "cached" : "scan") + ")";
     return info;
 }
 
 uint8_t scanNetworks(String networks[], uint8_t maxNetworks) {
+    ALLOC_SCOPE(ALLOC_TAG_WIFI);
+    WifiScanLock lock;
     int n = WiFi.scanNetworks();
     uint8_t count = min(n, (int)maxNetworks);
     for (uint8_t i = 0; i < count; ++i) {
@@ -59,7 +95,8 @@ uint8_t scanNetworks(String networks[], uint8_t maxNetworks) {
     return count;
 }
 
-bool connectToNetwork(const char* ssid, const char* password) {
+bool connectToNetwork(const char* ssid, const char* password, int32_t channel, const uint8_t* bssid) {
+    ALLOC_SCOPE(ALLOC_TAG_WIFI);
     static uint8_t retryCount = 0;
     const uint8_t maxRetries = 5;
     const uint16_t baseDelayMs = 1000;
@@ -69,8 +106,9 @@ bool connectToNetwork(const char* ssid, const char* password) {
     Serial.print("Using password: ");
     Serial.println(password);
 
+    uint32_t startMs = millis();
     WiFi.disconnect(true);
-    WiFi.begin(ssid, password);
+    WiFi.begin(ssid, password, channel, bssid);
 
     for (uint8_t i = 0; i < maxRetries; i++) {
         uint32_t startTime = millis();
@@ -94,13 +132,14 @@ bool connectToNetwork(const char* ssid, const char* password) {
                 Serial.print(WiFi.channel());
                 Serial.print(", RSSI: ");
                 Serial.println(WiFi.RSSI());
+                connected(ssid, startMs, false, false);
                 return true;
             }
         }
         if (i < maxRetries - 1) {
             WiFi.disconnect(true);
             delay(100);
-            WiFi.begin(ssid, password);
+            WiFi.begin(ssid, password, channel, bssid);
         }
     }
     retryCount = (retryCount + 1 < 10) ? retryCount + 1 : 10;
@@ -135,37 +174,126 @@ bool connectToNetwork(const char* ssid, const char* password) {
 }
 
 
-// #include "file_utils.h"
-
 bool loadWiFiCredentials(const char* ssid, char* password, size_t maxLen) {
-    String content = FileUtils::readFile("/config/wifi.csv");
-    if (content.isEmpty()) return false;
-
-    int startPos = 0;
-    while (startPos < content.length()) {
-        int endPos = content.indexOf('\n', startPos);
-        if (endPos == -1) endPos = content.length();
-        
-        String line = content.substring(startPos, endPos);
-        int separator = line.indexOf(',');
-        
-        if (separator != -1) {
-            String savedSSID = line.substring(0, separator);
-            String savedPassword = line.substring(separator + 1);
-            
-            if (savedSSID == ssid) {
-                savedPassword.toCharArray(password, maxLen);
-                return true;
-            }
+    return wifi_creds_lookup(ssid, password, maxLen);
+}
+
+void saveWiFiCredentials(const char* ssid, const char* password) {
+    if (!wifi_creds_save(ssid, password)) {
+        Serial.println("Failed to save WiFi credentials");
+    }
+}
+
+bool connectToLastNetwork() {
+    ALLOC_SCOPE(ALLOC_TAG_WIFI);
+    WifiLease lease;
+    if (!wifi_lease_load(&lease)) return false;
+    char password[WIFI_CREDS_PASS_LEN];
+    if (!wifi_creds_lookup(lease.ssid, password, sizeof(password))) return false;   // forgotten since
+    bool staticIp = lease.ip && settings_store_get_i32(WIFI_LEASE_STATIC_KEY, 0);
+
+    uint32_t startMs = millis();
+    WiFi.persistent(false);     // the lease is our cache; don't also rewrite the driver's NVS copy
+    WiFi.mode(WIFI_STA);
+    if (staticIp) {
+        WiFi.config(IPAddress(lease.ip), IPAddress(lease.gateway), IPAddress(lease.subnet), IPAddress(lease.dns));
+    }
+    WiFi.begin(lease.ssid, password, lease.channel, lease.bssid);
+    while (WiFi.status() != WL_CONNECTED && millis() - startMs < WIFI_FAST_TIMEOUT_MS) {
+        delay(20);
+    }
+    if (WiFi.status() != WL_CONNECTED) {
+        Serial.printf("[WiFi] Cached AP for %s (ch %u) not reachable in %lu ms, scanning\n", lease.ssid,
+                      lease.channel, (unsigned long)(millis() - startMs));
+        WiFi.disconnect();
+        if (staticIp) {
+            IPAddress none((uint32_t)0);
+            WiFi.config(none, none, none);   // back to DHCP for the scan path
         }
-        startPos = endPos + 1;
+        return false;
+    }
+    connected(lease.ssid, startMs, true, staticIp);
+    return true;
+}
+
+WifiConnectStats getLastConnectStats() {
+    portENTER_CRITICAL(&s_connect_mux);
+    WifiConnectStats st = s_connect;
+    portEXIT_CRITICAL(&s_connect_mux);
+    return st;
+}
+
+bool roamToAccessPoint(const uint8_t *bssid, int32_t channel) {
+    ALLOC_SCOPE(ALLOC_TAG_WIFI);
+    String ssid = WiFi.SSID();
+    char password[WIFI_CREDS_PASS_LEN];
+    if (!wifi_creds_lookup(ssid.c_str(), password, sizeof(password))) return false;
+    bool staticIp = getLastConnectStats().staticIp;
+
+    // No disconnect first: the driver leaves the old AP as part of the join
+    uint32_t startMs = millis();
+    WiFi.begin(ssid.c_str(), password, channel, bssid);
+    while (millis() - startMs < WIFI_FAST_TIMEOUT_MS) {
+        const uint8_t *current = WiFi.status() == WL_CONNECTED ? WiFi.BSSID() : nullptr;
+        if (current && memcmp(current, bssid, 6) == 0) {
+            connected(ssid.c_str(), startMs, true, staticIp);
+            return true;
+        }
+        delay(20);
     }
     return false;
 }
 
-void saveWiFiCredentials(const char* ssid, const char* password) {
-    String entry = String(ssid) + "," + password + "\n";
-    if (!FileUtils::writeFile("/config/wifi.csv", entry.c_str(), true)) {
-        Serial.println("Failed to save WiFi credentials");
+// Same as below, but from the background scan cache instead of a new scan
+static bool connectToBestCached() {
+    static WifiScanResult results[WIFI_SCAN_MAX];
+    WifiScanEntry aps[WIFI_SCAN_MAX];
+
+    int n = (int)wifi_scan_results(results, WIFI_SCAN_MAX);
+    for (int i = 0; i < n; i++) {
+        aps[i].ssid = results[i].ssid;
+        aps[i].rssi = results[i].rssi;
     }
+    int best = wifi_creds_pick(aps, n);
+    if (best < 0) return false;
+
+    char password[WIFI_CREDS_PASS_LEN];
+    if (!wifi_creds_lookup(results[best].ssid, password, sizeof(password))) return false;
+    return connectToNetwork(results[best].ssid, password, results[best].channel, results[best].bssid);
+}
+
+bool connectToBestNetwork() {
+    ALLOC_SCOPE(ALLOC_TAG_WIFI);
+    // The WiFi settings screen may have scanned a moment ago
+    if (wifi_scan_fresh()) return connectToBestCached();
+
+    // Scan results are copied out before scanDelete(); static to keep it off the task stack
+    static char ssids[WIFI_SCAN_MAX][WIFI_CREDS_SSID_LEN];
+    WifiScanEntry aps[WIFI_SCAN_MAX];
+    int best;
+    int32_t channel;
+    uint8_t bssid[6];
+    {
+        WifiScanLock lock;   // The background scan may be using the driver's result list
+        int n = WiFi.scanNetworks();
+        if (n <= 0) return false;
+        if (n > WIFI_SCAN_MAX) n = WIFI_SCAN_MAX;
+        for (int i = 0; i < n; i++) {
+            strlcpy(ssids[i], WiFi.SSID(i).c_str(), sizeof(ssids[i]));
+            aps[i].ssid = ssids[i];
+            aps[i].rssi = WiFi.RSSI(i);
+        }
+        best = wifi_creds_pick(aps, n);
+        if (best < 0) {
+            WiFi.scanDelete();
+            return false;
+        }
+        channel = WiFi.channel(best);
+        memcpy(bssid, WiFi.BSSID(best), sizeof(bssid));
+        WiFi.scanDelete();
+    }
+
+    char password[WIFI_CREDS_PASS_LEN];
+    if (!wifi_creds_lookup(ssids[best], password, sizeof(password))) return false;
+    return connectToNetwork(ssids[best], password, channel, bssid);
 }
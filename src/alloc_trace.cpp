@@ -0,0 +1,515 @@
+/**
+ * @file alloc_trace.cpp
+ * @brief Implements the allocation tracer.
+ *
+ * Live blocks sit in an open-addressing table keyed by pointer, with linear
+ * probing and backward-shift deletion, so it never fills up with
+ * tombstones. Frees of pointers the table does not hold (allocated before
+ * a hook saw them, through heap_caps directly, or while the table was
+ * full) pass straight through.
+ */
+#include "alloc_trace.h"
+
+#ifdef ALLOC_TRACE
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <new>
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <SdFat.h>
+#include "SD_utils.h"
+#include "sd_mount.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+static_assert((ALLOC_TRACE_MAX_LIVE & (ALLOC_TRACE_MAX_LIVE - 1)) == 0, "ALLOC_TRACE_MAX_LIVE must be a power of two");
+
+extern "C" {
+void *__real_malloc(size_t size);
+void __real_free(void *ptr);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+#ifdef ARDUINO
+struct _reent;
+void *__real__malloc_r(struct _reent *r, size_t size);
+void __real__free_r(struct _reent *r, void *ptr);
+void *__real__calloc_r(struct _reent *r, size_t n, size_t size);
+void *__real__realloc_r(struct _reent *r, void *ptr, size_t size);
+#endif
+}
+
+#ifdef ARDUINO
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+#define TRACE_LOCK()    portENTER_CRITICAL(&s_mux)
+#define TRACE_UNLOCK()  portEXIT_CRITICAL(&s_mux)
+#else
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define TRACE_LOCK()    pthread_mutex_lock(&s_mutex)
+#define TRACE_UNLOCK()  pthread_mutex_unlock(&s_mutex)
+#endif
+
+#define LIVE_MASK   (ALLOC_TRACE_MAX_LIVE - 1)
+#define LIVE_LIMIT  (ALLOC_TRACE_MAX_LIVE * 3 / 4)  // Keeps probe runs short
+
+struct LiveEntry {
+    uintptr_t ptr;          ///< 0: empty slot
+    uint32_t size;
+    uint16_t site;
+    uint8_t tag;
+    uint8_t epoch;
+};
+
+struct Site {
+    const char *label;      ///< Function of the innermost scope, nullptr outside any
+    uintptr_t pc;           ///< Return address of the allocation call
+    uint8_t tag;
+    uint32_t liveBytes;
+    uint32_t liveBlocks;
+    uint32_t allocs;
+};
+
+static const char *const kTagNames[ALLOC_TAG_COUNT] = {
+    "other", "ui", "wifi", "mqtt", "sd", "explorer", "launcher",
+};
+
+static LiveEntry s_live[ALLOC_TRACE_MAX_LIVE];
+static uint32_t s_liveCount = 0;
+static uint32_t s_untracked = 0;            // Allocations not recorded because the table was full
+static Site s_sites[ALLOC_TRACE_MAX_SITES]; // Slot 0 pools the sites that did not fit
+static AllocTagStats s_tags[ALLOC_TAG_COUNT];
+static uint8_t s_epoch = 0;
+
+static uint32_t s_scopesDropped = 0;       // Scopes ignored because every task slot was taken
+
+#ifdef ARDUINO
+// The core's FreeRTOS has one thread-local storage pointer, which pthread
+// owns, and __thread storage is not there before the scheduler starts, when
+// global constructors already allocate. A task inside a scope holds a slot
+// here instead, until its outermost scope ends.
+struct TaskScope {
+    TaskHandle_t task;      ///< nullptr: free slot
+    uint8_t tag;
+    const char *label;
+};
+
+static TaskScope s_scopes[ALLOC_TRACE_MAX_TASKS];
+
+// No scope applies before the scheduler starts or in an interrupt
+static TaskHandle_t scope_task() {
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED || xPortInIsrContext()) return nullptr;
+    return xTaskGetCurrentTaskHandle();
+}
+
+// Call with the lock held
+static TaskScope *scope_slot(TaskHandle_t task, bool claim) {
+    TaskScope *freeSlot = nullptr;
+    for (TaskScope &s : s_scopes) {
+        if (s.task == task) return &s;
+        if (!s.task && !freeSlot) freeSlot = &s;
+    }
+    if (!claim || !freeSlot) return nullptr;
+    *freeSlot = {task, ALLOC_TAG_OTHER, nullptr};
+    return freeSlot;
+}
+
+// Call with the lock held
+static void scope_get(uint8_t *tag, const char **label) {
+    TaskHandle_t task = scope_task();
+    const TaskScope *s = task ? scope_slot(task, false) : nullptr;
+    *tag = s ? s->tag : (uint8_t)ALLOC_TAG_OTHER;
+    *label = s ? s->label : nullptr;
+}
+
+// Call with the lock held; false if the table is full
+static bool scope_set(uint8_t tag, const char *label) {
+    TaskHandle_t task = scope_task();
+    if (!task) return true;
+    bool none = tag == ALLOC_TAG_OTHER && !label;   // Leaving the outermost scope
+    TaskScope *s = scope_slot(task, !none);
+    if (!s) return none;
+    if (none) {
+        s->task = nullptr;
+    } else {
+        s->tag = tag;
+        s->label = label;
+    }
+    return true;
+}
+#else
+static __thread uint8_t t_tag = ALLOC_TAG_OTHER;
+static __thread const char *t_label = nullptr;
+
+static void scope_get(uint8_t *tag, const char **label) {
+    *tag = t_tag;
+    *label = t_label;
+}
+
+static bool scope_set(uint8_t tag, const char *label) {
+    t_tag = tag;
+    t_label = label;
+    return true;
+}
+#endif
+
+static inline uintptr_t caller_pc(void *ra) {
+    uintptr_t pc = (uintptr_t)ra;
+#ifdef __XTENSA__
+    pc = (pc & 0x3FFFFFFF) | 0x40000000;    // Strip the register window increment
+#endif
+    return pc;
+}
+
+static inline uint32_t live_hash(uintptr_t ptr) {
+    return ((uint32_t)(ptr >> 3) * 2654435761u) & LIVE_MASK;
+}
+
+// Call with the lock held
+static uint16_t site_for(const char *label, uintptr_t pc, uint8_t tag) {
+    uint32_t h = ((uint32_t)(uintptr_t)label * 31u) ^ (uint32_t)pc ^ tag;
+    h *= 2654435761u;
+    for (uint32_t n = 0; n < ALLOC_TRACE_MAX_SITES - 1; n++) {
+        uint16_t i = 1 + (h + n) % (ALLOC_TRACE_MAX_SITES - 1);
+        Site &s = s_sites[i];
+        if (s.label == label && s.pc == pc && s.tag == tag && s.allocs) return i;
+        if (!s.allocs) {
+            s.label = label;
+            s.pc = pc;
+            s.tag = tag;
+            return i;
+        }
+    }
+    return 0;
+}
+
+static void record(void *ptr, size_t size, uintptr_t pc) {
+    if (!ptr) return;
+    uint8_t tag;
+    const char *label;
+    TRACE_LOCK();
+    scope_get(&tag, &label);
+    if (s_liveCount >= LIVE_LIMIT) {
+        s_untracked++;
+        TRACE_UNLOCK();
+        return;
+    }
+    uint16_t site = site_for(label, pc, tag);
+    uint32_t i = live_hash((uintptr_t)ptr);
+    while (s_live[i].ptr) i = (i + 1) & LIVE_MASK;
+    s_live[i] = {(uintptr_t)ptr, (uint32_t)size, site, tag, s_epoch};
+    s_liveCount++;
+
+    Site &s = s_sites[site];
+    s.liveBytes += size;
+    s.liveBlocks++;
+    s.allocs++;
+    AllocTagStats &t = s_tags[tag];
+    t.liveBytes += size;
+    t.liveBlocks++;
+    t.allocs++;
+    if (t.liveBytes > t.peakBytes) t.peakBytes = t.liveBytes;
+    TRACE_UNLOCK();
+}
+
+// Returns the recorded size, or -1 if @p ptr is not tracked
+static long forget(void *ptr) {
+    if (!ptr) return -1;
+    TRACE_LOCK();
+    uint32_t i = live_hash((uintptr_t)ptr);
+    while (s_live[i].ptr && s_live[i].ptr != (uintptr_t)ptr) i = (i + 1) & LIVE_MASK;
+    if (!s_live[i].ptr) {
+        TRACE_UNLOCK();
+        return -1;
+    }
+    LiveEntry e = s_live[i];
+    Site &s = s_sites[e.site];
+    s.liveBytes -= e.size;
+    s.liveBlocks--;
+    AllocTagStats &t = s_tags[e.tag];
+    t.liveBytes -= e.size;
+    t.liveBlocks--;
+    t.frees++;
+
+    // Backward-shift: pull later entries of the probe run into the hole
+    uint32_t j = i;
+    while (1) {
+        j = (j + 1) & LIVE_MASK;
+        if (!s_live[j].ptr) break;
+        uint32_t k = live_hash(s_live[j].ptr);
+        bool stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays) {
+            s_live[i] = s_live[j];
+            i = j;
+        }
+    }
+    s_live[i].ptr = 0;
+    s_liveCount--;
+    TRACE_UNLOCK();
+    return (long)e.size;
+}
+
+static void *traced_realloc(void *ptr, size_t size, uintptr_t pc, void *(*real)(void *, size_t, void *), void *ctx) {
+    long oldSize = forget(ptr);
+    void *q = real(ptr, size, ctx);
+    if (q) record(q, size, pc);
+    else if (size && oldSize >= 0) record(ptr, (size_t)oldSize, pc);   // The old block is still there
+    return q;
+}
+
+static void *real_realloc(void *ptr, size_t size, void *) {
+    return __real_realloc(ptr, size);
+}
+
+// --- Hooks (--wrap=symbol routes every reference to symbol here) ---
+
+extern "C" {
+
+void *__wrap_malloc(size_t size) {
+    void *p = __real_malloc(size);
+    record(p, size, caller_pc(__builtin_return_address(0)));
+    return p;
+}
+
+void __wrap_free(void *ptr) {
+    forget(ptr);    // Before the block can be handed out again
+    __real_free(ptr);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    void *p = __real_calloc(n, size);
+    record(p, n * size, caller_pc(__builtin_return_address(0)));
+    return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    return traced_realloc(ptr, size, caller_pc(__builtin_return_address(0)), real_realloc, nullptr);
+}
+
+#ifdef ARDUINO
+static void *real_realloc_r(void *ptr, size_t size, void *r) {
+    return __real__realloc_r((struct _reent *)r, ptr, size);
+}
+
+void *__wrap__malloc_r(struct _reent *r, size_t size) {
+    void *p = __real__malloc_r(r, size);
+    record(p, size, caller_pc(__builtin_return_address(0)));
+    return p;
+}
+
+void __wrap__free_r(struct _reent *r, void *ptr) {
+    forget(ptr);
+    __real__free_r(r, ptr);
+}
+
+void *__wrap__calloc_r(struct _reent *r, size_t n, size_t size) {
+    void *p = __real__calloc_r(r, n, size);
+    record(p, n * size, caller_pc(__builtin_return_address(0)));
+    return p;
+}
+
+void *__wrap__realloc_r(struct _reent *r, void *ptr, size_t size) {
+    return traced_realloc(ptr, size, caller_pc(__builtin_return_address(0)), real_realloc_r, r);
+}
+#else
+// glibc's strdup allocates inside libc, where --wrap does not reach
+char *__wrap_strdup(const char *s) {
+    size_t n = strlen(s) + 1;
+    char *p = (char *)__real_malloc(n);
+    if (p) memcpy(p, s, n);
+    record(p, n, caller_pc(__builtin_return_address(0)));
+    return p;
+}
+#endif
+
+} // extern "C"
+
+#ifndef ARDUINO
+// libstdc++ is a shared library on Linux, so its operator new is out of
+// reach of --wrap too; replace it to see std::vector and friends
+static void *traced_new(size_t size, uintptr_t pc) {
+    void *p = __real_malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    record(p, size, pc);
+    return p;
+}
+
+void *operator new(size_t size) { return traced_new(size, caller_pc(__builtin_return_address(0))); }
+void *operator new[](size_t size) { return traced_new(size, caller_pc(__builtin_return_address(0))); }
+void operator delete(void *ptr) noexcept { __wrap_free(ptr); }
+void operator delete[](void *ptr) noexcept { __wrap_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { __wrap_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { __wrap_free(ptr); }
+#endif
+
+// --- Scopes and reports ---
+
+AllocScope::AllocScope(AllocTag tag, const char *label) {
+    TRACE_LOCK();
+    scope_get(&m_prevTag, &m_prevLabel);
+    if (!scope_set(tag, label)) s_scopesDropped++;
+    TRACE_UNLOCK();
+}
+
+AllocScope::~AllocScope() {
+    TRACE_LOCK();
+    scope_set(m_prevTag, m_prevLabel);
+    TRACE_UNLOCK();
+}
+
+void alloc_trace_note_alloc(void *ptr, size_t size) {
+    record(ptr, size, caller_pc(__builtin_return_address(0)));
+}
+
+void alloc_trace_note_free(void *ptr) {
+    forget(ptr);
+}
+
+static uint32_t now_ms() {
+#ifdef ARDUINO
+    return millis();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#endif
+}
+
+const char *alloc_trace_tag_name(AllocTag tag) {
+    return tag < ALLOC_TAG_COUNT ? kTagNames[tag] : "?";
+}
+
+AllocTagStats alloc_trace_tag_stats(AllocTag tag) {
+    AllocTagStats st = {};
+    if (tag >= ALLOC_TAG_COUNT) return st;
+    TRACE_LOCK();
+    st = s_tags[tag];
+    TRACE_UNLOCK();
+    return st;
+}
+
+void alloc_trace_mark() {
+    TRACE_LOCK();
+    s_epoch++;
+    TRACE_UNLOCK();
+}
+
+// Report buffers: static so a report never allocates while it runs
+static Site s_snapSites[ALLOC_TRACE_MAX_SITES];
+static uint32_t s_markBytes[ALLOC_TRACE_MAX_SITES];
+static uint32_t s_markBlocks[ALLOC_TRACE_MAX_SITES];
+static uint32_t s_rateAllocs[ALLOC_TAG_COUNT];
+static uint32_t s_rate[ALLOC_TAG_COUNT];
+static uint32_t s_rateMs = 0;
+
+void alloc_trace_report(AllocTraceWrite write, void *ctx, bool sinceMark) {
+    AllocTagStats tags[ALLOC_TAG_COUNT];
+    TRACE_LOCK();
+    memcpy(tags, s_tags, sizeof(tags));
+    memcpy(s_snapSites, s_sites, sizeof(s_snapSites));
+    uint32_t liveCount = s_liveCount;
+    uint32_t untracked = s_untracked;
+    uint32_t scopesDropped = s_scopesDropped;
+    if (sinceMark) {
+        memset(s_markBytes, 0, sizeof(s_markBytes));
+        memset(s_markBlocks, 0, sizeof(s_markBlocks));
+        for (uint32_t i = 0; i < ALLOC_TRACE_MAX_LIVE; i++) {
+            if (!s_live[i].ptr || s_live[i].epoch != s_epoch) continue;
+            s_markBytes[s_live[i].site] += s_live[i].size;
+            s_markBlocks[s_live[i].site]++;
+        }
+    }
+    TRACE_UNLOCK();
+
+    // A report right after another keeps the previous window's rates
+    uint32_t now = now_ms();
+    uint32_t elapsed = now - s_rateMs;
+    if (elapsed >= 1000) {
+        for (uint8_t t = 0; t < ALLOC_TAG_COUNT; t++) {
+            s_rate[t] = (uint32_t)((uint64_t)(tags[t].allocs - s_rateAllocs[t]) * 1000 / elapsed);
+            s_rateAllocs[t] = tags[t].allocs;
+        }
+        s_rateMs = now;
+    }
+
+    char line[160];
+    uint32_t liveBytes = 0;
+    for (uint8_t t = 0; t < ALLOC_TAG_COUNT; t++) liveBytes += tags[t].liveBytes;
+    snprintf(line, sizeof(line), "[AllocTrace] up %lu s: %lu B live in %lu blocks, %lu untracked, %lu scopes dropped\n",
+             (unsigned long)(now / 1000), (unsigned long)liveBytes, (unsigned long)liveCount, (unsigned long)untracked,
+             (unsigned long)scopesDropped);
+    write(line, ctx);
+    write("[AllocTrace] tag          live B   blocks    peak B  allocs/s\n", ctx);
+    for (uint8_t t = 0; t < ALLOC_TAG_COUNT; t++) {
+        if (!tags[t].allocs) continue;
+        snprintf(line, sizeof(line), "[AllocTrace] %-9s %9lu %8lu %9lu %9lu\n", kTagNames[t],
+                 (unsigned long)tags[t].liveBytes, (unsigned long)tags[t].liveBlocks, (unsigned long)tags[t].peakBytes,
+                 (unsigned long)s_rate[t]);
+        write(line, ctx);
+    }
+
+    if (sinceMark) {
+        for (uint16_t i = 0; i < ALLOC_TRACE_MAX_SITES; i++) {
+            s_snapSites[i].liveBytes = s_markBytes[i];
+            s_snapSites[i].liveBlocks = s_markBlocks[i];
+        }
+    }
+    snprintf(line, sizeof(line), "[AllocTrace] top sites by live bytes%s:\n", sinceMark ? " since mark" : "");
+    write(line, ctx);
+    // Selection of the largest few; the table is small
+    for (uint8_t n = 0; n < ALLOC_TRACE_TOP_SITES; n++) {
+        uint16_t best = 0;
+        uint32_t bestBytes = 0;
+        for (uint16_t i = 0; i < ALLOC_TRACE_MAX_SITES; i++) {
+            if (s_snapSites[i].liveBytes > bestBytes) {
+                best = i;
+                bestBytes = s_snapSites[i].liveBytes;
+            }
+        }
+        if (!bestBytes) break;
+        const Site &s = s_snapSites[best];
+        const char *label = best == 0 ? "(sites over limit)" : s.label ? s.label : "-";
+        snprintf(line, sizeof(line), "[AllocTrace]   %-9s %-24s pc 0x%08lx %9lu B %6lu blocks %8lu allocs\n",
+                 kTagNames[s.tag], label, (unsigned long)s.pc, (unsigned long)s.liveBytes,
+                 (unsigned long)s.liveBlocks, (unsigned long)s.allocs);
+        write(line, ctx);
+        s_snapSites[best].liveBytes = 0;
+    }
+}
+
+#ifdef ARDUINO
+static void report_line(const char *line, void *ctx) {
+    if (ctx) ((SdFile *)ctx)->write(line, strlen(line));
+    else Serial.print(line);
+}
+
+static void report_task(void *pvParameters) {
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(ALLOC_TRACE_REPORT_MS));
+        alloc_trace_report(report_line, nullptr, false);
+        if (!sd_mounted()) continue;
+        SdLock lock;
+        SdFile file;
+        if (file.open(ALLOC_TRACE_SD_PATH, O_WRONLY | O_CREAT | O_APPEND)) {
+            alloc_trace_report(report_line, &file, false);
+            file.close();
+        }
+    }
+}
+
+bool alloc_trace_begin() {
+    static TaskHandle_t task = nullptr;
+    if (task) return true;
+    return xTaskCreatePinnedToCore(report_task, "AllocTrace", 4096, NULL, 1, &task, 1) == pdPASS;
+}
+#else
+bool alloc_trace_begin() {
+    return true;
+}
+#endif
+
+#endif // ALLOC_TRACE
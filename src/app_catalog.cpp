@@ -0,0 +1,401 @@
+/**
+ * @file app_catalog.cpp
+ * @brief Implements the persistent app catalog index for cydOS.
+ *
+ * The index is a small header followed by packed AppInfo records. It is read
+ * in one go when the launcher opens and kept current by a budgeted
+ * revalidation pass that only rescans apps whose timestamps changed.
+ */
+#include <Arduino.h>
+#include <SdFat.h>
+#include <rom/crc.h>
+#include <stdlib.h>
+#include <string.h>
+#include "app_catalog.h"
+#include "SD_utils.h"
+#include "dir_cache.h"
+#include "sd_space.h"
+
+extern SdFat sd;
+
+#define CATALOG_MAGIC    0x49415943UL  // "CYAI"
+#define CATALOG_VERSION  2      // 2: APP_HASH_VALID
+#define HASH_CHUNK       4096
+
+struct CatalogHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t count;
+    uint32_t crc;       ///< CRC32 over all records
+};
+
+enum ScanPhase { SCAN_IDLE, SCAN_LIST, SCAN_HASH };
+
+static char s_root[32] = APP_CATALOG_ROOT;
+static AppInfo *s_apps = nullptr;
+static uint16_t s_count = 0;
+static uint16_t s_capacity = 0;
+
+static ScanPhase s_phase = SCAN_IDLE;
+static SdFile s_scanDir;
+static SdFile s_hashFile;
+static int s_hashIdx = -1;
+static uint32_t s_hashCrc = 0;
+static uint16_t s_hashDirDate = 0;     // Directory stamps committed once the hash is done
+static uint16_t s_hashDirTime = 0;
+static uint8_t s_hashBuf[HASH_CHUNK];  // Static: steps run on the 8 KB LVGL stack
+static bool s_changed = false;
+
+static uint16_t s_benchApps = 0;       // Tree app_catalog_bench_prepare() is working on
+static uint16_t s_benchNext = 0;       // Next app of it to check
+
+static void index_path(char *out, size_t len) {
+    snprintf(out, len, "%s/%s", s_root, APP_CATALOG_FILE);
+}
+
+static bool reserve(uint16_t capacity) {
+    if (capacity <= s_capacity) return true;
+    uint16_t newCap = s_capacity ? s_capacity : 16;
+    while (newCap < capacity) newCap *= 2;
+    AppInfo *grown = (AppInfo *)realloc(s_apps, newCap * sizeof(AppInfo));
+    if (!grown) {
+        Serial.println("[Catalog] Out of memory");
+        return false;
+    }
+    s_apps = grown;
+    s_capacity = newCap;
+    return true;
+}
+
+static int find_index(const char *name) {
+    for (uint16_t i = 0; i < s_count; i++) {
+        if (strncmp(s_apps[i].name, name, APP_NAME_LEN) == 0) return i;
+    }
+    return -1;
+}
+
+static void close_scan() {
+    if (s_hashFile.isOpen()) s_hashFile.close();
+    if (s_scanDir.isOpen()) s_scanDir.close();
+    s_hashIdx = -1;
+    s_phase = SCAN_IDLE;
+}
+
+static bool save_index() {
+    char path[48], tmp[48];
+    index_path(path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    dir_cache_note_write(path);
+
+    CatalogHeader hdr;
+    hdr.magic = CATALOG_MAGIC;
+    hdr.version = CATALOG_VERSION;
+    hdr.recordSize = sizeof(AppInfo);
+    hdr.count = s_count;
+    hdr.crc = crc32_le(0, (const uint8_t *)s_apps, s_count * sizeof(AppInfo));
+
+    SdFile file;
+    if (!file.open(tmp, O_WRONLY | O_CREAT | O_TRUNC)) {
+        Serial.printf("[Catalog] Failed to create %s\n", tmp);
+        return false;
+    }
+    size_t body = s_count * sizeof(AppInfo);
+    bool ok = file.write(&hdr, sizeof(hdr)) == sizeof(hdr) &&
+              (body == 0 || file.write(s_apps, body) == body);
+    ok = file.close() && ok;
+    if (!ok) {
+        sd.remove(tmp);
+        Serial.println("[Catalog] Failed to write index");
+        return false;
+    }
+    uint32_t oldSize = 0;
+    SdFile old;
+    if (old.open(path, O_RDONLY)) {
+        oldSize = old.fileSize();
+        old.close();
+    }
+    sd.remove(path);
+    sd_space_note_file(oldSize, sizeof(hdr) + body);
+    return sd.rename(tmp, path);
+}
+
+// Fill everything except the hash; returns false if the app dir can't be read.
+static bool scan_app_dir(AppInfo &app) {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", s_root, app.name);
+
+    SdFile dir;
+    if (!dir.open(path, O_RDONLY)) return false;
+
+    app.flags = 0;
+    app.fwSize = 0;
+    app.totalSize = 0;
+    app.version[0] = '\0';
+    app.fwDate = app.fwTime = 0;
+
+    SdFile entry;
+    char name[32];
+    while (entry.openNext(&dir, O_RDONLY)) {
+        entry.getName(name, sizeof(name));
+        uint32_t size = entry.fileSize();
+        app.totalSize += size;
+        if (strcasecmp(name, "firmware.bin") == 0) {
+            app.flags |= APP_HAS_FIRMWARE;
+            app.fwSize = size;
+            entry.getModifyDateTime(&app.fwDate, &app.fwTime);
+        } else if (strcasecmp(name, "bootloader.bin") == 0) {
+            app.flags |= APP_HAS_BOOTLOADER;
+        } else if (strcasecmp(name, "boot_app0.bin") == 0) {
+            app.flags |= APP_HAS_BOOT_APP0;
+        } else if (strcasecmp(name, "icon.jpg") == 0) {
+            app.flags |= APP_HAS_ICON;
+        } else if (strcasecmp(name, "version.txt") == 0) {
+            int n = entry.read(app.version, sizeof(app.version) - 1);
+            app.version[n > 0 ? n : 0] = '\0';
+            char *eol = strpbrk(app.version, "\r\n");
+            if (eol) *eol = '\0';
+        }
+        entry.close();
+    }
+    dir.close();
+    return true;
+}
+
+// Cheap change check: compare the firmware timestamp/size without a full rescan.
+static bool firmware_unchanged(const AppInfo &app) {
+    char path[112];
+    snprintf(path, sizeof(path), "%s/%s/firmware.bin", s_root, app.name);
+    SdFile fw;
+    if (!fw.open(path, O_RDONLY)) return !(app.flags & APP_HAS_FIRMWARE);
+    uint16_t date = 0, time = 0;
+    fw.getModifyDateTime(&date, &time);
+    bool same = (app.flags & APP_HAS_FIRMWARE) && fw.fileSize() == app.fwSize &&
+                date == app.fwDate && time == app.fwTime;
+    fw.close();
+    return same;
+}
+
+// The directory stamps are only stored with a finished hash: until then they
+// stay zero (never a valid FAT date), so an abandoned pass rehashes next time.
+static void start_hash(int idx, uint16_t dirDate, uint16_t dirTime) {
+    AppInfo &app = s_apps[idx];
+    char path[112];
+    snprintf(path, sizeof(path), "%s/%s/firmware.bin", s_root, app.name);
+    if (!(app.flags & APP_HAS_FIRMWARE) || !s_hashFile.open(path, O_RDONLY)) {
+        app.dirDate = dirDate;
+        app.dirTime = dirTime;
+        return;
+    }
+    app.dirDate = app.dirTime = 0;
+    s_hashDirDate = dirDate;
+    s_hashDirTime = dirTime;
+    s_hashIdx = idx;
+    s_hashCrc = 0;
+    s_phase = SCAN_HASH;
+}
+
+static void finish_pass() {
+    close_scan();
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < s_count; i++) {
+        if (s_apps[i].flags & APP_STALE) {
+            s_changed = true;
+            continue;
+        }
+        if (kept != i) s_apps[kept] = s_apps[i];
+        kept++;
+    }
+    s_count = kept;
+    if (s_changed) {
+        save_index();
+        Serial.printf("[Catalog] Index updated, %u apps\n", s_count);
+    }
+}
+
+bool app_catalog_load(const char *root) {
+    close_scan();
+    strncpy(s_root, root, sizeof(s_root) - 1);
+    s_root[sizeof(s_root) - 1] = '\0';
+    s_count = 0;
+
+    char path[48];
+    index_path(path, sizeof(path));
+    SdFile file;
+    if (!file.open(path, O_RDONLY)) return false;
+
+    CatalogHeader hdr;
+    bool ok = file.read(&hdr, sizeof(hdr)) == sizeof(hdr) &&
+              hdr.magic == CATALOG_MAGIC && hdr.version == CATALOG_VERSION &&
+              hdr.recordSize == sizeof(AppInfo) && hdr.count <= UINT16_MAX &&
+              file.fileSize() == sizeof(hdr) + hdr.count * sizeof(AppInfo) &&
+              reserve(hdr.count);
+    if (ok && hdr.count) {
+        size_t body = hdr.count * sizeof(AppInfo);
+        ok = file.read(s_apps, body) == (int)body &&
+             crc32_le(0, (const uint8_t *)s_apps, body) == hdr.crc;
+    }
+    file.close();
+    if (!ok) {
+        Serial.println("[Catalog] Index missing or corrupt, will rebuild");
+        return false;
+    }
+    s_count = hdr.count;
+    return true;
+}
+
+void app_catalog_revalidate_begin() {
+    close_scan();
+    s_changed = false;
+    if (!s_scanDir.open(s_root, O_RDONLY)) {
+        Serial.printf("[Catalog] Failed to open %s\n", s_root);
+        return;
+    }
+    for (uint16_t i = 0; i < s_count; i++) s_apps[i].flags |= APP_STALE;
+    s_phase = SCAN_LIST;
+}
+
+bool app_catalog_revalidate_step(uint16_t budget, bool *changed) {
+    while (budget > 0 && s_phase != SCAN_IDLE) {
+        budget--;
+        if (s_phase == SCAN_HASH) {
+            int n = s_hashFile.read(s_hashBuf, sizeof(s_hashBuf));
+            if (n > 0) {
+                s_hashCrc = crc32_le(s_hashCrc, s_hashBuf, n);
+                continue;
+            }
+            AppInfo &hashed = s_apps[s_hashIdx];
+            hashed.hash = s_hashCrc;
+            hashed.flags |= APP_HASH_VALID;
+            hashed.dirDate = s_hashDirDate;
+            hashed.dirTime = s_hashDirTime;
+            s_hashFile.close();
+            s_hashIdx = -1;
+            s_phase = SCAN_LIST;
+            continue;
+        }
+
+        SdFile entry;
+        if (!entry.openNext(&s_scanDir, O_RDONLY)) {
+            finish_pass();
+            break;
+        }
+        char name[APP_NAME_LEN];
+        entry.getName(name, sizeof(name));
+        bool isDir = entry.isDir();
+        uint16_t date = 0, time = 0;
+        entry.getModifyDateTime(&date, &time);
+        entry.close();
+        if (!isDir || name[0] == '.') continue;
+
+        int idx = find_index(name);
+        if (idx >= 0) {
+            AppInfo &app = s_apps[idx];
+            app.flags &= ~APP_STALE;
+            if (app.dirDate == date && app.dirTime == time && firmware_unchanged(app)) continue;
+        } else {
+            if (!reserve(s_count + 1)) continue;
+            idx = s_count++;
+            memset(&s_apps[idx], 0, sizeof(AppInfo));
+            strncpy(s_apps[idx].name, name, APP_NAME_LEN - 1);
+        }
+
+        s_changed = true;
+        if (!scan_app_dir(s_apps[idx])) continue;   // Stamps untouched: retried next pass
+        start_hash(idx, date, time);
+    }
+
+    if (s_phase != SCAN_IDLE) return false;
+    if (changed) *changed = s_changed;
+    return true;
+}
+
+bool app_catalog_rebuild(const char *root) {
+    close_scan();
+    strncpy(s_root, root, sizeof(s_root) - 1);
+    s_root[sizeof(s_root) - 1] = '\0';
+    s_count = 0;
+    app_catalog_revalidate_begin();
+    if (s_phase == SCAN_IDLE) return false;
+    bool changed = false;
+    while (!app_catalog_revalidate_step(UINT16_MAX, &changed)) {
+    }
+    if (!changed) save_index();  // Empty directory still gets a valid index
+    return true;
+}
+
+uint16_t app_catalog_count() {
+    return s_count;
+}
+
+const AppInfo *app_catalog_get(uint16_t index) {
+    return index < s_count ? &s_apps[index] : nullptr;
+}
+
+const AppInfo *app_catalog_find(const char *name) {
+    int idx = find_index(name);
+    return idx >= 0 ? &s_apps[idx] : nullptr;
+}
+
+static void bench_root(char *out, size_t len, uint16_t apps) {
+    snprintf(out, len, APP_BENCH_ROOT "/apps%u", apps);
+}
+
+int app_catalog_bench_prepare(uint16_t apps, uint16_t budget) {
+    char root[24];
+    bench_root(root, sizeof(root), apps);
+    if (apps != s_benchApps) {
+        if (!check_and_create_dir(APP_BENCH_ROOT) || !check_and_create_dir(root)) return -1;
+        s_benchApps = apps;
+        s_benchNext = 0;
+    }
+    static const uint8_t payload[512] = {0xE9};  // Image magic, then zeros
+    char path[64];
+    for (; budget > 0 && s_benchNext < apps; budget--, s_benchNext++) {
+        snprintf(path, sizeof(path), "%s/app%03u", root, s_benchNext);
+        if (sd.exists(path)) continue;
+        if (!sd.mkdir(path)) return -1;
+        dir_cache_note_write(path);
+        sd_space_note_clusters(1);
+
+        snprintf(path, sizeof(path), "%s/app%03u/firmware.bin", root, s_benchNext);
+        SdFile fw;
+        if (!fw.open(path, O_WRONLY | O_CREAT | O_TRUNC)) return -1;
+        bool ok = true;
+        for (int k = 0; k < 8; k++) ok = fw.write(payload, sizeof(payload)) == sizeof(payload) && ok;
+        if (!fw.close() || !ok) return -1;
+        sd_space_note_file(0, 8 * sizeof(payload));
+    }
+    return apps - s_benchNext;
+}
+
+bool app_catalog_bench_run(uint16_t apps, AppCatalogBench &out) {
+    char root[24];
+    bench_root(root, sizeof(root), apps);
+    memset(&out, 0, sizeof(out));
+    out.apps = apps;
+
+    uint32_t t0 = millis();
+    SdFile dir, entry;
+    if (!dir.open(root, O_RDONLY)) return false;
+    while (entry.openNext(&dir, O_RDONLY)) entry.close();
+    dir.close();
+    out.legacyMs = millis() - t0;
+
+    // The rebuild starts from an empty catalog; it never reads the old index
+    t0 = millis();
+    bool ok = app_catalog_rebuild(root);
+    out.coldMs = millis() - t0;
+    out.indexed = app_catalog_count();
+
+    t0 = millis();
+    ok = app_catalog_load(root) && ok;
+    out.warmMs = millis() - t0;
+
+    Serial.printf("[Catalog] %u apps: legacy walk %lu ms, cold rebuild %lu ms, warm load %lu ms (%u indexed)\n",
+                  apps, (unsigned long)out.legacyMs, (unsigned long)out.coldMs, (unsigned long)out.warmMs,
+                  out.indexed);
+    app_catalog_load(APP_CATALOG_ROOT);
+    return ok && out.indexed == apps;
+}
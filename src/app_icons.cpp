@@ -0,0 +1,343 @@
+/**
+ * @file app_icons.cpp
+ * @brief Implements lazy launcher icons with a background JPEGDEC decoder.
+ *
+ * The LVGL task owns the slot table and the image bindings; the decoder task
+ * only fills slots that the LVGL task has marked as loading. Slot state and
+ * counters are shared through a spinlock.
+ */
+#include <Arduino.h>
+#include <SdFat.h>
+#include <JPEGDEC.h>
+#include <string.h>
+#include "app_icons.h"
+#include "app_catalog.h"
+#include "SD_utils.h"
+#include "dir_cache.h"
+#include "sd_space.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#define ICON_PIXELS      (APP_ICON_SIZE * APP_ICON_SIZE)
+#define ICON_BYTES       (ICON_PIXELS * sizeof(uint16_t))
+#define ICON_SLOTS       (APP_ICON_CACHE_BYTES / ICON_BYTES)
+#define ICON_FILE_MAGIC  0x35363549UL  // "I565"
+
+enum SlotState : uint8_t { SLOT_EMPTY, SLOT_LOADING, SLOT_READY, SLOT_FAILED };
+
+struct IconSlot {
+    char name[APP_NAME_LEN];
+    volatile SlotState state;
+    bool needsBind;         ///< Ready pixels not yet pushed to owner
+    uint32_t lastUse;       ///< LRU stamp (bind counter)
+    lv_obj_t *owner;        ///< Image currently showing (or waiting for) this icon
+    lv_img_dsc_t dsc;
+    uint16_t *pixels;
+};
+
+struct IconFileHeader {
+    uint32_t magic;
+    uint32_t jpgSize;
+    uint16_t jpgDate;
+    uint16_t jpgTime;
+};
+
+struct DecodeTarget {
+    uint16_t *pixels;
+    int srcW, srcH;     ///< Decoded (scaled) image size
+    int span;           ///< max(srcW, srcH), maps onto APP_ICON_SIZE
+    int offX, offY;     ///< Centering offset for non-square images
+};
+
+static IconSlot s_slots[ICON_SLOTS];
+static uint16_t *s_pixelPool = nullptr;
+static QueueHandle_t s_queue = NULL;
+static uint32_t s_useClock = 0;
+static AppIconStats s_stats;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static JPEGDEC *s_jpeg = nullptr;
+static SdFile s_jpgFile;
+
+// --- JPEGDEC file callbacks (decoder task, SD lock held per call) ---
+
+static void *jpg_open(const char *path, int32_t *size) {
+    SdLock lock;
+    if (!s_jpgFile.open(path, O_RDONLY)) return nullptr;
+    *size = s_jpgFile.fileSize();
+    return &s_jpgFile;
+}
+
+static void jpg_close(void *handle) {
+    SdLock lock;
+    ((SdFile *)handle)->close();
+}
+
+static int32_t jpg_read(JPEGFILE *file, uint8_t *buf, int32_t len) {
+    SdLock lock;
+    SdFile *f = (SdFile *)file->fHandle;
+    int32_t n = f->read(buf, len);
+    file->iPos = f->curPosition();
+    return n < 0 ? 0 : n;
+}
+
+static int32_t jpg_seek(JPEGFILE *file, int32_t pos) {
+    SdLock lock;
+    SdFile *f = (SdFile *)file->fHandle;
+    if (!f->seekSet(pos)) return -1;
+    file->iPos = pos;
+    return pos;
+}
+
+// Nearest-neighbour downsample of each decoded MCU block into the icon buffer
+static int jpg_draw(JPEGDRAW *draw) {
+    DecodeTarget *t = (DecodeTarget *)draw->pUser;
+    for (int y = 0; y < draw->iHeight; y++) {
+        int sy = draw->y + y;
+        if (sy >= t->srcH) break;
+        int dy = t->offY + sy * APP_ICON_SIZE / t->span;
+        const uint16_t *row = draw->pPixels + y * draw->iWidth;
+        for (int x = 0; x < draw->iWidth; x++) {
+            int sx = draw->x + x;
+            if (sx >= t->srcW) break;
+            int dx = t->offX + sx * APP_ICON_SIZE / t->span;
+            t->pixels[dy * APP_ICON_SIZE + dx] = row[x];
+        }
+    }
+    return 1;
+}
+
+// --- Decoder task ---
+
+static bool load_persisted(const char *path, const IconFileHeader &want, uint16_t *pixels) {
+    SdLock lock;
+    SdFile f;
+    if (!f.open(path, O_RDONLY)) return false;
+    IconFileHeader hdr;
+    bool ok = f.read(&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == ICON_FILE_MAGIC &&
+              hdr.jpgSize == want.jpgSize && hdr.jpgDate == want.jpgDate &&
+              hdr.jpgTime == want.jpgTime && f.read(pixels, ICON_BYTES) == (int)ICON_BYTES;
+    f.close();
+    return ok;
+}
+
+static void save_persisted(const char *path, const IconFileHeader &hdr, const uint16_t *pixels) {
+    SdLock lock;
+    dir_cache_note_write(path);
+    SdFile f;
+    uint32_t oldSize = 0;
+    if (f.open(path, O_RDONLY)) {
+        oldSize = f.fileSize();
+        f.close();
+    }
+    if (!f.open(path, O_WRONLY | O_CREAT | O_TRUNC)) return;
+    bool ok = f.write(&hdr, sizeof(hdr)) == sizeof(hdr) && f.write(pixels, ICON_BYTES) == ICON_BYTES;
+    f.close();
+    if (!ok) sd.remove(path);
+    sd_space_note_file(oldSize, ok ? sizeof(hdr) + ICON_BYTES : 0);
+}
+
+static bool decode_jpeg(const char *path, uint16_t *pixels) {
+    if (!s_jpeg) s_jpeg = new JPEGDEC();
+    if (!s_jpeg || !s_jpeg->open(path, jpg_open, jpg_close, jpg_read, jpg_seek, jpg_draw)) return false;
+
+    // Pick the strongest DCT scaling that still leaves at least APP_ICON_SIZE pixels
+    int w = s_jpeg->getWidth(), h = s_jpeg->getHeight();
+    int span = w > h ? w : h;
+    int shift = 0;
+    while (shift < 3 && (span >> (shift + 1)) >= APP_ICON_SIZE) shift++;
+    static const int scaleOpts[] = {0, JPEG_SCALE_HALF, JPEG_SCALE_QUARTER, JPEG_SCALE_EIGHTH};
+
+    DecodeTarget target;
+    target.pixels = pixels;
+    target.srcW = w >> shift;
+    target.srcH = h >> shift;
+    target.span = span >> shift;
+    if (target.span < 1) target.span = 1;
+    target.offX = (APP_ICON_SIZE - target.srcW * APP_ICON_SIZE / target.span) / 2;
+    target.offY = (APP_ICON_SIZE - target.srcH * APP_ICON_SIZE / target.span) / 2;
+    memset(pixels, 0, ICON_BYTES);
+
+    s_jpeg->setPixelType(RGB565_LITTLE_ENDIAN);  // LV_COLOR_16_SWAP == 0
+    s_jpeg->setUserPointer(&target);
+    bool ok = s_jpeg->decode(0, 0, scaleOpts[shift]) == 1;
+    s_jpeg->close();
+    return ok;
+}
+
+static bool load_icon(IconSlot &slot) {
+    char jpgPath[96], rawPath[96];
+    snprintf(jpgPath, sizeof(jpgPath), "%s/%s/icon.jpg", APP_CATALOG_ROOT, slot.name);
+    snprintf(rawPath, sizeof(rawPath), "%s/%s/icon.565", APP_CATALOG_ROOT, slot.name);
+
+    IconFileHeader hdr = {ICON_FILE_MAGIC, 0, 0, 0};
+    {
+        SdLock lock;
+        SdFile jpg;
+        if (!jpg.open(jpgPath, O_RDONLY)) return false;
+        hdr.jpgSize = jpg.fileSize();
+        jpg.getModifyDateTime(&hdr.jpgDate, &hdr.jpgTime);
+        jpg.close();
+    }
+
+    if (APP_ICON_PERSIST && load_persisted(rawPath, hdr, slot.pixels)) {
+        taskENTER_CRITICAL(&s_mux);
+        s_stats.persistedLoads++;
+        taskEXIT_CRITICAL(&s_mux);
+        return true;
+    }
+
+    uint32_t t0 = micros();
+    bool ok = decode_jpeg(jpgPath, slot.pixels);
+    uint32_t us = micros() - t0;
+    taskENTER_CRITICAL(&s_mux);
+    s_stats.decodes++;
+    s_stats.decodeUsTotal += us;
+    if (us > s_stats.decodeUsMax) s_stats.decodeUsMax = us;
+    taskEXIT_CRITICAL(&s_mux);
+
+    if (ok && APP_ICON_PERSIST) save_persisted(rawPath, hdr, slot.pixels);
+    return ok;
+}
+
+static void icon_task(void *pvParameters) {
+    uint8_t idx;
+    while (1) {
+        if (xQueueReceive(s_queue, &idx, portMAX_DELAY) != pdTRUE) continue;
+        IconSlot &slot = s_slots[idx];
+        bool ok = load_icon(slot);
+        taskENTER_CRITICAL(&s_mux);
+        slot.state = ok ? SLOT_READY : SLOT_FAILED;
+        slot.needsBind = ok;
+        if (!ok) s_stats.failures++;
+        taskEXIT_CRITICAL(&s_mux);
+    }
+}
+
+// --- LVGL side ---
+
+static bool ensure_started() {
+    if (s_queue) return true;
+    s_pixelPool = (uint16_t *)malloc(ICON_SLOTS * ICON_BYTES);
+    if (!s_pixelPool) {
+        Serial.println("[Icons] Failed to allocate icon cache");
+        return false;
+    }
+    for (size_t i = 0; i < ICON_SLOTS; i++) {
+        IconSlot &slot = s_slots[i];
+        memset(&slot, 0, sizeof(slot));
+        slot.pixels = s_pixelPool + i * ICON_PIXELS;
+        slot.dsc.header.cf = LV_IMG_CF_TRUE_COLOR;
+        slot.dsc.header.w = APP_ICON_SIZE;
+        slot.dsc.header.h = APP_ICON_SIZE;
+        slot.dsc.data_size = ICON_BYTES;
+        slot.dsc.data = (const uint8_t *)slot.pixels;
+    }
+    s_queue = xQueueCreate(ICON_SLOTS, sizeof(uint8_t));
+    xTaskCreatePinnedToCore(icon_task, "AppIcons", 6144, NULL, 1, NULL, 1);
+    return true;
+}
+
+static void release_owner(IconSlot &slot) {
+    if (slot.owner && lv_obj_is_valid(slot.owner) && lv_img_get_src(slot.owner) == &slot.dsc) {
+        lv_img_set_src(slot.owner, LV_SYMBOL_DIRECTORY);
+    }
+    slot.owner = nullptr;
+}
+
+void app_icon_unbind(lv_obj_t *img) {
+    for (size_t i = 0; i < ICON_SLOTS; i++) {
+        if (s_slots[i].owner == img) s_slots[i].owner = nullptr;
+    }
+}
+
+void app_icon_bind(const char *appName, lv_obj_t *img) {
+    if (!ensure_started()) return;
+
+    IconSlot *victim = nullptr;
+    for (size_t i = 0; i < ICON_SLOTS; i++) {
+        IconSlot &slot = s_slots[i];
+        bool match = slot.state != SLOT_EMPTY && strncmp(slot.name, appName, APP_NAME_LEN) == 0;
+        if (!match && slot.owner == img) slot.owner = nullptr;  // Recycled row moved to another app
+    }
+    for (size_t i = 0; i < ICON_SLOTS; i++) {
+        IconSlot &slot = s_slots[i];
+        if (slot.state != SLOT_EMPTY && strncmp(slot.name, appName, APP_NAME_LEN) == 0) {
+            bool fresh = slot.owner != img;
+            slot.lastUse = ++s_useClock;
+            if (fresh) {
+                taskENTER_CRITICAL(&s_mux);
+                if (slot.state == SLOT_READY) s_stats.hits++;
+                taskEXIT_CRITICAL(&s_mux);
+                release_owner(slot);
+                slot.owner = img;
+            }
+            if (slot.state == SLOT_READY && lv_img_get_src(img) != &slot.dsc) {
+                lv_img_set_src(img, &slot.dsc);
+            }
+            return;
+        }
+        if (slot.state == SLOT_LOADING) continue;
+        if (!victim || slot.state == SLOT_EMPTY ||
+            (victim->state != SLOT_EMPTY && slot.lastUse < victim->lastUse)) {
+            victim = &slot;
+        }
+    }
+    if (!victim) return;  // Every slot is loading; retried on the next pass
+
+    release_owner(*victim);
+    strncpy(victim->name, appName, APP_NAME_LEN - 1);
+    victim->name[APP_NAME_LEN - 1] = '\0';
+    victim->owner = img;
+    victim->lastUse = ++s_useClock;
+    victim->needsBind = false;
+    taskENTER_CRITICAL(&s_mux);
+    victim->state = SLOT_LOADING;
+    s_stats.misses++;
+    taskEXIT_CRITICAL(&s_mux);
+
+    uint8_t idx = victim - s_slots;
+    if (xQueueSend(s_queue, &idx, 0) != pdTRUE) victim->state = SLOT_EMPTY;
+}
+
+bool app_icons_poll() {
+    bool loading = false;
+    for (size_t i = 0; i < ICON_SLOTS && s_queue; i++) {
+        IconSlot &slot = s_slots[i];
+        taskENTER_CRITICAL(&s_mux);
+        SlotState state = slot.state;
+        bool bind = slot.needsBind;
+        slot.needsBind = false;
+        taskEXIT_CRITICAL(&s_mux);
+        if (state == SLOT_LOADING) loading = true;
+        if (bind && slot.owner && lv_obj_is_valid(slot.owner)) {
+            lv_img_set_src(slot.owner, &slot.dsc);
+        }
+    }
+    return loading;
+}
+
+void app_icons_unbind_all() {
+    for (size_t i = 0; i < ICON_SLOTS; i++) s_slots[i].owner = nullptr;
+}
+
+AppIconStats app_icons_stats() {
+    taskENTER_CRITICAL(&s_mux);
+    AppIconStats copy = s_stats;
+    taskEXIT_CRITICAL(&s_mux);
+    return copy;
+}
+
+void app_icons_print_stats() {
+    AppIconStats st = app_icons_stats();
+    uint32_t lookups = st.hits + st.misses;
+    Serial.printf("[Icons] hits %lu, misses %lu (hit rate %lu%%), decodes %lu (avg %lu us, max %lu us), "
+                  "icon.565 loads %lu, failures %lu\n",
+                  (unsigned long)st.hits, (unsigned long)st.misses,
+                  (unsigned long)(lookups ? st.hits * 100 / lookups : 0),
+                  (unsigned long)st.decodes,
+                  (unsigned long)(st.decodes ? st.decodeUsTotal / st.decodes : 0),
+                  (unsigned long)st.decodeUsMax, (unsigned long)st.persistedLoads,
+                  (unsigned long)st.failures);
+}
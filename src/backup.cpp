@@ -0,0 +1,529 @@
+/**
+ * @file backup.cpp
+ * @brief Implements the streaming backup archive and the two-pass restore.
+ *
+ * Archive layout: an uncompressed ArchiveHeader, then one LZSS stream of
+ * records (all fields little-endian):
+ *
+ *   NVS   type, nsLen, ns, keyLen, key, nvsType, u16 len, value, u32 crc
+ *   FILE  type, pathLen, path, u32 len, data, u32 crc
+ *   END   type, u16 records, u32 rawLen, u32 crc
+ *
+ * Record CRCs cover their value or data; the END CRC covers every stream
+ * byte before the END record.
+ */
+#include <Arduino.h>
+#include <new>
+#include <nvs.h>
+#include <rom/crc.h>
+#include <string.h>
+#include "backup.h"
+#include "config.h"
+#include "lzss.h"
+#include "settings_store.h"
+#include "wifi_creds.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define ARCHIVE_MAGIC    0x4B425943UL  // "CYBK"
+#define ARCHIVE_VERSION  1
+#define BACKUP_TMP       BACKUP_DIR "/device.tmp"
+#define NVS_PART         "nvs"
+#define NVS_NAME_LEN     16            ///< NVS namespace/key limit: 15 characters + NUL
+
+enum RecordType : uint8_t {
+    REC_END = 0,
+    REC_NVS = 1,
+    REC_FILE = 2
+};
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+};
+
+// What a backup contains
+static const char *const kNamespaces[] = {SETTINGS_STORE_NAMESPACE, CONFIG_NAMESPACE, WIFI_CREDS_NAMESPACE};
+static const char *const kFiles[] = {WIFI_CREDS_LEGACY_CSV};
+
+struct Context {
+    union {
+        LzssEncoder enc;
+        LzssDecoder dec;
+    };
+    VfsFile archive;
+    VfsFile file;
+    uint32_t crc;                       ///< Running CRC of the raw stream
+    uint32_t raw;                       ///< Raw stream bytes so far
+    uint16_t records;
+    uint64_t changed;                   ///< Restore: bit per record that differs
+    alignas(8) uint8_t value[BACKUP_VALUE_MAX];
+    alignas(8) uint8_t current[BACKUP_VALUE_MAX];
+    uint8_t chunk[BACKUP_CHUNK];
+    uint8_t cmp[BACKUP_CHUNK];
+    char error[48];
+};
+
+static BackupStatus s_status = {};
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_running = false;
+static BackupOp s_op = BACKUP_OP_NONE;
+static uint32_t s_startMs = 0;
+
+// --- Status ---
+
+static void status_update(BackupState state, const Context *c) {
+    portENTER_CRITICAL(&s_mux);
+    s_status.state = state;
+    if (c) {
+        s_status.records = c->records;
+        s_status.rawBytes = c->raw;
+        if (c->error[0]) strlcpy(s_status.error, c->error, sizeof(s_status.error));
+    }
+    s_status.elapsedMs = millis() - s_startMs;
+    s_status.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+static bool fail(Context *c, const char *why) {
+    if (!c->error[0]) strlcpy(c->error, why, sizeof(c->error));
+    return false;
+}
+
+// --- NVS values ---
+
+// Integer types encode their width in the low nibble (NVS_TYPE_U8 = 0x01, NVS_TYPE_I32 = 0x14, ...)
+static bool is_int_type(uint8_t type) {
+    uint8_t w = type & 0x0F;
+    return (type & 0xE0) == 0 && (w == 1 || w == 2 || w == 4 || w == 8);
+}
+
+static int nvs_read_value(nvs_handle_t h, const char *key, uint8_t type, uint8_t *out, size_t max) {
+    size_t len = max;
+    esp_err_t err;
+    switch (type) {
+        case NVS_TYPE_U8:  err = nvs_get_u8(h, key, (uint8_t *)out); len = 1; break;
+        case NVS_TYPE_I8:  err = nvs_get_i8(h, key, (int8_t *)out); len = 1; break;
+        case NVS_TYPE_U16: err = nvs_get_u16(h, key, (uint16_t *)out); len = 2; break;
+        case NVS_TYPE_I16: err = nvs_get_i16(h, key, (int16_t *)out); len = 2; break;
+        case NVS_TYPE_U32: err = nvs_get_u32(h, key, (uint32_t *)out); len = 4; break;
+        case NVS_TYPE_I32: err = nvs_get_i32(h, key, (int32_t *)out); len = 4; break;
+        case NVS_TYPE_U64: err = nvs_get_u64(h, key, (uint64_t *)out); len = 8; break;
+        case NVS_TYPE_I64: err = nvs_get_i64(h, key, (int64_t *)out); len = 8; break;
+        case NVS_TYPE_STR: err = nvs_get_str(h, key, (char *)out, &len); break;
+        case NVS_TYPE_BLOB: err = nvs_get_blob(h, key, out, &len); break;
+        default: return -1;
+    }
+    return err == ESP_OK ? (int)len : -1;
+}
+
+static esp_err_t nvs_write_value(nvs_handle_t h, const char *key, uint8_t type, const uint8_t *in,
+                                 size_t len) {
+    if (is_int_type(type) && len != (size_t)(type & 0x0F)) return ESP_ERR_INVALID_SIZE;
+    switch (type) {
+        case NVS_TYPE_U8:  return nvs_set_u8(h, key, *(const uint8_t *)in);
+        case NVS_TYPE_I8:  return nvs_set_i8(h, key, *(const int8_t *)in);
+        case NVS_TYPE_U16: return nvs_set_u16(h, key, *(const uint16_t *)in);
+        case NVS_TYPE_I16: return nvs_set_i16(h, key, *(const int16_t *)in);
+        case NVS_TYPE_U32: return nvs_set_u32(h, key, *(const uint32_t *)in);
+        case NVS_TYPE_I32: return nvs_set_i32(h, key, *(const int32_t *)in);
+        case NVS_TYPE_U64: return nvs_set_u64(h, key, *(const uint64_t *)in);
+        case NVS_TYPE_I64: return nvs_set_i64(h, key, *(const int64_t *)in);
+        case NVS_TYPE_STR:
+            if (len == 0 || in[len - 1] != '\0') return ESP_ERR_INVALID_ARG;
+            return nvs_set_str(h, key, (const char *)in);
+        case NVS_TYPE_BLOB: return nvs_set_blob(h, key, in, len);
+        default: return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+// --- Raw stream ---
+
+static bool archive_sink(void *ctx, const uint8_t *data, size_t len) {
+    return ((VfsFile *)ctx)->write(data, len) == len;
+}
+
+static int archive_source(void *ctx, uint8_t *data, size_t len) {
+    return ((VfsFile *)ctx)->read(data, len);
+}
+
+static bool put(Context *c, const void *data, size_t len) {
+    c->crc = crc32_le(c->crc, (const uint8_t *)data, len);
+    c->raw += len;
+    return lzss_encode(&c->enc, data, len) || fail(c, "Write to SD failed");
+}
+
+static bool put_name(Context *c, const char *name) {
+    uint8_t len = (uint8_t)strlen(name);
+    return put(c, &len, 1) && put(c, name, len);
+}
+
+static bool get(Context *c, void *data, size_t len) {
+    uint8_t *out = (uint8_t *)data;
+    size_t done = 0;
+    while (done < len) {
+        int n = lzss_decode(&c->dec, out + done, len - done);
+        if (n <= 0) return fail(c, "Archive truncated");
+        done += n;
+    }
+    c->crc = crc32_le(c->crc, out, len);
+    c->raw += len;
+    return true;
+}
+
+static bool get_name(Context *c, char *name, size_t size) {
+    uint8_t len;
+    if (!get(c, &len, 1)) return false;
+    if (len >= size) return fail(c, "Bad name in archive");
+    name[len] = '\0';
+    return get(c, name, len);
+}
+
+// --- Create ---
+
+static bool write_nvs_namespace(Context *c, const char *ns) {
+    nvs_handle_t h;
+    if (nvs_open(ns, NVS_READONLY, &h) != ESP_OK) return true;   // never written: nothing to save
+    bool ok = true;
+    nvs_iterator_t it = nvs_entry_find(NVS_PART, ns, NVS_TYPE_ANY);
+    while (it && ok) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        int len = nvs_read_value(h, info.key, info.type, c->value, sizeof(c->value));
+        if (len < 0) {
+            Serial.printf("[Backup] Skipping %s/%s (type 0x%02x)\n", ns, info.key, info.type);
+        } else if (c->records >= BACKUP_MAX_RECORDS) {
+            ok = fail(c, "Too many entries");
+        } else {
+            uint8_t type = REC_NVS;
+            uint8_t nvsType = info.type;
+            uint16_t len16 = (uint16_t)len;
+            uint32_t crc = crc32_le(0, c->value, len);
+            ok = put(c, &type, 1) && put_name(c, ns) && put_name(c, info.key) && put(c, &nvsType, 1) &&
+                 put(c, &len16, 2) && put(c, c->value, len) && put(c, &crc, 4);
+            c->records++;
+        }
+        it = nvs_entry_next(it);
+    }
+    nvs_release_iterator(it);
+    nvs_close(h);
+    return ok;
+}
+
+static bool write_file(Context *c, const char *path) {
+    if (!c->file.open(path, VFS_READ)) return true;   // optional
+    if (c->records >= BACKUP_MAX_RECORDS) return fail(c, "Too many entries");
+    uint8_t type = REC_FILE;
+    uint32_t len = c->file.size();
+    bool ok = put(c, &type, 1) && put_name(c, path) && put(c, &len, 4);
+    uint32_t crc = 0;
+    for (uint32_t left = len; ok && left;) {
+        size_t n = left < sizeof(c->chunk) ? left : sizeof(c->chunk);
+        if (c->file.read(c->chunk, n) != (int)n) {
+            ok = fail(c, "Read failed");
+            break;
+        }
+        crc = crc32_le(crc, c->chunk, n);
+        ok = put(c, c->chunk, n);
+        left -= n;
+    }
+    c->file.close();
+    if (ok) ok = put(c, &crc, 4);
+    c->records++;
+    return ok;
+}
+
+static bool run_create(Context *c) {
+    settings_store_flush();     // pending changes belong in the backup
+    if (!vfs_mkdir(BACKUP_DIR) || !c->archive.open(BACKUP_TMP, VFS_WRITE)) {
+        return fail(c, "Can't create archive on SD");
+    }
+    ArchiveHeader hdr = {ARCHIVE_MAGIC, ARCHIVE_VERSION, 0};
+    bool ok = c->archive.write(&hdr, sizeof(hdr)) == sizeof(hdr) || fail(c, "Write to SD failed");
+    lzss_encoder_init(&c->enc, archive_sink, &c->archive);
+
+    for (size_t i = 0; ok && i < sizeof(kNamespaces) / sizeof(kNamespaces[0]); i++) {
+        ok = write_nvs_namespace(c, kNamespaces[i]);
+        status_update(BACKUP_RUNNING, c);
+    }
+    for (size_t i = 0; ok && i < sizeof(kFiles) / sizeof(kFiles[0]); i++) {
+        ok = write_file(c, kFiles[i]);
+        status_update(BACKUP_RUNNING, c);
+    }
+    if (ok) {
+        uint32_t crc = c->crc, raw = c->raw;
+        uint8_t type = REC_END;
+        ok = put(c, &type, 1) && put(c, &c->records, 2) && put(c, &raw, 4) && put(c, &crc, 4);
+    }
+    if (ok) ok = lzss_encoder_finish(&c->enc) || fail(c, "Write to SD failed");
+    if (!c->archive.close() && ok) ok = fail(c, "Write to SD failed");
+
+    if (ok) {
+        vfs_remove(BACKUP_FILE);
+        ok = vfs_rename(BACKUP_TMP, BACKUP_FILE) || fail(c, "Can't replace old archive");
+    } else {
+        vfs_remove(BACKUP_TMP);
+    }
+    portENTER_CRITICAL(&s_mux);
+    s_status.archiveBytes = sizeof(hdr) + c->enc.outBytes;
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+// --- Restore ---
+
+static bool nvs_record(Context *c, bool apply, uint16_t index, nvs_handle_t *h, char *openNs) {
+    char ns[NVS_NAME_LEN], key[NVS_NAME_LEN];
+    uint8_t type;
+    uint16_t len;
+    uint32_t crc;
+    if (!get_name(c, ns, sizeof(ns)) || !get_name(c, key, sizeof(key)) || !get(c, &type, 1) ||
+        !get(c, &len, 2)) {
+        return false;
+    }
+    if (len > sizeof(c->value)) return fail(c, "Bad value in archive");
+    if (!get(c, c->value, len) || !get(c, &crc, 4)) return false;
+    if (crc32_le(0, c->value, len) != crc) return fail(c, "Entry CRC mismatch");
+
+    uint64_t bit = 1ULL << index;
+    if (!apply) {
+        nvs_handle_t rh;
+        bool same = false;
+        if (nvs_open(ns, NVS_READONLY, &rh) == ESP_OK) {
+            int cur = nvs_read_value(rh, key, type, c->current, sizeof(c->current));
+            same = cur == (int)len && memcmp(c->current, c->value, len) == 0;
+            nvs_close(rh);
+        }
+        if (!same) c->changed |= bit;
+        return true;
+    }
+    if (!(c->changed & bit)) return true;
+
+    // One handle per namespace run; committed when the namespace changes
+    if (*h && strcmp(openNs, ns) != 0) {
+        nvs_commit(*h);
+        nvs_close(*h);
+        *h = 0;
+    }
+    if (!*h) {
+        if (nvs_open(ns, NVS_READWRITE, h) != ESP_OK) {
+            *h = 0;
+            return fail(c, "Can't open NVS");
+        }
+        strlcpy(openNs, ns, NVS_NAME_LEN);
+    }
+    esp_err_t err = nvs_write_value(*h, key, type, c->value, len);
+    if (err == ESP_ERR_NVS_TYPE_MISMATCH) {
+        nvs_erase_key(*h, key);
+        err = nvs_write_value(*h, key, type, c->value, len);
+    }
+    return err == ESP_OK || fail(c, "NVS write failed");
+}
+
+static bool file_record(Context *c, bool apply, uint16_t index) {
+    char path[VFS_PATH_LEN], tmp[VFS_PATH_LEN + 4];
+    uint32_t len;
+    if (!get_name(c, path, sizeof(path)) || !get(c, &len, 4)) return false;
+
+    uint64_t bit = 1ULL << index;
+    bool same = false, writing = false;
+    if (!apply) {
+        same = c->file.open(path, VFS_READ) && c->file.size() == len;
+    } else if (c->changed & bit) {
+        snprintf(tmp, sizeof(tmp), "%s.rst", path);
+        writing = c->file.open(tmp, VFS_WRITE);
+        if (!writing) return fail(c, "Can't write restored file");
+    }
+
+    uint32_t crc = 0;
+    bool ok = true;
+    for (uint32_t left = len; ok && left;) {
+        size_t n = left < sizeof(c->chunk) ? left : sizeof(c->chunk);
+        ok = get(c, c->chunk, n);
+        if (!ok) break;
+        crc = crc32_le(crc, c->chunk, n);
+        if (same) same = c->file.read(c->cmp, n) == (int)n && memcmp(c->cmp, c->chunk, n) == 0;
+        if (writing && c->file.write(c->chunk, n) != n) ok = fail(c, "Write to SD failed");
+        left -= n;
+    }
+    uint32_t stored;
+    if (ok) ok = get(c, &stored, 4);
+    if (ok && stored != crc) ok = fail(c, "File CRC mismatch");
+    if (!c->file.close() && writing && ok) ok = fail(c, "Write to SD failed");
+
+    if (!apply) {
+        if (!same) c->changed |= bit;
+    } else if (writing) {
+        if (ok) {
+            vfs_remove(path);
+            ok = vfs_rename(tmp, path) || fail(c, "Can't replace file");
+        } else {
+            vfs_remove(tmp);
+        }
+    }
+    return ok;
+}
+
+// Parse the whole archive; the verify pass only compares, the apply pass writes
+static bool restore_pass(Context *c, bool apply) {
+    if (!c->archive.open(BACKUP_FILE, VFS_READ)) return fail(c, "No backup on SD");
+    ArchiveHeader hdr;
+    if (c->archive.read(&hdr, sizeof(hdr)) != sizeof(hdr) || hdr.magic != ARCHIVE_MAGIC) {
+        c->archive.close();
+        return fail(c, "Not a backup archive");
+    }
+    if (hdr.version != ARCHIVE_VERSION) {
+        c->archive.close();
+        return fail(c, "Unsupported archive version");
+    }
+    lzss_decoder_init(&c->dec, archive_source, &c->archive);
+    c->crc = 0;
+    c->raw = 0;
+    c->records = 0;
+
+    nvs_handle_t h = 0;
+    char openNs[NVS_NAME_LEN] = "";
+    bool ok = true, end = false;
+    while (ok && !end) {
+        uint32_t crcBefore = c->crc, rawBefore = c->raw;
+        uint8_t type;
+        if (!(ok = get(c, &type, 1))) break;
+        if (type != REC_END && c->records >= BACKUP_MAX_RECORDS) {
+            ok = fail(c, "Too many entries");
+            break;
+        }
+        switch (type) {
+            case REC_NVS:
+                ok = nvs_record(c, apply, c->records++, &h, openNs);
+                break;
+            case REC_FILE:
+                ok = file_record(c, apply, c->records++);
+                break;
+            case REC_END: {
+                uint16_t records;
+                uint32_t raw, crc;
+                ok = get(c, &records, 2) && get(c, &raw, 4) && get(c, &crc, 4);
+                if (ok && (records != c->records || raw != rawBefore || crc != crcBefore)) {
+                    ok = fail(c, "Archive CRC mismatch");
+                }
+                end = true;
+                break;
+            }
+            default:
+                ok = fail(c, "Unknown record in archive");
+                break;
+        }
+        if (!apply) status_update(BACKUP_VERIFYING, c);
+    }
+    // Nothing may follow the end record
+    uint8_t extra;
+    if (ok && lzss_decode(&c->dec, &extra, 1) != 0) ok = fail(c, "Trailing data in archive");
+    if (h) {
+        if (ok && nvs_commit(h) != ESP_OK) ok = fail(c, "NVS commit failed");
+        nvs_close(h);
+    }
+    c->archive.close();
+    return ok;
+}
+
+static bool run_restore(Context *c) {
+    settings_store_flush();     // or a pending write would land on top of the restored value
+    c->changed = 0;
+    bool ok = restore_pass(c, false);
+    uint32_t verifyMs = millis() - s_startMs;
+    uint16_t changed = 0;
+    for (uint16_t i = 0; i < c->records; i++) changed += (c->changed >> i) & 1;
+    portENTER_CRITICAL(&s_mux);
+    s_status.verifyMs = verifyMs;
+    s_status.changed = changed;
+    portEXIT_CRITICAL(&s_mux);
+    if (!ok) return false;
+    Serial.printf("[Backup] Verified %u records in %lu ms, %u differ\n", c->records, (unsigned long)verifyMs,
+                  changed);
+    if (changed == 0) return true;
+
+    status_update(BACKUP_RUNNING, c);
+    ok = restore_pass(c, true);
+    // Drop cached copies of what was just overwritten
+    settings_store_invalidate();
+    wifi_creds_invalidate();
+    loadConfig(nullptr);
+    return ok;
+}
+
+// --- Task ---
+
+static void backup_task(void *pvParameters) {
+    Context *c = (Context *)pvParameters;
+    bool ok = s_op == BACKUP_OP_CREATE ? run_create(c) : run_restore(c);
+    status_update(ok ? BACKUP_DONE : BACKUP_FAILED, c);
+
+    BackupStatus st = backup_status();
+    if (ok) {
+        Serial.printf("[Backup] %s: %u records, %lu B raw, %lu B archive in %lu ms\n",
+                      s_op == BACKUP_OP_CREATE ? "Created" : "Restored", st.records, (unsigned long)st.rawBytes,
+                      (unsigned long)st.archiveBytes, (unsigned long)st.elapsedMs);
+    } else {
+        Serial.printf("[Backup] Failed after %lu ms: %s\n", (unsigned long)st.elapsedMs, st.error);
+    }
+    delete c;
+    s_running = false;
+    vTaskDelete(NULL);
+}
+
+static bool launch(BackupOp op) {
+    if (s_running) return false;
+    Context *c = new (std::nothrow) Context();
+    if (!c) {
+        Serial.println("[Backup] Out of memory");
+        return false;
+    }
+    s_running = true;
+    s_op = op;
+    s_startMs = millis();
+    portENTER_CRITICAL(&s_mux);
+    uint32_t gen = s_status.generation;
+    memset(&s_status, 0, sizeof(s_status));
+    s_status.op = op;
+    s_status.state = op == BACKUP_OP_RESTORE ? BACKUP_VERIFYING : BACKUP_RUNNING;
+    s_status.generation = gen + 1;
+    portEXIT_CRITICAL(&s_mux);
+    if (op == BACKUP_OP_RESTORE) {
+        VfsFile f;
+        if (f.open(BACKUP_FILE, VFS_READ)) {
+            portENTER_CRITICAL(&s_mux);
+            s_status.archiveBytes = f.size();
+            portEXIT_CRITICAL(&s_mux);
+        }
+    }
+    if (xTaskCreatePinnedToCore(backup_task, "Backup", 6144, c, 1, NULL, 1) != pdPASS) {
+        delete c;
+        portENTER_CRITICAL(&s_mux);
+        strlcpy(s_status.error, "Can't start task", sizeof(s_status.error));
+        portEXIT_CRITICAL(&s_mux);
+        status_update(BACKUP_FAILED, nullptr);
+        s_running = false;
+        return false;
+    }
+    return true;
+}
+
+bool backup_create_start() {
+    return launch(BACKUP_OP_CREATE);
+}
+
+bool backup_restore_start() {
+    return launch(BACKUP_OP_RESTORE);
+}
+
+bool backup_busy() {
+    return s_running;
+}
+
+BackupStatus backup_status() {
+    portENTER_CRITICAL(&s_mux);
+    BackupStatus st = s_status;
+    portEXIT_CRITICAL(&s_mux);
+    return st;
+}
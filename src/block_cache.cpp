@@ -0,0 +1,251 @@
+/**
+ * @file block_cache.cpp
+ * @brief Implements the read-ahead / write-behind sector cache.
+ *
+ * Not thread-safe by itself: like every other SdFat call it runs under the
+ * SD lock.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "block_cache.h"
+
+#define MAX_LINES 128
+#define STAGE_SECTORS (SD_CACHE_READAHEAD > SD_CACHE_WRITE_BATCH ? SD_CACHE_READAHEAD : SD_CACHE_WRITE_BATCH)
+
+bool BlockCache::begin(FsBlockDevice *dev, uint16_t lines) {
+    end();
+    if (!dev) return false;
+    if (lines < STAGE_SECTORS) lines = STAGE_SECTORS;
+    if (lines > MAX_LINES) lines = MAX_LINES;
+    m_lines = (Line *)calloc(lines, sizeof(Line));
+    m_data = (uint8_t *)malloc((size_t)lines * 512);
+    m_stage = (uint8_t *)malloc(STAGE_SECTORS * 512);
+    if (!m_lines || !m_data || !m_stage) {
+        end();
+        return false;
+    }
+    m_dev = dev;
+    m_count = lines;
+    m_dirty = 0;
+    m_nextSeq = UINT32_MAX;
+    m_seqRun = 0;
+    resetStats();
+    return true;
+}
+
+void BlockCache::end() {
+    if (m_dev) flush();
+    free(m_lines);
+    free(m_data);
+    free(m_stage);
+    m_lines = nullptr;
+    m_data = m_stage = nullptr;
+    m_dev = nullptr;
+    m_count = m_dirty = 0;
+}
+
+int BlockCache::find(uint32_t sector) {
+    for (int i = 0; i < m_count; i++) {
+        if (m_lines[i].valid && m_lines[i].sector == sector) return i;
+    }
+    return -1;
+}
+
+int BlockCache::victim() {
+    int lru = -1;
+    for (int i = 0; i < m_count; i++) {
+        if (!m_lines[i].valid) return i;
+        if (lru < 0 || m_lines[i].lastUse < m_lines[lru].lastUse) lru = i;
+    }
+    // Evicting a dirty line writes back the whole batch, in order
+    if (m_lines[lru].dirty && !writeBack()) return -1;
+    return lru;
+}
+
+bool BlockCache::writeBack() {
+    if (m_dirty == 0) return true;
+
+    uint16_t order[MAX_LINES];
+    uint16_t n = 0;
+    for (uint16_t i = 0; i < m_count; i++) {
+        if (m_lines[i].valid && m_lines[i].dirty) order[n++] = i;
+    }
+    // Insertion sort by sector; n is at most a few dozen
+    for (uint16_t i = 1; i < n; i++) {
+        uint16_t v = order[i];
+        uint16_t j = i;
+        while (j > 0 && m_lines[order[j - 1]].sector > m_lines[v].sector) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = v;
+    }
+
+    bool ok = true;
+    for (uint16_t i = 0; i < n;) {
+        // Coalesce consecutive sectors into one multi-block write
+        uint16_t run = 1;
+        while (i + run < n && run < STAGE_SECTORS &&
+               m_lines[order[i + run]].sector == m_lines[order[i]].sector + run) {
+            run++;
+        }
+        for (uint16_t k = 0; k < run; k++) memcpy(m_stage + k * 512, data(order[i + k]), 512);
+        if (m_dev->writeSectors(m_lines[order[i]].sector, m_stage, run)) {
+            for (uint16_t k = 0; k < run; k++) m_lines[order[i + k]].dirty = false;
+            m_dirty -= run;
+            m_stats.writeBacks++;
+            m_stats.sectorsWritten += run;
+        } else {
+            ok = false;
+        }
+        i += run;
+    }
+    return ok;
+}
+
+bool BlockCache::fetch(uint32_t sector, uint32_t count) {
+    uint32_t total = m_dev->sectorCount();
+    if (sector + count > total) count = total > sector ? total - sector : 1;
+
+    // Claim the lines before reading: evicting a dirty one writes back
+    // through m_stage, which would clobber the sectors just read
+    int slot[STAGE_SECTORS];
+    for (uint32_t k = 0; k < count; k++) {
+        slot[k] = -1;
+        if (find(sector + k) >= 0) continue;  // Never overwrite a newer (dirty) copy
+        int i = victim();
+        if (i < 0) {
+            if (k == 0) return false;
+            count = k;
+            break;
+        }
+        Line &line = m_lines[i];
+        line.sector = sector + k;
+        line.valid = true;
+        line.dirty = false;
+        line.prefetched = k > 0;
+        line.lastUse = k == 0 ? ++m_clock : m_clock;
+        slot[k] = i;
+    }
+    bool ok = m_dev->readSectors(sector, m_stage, count);
+    for (uint32_t k = 0; k < count; k++) {
+        if (slot[k] < 0) continue;
+        if (ok) {
+            memcpy(data(slot[k]), m_stage + k * 512, 512);
+        } else {
+            m_lines[slot[k]].valid = false;
+        }
+    }
+    return ok;
+}
+
+bool BlockCache::readSector(uint32_t sector, uint8_t *dst) {
+    if (!m_dev) return false;
+    m_seqRun = sector == m_nextSeq ? (m_seqRun < 255 ? m_seqRun + 1 : 255) : 0;
+    m_nextSeq = sector + 1;
+
+    int i = find(sector);
+    if (i >= 0) {
+        m_stats.hits++;
+        if (m_lines[i].prefetched) {
+            m_stats.readAheadHits++;
+            m_lines[i].prefetched = false;
+        }
+    } else {
+        m_stats.misses++;
+        uint32_t count = m_seqRun > 0 ? SD_CACHE_READAHEAD : 1;
+        if (!fetch(sector, count)) return false;
+        if (count > 1) m_stats.readAheadSectors += count - 1;
+        i = find(sector);
+        if (i < 0) return false;
+    }
+    m_lines[i].lastUse = ++m_clock;
+    memcpy(dst, data(i), 512);
+    return true;
+}
+
+bool BlockCache::flushRange(uint32_t sector, size_t ns, bool drop) {
+    bool needWrite = false;
+    for (int i = 0; i < m_count; i++) {
+        Line &line = m_lines[i];
+        if (!line.valid || line.sector < sector || line.sector >= sector + ns) continue;
+        if (drop) {
+            if (line.dirty) m_dirty--;
+            line.valid = line.dirty = false;
+        } else if (line.dirty) {
+            needWrite = true;
+        }
+    }
+    return !needWrite || writeBack();
+}
+
+bool BlockCache::readSectors(uint32_t sector, uint8_t *dst, size_t ns) {
+    if (!m_dev) return false;
+    if (ns >= SD_CACHE_BYPASS) {
+        // The card must have the newest data before we read around the cache
+        if (!flushRange(sector, ns, false)) return false;
+        m_stats.bypassReads++;
+        m_nextSeq = sector + ns;
+        return m_dev->readSectors(sector, dst, ns);
+    }
+    for (size_t k = 0; k < ns; k++) {
+        if (!readSector(sector + k, dst + k * 512)) return false;
+    }
+    return true;
+}
+
+bool BlockCache::writeSector(uint32_t sector, const uint8_t *src) {
+    if (!m_dev) return false;
+    int i = find(sector);
+    if (i < 0 && (i = victim()) < 0) return false;
+    Line &line = m_lines[i];
+    memcpy(data(i), src, 512);
+    if (!line.valid || !line.dirty) m_dirty++;
+    line.sector = sector;
+    line.valid = true;
+    line.dirty = true;
+    line.prefetched = false;
+    line.lastUse = ++m_clock;
+    m_stats.writesAbsorbed++;
+    return m_dirty < SD_CACHE_WRITE_BATCH || writeBack();
+}
+
+bool BlockCache::writeSectors(uint32_t sector, const uint8_t *src, size_t ns) {
+    if (!m_dev) return false;
+    if (ns >= SD_CACHE_BYPASS) {
+        flushRange(sector, ns, true);  // Cached copies are about to be stale
+        m_stats.bypassWrites++;
+        return m_dev->writeSectors(sector, src, ns);
+    }
+    for (size_t k = 0; k < ns; k++) {
+        if (!writeSector(sector + k, src + k * 512)) return false;
+    }
+    return true;
+}
+
+bool BlockCache::flush() {
+    if (!m_dev) return false;
+    if (m_dirty) m_stats.flushes++;
+    return writeBack();
+}
+
+bool BlockCache::syncDevice() {
+    return flush() && m_dev->syncDevice();
+}
+
+uint16_t BlockCache::discard() {
+    uint16_t dropped = m_dirty;
+    for (int i = 0; i < m_count; i++) m_lines[i].dirty = false;
+    m_dirty = 0;
+    end();
+    return dropped;
+}
+
+bool BlockCache::invalidate() {
+    if (!m_dev) return true;
+    bool ok = flush();
+    for (int i = 0; i < m_count; i++) m_lines[i].valid = false;
+    m_nextSeq = UINT32_MAX;
+    m_seqRun = 0;
+    return ok;
+}
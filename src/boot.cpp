@@ -0,0 +1,127 @@
+/**
+ * @file boot.cpp
+ * @brief Implements the boot stage runner and timeline.
+ *
+ * Each stage task blocks on an event group until the bits of its
+ * dependencies are set, then runs and sets its own bit. Dependencies must
+ * point at earlier table entries, which rules out cycles (and the hang
+ * they would cause) when the table is checked up front.
+ */
+#include "boot.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+#define STAGE_TASK_PRIORITY  2
+
+struct BootEvent {
+    const char *name;
+    int64_t startUs;
+    int64_t endUs;
+    int8_t core;            ///< -1 for milestones
+    bool ok;
+};
+
+struct StageCtx {
+    const BootStage *stage;
+    uint8_t index;
+    bool ok;
+};
+
+static BootEvent s_events[BOOT_MAX_EVENTS];
+static uint8_t s_eventCount = 0;
+static bool s_printed = false;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+// Never deleted: a stage task may still be returning from xEventGroupSetBits() when boot_run() wakes
+static EventGroupHandle_t s_done = nullptr;
+
+static void record(const char *name, int64_t startUs, int64_t endUs, int8_t core, bool ok) {
+    portENTER_CRITICAL(&s_mux);
+    if (s_eventCount < BOOT_MAX_EVENTS) {
+        s_events[s_eventCount++] = {name, startUs, endUs, core, ok};
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+static void stage_task(void *pvParameters) {
+    StageCtx *ctx = (StageCtx *)pvParameters;
+    const BootStage *stage = ctx->stage;
+    if (stage->deps) xEventGroupWaitBits(s_done, stage->deps, pdFALSE, pdTRUE, portMAX_DELAY);
+    int64_t start = esp_timer_get_time();
+    ctx->ok = stage->run();
+    record(stage->name, start, esp_timer_get_time(), (int8_t)xPortGetCoreID(), ctx->ok);
+    xEventGroupSetBits(s_done, BOOT_DEP(ctx->index));
+    vTaskDelete(NULL);
+}
+
+bool boot_run(const BootStage *stages, size_t count) {
+    if (count == 0 || count > BOOT_MAX_STAGES) return false;
+    for (size_t i = 0; i < count; i++) {
+        if (stages[i].deps & ~(BOOT_DEP(i) - 1)) {
+            Serial.printf("[Boot] Stage %s depends on itself or a later stage\n", stages[i].name);
+            return false;
+        }
+    }
+    if (!s_done) s_done = xEventGroupCreate();
+    if (!s_done) return false;
+    xEventGroupClearBits(s_done, BOOT_DEP(count) - 1);
+
+    StageCtx ctx[BOOT_MAX_STAGES];
+    for (size_t i = 0; i < count; i++) {
+        ctx[i] = {&stages[i], (uint8_t)i, false};
+        uint16_t stack = stages[i].stack ? stages[i].stack : BOOT_STAGE_STACK;
+        if (xTaskCreatePinnedToCore(stage_task, stages[i].name, stack, &ctx[i], STAGE_TASK_PRIORITY, NULL,
+                                    stages[i].core) != pdPASS) {
+            // Let dependents go ahead without it, as if it had failed
+            int64_t now = esp_timer_get_time();
+            record(stages[i].name, now, now, -1, false);
+            xEventGroupSetBits(s_done, BOOT_DEP(i));
+        }
+    }
+    xEventGroupWaitBits(s_done, BOOT_DEP(count) - 1, pdFALSE, pdTRUE, portMAX_DELAY);
+
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) ok &= ctx[i].ok;
+    Serial.printf("[Boot] %u stages done at %lu ms%s\n", (unsigned)count,
+                  (unsigned long)(esp_timer_get_time() / 1000), ok ? "" : " (with failures)");
+    return ok;
+}
+
+void boot_mark(const char *name) {
+    int64_t now = esp_timer_get_time();
+    record(name, now, now, -1, true);
+}
+
+void boot_print_timeline() {
+    BootEvent events[BOOT_MAX_EVENTS];
+    portENTER_CRITICAL(&s_mux);
+    bool printed = s_printed;
+    s_printed = true;
+    uint8_t n = s_eventCount;
+    memcpy(events, s_events, n * sizeof(BootEvent));
+    portEXIT_CRITICAL(&s_mux);
+    if (printed) return;
+
+    // Order by start time; stages were recorded as they finished
+    for (uint8_t i = 1; i < n; i++) {
+        BootEvent e = events[i];
+        uint8_t j = i;
+        for (; j > 0 && events[j - 1].startUs > e.startUs; j--) events[j] = events[j - 1];
+        events[j] = e;
+    }
+
+    Serial.println("[Boot] Timeline (ms since reset):");
+    for (uint8_t i = 0; i < n; i++) {
+        const BootEvent &e = events[i];
+        unsigned long start = (unsigned long)(e.startUs / 1000);
+        if (e.core < 0 && e.ok) {
+            Serial.printf("[Boot]   %6lu          * %s\n", start, e.name);
+        } else {
+            Serial.printf("[Boot]   %6lu..%6lu  %-12s %5lu ms  core %d%s\n", start,
+                          (unsigned long)(e.endUs / 1000), e.name, (unsigned long)((e.endUs - e.startUs) / 1000),
+                          e.core, e.ok ? "" : "  FAILED");
+        }
+    }
+}
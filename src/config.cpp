@@ -1,33 +1,103 @@
+/**
+ * @file config.cpp
+ * @brief Implements the NVS configuration store and the legacy JSON import.
+ *
+ * Schema changes bump CONFIG_SCHEMA_VERSION and add a case to migrate():
+ * older blobs are read into their own layout and converted, never
+ * reinterpreted as the new struct.
+ */
 #include "config.h"
 #include <ArduinoJson.h>
-#include <FS.h>
-#include <SPIFFS.h>
+#include <nvs.h>
+#include "vfs.h"
+
+#define CONFIG_KEY_VER   "ver"
+#define CONFIG_KEY_BLOB  "cfg"
+#define CONFIG_JSON_MAX  1024
 
 DeviceConfig g_config;
 
-bool loadConfig(const char* path) {
-    if (!SPIFFS.begin(true)) {
-        Serial.println("Failed to mount SPIFFS");
-        return false;
+// Bring an older blob up to the current layout; none exist yet
+static bool migrate(uint8_t version, nvs_handle_t h) {
+    switch (version) {
+        default:
+            Serial.printf("[Config] No migration from schema %u\n", version);
+            return false;
     }
-    File file = SPIFFS.open(path, "r");
-    if (!file) {
-        Serial.println("Failed to open config file");
-        return false;
+}
+
+static bool load_nvs() {
+    nvs_handle_t h;
+    if (nvs_open(CONFIG_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return false;
+    uint8_t version = 0;
+    bool ok = nvs_get_u8(h, CONFIG_KEY_VER, &version) == ESP_OK;
+    if (ok && version == CONFIG_SCHEMA_VERSION) {
+        size_t len = sizeof(g_config);
+        ok = nvs_get_blob(h, CONFIG_KEY_BLOB, &g_config, &len) == ESP_OK && len == sizeof(g_config);
+    } else if (ok) {
+        ok = migrate(version, h);
+    }
+    nvs_close(h);
+    if (!ok) memset(&g_config, 0, sizeof(g_config));
+    return ok;
+}
+
+bool saveConfig() {
+    nvs_handle_t h;
+    if (nvs_open(CONFIG_NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return false;
+    bool ok = nvs_set_blob(h, CONFIG_KEY_BLOB, &g_config, sizeof(g_config)) == ESP_OK &&
+              nvs_set_u8(h, CONFIG_KEY_VER, CONFIG_SCHEMA_VERSION) == ESP_OK && nvs_commit(h) == ESP_OK;
+    nvs_close(h);
+    return ok;
+}
+
+static void import_field(char *field, size_t size, JsonVariantConst value, const char *key) {
+    const char *text = value | "";
+    if (strlcpy(field, text, size) >= size) {
+        Serial.printf("[Config] %s truncated to %u characters\n", key, (unsigned)(size - 1));
+    }
+}
+
+// One-time import; the JSON document only lives for this call
+static bool import_legacy(const char *path) {
+    char *text = (char *)malloc(CONFIG_JSON_MAX);
+    if (!text) return false;
+    bool ok = vfs_read_all(path, text, CONFIG_JSON_MAX) >= 0;
+    if (ok) {
+        JsonDocument doc;
+        ok = !deserializeJson(doc, (const char *)text);
+        if (ok) {
+            memset(&g_config, 0, sizeof(g_config));
+            import_field(g_config.wifi_ssid, sizeof(g_config.wifi_ssid), doc["wifi_ssid"], "wifi_ssid");
+            import_field(g_config.wifi_password, sizeof(g_config.wifi_password), doc["wifi_password"],
+                         "wifi_password");
+            import_field(g_config.deviceId, sizeof(g_config.deviceId), doc["deviceId"], "deviceId");
+            import_field(g_config.department, sizeof(g_config.department), doc["department"], "department");
+            import_field(g_config.stationId, sizeof(g_config.stationId), doc["stationId"], "stationId");
+            import_field(g_config.location, sizeof(g_config.location), doc["location"], "location");
+            import_field(g_config.firmwareVersion, sizeof(g_config.firmwareVersion), doc["firmwareVersion"],
+                         "firmwareVersion");
+        } else {
+            Serial.println("[Config] Failed to parse legacy config file");
+        }
+    }
+    free(text);
+    return ok;
+}
+
+bool loadConfig(const char *legacyPath) {
+    uint32_t t0 = micros();
+    if (load_nvs()) {
+        Serial.printf("[Config] Loaded schema %u from NVS in %lu us\n", CONFIG_SCHEMA_VERSION,
+                      (unsigned long)(micros() - t0));
+        return true;
     }
-    StaticJsonDocument<256> doc;
-    DeserializationError err = deserializeJson(doc, file);
-    file.close();
-    if (err) {
-        Serial.println("Failed to parse config file");
+    if (!legacyPath || !import_legacy(legacyPath)) {
+        Serial.println("[Config] No configuration in NVS and no legacy file to import");
         return false;
     }
-    g_config.wifi_ssid = doc["wifi_ssid"] | "";
-    g_config.wifi_password = doc["wifi_password"] | "";
-    g_config.deviceId = doc["deviceId"] | "";
-    g_config.department = doc["department"] | "";
-    g_config.stationId = doc["stationId"] | "";
-    g_config.location = doc["location"] | "";
-    g_config.firmwareVersion = doc["firmwareVersion"] | "";
+    bool saved = saveConfig();
+    Serial.printf("[Config] Imported %s in %lu us%s\n", legacyPath, (unsigned long)(micros() - t0),
+                  saved ? "" : " (NVS save failed, will import again)");
     return true;
-} 
\ No newline at end of file
+}
@@ -0,0 +1,339 @@
+/**
+ * @file dir_cache.cpp
+ * @brief Implements the directory listing cache and its prefetch task.
+ *
+ * The slot table is shared between the LVGL task and the prefetch task and is
+ * guarded by its own mutex. SD access always takes the SD lock first and the
+ * cache mutex second, never the other way round.
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "dir_cache.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+
+#define DIR_CACHE_HISTORY   16   // Remembered parent -> child visits
+#define PREFETCH_PAGE       32   // Entries read per SD lock hold
+
+struct CacheSlot {
+    bool used;
+    bool prefetched;        ///< Loaded by the prefetch task and not yet hit
+    char key[DIR_CACHE_PATH_LEN];
+    DirSig sig;
+    uint32_t lastUse;
+    EntryStore listing;
+};
+
+struct VisitRec {
+    uint32_t parentHash;
+    uint32_t stamp;
+    char child[64];
+};
+
+static CacheSlot s_slots[DIR_CACHE_SLOTS];
+static VisitRec s_visits[DIR_CACHE_HISTORY];
+static uint32_t s_clock = 0;
+static DirCacheStats s_stats;
+static QueueHandle_t s_prefetchQueue = NULL;
+
+static SemaphoreHandle_t cache_mutex() {
+    static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+    return mutex;
+}
+
+class CacheLock {
+public:
+    CacheLock() { xSemaphoreTake(cache_mutex(), portMAX_DELAY); }
+    ~CacheLock() { xSemaphoreGive(cache_mutex()); }
+};
+
+// Collapse repeated slashes and drop a trailing one so "//a/b/" == "/a/b"
+static bool make_key(const char *path, char *key) {
+    size_t n = 0;
+    key[n++] = '/';
+    for (const char *p = path; *p; p++) {
+        if (*p == '/' && key[n - 1] == '/') continue;
+        if (n >= DIR_CACHE_PATH_LEN - 1) return false;
+        key[n++] = *p;
+    }
+    if (n > 1 && key[n - 1] == '/') n--;
+    key[n] = '\0';
+    return true;
+}
+
+static uint32_t hash_key(const char *key) {
+    uint32_t h = 2166136261u;  // FNV-1a
+    while (*key) {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static CacheSlot *find_slot(const char *key) {
+    for (size_t i = 0; i < DIR_CACHE_SLOTS; i++) {
+        if (s_slots[i].used && strcmp(s_slots[i].key, key) == 0) return &s_slots[i];
+    }
+    return nullptr;
+}
+
+static void drop_slot(CacheSlot &slot) {
+    slot.used = false;
+    slot.prefetched = false;
+    slot.listing.release();
+}
+
+static size_t cached_bytes() {
+    size_t total = 0;
+    for (size_t i = 0; i < DIR_CACHE_SLOTS; i++) {
+        if (s_slots[i].used) total += s_slots[i].listing.footprint();
+    }
+    return total;
+}
+
+static CacheSlot *lru_slot() {
+    CacheSlot *lru = nullptr;
+    for (size_t i = 0; i < DIR_CACHE_SLOTS; i++) {
+        if (s_slots[i].used && (!lru || s_slots[i].lastUse < lru->lastUse)) lru = &s_slots[i];
+    }
+    return lru;
+}
+
+// Caller holds the cache lock. With @p take the listing is moved, not copied.
+static void store_locked(const char *key, const DirSig &sig, EntryStore &listing, bool take,
+                         bool prefetched) {
+    size_t need = take ? listing.footprint() : listing.usedBytes();
+    if (need > DIR_CACHE_BYTES) return;
+
+    CacheSlot *slot = find_slot(key);
+    if (slot) drop_slot(*slot);
+
+    // Evict least recently used listings until both budgets fit
+    while (cached_bytes() + need > DIR_CACHE_BYTES) {
+        CacheSlot *lru = lru_slot();
+        if (!lru) break;
+        drop_slot(*lru);
+        s_stats.evictions++;
+    }
+    if (!slot) {
+        for (size_t i = 0; i < DIR_CACHE_SLOTS && !slot; i++) {
+            if (!s_slots[i].used) slot = &s_slots[i];
+        }
+    }
+    if (!slot) {
+        slot = lru_slot();
+        drop_slot(*slot);
+        s_stats.evictions++;
+    }
+
+    if (take) {
+        slot->listing.release();
+        slot->listing.swap(listing);
+    } else if (!slot->listing.assign(listing)) {
+        slot->listing.release();
+        return;
+    }
+    strcpy(slot->key, key);
+    slot->sig = sig;
+    slot->lastUse = ++s_clock;
+    slot->prefetched = prefetched;
+    slot->used = true;
+}
+
+bool dir_cache_signature(SdFile &dir, DirSig &sig) {
+    memset(&sig, 0, sizeof(sig));
+    sig.firstSector = dir.firstSector();
+    sig.size = dir.fileSize();
+    if (!dir.getModifyDateTime(&sig.date, &sig.time)) sig.date = sig.time = 0;
+    return sig.firstSector != 0 || sig.size != 0;
+}
+
+bool dir_cache_get(const char *path, SdFile &dir, EntryStore &out) {
+    char key[DIR_CACHE_PATH_LEN];
+    if (!make_key(path, key)) return false;
+
+    DirSig sig;
+    {
+        SdLock lock;
+        dir_cache_signature(dir, sig);
+    }
+
+    CacheLock lock;
+    s_stats.lookups++;
+    CacheSlot *slot = find_slot(key);
+    if (!slot) return false;
+    if (memcmp(&slot->sig, &sig, sizeof(sig)) != 0) {
+        drop_slot(*slot);
+        s_stats.stale++;
+        return false;
+    }
+    if (!out.assign(slot->listing)) return false;
+    slot->lastUse = ++s_clock;
+    s_stats.hits++;
+    if (slot->prefetched) {
+        s_stats.prefetchHits++;
+        slot->prefetched = false;
+    }
+    return true;
+}
+
+void dir_cache_put(const char *path, const DirSig &sig, const EntryStore &listing) {
+    char key[DIR_CACHE_PATH_LEN];
+    if (!make_key(path, key)) return;
+    CacheLock lock;
+    store_locked(key, sig, const_cast<EntryStore &>(listing), false, false);
+}
+
+void dir_cache_invalidate(const char *path) {
+    char key[DIR_CACHE_PATH_LEN];
+    if (!make_key(path, key)) return;
+    CacheLock lock;
+    CacheSlot *slot = find_slot(key);
+    if (slot) drop_slot(*slot);
+}
+
+void dir_cache_note_write(const char *filePath) {
+    char key[DIR_CACHE_PATH_LEN];
+    if (!make_key(filePath, key)) return;
+    char *slash = strrchr(key, '/');
+    if (slash == key) slash[1] = '\0';
+    else *slash = '\0';
+    CacheLock lock;
+    CacheSlot *slot = find_slot(key);
+    if (slot) drop_slot(*slot);
+}
+
+void dir_cache_invalidate_all() {
+    CacheLock lock;
+    for (size_t i = 0; i < DIR_CACHE_SLOTS; i++) {
+        if (s_slots[i].used) drop_slot(s_slots[i]);
+    }
+}
+
+void dir_cache_note_visit(const char *parent, const char *child) {
+    char key[DIR_CACHE_PATH_LEN];
+    if (!make_key(parent, key)) return;
+    uint32_t h = hash_key(key);
+
+    CacheLock lock;
+    VisitRec *rec = nullptr;
+    for (size_t i = 0; i < DIR_CACHE_HISTORY; i++) {
+        if (s_visits[i].parentHash == h) {
+            rec = &s_visits[i];
+            break;
+        }
+        if (!rec || s_visits[i].stamp < rec->stamp) rec = &s_visits[i];
+    }
+    rec->parentHash = h;
+    rec->stamp = ++s_clock;
+    strncpy(rec->child, child, sizeof(rec->child) - 1);
+    rec->child[sizeof(rec->child) - 1] = '\0';
+}
+
+// --- Prefetch task ---
+
+static bool fill_cb(const DirEntryInfo &info, void *ctx) {
+    return ((EntryStore *)ctx)->add(info.name, info.size, info.flags, info.date, info.time);
+}
+
+static void prefetch_one(const char *key) {
+    {
+        CacheLock lock;
+        if (find_slot(key)) return;
+    }
+
+    SdFile dir;
+    DirSig sig;
+    {
+        SdLock lock;
+        if (!open_dir(dir, key)) return;
+        dir_cache_signature(dir, sig);
+    }
+
+    // Read in pages so the LVGL task never waits long for the card
+    EntryStore listing;
+    DirCursor cursor;
+    bool ok = true;
+    while (ok && !cursor.done) {
+        if (uxQueueMessagesWaiting(s_prefetchQueue) > 0) break;  // User moved on
+        SdLock lock;
+        ok = dir_enumerate(dir, cursor, PREFETCH_PAGE, DIR_WANT_TYPE | DIR_WANT_MTIME,
+                           fill_cb, &listing) >= 0 &&
+             listing.count() <= DIR_CACHE_PREFETCH_MAX;
+    }
+    {
+        SdLock lock;
+        dir.close();
+    }
+    if (!ok || !cursor.done) return;
+
+    CacheLock lock;
+    store_locked(key, sig, listing, true, true);
+    s_stats.prefetches++;
+}
+
+static void prefetch_task(void *pvParameters) {
+    char key[DIR_CACHE_PATH_LEN];
+    while (1) {
+        if (xQueueReceive(s_prefetchQueue, key, portMAX_DELAY) != pdTRUE) continue;
+        prefetch_one(key);
+    }
+}
+
+void dir_cache_prefetch_next(const char *path, const EntryStore &listing) {
+    char key[DIR_CACHE_PATH_LEN];
+    if (!make_key(path, key)) return;
+    uint32_t h = hash_key(key);
+
+    // Prefer the child last opened from here, then the first subdirectory
+    const char *pick = nullptr;
+    {
+        CacheLock lock;
+        for (size_t i = 0; i < DIR_CACHE_HISTORY; i++) {
+            if (s_visits[i].stamp && s_visits[i].parentHash == h) {
+                for (uint32_t k = 0; k < listing.count(); k++) {
+                    if (listing.isDir(k) && strcmp(listing.name(k), s_visits[i].child) == 0) {
+                        pick = listing.name(k);
+                        break;
+                    }
+                }
+                break;
+            }
+        }
+    }
+    for (uint32_t k = 0; k < listing.count() && !pick; k++) {
+        if (listing.isDir(k) && !(listing.rec(k).flags & ENTRY_HIDDEN)) pick = listing.name(k);
+    }
+    if (!pick) return;
+
+    char child[DIR_CACHE_PATH_LEN];
+    int n = snprintf(child, sizeof(child), "%s/%s", key, pick);
+    if (n < 0 || n >= (int)sizeof(child) || !make_key(child, key)) return;
+
+    if (!s_prefetchQueue) {
+        s_prefetchQueue = xQueueCreate(1, DIR_CACHE_PATH_LEN);
+        xTaskCreatePinnedToCore(prefetch_task, "DirPrefetch", 4096, NULL, 1, NULL, 1);
+    }
+    xQueueOverwrite(s_prefetchQueue, key);  // Only the latest guess matters
+}
+
+DirCacheStats dir_cache_stats() {
+    CacheLock lock;
+    return s_stats;
+}
+
+void dir_cache_print_stats() {
+    DirCacheStats st;
+    size_t bytes;
+    {
+        CacheLock lock;
+        st = s_stats;
+        bytes = cached_bytes();
+    }
+    Serial.printf("[DirCache] %lu/%lu hits (%lu%%), %lu stale, %lu evicted, prefetched %lu (%lu used), %u bytes\n",
+                  (unsigned long)st.hits, (unsigned long)st.lookups,
+                  (unsigned long)(st.lookups ? st.hits * 100 / st.lookups : 0),
+                  (unsigned long)st.stale, (unsigned long)st.evictions,
+                  (unsigned long)st.prefetches, (unsigned long)st.prefetchHits, (unsigned)bytes);
+}
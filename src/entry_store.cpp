@@ -0,0 +1,89 @@
+/**
+ * @file entry_store.cpp
+ * @brief Implements the compact directory entry store.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "entry_store.h"
+
+EntryStore::~EntryStore() {
+    release();
+}
+
+bool EntryStore::reserve(uint32_t entries, uint32_t nameBytes) {
+    if (entries > m_cap) {
+        EntryRec *recs = (EntryRec *)realloc(m_recs, entries * sizeof(EntryRec));
+        if (!recs) return false;
+        m_recs = recs;
+        m_cap = entries;
+    }
+    if (nameBytes > m_arenaCap) {
+        char *arena = (char *)realloc(m_arena, nameBytes);
+        if (!arena) return false;
+        m_arena = arena;
+        m_arenaCap = nameBytes;
+    }
+    return true;
+}
+
+bool EntryStore::add(const char *name, uint32_t size, uint8_t flags, uint16_t date, uint16_t time) {
+    size_t len = strlen(name);
+    if (len > 255) len = 255;
+
+    // Grow geometrically so a long listing costs O(log n) reallocs
+    uint32_t wantRecs = m_count + 1 > m_cap ? (m_cap ? m_cap * 2 : 32) : m_cap;
+    uint32_t wantArena = m_arenaUsed + len + 1;
+    if (wantArena > m_arenaCap) {
+        uint32_t grown = m_arenaCap ? m_arenaCap * 2 : 512;
+        wantArena = grown > wantArena ? grown : wantArena;
+    } else {
+        wantArena = m_arenaCap;
+    }
+    if (!reserve(wantRecs, wantArena)) return false;
+
+    EntryRec &r = m_recs[m_count++];
+    r.nameOff = m_arenaUsed;
+    r.size = size;
+    r.date = date;
+    r.time = time;
+    r.nameLen = (uint8_t)len;
+    r.flags = flags;
+    r.reserved = 0;
+    memcpy(m_arena + m_arenaUsed, name, len);
+    m_arena[m_arenaUsed + len] = '\0';
+    m_arenaUsed += len + 1;
+    return true;
+}
+
+bool EntryStore::assign(const EntryStore &other) {
+    clear();
+    if (!reserve(other.m_count, other.m_arenaUsed)) return false;
+    if (other.m_count) memcpy(m_recs, other.m_recs, other.m_count * sizeof(EntryRec));
+    if (other.m_arenaUsed) memcpy(m_arena, other.m_arena, other.m_arenaUsed);
+    m_count = other.m_count;
+    m_arenaUsed = other.m_arenaUsed;
+    return true;
+}
+
+void EntryStore::swap(EntryStore &other) {
+    char *arena = m_arena;           m_arena = other.m_arena;           other.m_arena = arena;
+    uint32_t arenaUsed = m_arenaUsed; m_arenaUsed = other.m_arenaUsed; other.m_arenaUsed = arenaUsed;
+    uint32_t arenaCap = m_arenaCap;  m_arenaCap = other.m_arenaCap;    other.m_arenaCap = arenaCap;
+    EntryRec *recs = m_recs;         m_recs = other.m_recs;             other.m_recs = recs;
+    uint32_t count = m_count;        m_count = other.m_count;           other.m_count = count;
+    uint32_t cap = m_cap;            m_cap = other.m_cap;               other.m_cap = cap;
+}
+
+void EntryStore::clear() {
+    m_count = 0;
+    m_arenaUsed = 0;
+}
+
+void EntryStore::release() {
+    free(m_recs);
+    free(m_arena);
+    m_recs = nullptr;
+    m_arena = nullptr;
+    m_count = m_cap = 0;
+    m_arenaUsed = m_arenaCap = 0;
+}
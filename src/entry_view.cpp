@@ -0,0 +1,131 @@
+/**
+ * @file entry_view.cpp
+ * @brief Implements sorting and prefix filtering over an EntryStore.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include "entry_view.h"
+
+struct EntryLess {
+    const EntryStore *store;
+    EntrySortKey key;
+
+    bool operator()(uint16_t a, uint16_t b) const {
+        const EntryRec &ra = store->rec(a);
+        const EntryRec &rb = store->rec(b);
+        bool da = ra.flags & ENTRY_DIR, db = rb.flags & ENTRY_DIR;
+        if (da != db) return da;
+
+        switch (key) {
+            case ENTRY_SORT_SIZE:
+                if (ra.size != rb.size) return ra.size > rb.size;
+                break;
+            case ENTRY_SORT_DATE: {
+                uint32_t ta = ((uint32_t)ra.date << 16) | ra.time;
+                uint32_t tb = ((uint32_t)rb.date << 16) | rb.time;
+                if (ta != tb) return ta > tb;
+                break;
+            }
+            default:
+                break;
+        }
+        int c = strcasecmp(store->name(a), store->name(b));
+        return c != 0 ? c < 0 : a < b;  // Ties keep directory order
+    }
+};
+
+EntryView::~EntryView() {
+    release();
+}
+
+void EntryView::release() {
+    free(m_order);
+    free(m_visible);
+    m_order = m_visible = nullptr;
+    m_count = m_visibleCount = m_cap = 0;
+}
+
+bool EntryView::grow(uint32_t entries) {
+    if (entries <= m_cap) return true;
+    uint32_t cap = m_cap ? m_cap * 2 : 64;
+    if (cap < entries) cap = entries;
+    if (cap > ENTRY_VIEW_MAX) cap = ENTRY_VIEW_MAX;
+    uint16_t *order = (uint16_t *)realloc(m_order, cap * sizeof(uint16_t));
+    if (!order) return false;
+    m_order = order;
+    uint16_t *visible = (uint16_t *)realloc(m_visible, cap * sizeof(uint16_t));
+    if (!visible) return false;
+    m_visible = visible;
+    m_cap = cap;
+    return true;
+}
+
+void EntryView::reset(const EntryStore *store) {
+    m_store = store;
+    m_count = m_visibleCount = 0;
+    m_truncated = false;
+}
+
+bool EntryView::matches(uint32_t index) const {
+    return m_filterLen == 0 || strncasecmp(m_store->name(index), m_filter, m_filterLen) == 0;
+}
+
+bool EntryView::sync() {
+    if (!m_store) return true;
+    uint32_t want = m_store->count();
+    if (want > ENTRY_VIEW_MAX) {
+        want = ENTRY_VIEW_MAX;
+        m_truncated = true;
+    }
+    // Without memory for all of them, index what still fits
+    if (want > m_count && !grow(want)) {
+        want = m_cap;
+        m_truncated = true;
+    }
+    for (uint32_t i = m_count; i < want; i++) {
+        m_order[i] = (uint16_t)i;
+        if (matches(i)) m_visible[m_visibleCount++] = (uint16_t)i;
+    }
+    if (want > m_count) m_count = want;
+    return !m_truncated;
+}
+
+void EntryView::sort(EntrySortKey key) {
+    m_key = key;
+    if (!m_store || m_count == 0) return;
+    if (key == ENTRY_SORT_NONE) {
+        for (uint32_t i = 0; i < m_count; i++) m_order[i] = (uint16_t)i;
+    } else {
+        std::sort(m_order, m_order + m_count, EntryLess{m_store, key});
+    }
+    refilter(false);
+}
+
+void EntryView::refilter(bool narrow) {
+    if (narrow) {
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < m_visibleCount; i++) {
+            if (matches(m_visible[i])) m_visible[n++] = m_visible[i];
+        }
+        m_visibleCount = n;
+        return;
+    }
+    m_visibleCount = 0;
+    for (uint32_t i = 0; i < m_count; i++) {
+        if (matches(m_order[i])) m_visible[m_visibleCount++] = m_order[i];
+    }
+}
+
+void EntryView::setFilter(const char *prefix) {
+    if (!prefix) prefix = "";
+    size_t len = strlen(prefix);
+    if (len > ENTRY_VIEW_FILTER_LEN) len = ENTRY_VIEW_FILTER_LEN;
+    // Typing another character only ever removes entries
+    bool narrow = len >= m_filterLen && strncasecmp(prefix, m_filter, m_filterLen) == 0;
+    memcpy(m_filter, prefix, len);
+    m_filter[len] = '\0';
+    m_filterLen = (uint8_t)len;
+    if (m_store) refilter(narrow);
+}
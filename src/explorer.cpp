@@ -3,34 +3,381 @@
  * @brief Implements the file explorer UI and directory navigation logic for cydOS.
  *
  * Handles SD card directory listing, navigation, and file operations.
+ * Listings are streamed page by page: the first screenful is shown at once and
+ * the remainder is appended from an LVGL timer. Complete listings go into the
+ * directory cache, which also prefetches the next likely folder. Rows are
+ * shown through an EntryView so sorting and type-to-filter never touch the SD.
+ * Long-pressing a row offers copy, move and delete; those run as background
+ * file jobs and a bar above the dock shows their progress. Tapping a file
+ * opens it in the streaming viewer.
  */
 #include "explorer.h"
 #include <lvgl.h>
 #include "launcher.h"
 #include "event_handlers.h"
+#include "vlist.h"
+#include "dir_cache.h"
+#include "entry_view.h"
+#include "file_jobs.h"
+#include "file_viewer.h"
+#include "sd_mount.h"
+#include "lv_heap.h"
+#include "alloc_trace.h"
 #include <stdlib.h>
 
-// Free user data callback
-static void free_user_data_event_cb(lv_event_t *e) {
-    if (lv_event_get_code(e) == LV_EVENT_DELETE) {
-        void *user_data = lv_obj_get_user_data(lv_event_get_target(e));
-        if (user_data) free(user_data);
+#define EXPLORER_ROW_H 36
+#define EXPLORER_FIRST_PAGE 16      // Enough to fill the first screen
+#define EXPLORER_PAGE 32            // Entries appended per background tick
+#define EXPLORER_PAGE_PERIOD_MS 10
+#define EXPLORER_TOOLBAR_H 36
+#define EXPLORER_DOCK_H 55
+#define EXPLORER_JOB_BAR_H 30
+#define EXPLORER_JOB_PERIOD_MS 250
+
+static char current_path[128] = "/"; // We all start at the root, if you know what I mean
+static uint32_t path_mount_gen = 0;     // Mount current_path was opened on
+
+// Listing of current_path; lives on the system heap, not in the LVGL pool
+static EntryStore entries;
+static SdFile load_dir;             // Kept open while the rest of the listing streams in
+static DirCursor load_cursor;
+static DirSig load_sig;             // Signature taken when the listing started
+static lv_timer_t *load_timer = NULL;
+static uint32_t load_started_ms = 0;
+
+// Sorted/filtered order of entries; the sort order survives directory changes
+static EntryView view;
+static EntrySortKey sort_key = ENTRY_SORT_NONE;
+static lv_obj_t *entry_list = NULL;
+static lv_obj_t *search_kb = NULL;
+static lv_obj_t *truncated_label = NULL;
+
+static const char *const sort_labels[ENTRY_SORT_COUNT] = {"Raw", "Name", "Size", "Date"};
+
+// Copy/move source picked from the row menu, pasted into whichever folder is open
+static char clip_path[FILE_JOB_PATH_LEN] = "";
+static FileJobOp clip_op = FILE_JOB_NONE;
+static char menu_path[FILE_JOB_PATH_LEN];
+
+static lv_obj_t *job_bar = NULL;
+static lv_obj_t *job_label = NULL;
+static lv_obj_t *job_btn_label = NULL;
+static lv_timer_t *job_timer = NULL;
+static uint32_t job_generation = 0;
+static FileJobState job_seen = FILE_JOB_IDLE;
+static bool job_result_dismissed = true;
+
+static const char *const job_op_labels[] = {"", "Copy", "Move", "Delete", "Bench"};
+
+static void bind_entry_row(lv_obj_t *row, uint32_t pos, void *user) {
+    uint32_t index = view.at(pos);
+    lv_img_set_src(lv_obj_get_child(row, 0), entries.isDir(index) ? LV_SYMBOL_DIRECTORY : LV_SYMBOL_FILE);
+    if (entries.isDir(index)) {
+        lv_label_set_text(lv_obj_get_child(row, 1), entries.name(index));
+    } else {
+        lv_label_set_text_fmt(lv_obj_get_child(row, 1), "%s (%lu KB)", entries.name(index),
+                              (unsigned long)(entries.size(index) / 1024));
     }
 }
 
-void showFileExplorer(lv_event_t *e) {
-    static bool sd_ok = false;
-    if (!is_initialized) { // First time? Let me show you around...
-        sd_ok = init_sd_card();
-        if (!sd_ok) {
-            Serial.println("SD init failed! Disabling file explorer features.");
-            // Optionally show a warning, but do not abort
+static void stop_background_load() {
+    if (load_timer) {
+        lv_timer_del(load_timer);
+        load_timer = NULL;
+    }
+    if (load_dir.isOpen()) {
+        SdLock lock;
+        load_dir.close();
+    }
+}
+
+static void show_view() {
+    if (!entry_list) return;
+    vlist_set_count(entry_list, view.count());
+    vlist_refresh(entry_list);
+}
+
+// Out of memory for the index: show what fits, say so, and stop reading
+static void show_truncated() {
+    Serial.printf("Explorer: list truncated at %lu of %lu entries\n", (unsigned long)view.total(),
+                  (unsigned long)entries.count());
+    stop_background_load();
+    if (truncated_label) lv_obj_clear_flag(truncated_label, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void listing_complete(bool cached) {
+    Serial.printf("Explorer: %lu entries (%u bytes) in %lu ms%s\n", (unsigned long)entries.count(),
+                  (unsigned)entries.footprint(), (unsigned long)(millis() - load_started_ms),
+                  cached ? " (cached)" : "");
+    if (!cached) dir_cache_put(current_path, load_sig, entries);
+    dir_cache_print_stats();
+    sd_cache_print_stats();
+    dir_cache_prefetch_next(current_path, entries);
+
+    if (sort_key != ENTRY_SORT_NONE) {
+        uint32_t t0 = micros();
+        view.sort(sort_key);
+        Serial.printf("Explorer: sorted by %s in %lu us\n", sort_labels[sort_key],
+                      (unsigned long)(micros() - t0));
+        show_view();
+    }
+}
+
+static void load_timer_cb(lv_timer_t *timer) {
+    // Runs from lv_timer_handler(), long after showFileExplorer() returned
+    ALLOC_SCOPE(ALLOC_TAG_EXPLORER);
+    lv_obj_t *list = (lv_obj_t *)timer->user_data;
+    {
+        SdLock lock;
+        // Resume after the last stored entry, even if the last page stopped short of memory
+        list_files_page(load_dir, load_cursor, entries.count(), EXPLORER_PAGE, entries);
+    }
+    bool complete = view.sync();
+    vlist_set_count(list, view.count());
+    if (!complete) {
+        show_truncated();
+        return;
+    }
+    if (!load_cursor.done) return;
+
+    stop_background_load();
+    listing_complete(false);
+}
+
+static void explorer_list_delete_cb(lv_event_t *e) {
+    stop_background_load();
+    entry_list = NULL;
+    search_kb = NULL;
+    truncated_label = NULL;
+}
+
+static void sort_btn_event_handler(lv_event_t *e) {
+    sort_key = (EntrySortKey)((sort_key + 1) % ENTRY_SORT_COUNT);
+    lv_label_set_text(lv_obj_get_child(lv_event_get_target(e), 0), sort_labels[sort_key]);
+    // A listing still streaming in is sorted once it is complete
+    if (load_timer) return;
+    uint32_t t0 = micros();
+    view.sort(sort_key);
+    Serial.printf("Explorer: sorted by %s in %lu us\n", sort_labels[sort_key],
+                  (unsigned long)(micros() - t0));
+    show_view();
+}
+
+static void search_event_handler(lv_event_t *e) {
+    lv_obj_t *ta = lv_event_get_target(e);
+    switch (lv_event_get_code(e)) {
+        case LV_EVENT_FOCUSED:
+            if (search_kb) {
+                lv_keyboard_set_textarea(search_kb, ta);
+                lv_obj_clear_flag(search_kb, LV_OBJ_FLAG_HIDDEN);
+            }
+            break;
+        case LV_EVENT_DEFOCUSED:
+            if (search_kb) lv_obj_add_flag(search_kb, LV_OBJ_FLAG_HIDDEN);
+            break;
+        case LV_EVENT_VALUE_CHANGED: {
+            uint32_t t0 = micros();
+            view.setFilter(lv_textarea_get_text(ta));
+            Serial.printf("Explorer: filter \"%s\" -> %lu entries in %lu us\n", view.filter(),
+                          (unsigned long)view.count(), (unsigned long)(micros() - t0));
+            show_view();
+            break;
         }
-        is_initialized = true;
+        default:
+            break;
+    }
+}
+
+static void search_kb_event_handler(lv_event_t *e) {
+    lv_event_code_t code = lv_event_get_code(e);
+    if (code == LV_EVENT_READY || code == LV_EVENT_CANCEL) {
+        lv_obj_t *kb = lv_event_get_target(e);
+        lv_obj_t *ta = lv_keyboard_get_textarea(kb);
+        if (ta) lv_obj_clear_state(ta, LV_STATE_FOCUSED);
+        lv_obj_add_flag(kb, LV_OBJ_FLAG_HIDDEN);
     }
+}
 
-    if (!sd_ok) {
+// Search box and sort toggle above the list
+static void draw_explorer_toolbar(lv_obj_t *scr) {
+    lv_obj_t *ta = lv_textarea_create(scr);
+    lv_obj_set_size(ta, 240 - 64, EXPLORER_TOOLBAR_H);
+    lv_obj_align(ta, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_textarea_set_one_line(ta, true);
+    lv_textarea_set_max_length(ta, ENTRY_VIEW_FILTER_LEN);
+    lv_textarea_set_placeholder_text(ta, "Filter...");
+    lv_obj_add_event_cb(ta, search_event_handler, LV_EVENT_ALL, NULL);
+
+    lv_obj_t *sort_btn = lv_btn_create(scr);
+    lv_obj_set_size(sort_btn, 60, EXPLORER_TOOLBAR_H);
+    lv_obj_align(sort_btn, LV_ALIGN_TOP_RIGHT, 0, 0);
+    lv_obj_add_event_cb(sort_btn, sort_btn_event_handler, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *sort_label = lv_label_create(sort_btn);
+    lv_label_set_text(sort_label, sort_labels[sort_key]);
+    lv_obj_center(sort_label);
+
+    // Drawn last so it sits above the list and dock when shown
+    search_kb = lv_keyboard_create(scr);
+    lv_obj_set_size(search_kb, 240, 120);
+    lv_obj_align(search_kb, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_obj_add_flag(search_kb, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_event_cb(search_kb, search_kb_event_handler, LV_EVENT_ALL, NULL);
+}
+
+static void update_job_bar() {
+    if (!job_bar) return;
+    FileJobStatus st = file_job_status();
+    const char *op = job_op_labels[st.op <= FILE_JOB_BENCH ? st.op : 0];
+
+    if (file_job_busy()) {
+        if (st.state == FILE_JOB_SCANNING) {
+            lv_label_set_text_fmt(job_label, "%s %s: counting...", op, st.name);
+        } else {
+            uint32_t pct = st.bytesTotal ? (uint32_t)(st.bytesDone * 100 / st.bytesTotal)
+                                         : (st.filesTotal ? st.filesDone * 100 / st.filesTotal : 0);
+            lv_label_set_text_fmt(job_label, "%s %lu%% %lu KB/s %lu:%02lu", op, (unsigned long)pct,
+                                  (unsigned long)st.kbPerSec, (unsigned long)(st.etaSec / 60),
+                                  (unsigned long)(st.etaSec % 60));
+        }
+        lv_label_set_text(job_btn_label, LV_SYMBOL_CLOSE);
+    } else if (clip_op != FILE_JOB_NONE) {
+        const char *slash = strrchr(clip_path, '/');
+        lv_label_set_text_fmt(job_label, "%s here: %s", job_op_labels[clip_op], slash ? slash + 1 : clip_path);
+        lv_label_set_text(job_btn_label, LV_SYMBOL_PASTE);
+    } else if (!job_result_dismissed && st.state >= FILE_JOB_DONE) {
+        static const char *const results[] = {"done", "failed", "cancelled"};
+        lv_label_set_text_fmt(job_label, "%s %s: %lu files, %lu s", op, results[st.state - FILE_JOB_DONE],
+                              (unsigned long)st.filesDone, (unsigned long)(st.elapsedMs / 1000));
+        lv_label_set_text(job_btn_label, LV_SYMBOL_OK);
+    } else {
+        lv_obj_add_flag(job_bar, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+    lv_obj_clear_flag(job_bar, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void job_timer_cb(lv_timer_t *timer) {
+    FileJobStatus st = file_job_status();
+    bool finished = st.state >= FILE_JOB_DONE && (job_seen == FILE_JOB_SCANNING || job_seen == FILE_JOB_RUNNING);
+    job_seen = st.state;
+    if (st.generation != job_generation) {
+        job_generation = st.generation;
+        update_job_bar();
+    }
+    // The job invalidated whatever it touched; reload so the listing shows it
+    if (finished && !load_timer) showFileExplorer(NULL);
+}
+
+static void job_btn_event_handler(lv_event_t *e) {
+    if (file_job_busy()) {
+        file_job_cancel();
+    } else if (clip_op != FILE_JOB_NONE) {
+        job_result_dismissed = false;
+        if (!file_job_start(clip_op, clip_path, current_path)) {
+            Serial.printf("Explorer: can't %s %s into %s\n", job_op_labels[clip_op], clip_path, current_path);
+        }
+        clip_op = FILE_JOB_NONE;
+    } else {
+        job_result_dismissed = true;
+    }
+    update_job_bar();
+}
+
+static void job_bar_delete_cb(lv_event_t *e) {
+    if (job_timer) lv_timer_del(job_timer);
+    job_timer = NULL;
+    job_bar = NULL;
+    job_label = NULL;
+    job_btn_label = NULL;
+}
+
+// Progress of the running job, or the pending paste, just above the dock
+static void draw_job_bar(lv_obj_t *scr) {
+    job_bar = lv_obj_create(scr);
+    lv_obj_set_size(job_bar, 240, EXPLORER_JOB_BAR_H);
+    lv_obj_align(job_bar, LV_ALIGN_BOTTOM_MID, 0, -EXPLORER_DOCK_H);
+    lv_obj_set_style_pad_all(job_bar, 2, 0);
+    lv_obj_clear_flag(job_bar, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_event_cb(job_bar, job_bar_delete_cb, LV_EVENT_DELETE, NULL);
+
+    job_label = lv_label_create(job_bar);
+    lv_obj_set_width(job_label, 240 - 52);
+    lv_label_set_long_mode(job_label, LV_LABEL_LONG_DOT);
+    lv_obj_align(job_label, LV_ALIGN_LEFT_MID, 2, 0);
+
+    lv_obj_t *btn = lv_btn_create(job_bar);
+    lv_obj_set_size(btn, 40, EXPLORER_JOB_BAR_H - 6);
+    lv_obj_align(btn, LV_ALIGN_RIGHT_MID, 0, 0);
+    lv_obj_add_event_cb(btn, job_btn_event_handler, LV_EVENT_CLICKED, NULL);
+    job_btn_label = lv_label_create(btn);
+    lv_obj_center(job_btn_label);
+
+    FileJobStatus st = file_job_status();
+    job_seen = st.state;
+    job_generation = st.generation;
+    update_job_bar();
+    job_timer = lv_timer_create(job_timer_cb, EXPLORER_JOB_PERIOD_MS, NULL);
+}
+
+static void delete_confirm_event_handler(lv_event_t *e) {
+    lv_obj_t *mbox = lv_event_get_current_target(e);
+    const char *txt = lv_msgbox_get_active_btn_text(mbox);
+    if (!txt) return;
+    if (strcmp(txt, "Delete") == 0) {
+        job_result_dismissed = false;
+        if (!file_job_start(FILE_JOB_DELETE, menu_path, NULL)) {
+            Serial.printf("Explorer: can't delete %s\n", menu_path);
+        }
+    }
+    lv_msgbox_close(mbox);
+    update_job_bar();
+}
+
+// Deleting a folder takes everything in it, so name the path and ask first
+static void confirm_delete() {
+    static const char *confirm_btns[] = {"Delete", "Cancel", ""};
+    char text[FILE_JOB_PATH_LEN + 64];
+    snprintf(text, sizeof(text), "Delete %s?\nA folder is deleted with everything in it.", menu_path);
+    lv_obj_t *mbox = lv_msgbox_create(NULL, "Delete", text, confirm_btns, false);
+    lv_obj_add_event_cb(mbox, delete_confirm_event_handler, LV_EVENT_VALUE_CHANGED, NULL);
+    lv_obj_center(mbox);
+}
+
+static void entry_menu_event_handler(lv_event_t *e) {
+    lv_obj_t *mbox = lv_event_get_current_target(e);
+    const char *txt = lv_msgbox_get_active_btn_text(mbox);
+    if (!txt) return;
+    if (strcmp(txt, "Delete") == 0) {
+        lv_msgbox_close(mbox);
+        confirm_delete();
+        return;
+    }
+    clip_op = strcmp(txt, "Move") == 0 ? FILE_JOB_MOVE : FILE_JOB_COPY;
+    strncpy(clip_path, menu_path, sizeof(clip_path) - 1);
+    clip_path[sizeof(clip_path) - 1] = '\0';
+    lv_msgbox_close(mbox);
+    update_job_bar();
+}
+
+static void entry_long_press_handler(lv_event_t *e) {
+    uint32_t pos = vlist_row_index(lv_event_get_target(e));
+    if (pos >= view.count()) return;
+    lv_indev_wait_release(lv_indev_get_act());  // No click (and navigation) on release
+    uint32_t index = view.at(pos);
+    snprintf(menu_path, sizeof(menu_path), "%s/%s", current_path, entries.name(index));
+
+    static const char *menu_btns[] = {"Copy", "Move", "Delete", ""};
+    lv_obj_t *mbox = lv_msgbox_create(NULL, entries.name(index), NULL, menu_btns, true);
+    lv_obj_add_event_cb(mbox, entry_menu_event_handler, LV_EVENT_VALUE_CHANGED, NULL);
+    lv_obj_center(mbox);
+}
+
+void showFileExplorer(lv_event_t *e) {
+    ALLOC_SCOPE(ALLOC_TAG_EXPLORER);
+    lv_heap_screen("explorer");
+    if (!sd_mounted()) {
         // SD not available, show a warning or minimal UI
+        sd_mount_request();  // A card inserted just now mounts in the background
         lv_obj_t *scr = lv_scr_act();
         lv_obj_clean(scr);
         lv_obj_t *label = lv_label_create(scr);
@@ -38,44 +385,87 @@ void showFileExplorer(lv_event_t *e) {
         lv_obj_align(label, LV_ALIGN_CENTER, 0, 0);
         return;
     }
-
-    SdFile dir;
-    if (!open_dir(dir, current_path)) {
-        showError("Failed to open current directory");
-        return;
+    // A different (or re-inserted) card may not have the folder we were in
+    uint32_t mount_gen = sd_mount_generation();
+    if (mount_gen != path_mount_gen) {
+        strcpy(current_path, "/");
+        path_mount_gen = mount_gen;
     }
 
+    // Cleaning deletes the old list, which also stops any listing still streaming in
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
+    stop_background_load();
 
-    lv_obj_t *list = lv_list_create(scr);
-    lv_obj_set_size(list, 240, 280);
-    lv_obj_align(list, LV_ALIGN_CENTER, 0, 0);
-
-  
+    load_started_ms = millis();
+    {
+        SdLock lock;
+        if (!open_dir(load_dir, current_path)) {
+            showError("Failed to open current directory");
+            return;
+        }
+    }
 
-    std::vector<FileInfo> files = list_files_in_dir(dir);
-    for (const auto &file : files) {
-        char file_info[128];
-        snprintf(file_info, sizeof(file_info), "%s (%d KB)", file.name, file.size / 1024);
-        lv_obj_t *btn = lv_list_add_btn(list, NULL, file_info);
-        char *file_name_copy = strdup(file.name);
-        lv_obj_set_user_data(btn, file_name_copy);
-        lv_obj_add_event_cb(btn, dir_event_handler, LV_EVENT_CLICKED, file_name_copy);
-        lv_obj_add_event_cb(btn, free_user_data_event_cb, LV_EVENT_DELETE, NULL);
+    entries.clear();
+    load_cursor = DirCursor();
+    bool cached = dir_cache_get(current_path, load_dir, entries);
+    if (cached) {
+        load_cursor.done = true;
+    } else {
+        // First screenful synchronously, the rest from a timer so input stays live
+        SdLock lock;
+        dir_cache_signature(load_dir, load_sig);
+        list_files_page(load_dir, load_cursor, 0, EXPLORER_FIRST_PAGE, entries);
     }
 
-    dir.close();
+    // A new directory starts unfiltered
+    view.setFilter("");
+    view.reset(&entries);
+    bool complete = view.sync();
+
+    lv_obj_t *list = vlist_create(scr, 240, 320 - EXPLORER_TOOLBAR_H - EXPLORER_DOCK_H, EXPLORER_ROW_H,
+                                  bind_entry_row, dir_event_handler, NULL);
+    lv_obj_align(list, LV_ALIGN_TOP_MID, 0, EXPLORER_TOOLBAR_H);
+    vlist_set_count(list, view.count());
+    lv_obj_add_event_cb(list, explorer_list_delete_cb, LV_EVENT_DELETE, NULL);
+    vlist_set_long_press_cb(list, entry_long_press_handler);
+    entry_list = list;
+
+    truncated_label = lv_label_create(scr);
+    lv_label_set_text(truncated_label, LV_SYMBOL_WARNING " List truncated");
+    lv_obj_set_style_bg_opa(truncated_label, LV_OPA_COVER, 0);
+    lv_obj_align(truncated_label, LV_ALIGN_BOTTOM_MID, 0, -EXPLORER_DOCK_H);
+    lv_obj_add_flag(truncated_label, LV_OBJ_FLAG_HIDDEN);
+
+    if (!complete) {
+        show_truncated();
+    } else if (load_cursor.done) {
+        stop_background_load();
+        listing_complete(cached);
+    } else {
+        load_timer = lv_timer_create(load_timer_cb, EXPLORER_PAGE_PERIOD_MS, list);
+    }
 
     drawExplorerNavBar();
+    draw_job_bar(scr);
+    draw_explorer_toolbar(scr);
 }
 
 void dir_event_handler(lv_event_t *e) {
-    lv_obj_t *btn = lv_event_get_target(e);
-    const char *dirName = (const char *)lv_obj_get_user_data(btn);
+    uint32_t pos = vlist_row_index(lv_event_get_target(e));
+    if (pos >= view.count()) return;
+    uint32_t index = view.at(pos);
+
+    if (!entries.isDir(index)) {
+        char file_path[128];
+        snprintf(file_path, sizeof(file_path), "%s/%s", current_path, entries.name(index));
+        file_viewer_open(file_path);
+        return;
+    }
+    dir_cache_note_visit(current_path, entries.name(index));
 
     char new_path[128];
-    snprintf(new_path, sizeof(new_path), "%s/%s", current_path, dirName);
+    snprintf(new_path, sizeof(new_path), "%s/%s", current_path, entries.name(index));
     strncpy(current_path, new_path, sizeof(current_path));
 
     showFileExplorer(e);
@@ -123,7 +513,13 @@ void confirm_create_dir_event_handler(lv_event_t *e) {
     lv_obj_t *ta = (lv_obj_t *)lv_obj_get_user_data(btn);
     const char *dirName = lv_textarea_get_text(ta);
 
-    if (create_directory(current_path, dirName)) {
+    bool created;
+    {
+        SdLock lock;
+        created = create_directory(current_path, dirName);
+    }
+    if (created) {
+        dir_cache_invalidate(current_path);
         showFileExplorer(e);
     } else {
         showError("Failed to create directory");
@@ -0,0 +1,106 @@
+/**
+ * @file file_block_device.cpp
+ * @brief Implements the image-file block device for host builds.
+ *
+ * Compiles to nothing in the firmware. Against the sector-only SdFat stand-in
+ * in test/host/stubs there is no volume to mount, so the mount helper is left out.
+ */
+#if !defined(ARDUINO)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "file_block_device.h"
+
+#if !defined(HOST_STUB_SDFAT_H)
+extern SdFat sd;
+#endif
+
+FileBlockDevice::~FileBlockDevice() {
+    end();
+}
+
+bool FileBlockDevice::open(const char *path, bool readOnly) {
+    end();
+    m_fd = ::open(path, readOnly ? O_RDONLY : O_RDWR);
+    if (m_fd < 0) {
+        fprintf(stderr, "[FileBlockDevice] Cannot open %s: %d\n", path, errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || st.st_size < 512 || st.st_size % 512 != 0 ||
+        st.st_size / 512 > UINT32_MAX) {
+        fprintf(stderr, "[FileBlockDevice] %s is not a sector-sized image\n", path);
+        end();
+        return false;
+    }
+    m_readOnly = readOnly;
+    m_sectors = (uint32_t)(st.st_size / 512);
+    resetStats();
+    return true;
+}
+
+void FileBlockDevice::end() {
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+    m_sectors = 0;
+}
+
+void FileBlockDevice::resetStats() {
+    m_stats = BlockDeviceStats();
+}
+
+void FileBlockDevice::delay(uint32_t us) {
+    if (us == 0) return;
+    m_stats.injectedUs += us;
+    struct timespec ts;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (long)(us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+bool FileBlockDevice::readSectors(uint32_t sector, uint8_t *dst, size_t ns) {
+    if (m_fd < 0 || (uint64_t)sector + ns > m_sectors) return false;
+    m_stats.readCalls++;
+    m_stats.sectorsRead += ns;
+    delay(m_latency.commandUs + m_latency.readSectorUs * (uint32_t)ns);
+    size_t len = ns * 512;
+    return pread(m_fd, dst, len, (off_t)sector * 512) == (ssize_t)len;
+}
+
+bool FileBlockDevice::readSector(uint32_t sector, uint8_t *dst) {
+    return readSectors(sector, dst, 1);
+}
+
+bool FileBlockDevice::writeSectors(uint32_t sector, const uint8_t *src, size_t ns) {
+    if (m_fd < 0 || m_readOnly || (uint64_t)sector + ns > m_sectors) return false;
+    m_stats.writeCalls++;
+    m_stats.sectorsWritten += ns;
+    delay(m_latency.commandUs + m_latency.writeSectorUs * (uint32_t)ns);
+    size_t len = ns * 512;
+    return pwrite(m_fd, src, len, (off_t)sector * 512) == (ssize_t)len;
+}
+
+bool FileBlockDevice::writeSector(uint32_t sector, const uint8_t *src) {
+    return writeSectors(sector, src, 1);
+}
+
+bool FileBlockDevice::syncDevice() {
+    if (m_fd < 0) return false;
+    m_stats.syncCalls++;
+    delay(m_latency.syncUs);
+    return m_readOnly || fdatasync(m_fd) == 0;
+}
+
+#if !defined(HOST_STUB_SDFAT_H)
+bool file_block_device_mount(FsBlockDevice *dev) {
+    // SdFat's own begin() wants an SPI card; the volume layer takes any device
+    return sd.FsVolume::begin(dev);
+}
+#endif
+
+#endif // !ARDUINO
@@ -0,0 +1,698 @@
+/**
+ * @file file_jobs.cpp
+ * @brief Implements background copy, move and delete jobs.
+ *
+ * A job walks its source tree twice: once to count files and bytes for the
+ * progress and ETA, once to do the work. The walk order of an unchanged
+ * tree is stable, so "files finished" plus "offset into the next file" is
+ * enough to pick a job up again after a reset. The journal keeps two
+ * CRC-checked slots written alternately, so a torn write loses at most one
+ * checkpoint.
+ *
+ * The SPI bus carries reads and writes one at a time, so a second buffer
+ * could not overlap them; the speed comes from chunk size instead: 32 KB
+ * sector-aligned transfers go to the card as single multi-block commands
+ * (past the sector cache), into a destination pre-allocated in one run of
+ * clusters.
+ */
+#include <Arduino.h>
+#include <rom/crc.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "file_jobs.h"
+#include "SD_utils.h"
+#include "dir_cache.h"
+#include "sd_bench.h"
+#include "sd_space.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define JOURNAL_MAGIC   0x424F4A46  // "FJOB"
+#define JOURNAL_VERSION 1
+#define BENCH_SRC       "/.fjbench.src"
+#define BENCH_DST       "/.fjbench.dst"
+#define RATE_WINDOW_MS  1000
+#define NAME_LEN        256         // FAT long names: 255 characters and the NUL
+
+enum JobPhase : uint8_t {
+    PHASE_COPY = 0,
+    PHASE_DELETE       // Move fallback: source is removed after the copy
+};
+
+struct Journal {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t op;
+    uint8_t phase;
+    uint8_t reserved;
+    uint32_t seq;                   // Picks the newer slot
+    char src[FILE_JOB_PATH_LEN];
+    char dst[FILE_JOB_PATH_LEN];    // Destination path of src itself
+    uint32_t filesDone;             // Files of the walk finished in this phase
+    uint32_t fileOffset;            // Bytes of the next file already on the card
+    uint32_t crc;                   // Over everything above
+};
+
+enum WalkEvent {
+    WALK_FILE,
+    WALK_DIR_ENTER,
+    WALK_DIR_LEAVE
+};
+
+typedef bool (*walk_cb_t)(WalkEvent ev, const char *path, uint32_t size);
+
+struct WalkLevel {
+    SdFile dir;
+    uint16_t pathLen;
+};
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static FileJobStatus s_status;
+static FileJobBench s_bench;
+static volatile bool s_running = false;
+static volatile bool s_cancel = false;
+
+// Owned by the job task while s_running
+static Journal s_job;
+static uint8_t *s_buf = nullptr;
+static WalkLevel s_levels[FILE_JOB_MAX_DEPTH];
+static uint32_t s_fileIndex = 0;
+static uint32_t s_startMs = 0;
+static uint32_t s_windowMs = 0;
+static uint64_t s_windowBytes = 0;
+
+// --- Paths ---
+
+// Collapse repeated and trailing slashes ("//a/b/" -> "/a/b")
+static bool normalize_path(char *out, size_t outLen, const char *in) {
+    size_t n = 0;
+    for (const char *p = in; *p; p++) {
+        if (*p == '/' && n > 0 && out[n - 1] == '/') continue;
+        if (n + 1 >= outLen) return false;
+        out[n++] = *p;
+    }
+    while (n > 1 && out[n - 1] == '/') n--;
+    out[n] = '\0';
+    return n > 0 && out[0] == '/';
+}
+
+static bool path_join(char *out, size_t outLen, const char *dir, const char *name) {
+    size_t n = strlen(dir);
+    while (n > 0 && dir[n - 1] == '/') n--;
+    int len = snprintf(out, outLen, "%.*s/%s", (int)n, dir, name);
+    return len > 0 && (size_t)len < outLen;
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Destination of a path inside the source tree
+static bool map_dst(const char *path, char *out) {
+    int len = snprintf(out, FILE_JOB_PATH_LEN, "%s%s", s_job.dst, path + strlen(s_job.src));
+    return len > 0 && len < FILE_JOB_PATH_LEN;
+}
+
+// --- Status ---
+
+static void status_begin(FileJobOp op, bool resumed) {
+    portENTER_CRITICAL(&s_mux);
+    uint32_t generation = s_status.generation;
+    memset(&s_status, 0, sizeof(s_status));
+    s_status.op = op;
+    s_status.state = FILE_JOB_SCANNING;
+    s_status.resumed = resumed;
+    s_status.generation = generation + 1;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+static void status_set(FileJobState state, const char *name) {
+    portENTER_CRITICAL(&s_mux);
+    s_status.state = state;
+    if (name) {
+        strncpy(s_status.name, name, sizeof(s_status.name) - 1);
+        s_status.name[sizeof(s_status.name) - 1] = '\0';
+    }
+    s_status.elapsedMs = millis() - s_startMs;
+    s_status.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+static void status_totals(uint32_t files, uint64_t bytes) {
+    portENTER_CRITICAL(&s_mux);
+    s_status.filesTotal = files;
+    s_status.bytesTotal = bytes;
+    s_status.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// @p moved is false for work skipped because it finished before a reset
+static void status_progress(uint64_t bytes, uint32_t files, bool moved) {
+    uint32_t now = millis();
+    if (moved) s_windowBytes += bytes;
+    uint32_t windowKBs = 0;
+    bool sample = now - s_windowMs >= RATE_WINDOW_MS;
+    if (sample) {
+        windowKBs = (uint32_t)(s_windowBytes * 1000 / 1024 / (now - s_windowMs));
+        s_windowMs = now;
+        s_windowBytes = 0;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    s_status.bytesDone += bytes;
+    s_status.filesDone += files;
+    if (sample) {
+        // Smooth over a few windows so the ETA does not jump with every card stall
+        s_status.kbPerSec = s_status.kbPerSec ? (s_status.kbPerSec * 3 + windowKBs) / 4 : windowKBs;
+        uint64_t left = s_status.bytesTotal > s_status.bytesDone ? s_status.bytesTotal - s_status.bytesDone : 0;
+        s_status.etaSec = s_status.kbPerSec ? (uint32_t)(left / 1024 / s_status.kbPerSec) : 0;
+    }
+    s_status.elapsedMs = now - s_startMs;
+    s_status.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+FileJobStatus file_job_status() {
+    portENTER_CRITICAL(&s_mux);
+    FileJobStatus copy = s_status;
+    portEXIT_CRITICAL(&s_mux);
+    return copy;
+}
+
+FileJobBench file_job_bench_result() {
+    portENTER_CRITICAL(&s_mux);
+    FileJobBench copy = s_bench;
+    portEXIT_CRITICAL(&s_mux);
+    return copy;
+}
+
+bool file_job_busy() {
+    return s_running;
+}
+
+void file_job_cancel() {
+    if (s_running) s_cancel = true;
+}
+
+// --- Journal ---
+
+static uint32_t journal_crc(const Journal &j) {
+    return crc32_le(0, (const uint8_t *)&j, offsetof(Journal, crc));
+}
+
+static bool journal_valid(const Journal &j) {
+    return j.magic == JOURNAL_MAGIC && j.version == JOURNAL_VERSION && j.crc == journal_crc(j) &&
+           memchr(j.src, '\0', sizeof(j.src)) && memchr(j.dst, '\0', sizeof(j.dst)) &&
+           j.op >= FILE_JOB_COPY && j.op <= FILE_JOB_DELETE;
+}
+
+static bool journal_save() {
+    s_job.seq++;
+    s_job.crc = journal_crc(s_job);
+    SdLock lock;
+    SdFile f;
+    bool created = !sd.exists(FILE_JOB_JOURNAL);
+    if (!f.open(FILE_JOB_JOURNAL, O_RDWR | O_CREAT)) return false;
+    // A new journal gets both slots so the file never has a hole to seek past
+    bool ok = created ? f.write(&s_job, sizeof(s_job)) == sizeof(s_job)
+                      : f.seekSet((s_job.seq & 1) * sizeof(Journal));
+    ok = ok && f.write(&s_job, sizeof(s_job)) == sizeof(s_job);
+    ok = f.close() && ok;  // close() syncs data and directory entry
+    if (created) {
+        dir_cache_note_write(FILE_JOB_JOURNAL);
+        sd_space_note_file(0, 2 * sizeof(Journal));
+    }
+    return ok;
+}
+
+static bool journal_load(Journal &out) {
+    Journal slots[2];
+    int n;
+    {
+        SdLock lock;
+        SdFile f;
+        if (!f.open(FILE_JOB_JOURNAL, O_RDONLY)) return false;
+        n = f.read(slots, sizeof(slots));
+        f.close();
+    }
+    bool valid0 = n >= (int)sizeof(Journal) && journal_valid(slots[0]);
+    bool valid1 = n >= (int)sizeof(slots) && journal_valid(slots[1]);
+    if (!valid0 && !valid1) return false;
+    out = (valid0 && (!valid1 || (int32_t)(slots[0].seq - slots[1].seq) > 0)) ? slots[0] : slots[1];
+    return true;
+}
+
+static void journal_remove() {
+    SdLock lock;
+    if (sd.remove(FILE_JOB_JOURNAL)) {
+        dir_cache_note_write(FILE_JOB_JOURNAL);
+        sd_space_note_file(2 * sizeof(Journal), 0);
+    }
+}
+
+// --- Tree walk ---
+
+// Pre-order for directories (enter), post-order for removal (leave). The SD
+// lock is only held per directory step; callbacks take it themselves.
+static bool walk(const char *root, walk_cb_t cb) {
+    char path[FILE_JOB_PATH_LEN];
+    strcpy(path, root);
+
+    bool isDir;
+    uint32_t size;
+    {
+        SdLock lock;
+        SdFile f;
+        if (!f.open(path, O_RDONLY)) return false;
+        isDir = f.isDir();
+        size = isDir ? 0 : f.fileSize();
+        f.close();
+    }
+    if (!isDir) return cb(WALK_FILE, path, size);
+    if (!cb(WALK_DIR_ENTER, path, 0)) return false;
+
+    int depth = 0;
+    {
+        SdLock lock;
+        if (!s_levels[0].dir.open(path, O_RDONLY)) return false;
+    }
+    s_levels[0].pathLen = strlen(path);
+
+    bool ok = true;
+    while (ok && depth >= 0) {
+        WalkLevel &level = s_levels[depth];
+        path[level.pathLen] = '\0';
+
+        SdFile entry;
+        char name[NAME_LEN];
+        bool got;
+        {
+            SdLock lock;
+            got = entry.openNext(&level.dir, O_RDONLY);
+            if (got) {
+                if (!entry.getName(name, sizeof(name))) name[0] = '\0';
+                isDir = entry.isDir();
+                size = isDir ? 0 : entry.fileSize();
+                entry.close();
+            } else {
+                level.dir.close();
+            }
+        }
+        if (!got) {
+            ok = cb(WALK_DIR_LEAVE, path, 0);
+            depth--;
+            continue;
+        }
+
+        size_t len = level.pathLen;
+        if (!name[0]) {
+            Serial.printf("[FileJob] Unreadable entry name under %s\n", path);
+            ok = false;
+            break;
+        }
+        if (len + 1 + strlen(name) >= sizeof(path)) {
+            Serial.printf("[FileJob] Path too long under %s\n", path);
+            ok = false;
+            break;
+        }
+        path[len] = '/';
+        strcpy(path + len + 1, name);
+
+        if (!isDir) {
+            ok = cb(WALK_FILE, path, size);
+        } else if (depth + 1 >= FILE_JOB_MAX_DEPTH) {
+            Serial.printf("[FileJob] Too deep: %s\n", path);
+            ok = false;
+        } else if ((ok = cb(WALK_DIR_ENTER, path, 0))) {
+            SdLock lock;
+            ok = s_levels[depth + 1].dir.open(path, O_RDONLY);
+            s_levels[++depth].pathLen = strlen(path);
+        }
+    }
+
+    // Aborted: close whatever is still open
+    for (; depth >= 0; depth--) {
+        SdLock lock;
+        if (s_levels[depth].dir.isOpen()) s_levels[depth].dir.close();
+    }
+    return ok;
+}
+
+// --- Operations ---
+
+static uint32_t s_scanFiles = 0;
+static uint64_t s_scanBytes = 0;
+
+static bool scan_cb(WalkEvent ev, const char *path, uint32_t size) {
+    if (ev == WALK_FILE) {
+        s_scanFiles++;
+        s_scanBytes += size;
+    }
+    return !s_cancel;
+}
+
+static bool copy_file(const char *src, const char *dst, uint32_t size, uint32_t offset) {
+    SdFile in, out;
+    bool ok;
+    {
+        SdLock lock;
+        ok = in.open(src, O_RDONLY);
+        if (ok && offset > 0 && offset <= size && out.open(dst, O_RDWR) && out.fileSize() >= offset) {
+            ok = in.seekSet(offset) && out.seekSet(offset);
+        } else if (ok) {
+            if (out.isOpen()) out.close();
+            offset = 0;
+            uint32_t oldSize = 0;
+            if (out.open(dst, O_RDONLY)) {
+                oldSize = out.fileSize();
+                out.close();
+            }
+            ok = out.open(dst, O_RDWR | O_CREAT | O_TRUNC);
+            // One run of clusters: no allocation or FAT walk per chunk. Fragmented
+            // free space makes this fail; the file then grows as it is written.
+            if (ok && size > 0) out.preAllocate(size);
+            dir_cache_note_write(dst);
+            if (ok) sd_space_note_file(oldSize, size);
+        }
+    }
+    if (offset) status_progress(offset, 0, false);
+
+    uint32_t pos = offset;
+    uint32_t sinceCheckpoint = 0;
+    while (ok && pos < size) {
+        if (s_cancel) {
+            ok = false;
+            break;
+        }
+        uint32_t n = size - pos < FILE_JOB_CHUNK ? size - pos : FILE_JOB_CHUNK;
+        // Separate lock holds so other SD users get in between read and write.
+        // One buffer: reads and writes share the SPI bus and the SD lock, so a
+        // second buffer filled ahead gains nothing (sd_bench_host measures both).
+        {
+            SdLock lock;
+            ok = in.read(s_buf, n) == (int)n;
+        }
+        if (ok) {
+            SdLock lock;
+            ok = out.write(s_buf, n) == n;
+        }
+        if (!ok) break;
+        pos += n;
+        status_progress(n, 0, true);
+
+        sinceCheckpoint += n;
+        if (sinceCheckpoint >= FILE_JOB_CHECKPOINT && pos < size && s_job.op != FILE_JOB_BENCH) {
+            {
+                SdLock lock;
+                ok = out.sync();
+            }
+            s_job.fileOffset = pos;
+            journal_save();
+            sinceCheckpoint = 0;
+        }
+    }
+
+    SdLock lock;
+    if (in.isOpen()) in.close();
+    if (out.isOpen()) ok = out.close() && ok;
+    if (!ok) {
+        // Never leave a truncated copy behind
+        if (sd.remove(dst)) sd_space_note_file(size, 0);
+        dir_cache_note_write(dst);
+    }
+    return ok;
+}
+
+static bool copy_cb(WalkEvent ev, const char *path, uint32_t size) {
+    if (s_cancel) return false;
+    char dst[FILE_JOB_PATH_LEN];
+    if (!map_dst(path, dst)) return false;
+
+    if (ev == WALK_DIR_ENTER) {
+        SdLock lock;
+        if (sd.exists(dst)) return true;  // Made before a reset
+        if (!sd.mkdir(dst, false)) {
+            Serial.printf("[FileJob] mkdir %s failed\n", dst);
+            return false;
+        }
+        dir_cache_note_write(dst);
+        sd_space_note_clusters(1);
+        return true;
+    }
+    if (ev == WALK_DIR_LEAVE) return true;
+
+    uint32_t index = s_fileIndex++;
+    if (index < s_job.filesDone) {
+        status_progress(size, 1, false);  // Finished before a reset
+        return true;
+    }
+    uint32_t offset = index == s_job.filesDone ? s_job.fileOffset : 0;
+    status_set(FILE_JOB_RUNNING, base_name(path));
+    if (!copy_file(path, dst, size, offset)) {
+        if (!s_cancel) Serial.printf("[FileJob] Copy %s -> %s failed\n", path, dst);
+        return false;
+    }
+    s_job.filesDone = index + 1;
+    s_job.fileOffset = 0;
+    journal_save();
+    status_progress(0, 1, true);
+    return true;
+}
+
+static bool delete_cb(WalkEvent ev, const char *path, uint32_t size) {
+    if (s_cancel) return false;
+    if (ev == WALK_DIR_ENTER) return true;
+
+    SdLock lock;
+    bool ok = ev == WALK_FILE ? sd.remove(path) : sd.rmdir(path);
+    if (!ok) {
+        Serial.printf("[FileJob] Remove %s failed\n", path);
+        return false;
+    }
+    dir_cache_note_write(path);
+    if (ev == WALK_FILE) {
+        sd_space_note_file(size, 0);
+        status_progress(size, 1, true);
+    } else {
+        sd_space_note_clusters(-1);
+    }
+    return true;
+}
+
+static bool run_delete() {
+    status_set(FILE_JOB_RUNNING, base_name(s_job.src));
+    return walk(s_job.src, delete_cb);
+}
+
+static bool run_copy() {
+    s_fileIndex = 0;
+    return walk(s_job.src, copy_cb);
+}
+
+static bool run_move() {
+    if (s_job.phase == PHASE_COPY && s_job.filesDone == 0 && s_job.fileOffset == 0) {
+        // Same volume: a rename moves the whole tree by rewriting two directory entries
+        SdLock lock;
+        if (sd.rename(s_job.src, s_job.dst)) {
+            dir_cache_note_write(s_job.src);
+            dir_cache_note_write(s_job.dst);
+            FileJobStatus st = file_job_status();
+            status_progress(st.bytesTotal, st.filesTotal, false);
+            return true;
+        }
+        Serial.println("[FileJob] Rename failed, moving by copy");
+    }
+    if (s_job.phase == PHASE_COPY) {
+        if (!run_copy()) return false;
+        s_job.phase = PHASE_DELETE;
+        journal_save();
+    }
+    return run_delete();
+}
+
+// A reset after the rename, or after the last removal of the delete phase,
+// leaves a journal for a move that is already complete
+static bool move_already_done() {
+    SdLock lock;
+    return s_job.op == FILE_JOB_MOVE && !sd.exists(s_job.src) && sd.exists(s_job.dst);
+}
+
+static bool run_bench() {
+    FileJobBench result = {};
+    SdBenchResult raw = {};
+    uint32_t first = 0, last = 0;
+    bool ok;
+    {
+        SdLock lock;
+        sd.remove(BENCH_SRC);
+        SdFile f;
+        ok = f.open(BENCH_SRC, O_RDWR | O_CREAT | O_TRUNC) && f.preAllocate(FILE_JOB_BENCH_BYTES) &&
+             f.contiguousRange(&first, &last);
+        if (f.isOpen()) f.close();
+        dir_cache_note_write(BENCH_SRC);
+        if (ok) {
+            sd_space_note_file(0, FILE_JOB_BENCH_BYTES);
+            // Raw rates over the same sectors the copy will read
+            status_set(FILE_JOB_RUNNING, "raw card");
+            SdBenchBlockIo io(sd_block_device());
+            sd_bench_device(&io, first, last - first + 1, raw);
+            sd_bench_print(raw);
+        } else {
+            sd.remove(BENCH_SRC);
+            Serial.println("[FileJob] Could not allocate the benchmark file");
+        }
+    }
+    if (!ok || !raw.ok) return false;
+
+    status_totals(1, FILE_JOB_BENCH_BYTES);
+    status_set(FILE_JOB_RUNNING, base_name(BENCH_DST));
+    uint32_t t0 = millis();
+    ok = copy_file(BENCH_SRC, BENCH_DST, FILE_JOB_BENCH_BYTES, 0);
+    uint32_t ms = millis() - t0;
+
+    {
+        SdLock lock;
+        if (sd.remove(BENCH_SRC)) sd_space_note_file(FILE_JOB_BENCH_BYTES, 0);
+        if (sd.remove(BENCH_DST)) sd_space_note_file(FILE_JOB_BENCH_BYTES, 0);
+        dir_cache_note_write(BENCH_SRC);
+    }
+    if (!ok) return false;
+
+    result.valid = true;
+    result.rawReadKBs = raw.seqReadKBs;
+    result.rawWriteKBs = raw.seqWriteKBs;
+    // One bus: reading and writing each byte takes the sum of both times
+    uint32_t sum = raw.seqReadKBs + raw.seqWriteKBs;
+    result.boundKBs = sum ? (uint32_t)((uint64_t)raw.seqReadKBs * raw.seqWriteKBs / sum) : 0;
+    result.copyKBs = ms ? (uint32_t)((uint64_t)FILE_JOB_BENCH_BYTES * 1000 / 1024 / ms) : 0;
+    Serial.printf("[FileJob] Copied %lu KB in %lu ms: %lu KB/s; raw R %lu W %lu -> bound %lu KB/s (%lu%%)\n",
+                  (unsigned long)(FILE_JOB_BENCH_BYTES / 1024), (unsigned long)ms,
+                  (unsigned long)result.copyKBs, (unsigned long)result.rawReadKBs,
+                  (unsigned long)result.rawWriteKBs, (unsigned long)result.boundKBs,
+                  (unsigned long)(result.boundKBs ? result.copyKBs * 100 / result.boundKBs : 0));
+
+    portENTER_CRITICAL(&s_mux);
+    s_bench = result;
+    portEXIT_CRITICAL(&s_mux);
+    return true;
+}
+
+static void job_task(void *pvParameters) {
+    bool ok = s_buf != nullptr;
+    if (!ok) Serial.println("[FileJob] Out of memory for the transfer buffer");
+
+    status_set(FILE_JOB_SCANNING, base_name(s_job.src));
+    bool finished = ok && file_job_status().resumed && move_already_done();
+    if (finished) Serial.printf("[FileJob] %s was already moved\n", s_job.src);
+    if (ok && !finished && s_job.op != FILE_JOB_BENCH) {
+        // Count first so progress and ETA have a total
+        s_scanFiles = 0;
+        s_scanBytes = 0;
+        ok = walk(s_job.src, scan_cb);
+        status_totals(s_scanFiles, s_scanBytes);
+        if (ok) ok = journal_save();
+    }
+    s_windowMs = millis();
+    s_windowBytes = 0;
+
+    if (ok && !finished) {
+        switch (s_job.op) {
+            case FILE_JOB_COPY: ok = run_copy(); break;
+            case FILE_JOB_MOVE: ok = run_move(); break;
+            case FILE_JOB_DELETE: ok = run_delete(); break;
+            case FILE_JOB_BENCH: ok = run_bench(); break;
+            default: ok = false; break;
+        }
+    }
+
+    if (s_job.op != FILE_JOB_BENCH) journal_remove();
+    sd_cache_flush();
+    free(s_buf);
+    s_buf = nullptr;
+
+    FileJobState end = s_cancel ? FILE_JOB_CANCELLED : (ok ? FILE_JOB_DONE : FILE_JOB_FAILED);
+    status_set(end, nullptr);
+    FileJobStatus st = file_job_status();
+    Serial.printf("[FileJob] %s: %lu/%lu files, %lu KB in %lu ms\n",
+                  end == FILE_JOB_DONE ? "Done" : (end == FILE_JOB_CANCELLED ? "Cancelled" : "Failed"),
+                  (unsigned long)st.filesDone, (unsigned long)st.filesTotal,
+                  (unsigned long)(st.bytesDone / 1024), (unsigned long)st.elapsedMs);
+    s_running = false;
+    vTaskDelete(NULL);
+}
+
+static bool launch(const Journal &job, bool resumed) {
+    if (s_running) return false;
+    bool benchRunning = false;
+    sd_bench_progress(nullptr, &benchRunning);
+    if (benchRunning) return false;  // The sweep remounts the card under us
+
+    s_running = true;
+    s_cancel = false;
+    s_job = job;
+    s_startMs = millis();
+    status_begin((FileJobOp)job.op, resumed);
+    s_buf = (uint8_t *)malloc(FILE_JOB_CHUNK);
+    if (xTaskCreatePinnedToCore(job_task, "FileJob", 6144, NULL, 1, NULL, 1) != pdPASS) {
+        free(s_buf);
+        s_buf = nullptr;
+        status_set(FILE_JOB_FAILED, nullptr);
+        s_running = false;
+        return false;
+    }
+    return true;
+}
+
+bool file_job_start(FileJobOp op, const char *src, const char *dstDir) {
+    if (s_running || !src || (op != FILE_JOB_COPY && op != FILE_JOB_MOVE && op != FILE_JOB_DELETE)) {
+        return false;
+    }
+    Journal job;
+    memset(&job, 0, sizeof(job));
+    job.magic = JOURNAL_MAGIC;
+    job.version = JOURNAL_VERSION;
+    job.op = op;
+    if (!normalize_path(job.src, sizeof(job.src), src) || strcmp(job.src, "/") == 0) return false;
+
+    if (op != FILE_JOB_DELETE) {
+        char dir[FILE_JOB_PATH_LEN];
+        if (!dstDir || !normalize_path(dir, sizeof(dir), dstDir) ||
+            !path_join(job.dst, sizeof(job.dst), dir, base_name(job.src))) {
+            return false;
+        }
+        // Never into itself or its own subtree
+        size_t n = strlen(job.src);
+        if (strncmp(job.dst, job.src, n) == 0 && (job.dst[n] == '\0' || job.dst[n] == '/')) return false;
+    }
+
+    {
+        SdLock lock;
+        if (!sd.exists(job.src)) return false;
+        if (op != FILE_JOB_DELETE && sd.exists(job.dst)) {
+            Serial.printf("[FileJob] %s already exists\n", job.dst);
+            return false;
+        }
+    }
+    return launch(job, false);
+}
+
+bool file_job_resume() {
+    if (s_running) return false;
+    Journal job;
+    if (!journal_load(job)) return false;
+    Serial.printf("[FileJob] Resuming %s of %s at file %lu + %lu bytes\n",
+                  job.op == FILE_JOB_COPY ? "copy" : (job.op == FILE_JOB_MOVE ? "move" : "delete"),
+                  job.src, (unsigned long)job.filesDone, (unsigned long)job.fileOffset);
+    return launch(job, true);
+}
+
+bool file_job_bench_start() {
+    Journal job;
+    memset(&job, 0, sizeof(job));
+    job.op = FILE_JOB_BENCH;
+    strcpy(job.src, BENCH_SRC);
+    strcpy(job.dst, BENCH_DST);
+    return launch(job, false);
+}
@@ -0,0 +1,354 @@
+/**
+ * @file file_viewer.cpp
+ * @brief Implements the streaming text pager and JPEG strip viewer.
+ *
+ * The pager never scans the file: a page is formatted from one window read
+ * at its start offset, and the previous page is found by reading the window
+ * before it and counting rows backwards. The JPEG path draws each decoded
+ * MCU strip with TFT_eSPI while LVGL is idle; the panel and the card sit on
+ * different SPI buses, so drawing and reading do not contend.
+ */
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <JPEGDEC.h>
+#include <lvgl.h>
+#include <string.h>
+#include <strings.h>
+#include "file_viewer.h"
+#include "explorer.h"
+#include "SD_utils.h"
+#include "esp_heap_caps.h"
+#include "lv_heap.h"
+
+#define VIEWER_HEADER_H 20
+#define VIEWER_DOCK_H 40
+#define VIEWER_ROW_H 10     // 8 px glyphs + 2 px line space
+
+extern TFT_eSPI tft;
+
+static SdFile v_file;
+static uint32_t v_size = 0;
+static uint32_t v_start = 0;    // File offset of the page shown
+static uint32_t v_end = 0;      // First byte after it
+static char v_name[64];
+static uint8_t v_window[VIEWER_TEXT_WINDOW];
+static char v_page[VIEWER_TEXT_ROWS * (VIEWER_TEXT_COLS + 1) + 1];
+static lv_obj_t *v_text = NULL;
+static lv_obj_t *v_header = NULL;
+
+// Lowest free heap seen while the viewer works, for the peak-use figure
+static size_t v_heapBefore = 0;
+static size_t v_heapMin = 0;
+
+static void heap_sample() {
+    size_t now = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    if (now < v_heapMin) v_heapMin = now;
+}
+
+static void heap_begin() {
+    v_heapBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    v_heapMin = v_heapBefore;
+}
+
+static bool is_jpeg(const char *name) {
+    const char *dot = strrchr(name, '.');
+    return dot && (strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0);
+}
+
+// --- Text pager ---
+
+static int read_window(uint32_t offset, uint32_t len) {
+    SdLock lock;
+    if (!v_file.isOpen() || !v_file.seekSet(offset)) return -1;
+    return v_file.read(v_window, len);
+}
+
+static uint32_t row_count(uint32_t lineLen) {
+    return lineLen == 0 ? 1 : (lineLen + VIEWER_TEXT_COLS - 1) / VIEWER_TEXT_COLS;
+}
+
+static void show_page(uint32_t start) {
+    uint32_t len = v_size - start < VIEWER_TEXT_WINDOW ? v_size - start : VIEWER_TEXT_WINDOW;
+    int n = read_window(start, len);
+    if (n < 0) n = 0;
+
+    // Wrap into fixed rows; the label only ever holds one page
+    size_t out = 0;
+    int i = 0, rows = 0, col = 0;
+    while (i < n && rows < VIEWER_TEXT_ROWS) {
+        char c = (char)v_window[i];
+        if (c == '\r') {
+            i++;
+            continue;
+        }
+        if (c == '\n') {
+            v_page[out++] = '\n';
+            rows++;
+            col = 0;
+            i++;
+            continue;
+        }
+        if (col == VIEWER_TEXT_COLS) {
+            v_page[out++] = '\n';
+            col = 0;
+            if (++rows == VIEWER_TEXT_ROWS) break;
+        }
+        v_page[out++] = c == '\t' ? ' ' : ((uint8_t)c < 0x20 || (uint8_t)c >= 0x7f ? '.' : c);
+        col++;
+        i++;
+    }
+    v_page[out] = '\0';
+    v_start = start;
+    v_end = start + i;
+
+    lv_label_set_text_static(v_text, v_page);
+    lv_label_set_text_fmt(v_header, "%s  %lu%%  %lu/%lu KB", v_name,
+                          (unsigned long)(v_size ? (uint64_t)v_end * 100 / v_size : 100),
+                          (unsigned long)(v_end / 1024), (unsigned long)(v_size / 1024));
+    heap_sample();
+}
+
+// Start of the page that ends at @p end, counted back from one window
+static uint32_t page_before(uint32_t end) {
+    if (end == 0) return 0;
+    uint32_t ws = end > VIEWER_TEXT_WINDOW ? end - VIEWER_TEXT_WINDOW : 0;
+    int n = read_window(ws, end - ws);
+    if (n <= 0) return 0;
+
+    // The newline ending the previous line belongs to it, not to a new row
+    int lineEnd = n;
+    if (lineEnd > 0 && v_window[lineEnd - 1] == '\n') lineEnd--;
+    uint32_t rows = 0;
+    while (true) {
+        int lineStart = lineEnd;
+        while (lineStart > 0 && v_window[lineStart - 1] != '\n') lineStart--;
+        uint32_t len = 0;
+        for (int k = lineStart; k < lineEnd; k++) {
+            if (v_window[k] != '\r') len++;
+        }
+        if (lineStart == 0 && ws > 0) {
+            // Line runs past the window: step back whole rows inside it
+            uint32_t back = (VIEWER_TEXT_ROWS - rows) * VIEWER_TEXT_COLS;
+            return end - (end - ws < back ? end - ws : back);
+        }
+        uint32_t r = row_count(len);
+        if (rows + r >= VIEWER_TEXT_ROWS) {
+            // Only the tail rows of this line fit
+            uint32_t skip = (rows + r - VIEWER_TEXT_ROWS) * VIEWER_TEXT_COLS;
+            return ws + lineStart + skip;
+        }
+        rows += r;
+        if (lineStart == 0) return ws;
+        lineEnd = lineStart - 1;
+    }
+}
+
+static void text_dock_event_handler(lv_event_t *e) {
+    lv_obj_t *btnm = lv_event_get_target(e);
+    switch (lv_btnmatrix_get_selected_btn(btnm)) {
+        case 0:
+            show_page(0);
+            break;
+        case 1:
+            show_page(page_before(v_start));
+            break;
+        case 2:
+            if (v_end < v_size) show_page(v_end);
+            break;
+        case 3:
+            show_page(page_before(v_size));
+            break;
+        default:
+            showFileExplorer(NULL);
+            break;
+    }
+}
+
+static void text_viewer_delete_cb(lv_event_t *e) {
+    v_text = NULL;
+    v_header = NULL;
+    SdLock lock;
+    if (v_file.isOpen()) v_file.close();
+}
+
+static void open_text(const char *path) {
+    uint32_t t0 = micros();
+    heap_begin();
+    {
+        SdLock lock;
+        if (v_file.isOpen()) v_file.close();
+        if (!v_file.open(path, O_RDONLY)) {
+            showError("Failed to open file");
+            return;
+        }
+        v_size = v_file.fileSize();
+    }
+
+    lv_heap_screen("text viewer");
+    lv_obj_t *scr = lv_scr_act();
+    lv_obj_clean(scr);
+
+    v_header = lv_label_create(scr);
+    lv_obj_set_width(v_header, 236);
+    lv_label_set_long_mode(v_header, LV_LABEL_LONG_DOT);
+    lv_obj_align(v_header, LV_ALIGN_TOP_LEFT, 2, 3);
+
+    v_text = lv_label_create(scr);
+    lv_obj_set_style_text_font(v_text, &lv_font_unscii_8, 0);
+    lv_obj_set_style_text_line_space(v_text, VIEWER_ROW_H - 8, 0);
+    lv_obj_set_size(v_text, 240 - 8, VIEWER_TEXT_ROWS * VIEWER_ROW_H);
+    lv_label_set_long_mode(v_text, LV_LABEL_LONG_CLIP);
+    lv_obj_align(v_text, LV_ALIGN_TOP_LEFT, 4, VIEWER_HEADER_H);
+    lv_obj_add_event_cb(v_text, text_viewer_delete_cb, LV_EVENT_DELETE, NULL);
+
+    static const char *dock_map[] = {"Top", LV_SYMBOL_LEFT, LV_SYMBOL_RIGHT, "End", LV_SYMBOL_CLOSE, ""};
+    lv_obj_t *dock = lv_btnmatrix_create(scr);
+    lv_btnmatrix_set_map(dock, dock_map);
+    lv_obj_set_size(dock, 240, VIEWER_DOCK_H);
+    lv_obj_align(dock, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_obj_add_event_cb(dock, text_dock_event_handler, LV_EVENT_VALUE_CHANGED, NULL);
+
+    show_page(0);
+    lv_refr_now(NULL);
+    heap_sample();
+    Serial.printf("[Viewer] Text %s (%lu bytes): first pixel in %lu ms, peak heap %u bytes\n", v_name,
+                  (unsigned long)v_size, (unsigned long)((micros() - t0) / 1000),
+                  (unsigned)(v_heapBefore - v_heapMin));
+}
+
+// --- JPEG strips ---
+
+struct JpegTarget {
+    int right, bottom;      ///< Exclusive clip edges of the scaled image on screen
+    uint32_t t0;
+    uint32_t firstPixelUs;
+};
+
+static void *viewer_jpg_open(const char *path, int32_t *size) {
+    SdLock lock;
+    if (!v_file.open(path, O_RDONLY)) return nullptr;
+    *size = v_file.fileSize();
+    return &v_file;
+}
+
+static void viewer_jpg_close(void *handle) {
+    SdLock lock;
+    ((SdFile *)handle)->close();
+}
+
+static int32_t viewer_jpg_read(JPEGFILE *file, uint8_t *buf, int32_t len) {
+    SdLock lock;
+    SdFile *f = (SdFile *)file->fHandle;
+    int32_t n = f->read(buf, len);
+    file->iPos = f->curPosition();
+    return n < 0 ? 0 : n;
+}
+
+static int32_t viewer_jpg_seek(JPEGFILE *file, int32_t pos) {
+    SdLock lock;
+    SdFile *f = (SdFile *)file->fHandle;
+    if (!f->seekSet(pos)) return -1;
+    file->iPos = pos;
+    return pos;
+}
+
+// Each MCU strip goes straight to the panel; edge strips are clipped row by row
+static int viewer_jpg_draw(JPEGDRAW *draw) {
+    JpegTarget *t = (JpegTarget *)draw->pUser;
+    int w = draw->iWidth, h = draw->iHeight;
+    if (draw->x + w > t->right) w = t->right - draw->x;
+    if (draw->y + h > t->bottom) h = t->bottom - draw->y;
+    if (w > 0 && h > 0) {
+        if (w == draw->iWidth) {
+            tft.pushImage(draw->x, draw->y, w, h, draw->pPixels);
+        } else {
+            for (int r = 0; r < h; r++) {
+                tft.pushImage(draw->x, draw->y + r, w, 1, draw->pPixels + r * draw->iWidth);
+            }
+        }
+    }
+    if (!t->firstPixelUs) t->firstPixelUs = micros() - t->t0;
+    heap_sample();
+    return 1;
+}
+
+static void image_viewer_click_cb(lv_event_t *e) {
+    showFileExplorer(NULL);
+}
+
+static void open_jpeg(const char *path) {
+    JpegTarget target = {};
+    target.t0 = micros();
+    heap_begin();
+
+    lv_heap_screen("image viewer");
+    // Clear the screen through LVGL first, then keep LVGL idle while we draw
+    lv_obj_t *scr = lv_scr_act();
+    lv_obj_clean(scr);
+    lv_obj_t *backdrop = lv_obj_create(scr);
+    lv_obj_remove_style_all(backdrop);
+    lv_obj_set_size(backdrop, LV_PCT(100), LV_PCT(100));
+    lv_obj_set_style_bg_color(backdrop, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(backdrop, LV_OPA_COVER, 0);
+    lv_obj_add_flag(backdrop, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_event_cb(backdrop, image_viewer_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_refr_now(NULL);
+
+    JPEGDEC *jpeg = new JPEGDEC();
+    heap_sample();
+    bool ok = jpeg && jpeg->open(path, viewer_jpg_open, viewer_jpg_close, viewer_jpg_read, viewer_jpg_seek,
+                                 viewer_jpg_draw);
+    int w = 0, h = 0;
+    if (ok) {
+        // Largest DCT scale that fits the panel; anything bigger is clipped
+        w = jpeg->getWidth();
+        h = jpeg->getHeight();
+        int dw = tft.width(), dh = tft.height();
+        int shift = 0;
+        while (shift < 3 && ((w >> shift) > dw || (h >> shift) > dh)) shift++;
+        static const int scaleOpts[] = {0, JPEG_SCALE_HALF, JPEG_SCALE_QUARTER, JPEG_SCALE_EIGHTH};
+        int sw = w >> shift, sh = h >> shift;
+        int x = sw < dw ? (dw - sw) / 2 : 0;
+        int y = sh < dh ? (dh - sh) / 2 : 0;
+        target.right = x + sw < dw ? x + sw : dw;
+        target.bottom = y + sh < dh ? y + sh : dh;
+
+        jpeg->setPixelType(RGB565_BIG_ENDIAN);  // Panel byte order; pushImage sends as-is
+        jpeg->setUserPointer(&target);
+        bool swap = tft.getSwapBytes();
+        tft.setSwapBytes(false);
+        tft.startWrite();
+        ok = jpeg->decode(x, y, scaleOpts[shift]) == 1;
+        tft.endWrite();
+        tft.setSwapBytes(swap);
+        jpeg->close();
+    }
+    delete jpeg;
+
+    uint32_t totalUs = micros() - target.t0;
+    Serial.printf("[Viewer] JPEG %s %dx%d: first pixel in %lu ms, complete in %lu ms, peak heap %u bytes%s\n",
+                  v_name, w, h, (unsigned long)(target.firstPixelUs / 1000), (unsigned long)(totalUs / 1000),
+                  (unsigned)(v_heapBefore - v_heapMin), ok ? "" : " (decode failed)");
+    if (!ok) {
+        lv_obj_t *label = lv_label_create(backdrop);
+        lv_obj_set_style_text_color(label, lv_color_white(), 0);
+        lv_label_set_text(label, "Can't decode this image.\nTap to go back.");
+        lv_obj_center(label);
+    }
+}
+
+void file_viewer_close_file() {
+    SdLock lock;
+    if (v_file.isOpen()) v_file.close();
+}
+
+void file_viewer_open(const char *path) {
+    const char *slash = strrchr(path, '/');
+    strncpy(v_name, slash ? slash + 1 : path, sizeof(v_name) - 1);
+    v_name[sizeof(v_name) - 1] = '\0';
+    if (is_jpeg(v_name)) {
+        open_jpeg(path);
+    } else {
+        open_text(path);
+    }
+}
@@ -23,6 +23,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "config.h"
+#include "lv_heap.h"
+#include "alloc_trace.h"
 
 QueueHandle_t buttonQueue = NULL; // Define the queue here for use in this file and others
 
@@ -45,16 +47,16 @@ void buttonEventTask(void *pvParameters) {
             bool success = false;
             switch (buttonEvent) {
                 case 0:
-                    success = publishEvent(String("QA Inspection"), String("inspection"), String("welding"), g_config.stationId.toInt(), std::map<String, String>{});
+                    success = publishEvent(String("QA Inspection"), String("inspection"), String("welding"), atoi(g_config.stationId), std::map<String, String>{});
                     break;
                 case 1:
-                    success = publishEvent(String("Supervisor Call"), String("supervisor_call"), String("welding"), g_config.stationId.toInt(), std::map<String, String>{});
+                    success = publishEvent(String("Supervisor Call"), String("supervisor_call"), String("welding"), atoi(g_config.stationId), std::map<String, String>{});
                     break;
                 case 2:
-                    success = publishEvent(String("Create Ticket"), String("ticket"), String("welding"), g_config.stationId.toInt(), std::map<String, String>{{"priority", "medium"}, {"note", "Equipment requires maintenance"}});
+                    success = publishEvent(String("Create Ticket"), String("ticket"), String("welding"), atoi(g_config.stationId), std::map<String, String>{{"priority", "medium"}, {"note", "Equipment requires maintenance"}});
                     break;
                 case 3:
-                    success = publishEvent(String("Health Check"), String("health_status"), String("welding"), g_config.stationId.toInt(), std::map<String, String>{});
+                    success = publishEvent(String("Health Check"), String("health_status"), String("welding"), atoi(g_config.stationId), std::map<String, String>{});
                     break;
                 default:
                     break;
@@ -172,35 +174,18 @@ void syncTimeWithNTP() {
 }
 
 String getCurrentTimeString() {
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("WiFi not connected, skipping NTP sync in getCurrentTimeString.");
-        return "N/A";
-    }
-    Serial.println("Syncing time with NTP server...");
-
-    timeClient.begin();
-    timeClient.update();
-
-    time_t localEpoch = timeClient.getEpochTime() - 5 * 3600; // -5 hours to represent CDT
-    localtime_r(&localEpoch, &timeinfo);
-
-    struct timeval tv = {
-        .tv_sec = localEpoch,
-        .tv_usec = 0};
-    settimeofday(&tv, NULL);
+    // The WiFi task syncs the clock with NTP; never block the UI on it here
+    time_t now = time(nullptr);
+    if (now < 1600000000) return "N/A";   // not synced yet
+    localtime_r(&now, &timeinfo);
 
     char timeStr[32];
     strftime(timeStr, sizeof(timeStr), "%H:%M", &timeinfo);
     return String(timeStr);
 }
 void drawHomeScreen() {
-    bool sd_ok = init_sd_card();
-    if (!sd_ok) {
-        Serial.println("SD card init failed, continuing without SD features.");
-        // Optionally, show a warning on the UI here
-    }
-    Serial.println("Initializing WiFi...");
-    
+    ALLOC_SCOPE(ALLOC_TAG_UI);
+    lv_heap_screen("home");
     // Clear screen once
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
@@ -236,9 +221,9 @@ void drawHomeScreen() {
     lv_table_set_cell_value(table, 0, 0, "Property");
     lv_table_set_cell_value(table, 0, 1, "Value");
     lv_table_set_cell_value(table, 1, 0, "Location");
-    lv_table_set_cell_value(table, 1, 1, g_config.location.c_str());
+    lv_table_set_cell_value(table, 1, 1, g_config.location);
     lv_table_set_cell_value(table, 2, 0, "Station");
-    lv_table_set_cell_value(table, 2, 1, g_config.stationId.c_str());
+    lv_table_set_cell_value(table, 2, 1, g_config.stationId);
     lv_table_set_cell_value(table, 3, 0, "Time");
     lv_table_set_cell_value(table, 3, 1, getCurrentTimeString().c_str());
     lv_table_set_cell_value(table, 4, 0, "Status");
@@ -290,13 +275,13 @@ void drawHomeScreen() {
             bool success = false;
             switch (btn_id) {
                 case 0: // QA
-                    success = publishEvent(String("QA Inspection"), String("inspection"), String("welding"), g_config.stationId.toInt(), std::map<String, String>{});
+                    success = publishEvent(String("QA Inspection"), String("inspection"), String("welding"), atoi(g_config.stationId), std::map<String, String>{});
                     break;
                 case 1: // Supervisor
-                    success = publishEvent(String("Supervisor Call"), String("supervisor_call"), String("welding"), g_config.stationId.toInt(), std::map<String, String>{});
+                    success = publishEvent(String("Supervisor Call"), String("supervisor_call"), String("welding"), atoi(g_config.stationId), std::map<String, String>{});
                     break;
                 case 2: // Ticket
-                    success = publishEvent(String("Create Ticket"), String("ticket"), String("welding"), g_config.stationId.toInt(), std::map<String, String>{{"priority", "medium"}, {"note", "Equipment requires maintenance"}});
+                    success = publishEvent(String("Create Ticket"), String("ticket"), String("welding"), atoi(g_config.stationId), std::map<String, String>{{"priority", "medium"}, {"note", "Equipment requires maintenance"}});
                     break;
                 default:
                     lv_obj_del(box);
@@ -331,8 +316,6 @@ void drawHomeScreen() {
 
     lv_obj_add_event_cb(btnm, fourth_tab_btnm_event_cb, LV_EVENT_ALL, NULL);
 
-    // Sync time with NTP server
-    syncTimeWithNTP();
     lv_obj_clear_flag(lv_tabview_get_content(tabview), LV_OBJ_FLAG_SCROLLABLE);
     drawNavBar();
 
@@ -0,0 +1,182 @@
+/**
+ * @file i2c_registry.cpp
+ * @brief Implements the I2C device registry.
+ *
+ * The device map is a 128-bit bitmap indexed by 7-bit address, held in
+ * RAM under a spinlock and stored in NVS as a 16-byte blob.
+ */
+#include "i2c_registry.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <nvs.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define KEY_MAP    "map"
+#define MAP_WORDS  4
+
+static uint32_t s_map[MAP_WORDS];
+static I2cRegistryStatus s_status = {};
+static volatile bool s_scanning = false;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline bool map_test(const uint32_t *map, uint8_t addr) {
+    return map[addr >> 5] & (1UL << (addr & 31));
+}
+
+static inline void map_set(uint32_t *map, uint8_t addr) {
+    map[addr >> 5] |= 1UL << (addr & 31);
+}
+
+static uint8_t map_count(const uint32_t *map) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < MAP_WORDS; i++) n += __builtin_popcount(map[i]);
+    return n;
+}
+
+static bool probe(uint8_t addr) {
+    Wire.beginTransmission(addr);
+    return Wire.endTransmission() == 0;
+}
+
+static bool nvs_load_map(uint32_t *map) {
+    nvs_handle_t h;
+    if (nvs_open(I2C_REGISTRY_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return false;
+    size_t len = MAP_WORDS * sizeof(uint32_t);
+    bool ok = nvs_get_blob(h, KEY_MAP, map, &len) == ESP_OK && len == MAP_WORDS * sizeof(uint32_t);
+    nvs_close(h);
+    return ok;
+}
+
+static bool nvs_save_map(const uint32_t *map) {
+    nvs_handle_t h;
+    if (nvs_open(I2C_REGISTRY_NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return false;
+    bool ok = nvs_set_blob(h, KEY_MAP, map, MAP_WORDS * sizeof(uint32_t)) == ESP_OK && nvs_commit(h) == ESP_OK;
+    nvs_close(h);
+    return ok;
+}
+
+static void publish_map(const uint32_t *map) {
+    portENTER_CRITICAL(&s_mux);
+    bool changed = memcmp(s_map, map, sizeof(s_map)) != 0;
+    memcpy(s_map, map, sizeof(s_map));
+    s_status.count = map_count(map);
+    if (changed) s_status.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+static void print_map(const char *what, const uint32_t *map, uint32_t elapsed, const char *unit, const char *note) {
+    char list[I2C_REGISTRY_ADDR_LAST * 5 + 1];
+    size_t pos = 0;
+    list[0] = '\0';
+    for (uint8_t addr = I2C_REGISTRY_ADDR_FIRST; addr <= I2C_REGISTRY_ADDR_LAST; addr++) {
+        if (map_test(map, addr)) pos += snprintf(list + pos, sizeof(list) - pos, " 0x%02X", addr);
+    }
+    Serial.printf("[I2C] %s: %u device(s)%s in %lu %s%s\n", what, map_count(map), list, (unsigned long)elapsed, unit,
+                  note);
+}
+
+static void full_scan() {
+    uint32_t found[MAP_WORDS] = {0};
+    uint32_t t0 = millis();
+    for (uint8_t addr = I2C_REGISTRY_ADDR_FIRST; addr <= I2C_REGISTRY_ADDR_LAST; addr++) {
+        if (probe(addr)) map_set(found, addr);
+    }
+    uint32_t ms = millis() - t0;
+    publish_map(found);
+
+    uint32_t stored[MAP_WORDS] = {0};
+    bool same = nvs_load_map(stored) && memcmp(stored, found, sizeof(found)) == 0;
+    const char *note = "";
+    if (!same) note = nvs_save_map(found) ? " (map updated)" : " (NVS write failed)";
+    print_map("Full scan", found, ms, "ms", note);
+
+    portENTER_CRITICAL(&s_mux);
+    s_status.fullScanMs = ms;
+    s_status.scanned = true;
+    s_status.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+static void scan_task(void *pvParameters) {
+    uint32_t delayMs = (uint32_t)(uintptr_t)pvParameters;
+    if (delayMs) vTaskDelay(pdMS_TO_TICKS(delayMs));
+    full_scan();
+    s_scanning = false;
+    vTaskDelete(NULL);
+}
+
+static bool start_scan(bool wait, uint32_t delayMs) {
+    portENTER_CRITICAL(&s_mux);
+    bool busy = s_scanning;
+    s_scanning = true;
+    portEXIT_CRITICAL(&s_mux);
+    if (busy) return false;
+
+    if (wait) {
+        full_scan();
+        s_scanning = false;
+        return true;
+    }
+    if (xTaskCreatePinnedToCore(scan_task, "I2CScan", 3072, (void *)(uintptr_t)delayMs, 1, NULL, 1) != pdPASS) {
+        s_scanning = false;
+        return false;
+    }
+    return true;
+}
+
+bool i2c_registry_begin() {
+    uint32_t known[MAP_WORDS] = {0};
+    nvs_load_map(known);
+
+    // One pass over the addresses that answered last time
+    uint32_t found[MAP_WORDS] = {0};
+    uint32_t t0 = micros();
+    for (uint8_t addr = I2C_REGISTRY_ADDR_FIRST; addr <= I2C_REGISTRY_ADDR_LAST; addr++) {
+        if (map_test(known, addr) && probe(addr)) map_set(found, addr);
+    }
+    uint32_t us = micros() - t0;
+    publish_map(found);
+
+    portENTER_CRITICAL(&s_mux);
+    s_status.knownAtBoot = map_count(known);
+    s_status.quickProbeUs = us;
+    portEXIT_CRITICAL(&s_mux);
+    char note[32];
+    snprintf(note, sizeof(note), " (%u stored)", map_count(known));
+    print_map("Quick probe", found, us, "us", note);
+
+    return start_scan(false, I2C_REGISTRY_SCAN_DELAY_MS);
+}
+
+bool i2c_registry_scan(bool wait) {
+    return start_scan(wait, 0);
+}
+
+bool i2c_registry_present(uint8_t addr) {
+    if (addr > 127) return false;
+    portENTER_CRITICAL(&s_mux);
+    bool present = map_test(s_map, addr);
+    portEXIT_CRITICAL(&s_mux);
+    return present;
+}
+
+size_t i2c_registry_devices(uint8_t *out, size_t max) {
+    uint32_t map[MAP_WORDS];
+    portENTER_CRITICAL(&s_mux);
+    memcpy(map, s_map, sizeof(map));
+    portEXIT_CRITICAL(&s_mux);
+    size_t n = 0;
+    for (uint8_t addr = I2C_REGISTRY_ADDR_FIRST; addr <= I2C_REGISTRY_ADDR_LAST && n < max; addr++) {
+        if (map_test(map, addr)) out[n++] = addr;
+    }
+    return n;
+}
+
+I2cRegistryStatus i2c_registry_status() {
+    portENTER_CRITICAL(&s_mux);
+    I2cRegistryStatus st = s_status;
+    portEXIT_CRITICAL(&s_mux);
+    st.scanning = s_scanning;
+    return st;
+}
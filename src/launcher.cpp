@@ -3,6 +3,10 @@
  * @brief Implements the application launcher UI and logic for cydOS.
  *
  * Handles SD card app directory listing, app selection, and OTA installation logic.
+ * The app list is served from the persistent catalog index (see app_catalog.h)
+ * and revalidated against the card in small steps after it is shown. Rows are
+ * recycled by the virtual list (see vlist.h) and app icons are loaded lazily for
+ * the rows that exist (see app_icons.h).
  */
 #include <TFT_eSPI.h>
 #include <SdFat.h>
@@ -11,24 +15,81 @@
 #include "event_handlers.h"
 #include "ui.h"
 #include "SD_utils.h"
+#include "sd_mount.h"
 #include "OTA_utils.h"
+#include "app_catalog.h"
+#include "app_icons.h"
+#include "vlist.h"
+#include "lv_heap.h"
+#include "alloc_trace.h"
 #include <stdlib.h>
 
 extern TFT_eSPI tft;
 extern SdFat sd;
-static bool is_initialized = false;
+static bool catalog_loaded = false;
+static uint32_t catalog_mount_gen = 0;  // Mount the catalog was loaded from
+static lv_timer_t *revalidate_timer = NULL;
+static lv_timer_t *icon_timer = NULL;
+static char install_dir[APP_NAME_LEN];
+
+#define REVALIDATE_BUDGET 8       // /apps entries (or 4 KB hash chunks) per tick
+#define REVALIDATE_PERIOD_MS 20
+#define ICON_PERIOD_MS 50
+#define LAUNCHER_ROW_H 44         // Fits a 32 px icon
 
 void showError(const char *msg);
 void showLauncher();
 void install_event_handler(lv_event_t *e);
 void confirm_install_event_handler(lv_event_t *e);
 
-// Free user data callback
-static void free_user_data_event_cb(lv_event_t *e) {
-    if (lv_event_get_code(e) == LV_EVENT_DELETE) {
-        void *user_data = lv_obj_get_user_data(lv_event_get_target(e));
-        if (user_data) free(user_data);
+static void bind_app_row(lv_obj_t *row, uint32_t index, void *user) {
+    const AppInfo *app = app_catalog_get(index);
+    lv_obj_t *img = lv_obj_get_child(row, 0);
+    lv_img_set_src(img, LV_SYMBOL_DIRECTORY);
+    lv_label_set_text(lv_obj_get_child(row, 1), app ? app->name : "");
+    if (app && (app->flags & APP_HAS_ICON)) {
+        app_icon_bind(app->name, img);  // Rows only exist for visible entries
+    } else {
+        app_icon_unbind(img);
+    }
+}
+
+static void populate_launcher_list(lv_obj_t *list) {
+    vlist_set_count(list, app_catalog_count());
+    vlist_refresh(list);
+}
+
+static void icon_timer_cb(lv_timer_t *timer) {
+    app_icons_poll();
+}
+
+// Advances the catalog revalidation; rebuilds the list only if something changed
+static void revalidate_timer_cb(lv_timer_t *timer) {
+    bool changed = false;
+    bool done;
+    {
+        SdLock lock;  // Icon decoder task may be reading the card
+        done = app_catalog_revalidate_step(REVALIDATE_BUDGET, &changed);
     }
+    if (!done) return;
+
+    lv_obj_t *list = (lv_obj_t *)timer->user_data;
+    lv_timer_del(timer);
+    revalidate_timer = NULL;
+    if (changed) populate_launcher_list(list);
+}
+
+static void launcher_list_delete_cb(lv_event_t *e) {
+    if (revalidate_timer) {
+        lv_timer_del(revalidate_timer);
+        revalidate_timer = NULL;
+    }
+    if (icon_timer) {
+        lv_timer_del(icon_timer);
+        icon_timer = NULL;
+    }
+    app_icons_unbind_all();
+    app_icons_print_stats();
 }
 
 void showError(const char *msg) {
@@ -49,20 +110,11 @@ void showError(const char *msg) {
 }
 
 void showLauncher() {
-    static bool sd_ok = false;
-    if (!is_initialized) {
-        sd_ok = init_sd_card();
-        if (!sd_ok) {
-            Serial.println("SD init failed! Disabling launcher features.");
-            // Optionally show a warning, but do not abort
-            // showError("SD init failed!"); // Remove or comment out
-            // return; // Remove or comment out
-        }
-        is_initialized = true;
-    }
-
-    if (!sd_ok) {
+    ALLOC_SCOPE(ALLOC_TAG_LAUNCHER);
+    lv_heap_screen("launcher");
+    if (!sd_mounted()) {
         // SD not available, show a warning or minimal UI
+        sd_mount_request();  // A card inserted just now mounts in the background
         lv_obj_t *scr = lv_scr_act();
         lv_obj_clean(scr);
         lv_obj_t *label = lv_label_create(scr);
@@ -76,84 +128,89 @@ void showLauncher() {
         return;
     }
 
-    SdFile appsDir;
-    if (!open_dir(appsDir, "/apps")) {
-        showError("Failed to open apps directory");
-        return;
+    uint32_t t0 = millis();
+    // Reload when the card changed; revalidation would get there, one entry at a time
+    uint32_t mount_gen = sd_mount_generation();
+    if (!catalog_loaded || catalog_mount_gen != mount_gen) {
+        app_catalog_load(APP_CATALOG_ROOT);
+        catalog_loaded = true;
+        catalog_mount_gen = mount_gen;
     }
 
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
 
-    lv_obj_t *list = lv_list_create(scr);
-    lv_obj_set_size(list, 240, 280);
+    lv_obj_t *list = vlist_create(scr, 240, 280, LAUNCHER_ROW_H, bind_app_row, install_event_handler, NULL);
     lv_obj_align(list, LV_ALIGN_CENTER, 0, 0);
+    populate_launcher_list(list);
 
-    appsDir.rewind();
-    SdFile entry;
-
-    while (entry.openNext(&appsDir, O_RDONLY)) {
-        if (entry.isDir()) {
-            char dirName[64];
-            entry.getName(dirName, sizeof(dirName));
-
-            lv_obj_t *btn = lv_list_add_btn(list, LV_SYMBOL_DIRECTORY, dirName);
-            char *dirNameCopy = strdup(dirName);
-            lv_obj_set_user_data(btn, dirNameCopy);
-            lv_obj_add_event_cb(btn, install_event_handler, LV_EVENT_CLICKED, dirNameCopy);
-            lv_obj_add_event_cb(btn, free_user_data_event_cb, LV_EVENT_DELETE, NULL);
-            Serial.printf("Created button for directory: %s\n", dirName);
-        }
-        entry.close();
+    // Show the cached catalog right away, then check the card in small steps
+    {
+        SdLock lock;
+        app_catalog_revalidate_begin();
     }
+    revalidate_timer = lv_timer_create(revalidate_timer_cb, REVALIDATE_PERIOD_MS, list);
+    icon_timer = lv_timer_create(icon_timer_cb, ICON_PERIOD_MS, list);
+    lv_obj_add_event_cb(list, launcher_list_delete_cb, LV_EVENT_DELETE, NULL);
 
-    appsDir.close();
     // drawNavBar();
-    Serial.println("SD card directories listed!");
+    Serial.printf("Launcher opened with %u apps in %lu ms\n", app_catalog_count(),
+                  (unsigned long)(millis() - t0));
 }
 
 void install_event_handler(lv_event_t *e) {
-    lv_obj_t *btn = lv_event_get_target(e);
-    const char *dirName = (const char *)lv_obj_get_user_data(btn);
+    const AppInfo *app = app_catalog_get(vlist_row_index(lv_event_get_target(e)));
+    if (!app) {
+        showError("App no longer available!");
+        return;
+    }
+    // The catalog may be revalidated later; the OTA task needs a stable copy
+    strncpy(install_dir, app->name, sizeof(install_dir) - 1);
+    install_dir[sizeof(install_dir) - 1] = '\0';
 
-    Serial.printf("Selected directory: %s\n", dirName);
+    Serial.printf("Selected directory: %s\n", install_dir);
 
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
 
     lv_obj_t *label = lv_label_create(scr);
-    lv_label_set_text_fmt(label, "Files in %s:", dirName);
+    lv_label_set_text_fmt(label, "Files in %s:", install_dir);
     lv_obj_align(label, LV_ALIGN_TOP_MID, 0, 0);
 
     lv_obj_t *file_list = lv_list_create(scr);
     lv_obj_set_size(file_list, 240, 180);
     lv_obj_align(file_list, LV_ALIGN_CENTER, 0, 20);
 
-    SdFile dir;
-    char full_dir_path[128];
-    snprintf(full_dir_path, sizeof(full_dir_path), "/apps/%s", dirName);
-
-    if (!open_dir(dir, full_dir_path)) {
-        showError("Failed to open selected directory!");
-        return;
+    // Everything shown here comes from the catalog; no need to walk the app dir again
+    char file_info[64];
+    if (app->flags & APP_HAS_FIRMWARE) {
+        snprintf(file_info, sizeof(file_info), "firmware.bin (%lu KB)", (unsigned long)(app->fwSize / 1024));
+        lv_list_add_btn(file_list, NULL, file_info);
+        if (app->flags & APP_HASH_VALID) {
+            snprintf(file_info, sizeof(file_info), "CRC32: %08lX", (unsigned long)app->hash);
+        } else {
+            snprintf(file_info, sizeof(file_info), "CRC32: pending");   // Revalidation still hashing
+        }
+        lv_list_add_btn(file_list, NULL, file_info);
+    } else {
+        lv_list_add_btn(file_list, LV_SYMBOL_WARNING, "firmware.bin missing");
     }
-
-    std::vector<FileInfo> files = list_files_in_dir(dir);
-    for (const auto &file : files) {
-        char file_info[128];
-        snprintf(file_info, sizeof(file_info), "%s (%d KB)", file.name, file.size / 1024);
+    if (app->flags & APP_HAS_BOOTLOADER) lv_list_add_btn(file_list, NULL, "bootloader.bin");
+    if (app->flags & APP_HAS_BOOT_APP0) lv_list_add_btn(file_list, NULL, "boot_app0.bin");
+    if (app->version[0]) {
+        snprintf(file_info, sizeof(file_info), "Version: %s", app->version);
         lv_list_add_btn(file_list, NULL, file_info);
     }
-
-    dir.close();
+    snprintf(file_info, sizeof(file_info), "Total: %lu KB", (unsigned long)(app->totalSize / 1024));
+    lv_list_add_btn(file_list, NULL, file_info);
 
     lv_obj_t *yes_btn = lv_btn_create(scr);
     lv_obj_set_size(yes_btn, 80, 40);
     lv_obj_align(yes_btn, LV_ALIGN_CENTER, -60, 90);
     lv_obj_t *yes_label = lv_label_create(yes_btn);
     lv_label_set_text(yes_label, "Install");
-    lv_obj_set_user_data(yes_btn, (void *)dirName);
-    lv_obj_add_event_cb(yes_btn, confirm_install_event_handler, LV_EVENT_CLICKED, (void *)dirName);
+    lv_obj_set_user_data(yes_btn, install_dir);
+    lv_obj_add_event_cb(yes_btn, confirm_install_event_handler, LV_EVENT_CLICKED, install_dir);
 
     lv_obj_t *no_btn = lv_btn_create(scr);
     lv_obj_set_size(no_btn, 80, 40);
@@ -172,4 +229,4 @@ void confirm_install_event_handler(lv_event_t *e) {
     Serial.printf("Confirmed install from directory: %s\n", dirName);
 
     xTaskCreatePinnedToCore(ota_task, "ota_task", 8192, (void *)dirName, 5, NULL, 1);
-}
\ No newline at end of file
+}
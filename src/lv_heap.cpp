@@ -0,0 +1,147 @@
+/**
+ * @file lv_heap.cpp
+ * @brief Implements the LVGL heap.
+ *
+ * LVGL itself runs on the LVGL task, but lv_async_call() and friends
+ * allocate from other tasks, so every allocator call runs under a spinlock.
+ * Growing leaves the lock while heap_caps_malloc() runs.
+ */
+#include "lv_heap.h"
+#include <Arduino.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "alloc_trace.h"
+
+static Tlsf s_tlsf;
+static uint8_t s_initialPool[LV_HEAP_INITIAL_SIZE] __attribute__((aligned(TLSF_ALIGN)));
+static bool s_ready = false;
+static uint32_t s_grows = 0;
+static uint32_t s_failures = 0;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static LvHeapScreenStats s_screens[LV_HEAP_MAX_SCREENS];
+static size_t s_screenCount = 0;
+static const char *s_screen = nullptr;
+
+// Call with s_mux held
+static void ensure_ready() {
+    if (s_ready) return;
+    s_tlsf.addPool(s_initialPool, sizeof(s_initialPool));
+    s_ready = true;
+}
+
+// Add a region big enough for @p size; called without s_mux held
+static bool grow(size_t size) {
+    size_t bytes = Tlsf::poolBytesFor(size);
+    if (bytes < LV_HEAP_GROW_BYTES) bytes = LV_HEAP_GROW_BYTES;
+    void *mem = heap_caps_malloc(bytes, LV_HEAP_CAPS);
+    if (!mem) return false;
+    portENTER_CRITICAL(&s_mux);
+    bool added = s_tlsf.addPool(mem, bytes);
+    if (added) s_grows++;
+    portEXIT_CRITICAL(&s_mux);
+    if (!added) heap_caps_free(mem);    // TLSF_MAX_POOLS reached
+    else alloc_trace_note_alloc(mem, bytes);   // heap_caps is not wrapped; the region is kept for good
+    return added;
+}
+
+void *lv_heap_malloc(size_t size) {
+    portENTER_CRITICAL(&s_mux);
+    ensure_ready();
+    void *p = s_tlsf.malloc(size);
+    portEXIT_CRITICAL(&s_mux);
+    if (p || size == 0) return p;
+
+    if (grow(size)) {
+        portENTER_CRITICAL(&s_mux);
+        p = s_tlsf.malloc(size);
+        portEXIT_CRITICAL(&s_mux);
+    }
+    if (!p) {
+        portENTER_CRITICAL(&s_mux);
+        s_failures++;
+        portEXIT_CRITICAL(&s_mux);
+    }
+    return p;
+}
+
+void lv_heap_free(void *ptr) {
+    if (!ptr) return;
+    portENTER_CRITICAL(&s_mux);
+    s_tlsf.free(ptr);
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void *lv_heap_realloc(void *ptr, size_t size) {
+    portENTER_CRITICAL(&s_mux);
+    ensure_ready();
+    void *p = s_tlsf.realloc(ptr, size);
+    portEXIT_CRITICAL(&s_mux);
+    if (p || size == 0) return p;
+
+    // Tlsf::realloc() leaves the block alone when it fails
+    if (grow(size)) {
+        portENTER_CRITICAL(&s_mux);
+        p = s_tlsf.realloc(ptr, size);
+        portEXIT_CRITICAL(&s_mux);
+    }
+    if (!p) {
+        portENTER_CRITICAL(&s_mux);
+        s_failures++;
+        portEXIT_CRITICAL(&s_mux);
+    }
+    return p;
+}
+
+static LvHeapScreenStats *screen_entry(const char *name) {
+    for (size_t i = 0; i < s_screenCount; i++) {
+        if (s_screens[i].name == name || strcmp(s_screens[i].name, name) == 0) return &s_screens[i];
+    }
+    if (s_screenCount >= LV_HEAP_MAX_SCREENS) return nullptr;
+    LvHeapScreenStats *entry = &s_screens[s_screenCount++];
+    memset(entry, 0, sizeof(*entry));
+    entry->name = name;
+    return entry;
+}
+
+void lv_heap_screen(const char *name) {
+    // Screens are built on the LVGL task, so the table needs no lock of its own
+    portENTER_CRITICAL(&s_mux);
+    ensure_ready();
+    TlsfStats st = s_tlsf.stats();
+    s_tlsf.resetPeak();
+    portEXIT_CRITICAL(&s_mux);
+
+    if (s_screen) {
+        LvHeapScreenStats *entry = screen_entry(s_screen);
+        if (entry) {
+            entry->visits++;
+            if (st.peakUsed > entry->peakUsed) entry->peakUsed = st.peakUsed;
+            entry->largestFree = st.largestFree;
+            entry->fragPct = st.fragPct;
+            if (st.fragPct > entry->worstFragPct) entry->worstFragPct = st.fragPct;
+        }
+        Serial.printf("[LvHeap] %s: peak %u, used %u of %u, largest free %u, frag %u%%, %u pool(s)\n", s_screen,
+                      (unsigned)st.peakUsed, (unsigned)st.usedBytes, (unsigned)st.totalBytes,
+                      (unsigned)st.largestFree, st.fragPct, st.pools);
+    }
+    s_screen = name;
+}
+
+LvHeapStats lv_heap_stats() {
+    LvHeapStats st;
+    portENTER_CRITICAL(&s_mux);
+    ensure_ready();
+    st.heap = s_tlsf.stats();
+    st.grows = s_grows;
+    st.failures = s_failures;
+    portEXIT_CRITICAL(&s_mux);
+    return st;
+}
+
+size_t lv_heap_screens(LvHeapScreenStats *out, size_t max) {
+    size_t n = s_screenCount < max ? s_screenCount : max;
+    memcpy(out, s_screens, n * sizeof(LvHeapScreenStats));
+    return n;
+}
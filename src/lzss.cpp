@@ -0,0 +1,200 @@
+/**
+ * @file lzss.cpp
+ * @brief Implements the streaming LZSS codec.
+ *
+ * The encoder keeps two windows of data in buf: history the back references
+ * may point into, then the bytes still to encode. Matches are found through
+ * hash chains over three-byte prefixes. When buf fills up its upper half
+ * slides down and every stored position moves with it.
+ */
+#include <string.h>
+#include "lzss.h"
+
+#define NIL        0xFFFF
+#define HASH_SIZE  (1 << LZSS_HASH_BITS)
+
+// --- Encoder ---
+
+static inline uint16_t hash3(const uint8_t *p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (uint16_t)((uint32_t)(v * 2654435761U) >> (32 - LZSS_HASH_BITS));
+}
+
+static void flush_group(LzssEncoder *enc) {
+    if (enc->outLen == 0) return;
+    if (!enc->error && !enc->sink(enc->ctx, enc->out, enc->outLen)) enc->error = true;
+    enc->outBytes += enc->outLen;
+    enc->outLen = 0;
+    enc->flagBit = 0;
+}
+
+static void emit(LzssEncoder *enc, bool match, uint8_t b0, uint8_t b1) {
+    if (enc->outLen == 0) {
+        enc->out[0] = 0;
+        enc->outLen = 1;
+    }
+    if (match) enc->out[0] |= 1 << enc->flagBit;
+    enc->out[enc->outLen++] = b0;
+    if (match) enc->out[enc->outLen++] = b1;
+    if (++enc->flagBit == 8) flush_group(enc);
+}
+
+static void insert(LzssEncoder *enc, uint16_t p) {
+    if (p + 2 >= enc->len) return;
+    uint16_t h = hash3(&enc->buf[p]);
+    enc->prev[p & (LZSS_WINDOW - 1)] = enc->head[h];
+    enc->head[h] = p;
+}
+
+static uint16_t find_match(LzssEncoder *enc, uint16_t avail, uint16_t *dist) {
+    if (avail < LZSS_MIN_MATCH) return 0;
+    const uint8_t *cur = &enc->buf[enc->pos];
+    uint16_t maxLen = avail < LZSS_MAX_MATCH ? avail : LZSS_MAX_MATCH;
+    uint16_t best = 0;
+    uint16_t cand = enc->head[hash3(cur)];
+    for (int chain = LZSS_MAX_CHAIN; chain > 0 && cand != NIL && cand < enc->pos; chain--) {
+        if (enc->pos - cand >= LZSS_WINDOW) break;
+        const uint8_t *c = &enc->buf[cand];
+        uint16_t n = 0;
+        while (n < maxLen && c[n] == cur[n]) n++;
+        if (n > best) {
+            best = n;
+            *dist = enc->pos - cand;
+            if (n == maxLen) break;
+        }
+        uint16_t next = enc->prev[cand & (LZSS_WINDOW - 1)];
+        if (next >= cand) break;    // overwritten slot, older data is gone
+        cand = next;
+    }
+    return best >= LZSS_MIN_MATCH ? best : 0;
+}
+
+static void step(LzssEncoder *enc) {
+    uint16_t dist = 0;
+    uint16_t n = find_match(enc, enc->len - enc->pos, &dist);
+    if (n) {
+        emit(enc, true, dist & 0xFF, ((dist >> 8) << 4) | (n - LZSS_MIN_MATCH));
+    } else {
+        n = 1;
+        emit(enc, false, enc->buf[enc->pos], 0);
+    }
+    for (uint16_t i = 0; i < n; i++) insert(enc, enc->pos + i);
+    enc->pos += n;
+}
+
+static inline uint16_t slide_pos(uint16_t v) {
+    return (v == NIL || v < LZSS_WINDOW) ? NIL : v - LZSS_WINDOW;
+}
+
+static void slide(LzssEncoder *enc) {
+    memmove(enc->buf, enc->buf + LZSS_WINDOW, enc->len - LZSS_WINDOW);
+    enc->len -= LZSS_WINDOW;
+    enc->pos -= LZSS_WINDOW;
+    for (int i = 0; i < HASH_SIZE; i++) enc->head[i] = slide_pos(enc->head[i]);
+    for (int i = 0; i < LZSS_WINDOW; i++) enc->prev[i] = slide_pos(enc->prev[i]);
+}
+
+void lzss_encoder_init(LzssEncoder *enc, LzssSink sink, void *ctx) {
+    memset(enc->head, 0xFF, sizeof(enc->head));
+    memset(enc->prev, 0xFF, sizeof(enc->prev));
+    enc->len = enc->pos = 0;
+    enc->outLen = enc->flagBit = 0;
+    enc->error = false;
+    enc->sink = sink;
+    enc->ctx = ctx;
+    enc->inBytes = enc->outBytes = 0;
+}
+
+bool lzss_encode(LzssEncoder *enc, const void *data, size_t len) {
+    const uint8_t *src = (const uint8_t *)data;
+    enc->inBytes += len;
+    while (len && !enc->error) {
+        // Only full once pos is past the first window, so history survives
+        if (enc->len == sizeof(enc->buf)) slide(enc);
+        size_t n = sizeof(enc->buf) - enc->len;
+        if (n > len) n = len;
+        memcpy(enc->buf + enc->len, src, n);
+        enc->len += n;
+        src += n;
+        len -= n;
+        // Keep a full look-ahead so matches are never cut short by a chunk boundary
+        while (enc->len - enc->pos >= LZSS_MAX_MATCH) step(enc);
+    }
+    return !enc->error;
+}
+
+bool lzss_encoder_finish(LzssEncoder *enc) {
+    while (enc->pos < enc->len) step(enc);
+    emit(enc, true, 0, 0);
+    flush_group(enc);
+    return !enc->error;
+}
+
+// --- Decoder ---
+
+void lzss_decoder_init(LzssDecoder *dec, LzssSource source, void *ctx) {
+    memset(dec->window, 0, sizeof(dec->window));
+    dec->wpos = 0;
+    dec->inPos = dec->inLen = 0;
+    dec->flags = dec->flagBits = 0;
+    dec->matchDist = 0;
+    dec->matchLeft = 0;
+    dec->done = dec->error = false;
+    dec->source = source;
+    dec->ctx = ctx;
+}
+
+static int next_byte(LzssDecoder *dec) {
+    if (dec->inPos == dec->inLen) {
+        int n = dec->source(dec->ctx, dec->in, sizeof(dec->in));
+        if (n <= 0) {
+            dec->error = true;
+            return -1;
+        }
+        dec->inLen = (uint16_t)n;
+        dec->inPos = 0;
+    }
+    return dec->in[dec->inPos++];
+}
+
+int lzss_decode(LzssDecoder *dec, void *out, size_t len) {
+    uint8_t *dst = (uint8_t *)out;
+    size_t produced = 0;
+    while (produced < len) {
+        if (dec->matchLeft) {
+            uint8_t b = dec->window[(uint16_t)(dec->wpos - dec->matchDist) & (LZSS_WINDOW - 1)];
+            dec->window[dec->wpos++ & (LZSS_WINDOW - 1)] = b;
+            dst[produced++] = b;
+            dec->matchLeft--;
+            continue;
+        }
+        if (dec->done || dec->error) break;
+        if (dec->flagBits == 0) {
+            int f = next_byte(dec);
+            if (f < 0) break;
+            dec->flags = (uint8_t)f;
+            dec->flagBits = 8;
+        }
+        bool match = dec->flags & 1;
+        dec->flags >>= 1;
+        dec->flagBits--;
+        int b0 = next_byte(dec);
+        if (b0 < 0) break;
+        if (!match) {
+            dec->window[dec->wpos++ & (LZSS_WINDOW - 1)] = (uint8_t)b0;
+            dst[produced++] = (uint8_t)b0;
+            continue;
+        }
+        int b1 = next_byte(dec);
+        if (b1 < 0) break;
+        uint16_t dist = (uint16_t)b0 | ((uint16_t)(b1 >> 4) << 8);
+        if (dist == 0) {
+            dec->done = true;
+            break;
+        }
+        dec->matchDist = dist;
+        dec->matchLeft = (b1 & 0x0F) + LZSS_MIN_MATCH;
+    }
+    if (produced == 0 && dec->error) return -1;
+    return (int)produced;
+}
@@ -12,9 +12,15 @@
 #include "main.h"
 #include <time.h>
 #include "WIFI_utils.h"
+#include "wifi_roam.h"
+#include "wifi_creds.h"
 #include <WiFi.h>
 #include "config.h"
 #include "I2C_utils.h"
+#include "i2c_registry.h"
+#include "sd_mount.h"
+#include "boot.h"
+#include "alloc_trace.h"
 #include <Arduino.h>
 extern "C" {
 #include "freertos/FreeRTOS.h"
@@ -32,7 +38,6 @@ extern "C" {
  */
 void update_lvgl_on_wifi_connect(void *param) {
     Serial.println("[LVGL] Updating UI after WiFi connected!");
-    syncTimeWithNTP();
 
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
@@ -141,6 +146,8 @@ static TaskHandle_t wifiTaskHandle = NULL;
  */
 void lvglTask(void *pvParameters) {
     drawHomeScreen();  // Only draw initial screen; avoid running WiFi here
+    lv_timer_handler();
+    boot_mark("first frame");
 
     while (1) {
         lv_timer_handler();
@@ -153,23 +160,35 @@ void lvglTask(void *pvParameters) {
  * @param pvParameters Unused parameter
  */
 void wifiTask(void *pvParameters) {
-    const char *ssid = g_config.wifi_ssid.c_str();
-    const char *password = g_config.wifi_password.c_str();
+    const char *ssid = g_config.wifi_ssid;
+    const char *password = g_config.wifi_password;
+    // The provisioned network is one of the known networks
+    if (ssid[0]) saveWiFiCredentials(ssid, password);
 
-    if (connectToNetwork(ssid, password)) {
+    // Hidden SSIDs never show up in a scan, so fall back to the provisioned one
+    if (connectToLastNetwork() || connectToBestNetwork() || connectToNetwork(ssid, password)) {
         wifiConnected = true;
+        boot_mark("wifi");
+        // NTP blocks on the network, so it runs here rather than on the LVGL task
+        syncTimeWithNTP();
+        boot_mark("ntp");
         // Signal LVGL thread safely
         lv_async_call(update_lvgl_on_wifi_connect, NULL);
     } else {
         Serial.println("[WiFi] Failed to connect.");
     }
+    boot_print_timeline();
 
     while (1) {
+        // Imports the legacy CSV once the card has mounted
+        wifi_creds_begin();
+        // Samples the link and moves to a better AP before this one drops
+        wifi_roam_poll();
         if (WiFi.status() != WL_CONNECTED) {
             Serial.println("[WiFi] Disconnected, trying to reconnect...");
-            connectToNetwork(ssid, password);
+            if (!connectToLastNetwork() && !connectToBestNetwork()) connectToNetwork(ssid, password);
         }
-        vTaskDelay(pdMS_TO_TICKS(10000)); // Check every 10 seconds
+        vTaskDelay(pdMS_TO_TICKS(WIFI_ROAM_SAMPLE_MS));
     }
 }
 
@@ -190,13 +209,13 @@ void heartbeatTask(void *pvParameters) {
                 if (retryCount >= maxRetries) {
                     // If we've failed too many times, try reconnecting WiFi
                     WiFi.disconnect();
-                    WiFi.begin(g_config.wifi_ssid.c_str(), g_config.wifi_password.c_str());
+                    WiFi.begin(g_config.wifi_ssid, g_config.wifi_password);
                     retryCount = 0;
                 }
             }
         } else {
             // WiFi not connected, try to reconnect
-            WiFi.begin(g_config.wifi_ssid.c_str(), g_config.wifi_password.c_str());
+            WiFi.begin(g_config.wifi_ssid, g_config.wifi_password);
             retryCount = 0;
         }
         
@@ -214,30 +233,46 @@ void mqttLoopTask(void *pvParameters) {
     }
 }
 
-/**
- * @brief Arduino setup function. Initializes hardware, LVGL, and creates core tasks.
- */
-void setup() {
-    Serial.begin(115200);
+// Boot stages; see kBootStages for what depends on what
+enum BootStageId {
+    STAGE_CONFIG,
+    STAGE_I2C,
+    STAGE_DISPLAY,
+    STAGE_LVGL,
+    STAGE_UI,
+    STAGE_MQTT,
+    STAGE_NETWORK,
+    STAGE_SD,
+    STAGE_COUNT
+};
+
+static bool stage_config() {
     if (!loadConfig()) {
         Serial.println("Using default config or failed to load config!");
     }
+    return true;
+}
 
-    // Initialize I2C
-    if (initI2C()) {
-        Serial.println("I2C initialized successfully");
-        scanI2CDevices();  // Scan for connected I2C devices
-    } else {
+static bool stage_i2c() {
+    if (!initI2C()) {
         Serial.println("Failed to initialize I2C");
+        return false;
     }
+    Serial.println("I2C initialized successfully");
+    // Probes only the devices seen last time; the full scan runs later in the background
+    i2c_registry_begin();
+    return true;
+}
 
-    // Initialize display
+static bool stage_display() {
     tft.begin();
     tft.setRotation(0);
     mySpi.begin(25, 39, 32, 33);
     ts.begin();
+    return true;
+}
 
-    // Initialize LVGL
+static bool stage_lvgl() {
     lv_init();
     lv_disp_draw_buf_init(&draw_buf, buf, NULL, 240 * 320 / 10);
     static lv_disp_drv_t disp_drv;
@@ -253,13 +288,57 @@ void setup() {
     indev_drv.type = LV_INDEV_TYPE_POINTER;
     indev_drv.read_cb = my_touchpad_read;
     lv_indev_drv_register(&indev_drv);
+    return true;
+}
+
+static bool stage_ui() {
+    return xTaskCreatePinnedToCore(lvglTask, "LVGL", 8192, NULL, 3, &lvglTaskHandle, 0) == pdPASS;
+}
 
-    // Create tasks with proper configuration
-    xTaskCreatePinnedToCore(lvglTask, "LVGL", 8192, NULL, 3, &lvglTaskHandle, 0);
-    xTaskCreatePinnedToCore(wifiTask, "WiFi", 4096, NULL, 2, &wifiTaskHandle, 1);
-    xTaskCreatePinnedToCore(heartbeatTask, "Heartbeat", MQTT_TASK_STACK_SIZE, NULL, MQTT_TASK_PRIORITY, NULL, MQTT_TASK_CORE);
-    xTaskCreatePinnedToCore(mqttLoopTask, "MQTTLoop", 4096, NULL, 1, NULL, 1);
+static bool stage_mqtt() {
     begin(); // Only call once at startup
+    return true;
+}
+
+static bool stage_network() {
+    bool ok = xTaskCreatePinnedToCore(wifiTask, "WiFi", 4096, NULL, 2, &wifiTaskHandle, 1) == pdPASS;
+    ok &= xTaskCreatePinnedToCore(heartbeatTask, "Heartbeat", MQTT_TASK_STACK_SIZE, NULL, MQTT_TASK_PRIORITY, NULL,
+                                  MQTT_TASK_CORE) == pdPASS;
+    ok &= xTaskCreatePinnedToCore(mqttLoopTask, "MQTTLoop", 4096, NULL, 1, NULL, 1) == pdPASS;
+    return ok;
+}
+
+static bool stage_sd() {
+    // Mounts on its own task and keeps watching for card changes
+    return sd_mount_begin();
+}
+
+// Config, I2C and the display don't depend on each other and start together.
+// The SD card shares the VSPI peripheral that stage_display() points at the
+// touch pins, so it is mounted after it. Nothing waits for the SD card or the
+// network before the first frame.
+static const BootStage kBootStages[STAGE_COUNT] = {
+    // name      run            deps                                            core  stack
+    {"config",  stage_config,  0,                                              1,    6144},
+    {"i2c",     stage_i2c,     0,                                              1,    0},
+    {"display", stage_display, 0,                                              0,    0},
+    {"lvgl",    stage_lvgl,    BOOT_DEP(STAGE_DISPLAY),                        0,    0},
+    {"ui",      stage_ui,      BOOT_DEP(STAGE_CONFIG) | BOOT_DEP(STAGE_LVGL),  0,    0},
+    {"mqtt",    stage_mqtt,    0,                                              1,    0},
+    // The WiFi task posts to LVGL once connected
+    {"network", stage_network, BOOT_DEP(STAGE_CONFIG) | BOOT_DEP(STAGE_LVGL) | BOOT_DEP(STAGE_MQTT), 1, 0},
+    {"sd",      stage_sd,      BOOT_DEP(STAGE_DISPLAY),                        1,    0},
+};
+
+/**
+ * @brief Arduino setup function. Runs the boot stages; returns once all have finished.
+ */
+void setup() {
+    Serial.begin(115200);
+    boot_mark("setup");
+    boot_run(kBootStages, STAGE_COUNT);
+    // Periodic heap report in the trace build; nothing otherwise
+    alloc_trace_begin();
 }
 
 /**
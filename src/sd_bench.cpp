@@ -0,0 +1,286 @@
+/**
+ * @file sd_bench.cpp
+ * @brief Implements the SD throughput benchmark and SPI clock tuning.
+ *
+ * Everything above the ARDUINO guard only needs an SdBenchIo and a clock,
+ * so it builds unchanged for a host run against a card image.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "sd_bench.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <nvs.h>
+#include <rom/crc.h>
+#include "SD_utils.h"
+#include "dir_cache.h"
+#include "file_jobs.h"
+#include "file_viewer.h"
+#include "sd_mount.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#define BENCH_LOG(...) Serial.printf(__VA_ARGS__)
+static uint32_t bench_us() { return micros(); }
+#else
+#include <stdio.h>
+#include <time.h>
+#define BENCH_LOG(...) printf(__VA_ARGS__)
+static uint32_t bench_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+#endif
+
+// Every sector gets content derived from its number and the pass seed, so a
+// misdirected or torn transfer shows up on read-back.
+static void fill_pattern(uint8_t *buf, uint32_t sector, uint32_t count, uint32_t seed) {
+    uint32_t *w = (uint32_t *)buf;
+    for (uint32_t s = 0; s < count; s++) {
+        uint32_t base = (sector + s) * 2654435761u ^ seed;
+        for (uint32_t i = 0; i < 512 / 4; i++) *w++ = base + i * 16777619u;
+    }
+}
+
+static bool check_pattern(const uint8_t *buf, uint32_t sector, uint32_t count, uint32_t seed) {
+    const uint32_t *w = (const uint32_t *)buf;
+    for (uint32_t s = 0; s < count; s++) {
+        uint32_t base = (sector + s) * 2654435761u ^ seed;
+        for (uint32_t i = 0; i < 512 / 4; i++) {
+            if (*w++ != base + i * 16777619u) return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t kb_per_s(uint64_t bytes, uint32_t us) {
+    return us ? (uint32_t)(bytes * 1000000ULL / 1024 / us) : 0;
+}
+
+static uint32_t next_random(uint32_t &state) {
+    state = state * 1103515245u + 12345u;
+    return state >> 8;
+}
+
+bool sd_bench_device(SdBenchIo *dev, uint32_t firstSector, uint32_t sectorCount,
+                     SdBenchResult &out) {
+    out.ok = false;
+    out.errors = 0;
+    out.seqWriteKBs = out.seqReadKBs = out.rndWriteKBs = out.rndReadKBs = 0;
+
+    uint32_t seqRuns = sectorCount / SD_BENCH_SEQ_SECTORS;
+    uint32_t rndSlots = sectorCount / SD_BENCH_RND_SECTORS;
+    if (!dev || seqRuns == 0) return false;
+
+    uint8_t *buf = (uint8_t *)malloc(SD_BENCH_SEQ_SECTORS * 512);
+    if (!buf) return false;
+    uint32_t seed = bench_us();
+
+    // Sequential write, then read back and verify
+    uint32_t t0 = bench_us();
+    for (uint32_t r = 0; r < seqRuns; r++) {
+        uint32_t sector = firstSector + r * SD_BENCH_SEQ_SECTORS;
+        fill_pattern(buf, sector, SD_BENCH_SEQ_SECTORS, seed);
+        if (!dev->writeSectors(sector, buf, SD_BENCH_SEQ_SECTORS)) out.errors++;
+    }
+    if (!dev->syncDevice()) out.errors++;
+    out.seqWriteKBs = kb_per_s((uint64_t)seqRuns * SD_BENCH_SEQ_SECTORS * 512, bench_us() - t0);
+
+    t0 = bench_us();
+    for (uint32_t r = 0; r < seqRuns; r++) {
+        uint32_t sector = firstSector + r * SD_BENCH_SEQ_SECTORS;
+        if (!dev->readSectors(sector, buf, SD_BENCH_SEQ_SECTORS) ||
+            !check_pattern(buf, sector, SD_BENCH_SEQ_SECTORS, seed)) {
+            out.errors++;
+        }
+    }
+    out.seqReadKBs = kb_per_s((uint64_t)seqRuns * SD_BENCH_SEQ_SECTORS * 512, bench_us() - t0);
+
+    // Random 4 KB writes, then the same sequence of reads with verification
+    uint32_t rndSeed = seed ^ 0x5A5A5A5A;
+    uint32_t state = rndSeed;
+    t0 = bench_us();
+    for (uint32_t i = 0; i < SD_BENCH_RND_OPS; i++) {
+        uint32_t sector = firstSector + (next_random(state) % rndSlots) * SD_BENCH_RND_SECTORS;
+        fill_pattern(buf, sector, SD_BENCH_RND_SECTORS, rndSeed);
+        if (!dev->writeSectors(sector, buf, SD_BENCH_RND_SECTORS)) out.errors++;
+    }
+    if (!dev->syncDevice()) out.errors++;
+    out.rndWriteKBs = kb_per_s((uint64_t)SD_BENCH_RND_OPS * SD_BENCH_RND_SECTORS * 512, bench_us() - t0);
+
+    state = rndSeed;
+    t0 = bench_us();
+    for (uint32_t i = 0; i < SD_BENCH_RND_OPS; i++) {
+        uint32_t sector = firstSector + (next_random(state) % rndSlots) * SD_BENCH_RND_SECTORS;
+        if (!dev->readSectors(sector, buf, SD_BENCH_RND_SECTORS) ||
+            !check_pattern(buf, sector, SD_BENCH_RND_SECTORS, rndSeed)) {
+            out.errors++;
+        }
+    }
+    out.rndReadKBs = kb_per_s((uint64_t)SD_BENCH_RND_OPS * SD_BENCH_RND_SECTORS * 512, bench_us() - t0);
+
+    free(buf);
+    out.ok = out.errors == 0;
+    return out.ok;
+}
+
+void sd_bench_print(const SdBenchResult &r) {
+    char clock[12] = "";    // No SPI clock off the device
+    if (r.clockMhz) snprintf(clock, sizeof(clock), "%2u MHz: ", r.clockMhz);
+    BENCH_LOG("[SdBench] %sseq W %lu KB/s R %lu KB/s, 4K W %lu KB/s R %lu KB/s, %s (%lu errors)\n",
+              clock, (unsigned long)r.seqWriteKBs, (unsigned long)r.seqReadKBs,
+              (unsigned long)r.rndWriteKBs, (unsigned long)r.rndReadKBs,
+              r.ok ? "ok" : "FAILED", (unsigned long)r.errors);
+}
+
+#ifdef ARDUINO
+
+#define NVS_NAMESPACE "storage"
+
+// ESP32 SPI clocks come from 80 MHz dividers; these are the useful steps
+static const uint8_t s_clocks[SD_BENCH_MAX_CLOCKS] = {10, 16, 20, 26, 32, 40};
+
+static SdBenchResult s_results[SD_BENCH_MAX_CLOCKS];
+static volatile size_t s_done = 0;
+static volatile bool s_running = false;
+static uint8_t s_best = 0;
+
+uint8_t sd_clock_load(uint32_t *cidHash) {
+    nvs_handle_t h;
+    uint8_t mhz = 0;
+    uint32_t cid = 0;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) == ESP_OK) {
+        nvs_get_u8(h, "sd_mhz", &mhz);
+        nvs_get_u32(h, "sd_cid", &cid);
+        nvs_close(h);
+    }
+    if (cidHash) *cidHash = cid;
+    return mhz;
+}
+
+void sd_clock_save(uint32_t cidHash, uint8_t mhz) {
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return;
+    nvs_set_u8(h, "sd_mhz", mhz);
+    nvs_set_u32(h, "sd_cid", cidHash);
+    nvs_commit(h);
+    nvs_close(h);
+}
+
+uint32_t sd_card_cid_hash() {
+    cid_t cid;
+    if (!sd.card() || !sd.card()->readCID(&cid)) return 0;
+    return crc32_le(0, (const uint8_t *)&cid, sizeof(cid));
+}
+
+// Contiguous scratch file so raw sector I/O stays inside space we own
+static bool create_scratch(uint32_t *first, uint32_t *count) {
+    sd.remove(SD_BENCH_FILE);
+    SdFile f;
+    if (!f.open(SD_BENCH_FILE, O_RDWR | O_CREAT | O_TRUNC)) return false;
+    uint32_t last = 0;
+    bool ok = f.preAllocate(SD_BENCH_FILE_BYTES) && f.contiguousRange(first, &last);
+    f.close();
+    dir_cache_note_write(SD_BENCH_FILE);
+    if (!ok) {
+        sd.remove(SD_BENCH_FILE);
+        return false;
+    }
+    *count = last - *first + 1;
+    return true;
+}
+
+static void bench_task(void *pvParameters) {
+    uint8_t startMhz = SD_CLOCK_DEFAULT_MHZ;
+    uint32_t cidHash = 0;
+    uint32_t first = 0, count = 0;
+    bool scratch;
+    file_viewer_close_file();  // Its handle would not survive the remounts
+    {
+        SdLock lock;
+        uint32_t savedCid;
+        uint8_t saved = sd_clock_load(&savedCid);
+        cidHash = sd_card_cid_hash();
+        if (saved && savedCid == cidHash) startMhz = saved;
+        scratch = create_scratch(&first, &count);
+        if (scratch) sd_cache_detach();  // Measure the card, not the sector cache
+    }
+    if (!scratch) {
+        BENCH_LOG("[SdBench] Could not allocate a contiguous %lu byte scratch file\n",
+                  (unsigned long)SD_BENCH_FILE_BYTES);
+        sd_mount_resume();
+        s_running = false;
+        vTaskDelete(NULL);
+        return;
+    }
+    BENCH_LOG("[SdBench] Scratch sectors %lu..%lu\n", (unsigned long)first, (unsigned long)(first + count - 1));
+
+    uint32_t bestScore = 0;
+    for (size_t i = 0; i < SD_BENCH_MAX_CLOCKS; i++) {
+        SdBenchResult &r = s_results[i];
+        memset(&r, 0, sizeof(r));
+        r.clockMhz = s_clocks[i];
+        {
+            // One clock per lock so the explorer and file jobs get a turn in between
+            SdLock lock;
+            sd.end();
+            if (sd.begin(SS, SD_SCK_MHZ(r.clockMhz))) {
+                SdBenchBlockIo io(sd.card());
+                sd_bench_device(&io, first, count, r);
+            } else {
+                r.errors = 1;
+                sd.begin(SS, SD_SCK_MHZ(SD_CLOCK_SAFE_MHZ));  // Keep a volume up between phases
+            }
+        }
+        sd_bench_print(r);
+        // Higher clocks only count if they are actually faster
+        uint32_t score = r.seqReadKBs + r.seqWriteKBs + r.rndReadKBs + r.rndWriteKBs;
+        if (r.ok && score > bestScore) {
+            bestScore = score;
+            s_best = r.clockMhz;
+        }
+        s_done = i + 1;
+    }
+
+    {
+        SdLock lock;
+        uint8_t mountMhz = s_best ? s_best : startMhz;
+        if (!sd_remount(mountMhz)) sd_remount(SD_CLOCK_SAFE_MHZ);
+        sd.remove(SD_BENCH_FILE);
+        dir_cache_invalidate_all();
+    }
+    sd_mount_resume();
+    if (s_best && cidHash) {
+        sd_clock_save(cidHash, s_best);
+        BENCH_LOG("[SdBench] Saved %u MHz for this card\n", s_best);
+    }
+    s_running = false;
+    vTaskDelete(NULL);
+}
+
+bool sd_bench_start() {
+    // Every clock step remounts: no screen may open files until the sweep is done
+    if (s_running || file_job_busy() || !sd_mount_suspend()) return false;
+    s_running = true;
+    s_done = 0;
+    s_best = 0;
+    if (xTaskCreatePinnedToCore(bench_task, "SdBench", 4096, NULL, 1, NULL, 1) != pdPASS) {
+        sd_mount_resume();
+        s_running = false;
+        return false;
+    }
+    return true;
+}
+
+size_t sd_bench_progress(const SdBenchResult **results, bool *running) {
+    if (results) *results = s_results;
+    if (running) *running = s_running;
+    return s_done;
+}
+
+uint8_t sd_bench_best_clock() {
+    return s_best;
+}
+
+#endif // ARDUINO
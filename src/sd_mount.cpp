@@ -0,0 +1,161 @@
+/**
+ * @file sd_mount.cpp
+ * @brief Implements the SD mount task.
+ *
+ * The task sleeps on its notification value, so sd_mount_request() wakes it
+ * early and an idle poll costs one CID read under the SD lock.
+ */
+#include "sd_mount.h"
+#include <Arduino.h>
+#include <SdFat.h>
+#include "SD_utils.h"
+#include "sd_bench.h"
+#include "dir_cache.h"
+#include "file_jobs.h"
+#include "file_viewer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define SD_MOUNT_JOB_STOP_MS 5000  // A job checks for cancel once per chunk
+
+static SdMountStatus s_status = {};
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_task = nullptr;
+
+static void set_state(SdMountState state) {
+    portENTER_CRITICAL(&s_mux);
+    s_status.state = state;
+    s_status.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// Returns how long to sleep before the next check
+static uint32_t mount() {
+    set_state(SD_MOUNT_MOUNTING);
+    uint32_t t0 = millis();
+    bool ok = init_sd_card();
+    uint32_t cid = 0;
+    if (ok) {
+        SdLock lock;
+        cid = sd_card_cid_hash();
+    }
+    uint32_t ms = millis() - t0;
+
+    portENTER_CRITICAL(&s_mux);
+    s_status.state = ok ? SD_MOUNT_MOUNTED : SD_MOUNT_NO_CARD;
+    if (ok) {
+        s_status.cid = cid;
+        s_status.mounts++;
+        s_status.mountMs = ms;
+    }
+    s_status.generation++;
+    portEXIT_CRITICAL(&s_mux);
+    if (ok) Serial.printf("[SdMount] Card %08lx mounted in %lu ms\n", (unsigned long)cid, (unsigned long)ms);
+    return ok ? SD_MOUNT_POLL_MS : SD_MOUNT_RETRY_MS;
+}
+
+// The card was pulled or swapped. An orderly unmount goes through
+// sd_remount(), which writes the cache back; here it is dropped, since on a
+// swapped card the dirty FAT and directory sectors would land on the new one.
+static void unmount(const char *why) {
+    file_job_cancel();
+    {
+        SdLock lock;
+        sd_cache_drop();        // Also fails the job's remaining I/O on a cached mount
+        file_viewer_close_file();
+    }
+    // Not under the SD lock: the job takes it for every chunk
+    uint32_t t0 = millis();
+    while (file_job_busy() && millis() - t0 < SD_MOUNT_JOB_STOP_MS) vTaskDelay(pdMS_TO_TICKS(10));
+    if (file_job_busy()) Serial.println("[SdMount] File job did not stop; unmounting anyway");
+    {
+        SdLock lock;
+        sd.end();
+        dir_cache_invalidate_all();
+    }
+    portENTER_CRITICAL(&s_mux);
+    s_status.state = SD_MOUNT_NO_CARD;
+    s_status.removals++;
+    s_status.generation++;
+    portEXIT_CRITICAL(&s_mux);
+    Serial.printf("[SdMount] Card %s, unmounted\n", why);
+}
+
+static uint32_t check() {
+    portENTER_CRITICAL(&s_mux);
+    SdMountState state = s_status.state;
+    uint32_t mountedCid = s_status.cid;
+    portEXIT_CRITICAL(&s_mux);
+    if (state == SD_MOUNT_SUSPENDED) return SD_MOUNT_POLL_MS;
+    if (state != SD_MOUNT_MOUNTED) return mount();
+
+    uint32_t cid;
+    {
+        SdLock lock;
+        cid = sd_card_cid_hash();
+    }
+    if (cid == mountedCid) return SD_MOUNT_POLL_MS;
+    if (cid == 0) {
+        unmount("removed");
+        return SD_MOUNT_RETRY_MS;
+    }
+    unmount("swapped");
+    return mount();
+}
+
+static void mount_task(void *pvParameters) {
+    while (1) {
+        uint32_t waitMs = check();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+    }
+}
+
+bool sd_mount_begin() {
+    if (s_task) return true;
+    return xTaskCreatePinnedToCore(mount_task, "SdMount", 6144, NULL, 1, &s_task, 1) == pdPASS;
+}
+
+bool sd_mounted() {
+    portENTER_CRITICAL(&s_mux);
+    bool mounted = s_status.state == SD_MOUNT_MOUNTED;
+    portEXIT_CRITICAL(&s_mux);
+    return mounted;
+}
+
+uint32_t sd_mount_generation() {
+    portENTER_CRITICAL(&s_mux);
+    uint32_t gen = s_status.generation;
+    portEXIT_CRITICAL(&s_mux);
+    return gen;
+}
+
+SdMountStatus sd_mount_status() {
+    portENTER_CRITICAL(&s_mux);
+    SdMountStatus st = s_status;
+    portEXIT_CRITICAL(&s_mux);
+    return st;
+}
+
+bool sd_mount_suspend() {
+    portENTER_CRITICAL(&s_mux);
+    bool mounted = s_status.state == SD_MOUNT_MOUNTED;
+    if (mounted) {
+        s_status.state = SD_MOUNT_SUSPENDED;
+        s_status.generation++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return mounted;
+}
+
+void sd_mount_resume() {
+    portENTER_CRITICAL(&s_mux);
+    if (s_status.state == SD_MOUNT_SUSPENDED) {
+        s_status.state = SD_MOUNT_MOUNTED;
+        s_status.generation++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void sd_mount_request() {
+    if (s_task) xTaskNotifyGive(s_task);
+}
@@ -0,0 +1,174 @@
+/**
+ * @file sd_space.cpp
+ * @brief Implements the background SD free-space tracker.
+ *
+ * FAT16/32 volumes are scanned by reading the FAT directly in small chunks,
+ * releasing the SD lock between chunks so the UI and other tasks keep
+ * working. exFAT keeps free space in a compact bitmap and FAT12 volumes are
+ * tiny, so SdFat's own count is used for those.
+ */
+#include <Arduino.h>
+#include <stdlib.h>
+#include "sd_space.h"
+#include "SD_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define SCAN_CHUNK_SECTORS 16   // FAT sectors read per SD lock hold
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static SdSpaceInfo s_info;
+static uint32_t s_cid = 0;
+static uint32_t s_clusterBytes = 0;
+static uint32_t s_freeClusters = 0;
+static int32_t s_scanDelta = 0;         // Changes reported while a scan runs
+static volatile bool s_restart = false; // Card changed under a running scan
+
+static uint64_t clamp_free(int64_t clusters, uint64_t total) {
+    if (clusters < 0) return 0;
+    uint64_t bytes = (uint64_t)clusters * s_clusterBytes;
+    return bytes > total ? total : bytes;
+}
+
+static bool count_fat_free(uint8_t fatType, uint32_t fatStart, uint32_t clusters, uint32_t *freeOut) {
+    uint32_t perSector = fatType == 32 ? 128 : (fatType == 16 ? 256 : 0);
+    if (perSector == 0) return false;
+    uint32_t entries = clusters + 2;  // Entries 0 and 1 are reserved
+    uint32_t sectors = (entries + perSector - 1) / perSector;
+
+    uint8_t *buf = (uint8_t *)malloc(SCAN_CHUNK_SECTORS * 512);
+    if (!buf) return false;
+
+    uint32_t freeCount = 0;
+    bool ok = true;
+    for (uint32_t s = 0; s < sectors && ok; s += SCAN_CHUNK_SECTORS) {
+        uint32_t n = sectors - s < SCAN_CHUNK_SECTORS ? sectors - s : SCAN_CHUNK_SECTORS;
+        {
+            SdLock lock;
+            FsBlockDevice *dev = sd_block_device();
+            ok = !s_restart && dev && dev->readSectors(fatStart + s, buf, n);
+        }
+        if (!ok) break;
+
+        uint32_t first = s * perSector;
+        uint32_t count = n * perSector;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t idx = first + i;
+            if (idx < 2 || idx >= entries) continue;
+            bool isFree = fatType == 32 ? (((uint32_t *)buf)[i] & 0x0FFFFFFF) == 0
+                                        : ((uint16_t *)buf)[i] == 0;
+            if (isFree) freeCount++;
+        }
+        vTaskDelay(1);  // Let waiting SD users in
+    }
+    free(buf);
+    *freeOut = freeCount;
+    return ok;
+}
+
+static void scan_task(void *pvParameters) {
+    bool ok;
+    uint32_t clusters, freeClusters, elapsed;
+    do {
+        s_restart = false;
+        uint32_t t0 = millis();
+        uint8_t fatType;
+        uint32_t fatStart, clusterBytes;
+        {
+            SdLock lock;
+            fatType = sd.vol()->fatType();
+            clusters = sd.vol()->clusterCount();
+            fatStart = sd.vol()->fatStartSector();
+            clusterBytes = sd.vol()->bytesPerCluster();
+        }
+        taskENTER_CRITICAL(&s_mux);
+        s_clusterBytes = clusterBytes;
+        s_scanDelta = 0;
+        taskEXIT_CRITICAL(&s_mux);
+
+        freeClusters = 0;
+        if (fatType == 16 || fatType == 32) {
+            ok = count_fat_free(fatType, fatStart, clusters, &freeClusters);
+        } else {
+            SdLock lock;
+            int32_t n = sd.vol()->freeClusterCount();
+            ok = n >= 0;
+            freeClusters = ok ? (uint32_t)n : 0;
+        }
+        elapsed = millis() - t0;
+    } while (s_restart);
+
+    taskENTER_CRITICAL(&s_mux);
+    s_info.scanning = false;
+    s_info.valid = ok;
+    if (ok) {
+        s_info.totalBytes = (uint64_t)clusters * s_clusterBytes;
+        int64_t adjusted = (int64_t)freeClusters - s_scanDelta;
+        s_freeClusters = adjusted < 0 ? 0 : (uint32_t)adjusted;
+        s_info.freeBytes = clamp_free(s_freeClusters, s_info.totalBytes);
+        s_info.scanMs = elapsed;
+    }
+    s_info.generation++;
+    taskEXIT_CRITICAL(&s_mux);
+
+    Serial.printf("[SdSpace] %s: %llu of %llu bytes free, scan %lu ms\n", ok ? "done" : "failed",
+                  (unsigned long long)s_info.freeBytes, (unsigned long long)s_info.totalBytes,
+                  (unsigned long)elapsed);
+    vTaskDelete(NULL);
+}
+
+void sd_space_rescan() {
+    taskENTER_CRITICAL(&s_mux);
+    bool running = s_info.scanning;
+    s_info.scanning = true;
+    taskEXIT_CRITICAL(&s_mux);
+    if (running) {
+        s_restart = true;
+        return;
+    }
+    if (xTaskCreatePinnedToCore(scan_task, "SdSpace", 3072, NULL, 1, NULL, 1) != pdPASS) {
+        taskENTER_CRITICAL(&s_mux);
+        s_info.scanning = false;
+        taskEXIT_CRITICAL(&s_mux);
+    }
+}
+
+void sd_space_mounted(uint32_t cidHash) {
+    taskENTER_CRITICAL(&s_mux);
+    bool keep = cidHash != 0 && cidHash == s_cid && (s_info.valid || s_info.scanning);
+    if (!keep) {
+        s_cid = cidHash;
+        s_info.valid = false;
+        s_info.generation++;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+    if (!keep) sd_space_rescan();
+}
+
+SdSpaceInfo sd_space_get() {
+    taskENTER_CRITICAL(&s_mux);
+    SdSpaceInfo info = s_info;
+    taskEXIT_CRITICAL(&s_mux);
+    return info;
+}
+
+void sd_space_note_clusters(int32_t delta) {
+    if (delta == 0) return;
+    taskENTER_CRITICAL(&s_mux);
+    if (s_info.scanning) s_scanDelta += delta;
+    if (s_info.valid) {
+        int64_t freeClusters = (int64_t)s_freeClusters - delta;
+        s_freeClusters = freeClusters < 0 ? 0 : (uint32_t)freeClusters;
+        s_info.freeBytes = clamp_free(s_freeClusters, s_info.totalBytes);
+        s_info.generation++;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+void sd_space_note_file(uint64_t oldSize, uint64_t newSize) {
+    uint32_t cb = s_clusterBytes;
+    if (cb == 0) return;
+    int64_t oldClusters = (oldSize + cb - 1) / cb;
+    int64_t newClusters = (newSize + cb - 1) / cb;
+    sd_space_note_clusters((int32_t)(newClusters - oldClusters));
+}
@@ -6,21 +6,33 @@
  */
 #include <TFT_eSPI.h>
 #include <lvgl.h>
-#include <nvs.h>
 #include <nvs_flash.h>
 #include <SdFat.h>
 #include "settings.h"
+#include "settings_store.h"
 #include "SD_utils.h"
+#include "backup.h"
+#include "sd_bench.h"
+#include "sd_space.h"
+#include "file_jobs.h"
+#include "app_catalog.h"
 #include "settings_WIFI.h"
 #include "ui.h"
+#include "lv_heap.h"
 
 extern TFT_eSPI tft;
 extern SdFat sd;
 
-#define NVS_NAMESPACE "storage"
-
 static lv_obj_t *slider;
 static lv_obj_t *label_brightness;
+static lv_obj_t *label_store_stats;
+
+static void update_store_stats() {
+    SettingsStoreStats st = settings_store_stats();
+    lv_label_set_text_fmt(label_store_stats, "NVS commits: %lu (%lu keys)\nLast %lu us, max %lu us",
+                          (unsigned long)st.commits, (unsigned long)st.keysWritten,
+                          (unsigned long)st.lastCommitUs, (unsigned long)st.maxCommitUs);
+}
 
 void initSettings() {
     // Initialize NVS
@@ -33,24 +45,21 @@ void initSettings() {
 }
 
 void saveBrightness(int brightness) {
-    nvs_handle_t my_handle;
-    ESP_ERROR_CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_handle));
-    ESP_ERROR_CHECK(nvs_set_i32(my_handle, "brightness", brightness));
-    ESP_ERROR_CHECK(nvs_commit(my_handle));
-    nvs_close(my_handle);
+    settings_store_set_i32("brightness", brightness);
 }
 
 int loadBrightness() {
-    nvs_handle_t my_handle;
-    int32_t brightness = 100;
-    ESP_ERROR_CHECK(nvs_open(NVS_NAMESPACE, NVS_READONLY, &my_handle));
-    ESP_ERROR_CHECK(nvs_get_i32(my_handle, "brightness", &brightness));
-    nvs_close(my_handle);
-    return brightness;
+    return settings_store_get_i32("brightness", 100);
 }
 
 void brightness_event_cb(lv_event_t *e) {
     lv_obj_t *slider = lv_event_get_target(e);
+    if (lv_event_get_code(e) == LV_EVENT_RELEASED) {
+        // End of the drag: no point waiting out the quiet period
+        settings_store_flush();
+        update_store_stats();
+        return;
+    }
     int brightness = lv_slider_get_value(slider);
     char buf[8];
     snprintf(buf, sizeof(buf), "%d%%", brightness);
@@ -60,6 +69,7 @@ void brightness_event_cb(lv_event_t *e) {
 }
 
 void showDisplaySettings(lv_event_t *e) {
+    lv_heap_screen("display");
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
 
@@ -73,6 +83,7 @@ void showDisplaySettings(lv_event_t *e) {
     lv_slider_set_range(slider, 0, 100);
     lv_slider_set_value(slider, loadBrightness(), LV_ANIM_OFF);
     lv_obj_add_event_cb(slider, brightness_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+    lv_obj_add_event_cb(slider, brightness_event_cb, LV_EVENT_RELEASED, NULL);
 
     label_brightness = lv_label_create(scr);
     lv_obj_align(label_brightness, LV_ALIGN_TOP_MID, 0, 70);
@@ -80,40 +91,289 @@ void showDisplaySettings(lv_event_t *e) {
     snprintf(buf, sizeof(buf), "%d%%", lv_slider_get_value(slider));
     lv_label_set_text(label_brightness, buf);
 
+    label_store_stats = lv_label_create(scr);
+    lv_obj_align(label_store_stats, LV_ALIGN_TOP_MID, 0, 100);
+    update_store_stats();
+
     // drawNavBar();
 }
 
+static lv_obj_t *bench_result_label = NULL;
+static lv_timer_t *bench_timer = NULL;
+
+// Mirrors the sweep results into the label while the benchmark task runs
+static void sd_bench_timer_cb(lv_timer_t *timer) {
+    const SdBenchResult *results;
+    bool running;
+    size_t n = sd_bench_progress(&results, &running);
+
+    char text[320];
+    size_t len = snprintf(text, sizeof(text), "%s\nMHz  seqW  seqR  4kW  4kR KB/s\n",
+                          running ? "Benchmarking..." : "Benchmark done");
+    for (size_t i = 0; i < n && len < sizeof(text); i++) {
+        const SdBenchResult &r = results[i];
+        if (r.ok) {
+            len += snprintf(text + len, sizeof(text) - len, "%3u %5lu %5lu %4lu %4lu\n", r.clockMhz,
+                            (unsigned long)r.seqWriteKBs, (unsigned long)r.seqReadKBs,
+                            (unsigned long)r.rndWriteKBs, (unsigned long)r.rndReadKBs);
+        } else {
+            len += snprintf(text + len, sizeof(text) - len, "%3u failed\n", r.clockMhz);
+        }
+    }
+    if (!running && len < sizeof(text)) {
+        uint8_t best = sd_bench_best_clock();
+        if (best) snprintf(text + len, sizeof(text) - len, "Saved %u MHz", best);
+        else snprintf(text + len, sizeof(text) - len, "No stable clock found");
+    }
+    if (bench_result_label) lv_label_set_text(bench_result_label, text);
+
+    if (!running) {
+        lv_timer_del(bench_timer);
+        bench_timer = NULL;
+    }
+}
+
+static void sd_bench_btn_cb(lv_event_t *e) {
+    if (bench_timer || !sd_bench_start()) return;
+    bench_timer = lv_timer_create(sd_bench_timer_cb, 250, NULL);
+}
+
+// Copy job throughput next to the raw rates it is bounded by
+static void copy_bench_timer_cb(lv_timer_t *timer) {
+    if (file_job_busy()) {
+        FileJobStatus st = file_job_status();
+        if (bench_result_label) {
+            lv_label_set_text_fmt(bench_result_label, "Copy test: %s...\n%lu KB/s", st.name,
+                                  (unsigned long)st.kbPerSec);
+        }
+        return;
+    }
+    FileJobBench r = file_job_bench_result();
+    if (bench_result_label) {
+        if (r.valid) {
+            lv_label_set_text_fmt(bench_result_label,
+                                  "Raw read %lu, write %lu KB/s\nCopy bound %lu KB/s\nCopy job %lu KB/s (%lu%%)",
+                                  (unsigned long)r.rawReadKBs, (unsigned long)r.rawWriteKBs,
+                                  (unsigned long)r.boundKBs, (unsigned long)r.copyKBs,
+                                  (unsigned long)(r.boundKBs ? r.copyKBs * 100 / r.boundKBs : 0));
+        } else {
+            lv_label_set_text(bench_result_label, "Copy test failed");
+        }
+    }
+    lv_timer_del(bench_timer);
+    bench_timer = NULL;
+}
+
+static void copy_bench_btn_cb(lv_event_t *e) {
+    if (bench_timer || !file_job_bench_start()) return;
+    bench_timer = lv_timer_create(copy_bench_timer_cb, 250, NULL);
+}
+
+static const uint16_t launch_bench_sizes[] = {10, 100, 500};
+#define LAUNCH_BENCH_SIZES    (sizeof(launch_bench_sizes) / sizeof(launch_bench_sizes[0]))
+#define LAUNCH_BENCH_SLICE    25        // Apps created per timer tick
+static AppCatalogBench launch_bench_results[LAUNCH_BENCH_SIZES];
+static uint8_t launch_bench_step = 0;
+
+static void launch_bench_finish(const char *text) {
+    if (bench_result_label) lv_label_set_text(bench_result_label, text);
+    lv_timer_del(bench_timer);
+    bench_timer = NULL;
+}
+
+// One slice per tick: create the synthetic apps, then time one size
+static void launch_bench_timer_cb(lv_timer_t *timer) {
+    uint16_t apps = launch_bench_sizes[launch_bench_step];
+    SdLock lock;
+    int left = app_catalog_bench_prepare(apps, LAUNCH_BENCH_SLICE);
+    if (left < 0) {
+        launch_bench_finish("Launcher test failed");
+        return;
+    }
+    if (left > 0) {
+        if (bench_result_label) {
+            lv_label_set_text_fmt(bench_result_label, "Creating %u test apps... %d left", apps, left);
+        }
+        return;
+    }
+    if (!app_catalog_bench_run(apps, launch_bench_results[launch_bench_step])) {
+        launch_bench_finish("Launcher test failed");
+        return;
+    }
+    if (++launch_bench_step < LAUNCH_BENCH_SIZES) {
+        if (bench_result_label) lv_label_set_text_fmt(bench_result_label, "Timing %u apps...",
+                                                      launch_bench_sizes[launch_bench_step]);
+        return;
+    }
+
+    char text[160];
+    size_t len = snprintf(text, sizeof(text), "Apps  walk  cold  warm ms\n");
+    for (size_t i = 0; i < LAUNCH_BENCH_SIZES && len < sizeof(text); i++) {
+        const AppCatalogBench &r = launch_bench_results[i];
+        len += snprintf(text + len, sizeof(text) - len, "%4u %5lu %5lu %5lu\n", r.apps,
+                        (unsigned long)r.legacyMs, (unsigned long)r.coldMs, (unsigned long)r.warmMs);
+    }
+    launch_bench_finish(text);
+}
+
+static void launch_bench_btn_cb(lv_event_t *e) {
+    if (bench_timer || file_job_busy()) return;
+    launch_bench_step = 0;
+    bench_timer = lv_timer_create(launch_bench_timer_cb, 50, NULL);
+    if (bench_result_label) lv_label_set_text(bench_result_label, "Launcher test...");
+}
+
+static void sd_bench_label_delete_cb(lv_event_t *e) {
+    bench_result_label = NULL;  // The sweep keeps running; the timer just stops drawing
+}
+
+static lv_obj_t *usage_label = NULL;
+static lv_obj_t *usage_bar = NULL;
+static lv_timer_t *usage_timer = NULL;
+static uint32_t usage_generation = 0;
+
+static void show_sd_usage(const SdSpaceInfo &info) {
+    usage_generation = info.generation;
+    if (!info.valid) {
+        lv_label_set_text(usage_label, info.scanning ? "SD Card Usage: counting..." : "SD Card Usage: unknown");
+        lv_bar_set_value(usage_bar, 0, LV_ANIM_OFF);
+        return;
+    }
+    uint64_t used = info.totalBytes - info.freeBytes;
+    lv_label_set_text_fmt(usage_label, "SD Card Usage: %lu / %lu MB", (unsigned long)(used >> 20),
+                          (unsigned long)(info.totalBytes >> 20));
+    // Per mille: byte counts overflow the bar's 32-bit range
+    lv_bar_set_value(usage_bar, info.totalBytes ? (int32_t)(used * 1000 / info.totalBytes) : 0, LV_ANIM_OFF);
+}
+
+static void sd_usage_timer_cb(lv_timer_t *timer) {
+    SdSpaceInfo info = sd_space_get();
+    if (info.generation != usage_generation) show_sd_usage(info);
+}
+
+static void sd_usage_delete_cb(lv_event_t *e) {
+    if (usage_timer) lv_timer_del(usage_timer);
+    usage_timer = NULL;
+    usage_label = NULL;
+    usage_bar = NULL;
+}
+
 void showSDCardSettings(lv_event_t *e) {
+    lv_heap_screen("sdcard");
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
 
-    uint64_t total_bytes = sd.card()->sectorCount() * 512;
-    uint64_t used_bytes = total_bytes - (sd.vol()->freeClusterCount() * sd.vol()->sectorsPerCluster() * 512);
+    usage_label = lv_label_create(scr);
+    lv_obj_align(usage_label, LV_ALIGN_TOP_MID, 0, 10);
+    lv_obj_add_event_cb(usage_label, sd_usage_delete_cb, LV_EVENT_DELETE, NULL);
+
+    usage_bar = lv_bar_create(scr);
+    lv_obj_set_size(usage_bar, 200, 20);
+    lv_obj_align(usage_bar, LV_ALIGN_TOP_MID, 0, 40);
+    lv_bar_set_range(usage_bar, 0, 1000);
+
+    // Cached value now; the timer picks up the background count or later writes
+    show_sd_usage(sd_space_get());
+    usage_timer = lv_timer_create(sd_usage_timer_cb, 500, NULL);
+
+    lv_obj_t *bench_btn = lv_btn_create(scr);
+    lv_obj_set_size(bench_btn, 110, 40);
+    lv_obj_align(bench_btn, LV_ALIGN_TOP_MID, -58, 75);
+    lv_obj_t *bench_label = lv_label_create(bench_btn);
+    lv_label_set_text(bench_label, "Benchmark");
+    lv_obj_center(bench_label);
+    lv_obj_add_event_cb(bench_btn, sd_bench_btn_cb, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *copy_btn = lv_btn_create(scr);
+    lv_obj_set_size(copy_btn, 110, 40);
+    lv_obj_align(copy_btn, LV_ALIGN_TOP_MID, 58, 75);
+    lv_obj_t *copy_label = lv_label_create(copy_btn);
+    lv_label_set_text(copy_label, "Copy test");
+    lv_obj_center(copy_label);
+    lv_obj_add_event_cb(copy_btn, copy_bench_btn_cb, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *launch_btn = lv_btn_create(scr);
+    lv_obj_set_size(launch_btn, 226, 40);
+    lv_obj_align(launch_btn, LV_ALIGN_TOP_MID, 0, 120);
+    lv_obj_t *launch_label = lv_label_create(launch_btn);
+    lv_label_set_text(launch_label, "Launcher open test");
+    lv_obj_center(launch_label);
+    lv_obj_add_event_cb(launch_btn, launch_bench_btn_cb, LV_EVENT_CLICKED, NULL);
+
+    bench_result_label = lv_label_create(scr);
+    lv_obj_set_width(bench_result_label, 230);
+    lv_obj_align(bench_result_label, LV_ALIGN_TOP_MID, 0, 170);
+    lv_obj_add_event_cb(bench_result_label, sd_bench_label_delete_cb, LV_EVENT_DELETE, NULL);
+    uint32_t cid;
+    uint8_t mhz = sd_clock_load(&cid);
+    if (mhz) lv_label_set_text_fmt(bench_result_label, "Tuned clock: %u MHz", mhz);
+    else lv_label_set_text(bench_result_label, "Clock not tuned yet");
 
-    lv_obj_t *label = lv_label_create(scr);
-    lv_label_set_text_fmt(label, "SD Card Usage: %llu / %llu bytes", used_bytes, total_bytes);
-    lv_obj_align(label, LV_ALIGN_TOP_MID, 0, 10);
+    // drawNavBar();
+}
 
-    lv_obj_t *bar = lv_bar_create(scr);
-    lv_obj_set_size(bar, 200, 20);
-    lv_obj_align(bar, LV_ALIGN_TOP_MID, 0, 40);
-    lv_bar_set_range(bar, 0, total_bytes);
-    lv_bar_set_value(bar, used_bytes, LV_ANIM_OFF);
+static lv_obj_t *backup_label = NULL;
+static lv_timer_t *backup_timer = NULL;
+
+static void backup_show_status(const BackupStatus &st) {
+    if (!backup_label) return;
+    switch (st.state) {
+        case BACKUP_VERIFYING:
+            lv_label_set_text_fmt(backup_label, "Verifying... %u entries", st.records);
+            break;
+        case BACKUP_RUNNING:
+            lv_label_set_text_fmt(backup_label, "%s... %u entries",
+                                  st.op == BACKUP_OP_CREATE ? "Backing up" : "Restoring", st.records);
+            break;
+        case BACKUP_DONE:
+            if (st.op == BACKUP_OP_CREATE) {
+                lv_label_set_text_fmt(backup_label, "Backed up %u entries\n%lu B -> %lu B in %lu ms", st.records,
+                                      (unsigned long)st.rawBytes, (unsigned long)st.archiveBytes,
+                                      (unsigned long)st.elapsedMs);
+            } else {
+                lv_label_set_text_fmt(backup_label, "Restored %u of %u entries\nVerify %lu ms, total %lu ms",
+                                      st.changed, st.records, (unsigned long)st.verifyMs,
+                                      (unsigned long)st.elapsedMs);
+            }
+            break;
+        case BACKUP_FAILED:
+            lv_label_set_text_fmt(backup_label, "%s failed:\n%s", st.op == BACKUP_OP_CREATE ? "Backup" : "Restore",
+                                  st.error);
+            break;
+        default:
+            lv_label_set_text(backup_label, "Archive: " BACKUP_FILE);
+            break;
+    }
+}
 
-    // drawNavBar();
+static void backup_timer_cb(lv_timer_t *timer) {
+    backup_show_status(backup_status());
+    if (!backup_busy()) {
+        lv_timer_del(backup_timer);
+        backup_timer = NULL;
+    }
+}
+
+static void backup_start(bool (*start)()) {
+    if (backup_timer || !start()) return;
+    backup_timer = lv_timer_create(backup_timer_cb, 200, NULL);
+    backup_show_status(backup_status());
 }
 
 void backup_create_cb(lv_event_t *e) {
-    // Implement backup creation logic here
-    showSettings(); // Go back to settings after the action
+    backup_start(backup_create_start);
 }
 
 void backup_restore_cb(lv_event_t *e) {
-    // Implement backup restoration logic here
-    showSettings(); // Go back to settings after the action
+    backup_start(backup_restore_start);
+}
+
+static void backup_label_delete_cb(lv_event_t *e) {
+    backup_label = NULL;    // The run finishes in the background
 }
 
 void showBackupSettings(lv_event_t *e) {
+    lv_heap_screen("backup");
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
 
@@ -131,10 +391,18 @@ void showBackupSettings(lv_event_t *e) {
     lv_label_set_text(restore_label, "Restore Backup");
     lv_obj_add_event_cb(restore_btn, backup_restore_cb, LV_EVENT_CLICKED, NULL);
 
+    backup_label = lv_label_create(scr);
+    lv_obj_set_width(backup_label, 230);
+    lv_obj_align(backup_label, LV_ALIGN_TOP_MID, 0, 160);
+    lv_obj_add_event_cb(backup_label, backup_label_delete_cb, LV_EVENT_DELETE, NULL);
+    backup_show_status(backup_status());
+    if (backup_busy() && !backup_timer) backup_timer = lv_timer_create(backup_timer_cb, 200, NULL);
+
     // drawNavBar();
 }
 
 void showSettings(lv_event_t *e) {
+    lv_heap_screen("settings");
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
 
@@ -160,6 +428,7 @@ void showSettings(lv_event_t *e) {
 }
 
 void showConnectivity(lv_event_t *e) {
+    lv_heap_screen("connectivity");
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
 
@@ -7,9 +7,13 @@
  */
 #include "settings_WIFI.h"
 #include "WIFI_utils.h"
+#include "wifi_lease.h"
+#include "settings_store.h"
+#include "wifi_scan.h"
+#include "lv_heap.h"
+#include "alloc_trace.h"
 #include <lvgl.h>
 #include <TFT_eSPI.h>
-#include <vector>
 #include <Arduino.h>
 #include <stdlib.h>
 // #include "ui.h"
@@ -17,6 +21,9 @@
 extern TFT_eSPI tft;
 
 static lv_obj_t *wifi_list;
+static lv_obj_t *scan_label;            ///< "Scanning..." row at the top of wifi_list
+static lv_timer_t *scan_timer = nullptr;
+static uint32_t scan_generation;
 
 // Forward declare the function
 void connect_to_wifi_event_cb(lv_event_t *e);
@@ -30,8 +37,13 @@ static void free_user_data_event_cb(lv_event_t *e) {
 }
 
 void prompt_for_password(const char* ssid) {
+    ALLOC_SCOPE(ALLOC_TAG_WIFI);
+    // ssid belongs to a list button that is about to be deleted
+    char *ssid_copy = strdup(ssid);
+    if (ssid_copy == nullptr) return;
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
+    ssid = ssid_copy;
 
     lv_obj_t *label = lv_label_create(scr);
     lv_label_set_text_fmt(label, "Password for %s:", ssid);
@@ -52,8 +64,9 @@ void prompt_for_password(const char* ssid) {
     lv_obj_align(connect_btn, LV_ALIGN_CENTER, 0, 90);
     lv_obj_t *connect_label = lv_label_create(connect_btn);
     lv_label_set_text(connect_label, LV_SYMBOL_OK);
-    lv_obj_set_user_data(connect_btn, (void *)ssid); // Cast const char* to void*
+    lv_obj_set_user_data(connect_btn, ssid_copy);
     lv_obj_add_event_cb(connect_btn, connect_to_wifi_event_cb, LV_EVENT_CLICKED, ta);
+    lv_obj_add_event_cb(connect_btn, free_user_data_event_cb, LV_EVENT_DELETE, NULL);
 }
 
 void connect_to_wifi_event_cb(lv_event_t *e) {
@@ -91,8 +104,6 @@ void connect_to_wifi_event_cb(lv_event_t *e) {
             lv_obj_t *label = lv_label_create(lv_scr_act());
             lv_label_set_text(label, "Failed to connect to WiFi");
             lv_obj_align(label, LV_ALIGN_CENTER, 0, 0);
-            // Free the memory allocated for the SSID
-            free((void *)ssid);
         }
     } else {
         // Load saved password
@@ -114,8 +125,6 @@ void connect_to_wifi_event_cb(lv_event_t *e) {
                 lv_obj_t *label = lv_label_create(lv_scr_act());
                 lv_label_set_text(label, "Failed to connect to WiFi");
                 lv_obj_align(label, LV_ALIGN_CENTER, 0, 0);
-                // Free the memory allocated for the SSID
-                free((void *)ssid);
             }
         } else {
             Serial.println("No saved password found, prompting for input");
@@ -124,25 +133,88 @@ void connect_to_wifi_event_cb(lv_event_t *e) {
     }
 }
 
-void showAvailableNetworks() {
-    const uint8_t maxNetworks = 20; // Define the maximum number of networks to scan
-    String networksArray[maxNetworks]; // Create an array to hold the network names
-    uint8_t networkCount = scanNetworks(networksArray, maxNetworks); // Call scanNetworks with arguments
-
-    std::vector<String> networks(networksArray, networksArray + networkCount); // Convert array to vector
-    Serial.println("Available Networks:");
-    for (const auto &network : networks) {
-        Serial.println(network);
-        lv_obj_t *btn = lv_list_add_btn(wifi_list, NULL, network.c_str());
-        char *network_copy = strdup(network.c_str());
-        if (network_copy == nullptr) {
-            Serial.println("Memory allocation failed for network_copy");
-            continue;
+static lv_obj_t *find_network_btn(const char *ssid) {
+    uint32_t count = lv_obj_get_child_cnt(wifi_list);
+    for (uint32_t i = 0; i < count; i++) {
+        lv_obj_t *child = lv_obj_get_child(wifi_list, i);
+        const char *btn_ssid = (const char *)lv_obj_get_user_data(child);
+        if (btn_ssid && strcmp(btn_ssid, ssid) == 0) return child;
+    }
+    return nullptr;
+}
+
+static bool in_results(const char *ssid, const WifiScanResult *results, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (strcmp(results[i].ssid, ssid) == 0) return true;
+    }
+    return false;
+}
+
+// Bring the list in line with the scan cache: update existing rows in place,
+// add new networks and drop ones the last scan no longer saw
+static void refresh_network_list() {
+    ALLOC_SCOPE(ALLOC_TAG_WIFI);
+    static WifiScanResult results[WIFI_SCAN_MAX_RESULTS];
+    size_t n = wifi_scan_results(results, WIFI_SCAN_MAX_RESULTS);
+
+    for (uint32_t i = lv_obj_get_child_cnt(wifi_list); i-- > 0;) {
+        lv_obj_t *child = lv_obj_get_child(wifi_list, i);
+        const char *btn_ssid = (const char *)lv_obj_get_user_data(child);
+        if (btn_ssid && !in_results(btn_ssid, results, n)) lv_obj_del(child);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        char text[WIFI_CREDS_SSID_LEN + 16];
+        snprintf(text, sizeof(text), "%s (%d dBm)", results[i].ssid, results[i].rssi);
+        lv_obj_t *btn = find_network_btn(results[i].ssid);
+        if (btn) {
+            lv_label_set_text(lv_obj_get_child(btn, 0), text);
+        } else {
+            char *network_copy = strdup(results[i].ssid);
+            if (network_copy == nullptr) {
+                Serial.println("Memory allocation failed for network_copy");
+                continue;
+            }
+            btn = lv_list_add_btn(wifi_list, NULL, text);
+            lv_obj_set_user_data(btn, network_copy);
+            lv_obj_add_event_cb(btn, connect_to_wifi_event_cb, LV_EVENT_CLICKED, network_copy);
+            lv_obj_add_event_cb(btn, free_user_data_event_cb, LV_EVENT_DELETE, NULL);
         }
-        lv_obj_set_user_data(btn, network_copy);
-        lv_obj_add_event_cb(btn, connect_to_wifi_event_cb, LV_EVENT_CLICKED, network_copy);
-        lv_obj_add_event_cb(btn, free_user_data_event_cb, LV_EVENT_DELETE, NULL);
+        lv_obj_move_to_index(btn, (int32_t)i + 1);   // below scan_label, strongest first
     }
+
+    if (wifi_scan_busy()) {
+        lv_label_set_text(scan_label, "Scanning...");
+    } else {
+        lv_label_set_text_fmt(scan_label, "%u networks", (unsigned)n);
+    }
+}
+
+static void scan_timer_cb(lv_timer_t *timer) {
+    uint32_t gen = wifi_scan_generation();
+    if (gen == scan_generation) return;
+    scan_generation = gen;
+    refresh_network_list();
+}
+
+static void wifi_list_delete_cb(lv_event_t *e) {
+    if (scan_timer) {
+        lv_timer_del(scan_timer);
+        scan_timer = nullptr;
+    }
+}
+
+void showAvailableNetworks() {
+    // Show the cache at once; the scan fills in the rest in the background
+    scan_label = lv_list_add_text(wifi_list, "Scanning...");
+    bool started = wifi_scan_start();
+    scan_generation = wifi_scan_generation();
+    refresh_network_list();
+    if (!started) lv_label_set_text(scan_label, "Scan failed");
+
+    lv_obj_add_event_cb(wifi_list, wifi_list_delete_cb, LV_EVENT_DELETE, NULL);
+    if (scan_timer) lv_timer_del(scan_timer);
+    scan_timer = lv_timer_create(scan_timer_cb, 250, NULL);
 }
 
 void wifi_enable_event_cb(lv_event_t *e) {
@@ -165,7 +237,13 @@ void wifi_switch_event_cb(lv_event_t *e) {
     showWiFiSettings();
 }
 
+static void static_ip_event_cb(lv_event_t *e) {
+    lv_obj_t *cb = lv_event_get_target(e);
+    settings_store_set_i32(WIFI_LEASE_STATIC_KEY, lv_obj_has_state(cb, LV_STATE_CHECKED) ? 1 : 0);
+}
+
 void showWiFiSettings(lv_event_t *e) {
+    lv_heap_screen("wifi");
     lv_obj_t *scr = lv_scr_act();
     lv_obj_clean(scr);
 
@@ -175,6 +253,13 @@ void showWiFiSettings(lv_event_t *e) {
     if (isWiFiEnabled()) {
         lv_obj_add_state(sw, LV_STATE_CHECKED);
 
+        // Skip DHCP on cached reconnects by reusing the last lease
+        lv_obj_t *static_cb = lv_checkbox_create(scr);
+        lv_checkbox_set_text(static_cb, "Static IP");
+        lv_obj_align(static_cb, LV_ALIGN_TOP_RIGHT, -5, 12);
+        if (settings_store_get_i32(WIFI_LEASE_STATIC_KEY, 0)) lv_obj_add_state(static_cb, LV_STATE_CHECKED);
+        lv_obj_add_event_cb(static_cb, static_ip_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+
         lv_obj_t *info_label = lv_label_create(scr);
         lv_label_set_text_fmt(info_label, "Current Network:\n%s", getCurrentNetworkInfo().c_str());
         lv_obj_align(info_label, LV_ALIGN_TOP_MID, 0, 60);
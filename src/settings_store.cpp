@@ -0,0 +1,186 @@
+/**
+ * @file settings_store.cpp
+ * @brief Implements the write-behind settings cache.
+ *
+ * The quiet-period timer is an esp_timer, so the commit runs on the timer
+ * task rather than stalling LVGL. The spinlock only guards the RAM table;
+ * NVS is always accessed outside it, serialized by s_commit_lock.
+ */
+#include "settings_store.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <nvs.h>
+
+struct Entry {
+    char key[SETTINGS_STORE_KEY_LEN];
+    int32_t value;
+    bool dirty;
+    bool missing;   ///< Not in NVS yet; any set writes it, even of the default
+};
+
+static Entry s_entries[SETTINGS_STORE_MAX_KEYS];
+static uint8_t s_count = 0;
+static SettingsStoreStats s_stats = {};
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t s_commit_lock = NULL;
+static esp_timer_handle_t s_timer = NULL;
+
+static void timer_cb(void *) {
+    settings_store_flush();
+}
+
+// Lazily create the timer and commit lock; called from the first set
+static bool ensure_init() {
+    if (s_timer) return true;
+    if (!s_commit_lock) s_commit_lock = xSemaphoreCreateMutex();
+    esp_timer_create_args_t args = {};
+    args.callback = timer_cb;
+    args.name = "settings";
+    return s_commit_lock && esp_timer_create(&args, &s_timer) == ESP_OK;
+}
+
+// Caller holds s_mux
+static Entry *find(const char *key) {
+    for (uint8_t i = 0; i < s_count; i++) {
+        if (strcmp(s_entries[i].key, key) == 0) return &s_entries[i];
+    }
+    return NULL;
+}
+
+// Caller holds s_mux
+static Entry *insert(const char *key, int32_t value, bool missing) {
+    if (s_count >= SETTINGS_STORE_MAX_KEYS) return NULL;
+    Entry *e = &s_entries[s_count++];
+    strlcpy(e->key, key, sizeof(e->key));
+    e->value = value;
+    e->dirty = false;
+    e->missing = missing;
+    return e;
+}
+
+int32_t settings_store_get_i32(const char *key, int32_t def) {
+    portENTER_CRITICAL(&s_mux);
+    Entry *e = find(key);
+    int32_t value = e ? e->value : def;
+    portEXIT_CRITICAL(&s_mux);
+    if (e) return value;
+
+    bool stored = false;
+    nvs_handle_t h;
+    if (nvs_open(SETTINGS_STORE_NAMESPACE, NVS_READONLY, &h) == ESP_OK) {
+        stored = nvs_get_i32(h, key, &value) == ESP_OK;
+        nvs_close(h);
+    }
+    portENTER_CRITICAL(&s_mux);
+    // Another task may have cached (or set) it while NVS was being read
+    e = find(key);
+    if (e) value = e->value;
+    else insert(key, value, !stored);
+    portEXIT_CRITICAL(&s_mux);
+    return value;
+}
+
+bool settings_store_set_i32(const char *key, int32_t value) {
+    if (!ensure_init()) return false;
+    // Seed the entry from NVS so an unchanged value does not dirty it; a key
+    // NVS does not have yet is written whatever its value
+    settings_store_get_i32(key, value);
+    bool changed = false;
+    portENTER_CRITICAL(&s_mux);
+    Entry *e = find(key);
+    if (!e) e = insert(key, value, true);
+    if (e && (e->value != value || e->missing)) {
+        e->missing = false;
+        e->value = value;
+        if (!e->dirty) s_stats.dirty++;
+        e->dirty = true;
+        s_stats.sets++;
+        s_stats.generation++;
+        changed = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (!e) {
+        Serial.printf("[Settings] No room to cache %s\n", key);
+        return false;
+    }
+    if (changed) {
+        // Re-arm: every change pushes the commit out by the full quiet period
+        esp_timer_stop(s_timer);
+        esp_timer_start_once(s_timer, (uint64_t)SETTINGS_STORE_QUIET_MS * 1000);
+    }
+    return true;
+}
+
+bool settings_store_flush() {
+    if (!s_commit_lock) return true;    // nothing was ever set
+    xSemaphoreTake(s_commit_lock, portMAX_DELAY);
+
+    Entry pending[SETTINGS_STORE_MAX_KEYS];
+    uint8_t n = 0;
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t i = 0; i < s_count; i++) {
+        if (!s_entries[i].dirty) continue;
+        pending[n++] = s_entries[i];
+        s_entries[i].dirty = false;
+    }
+    s_stats.dirty = 0;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (n == 0) {
+        xSemaphoreGive(s_commit_lock);
+        return true;
+    }
+
+    uint32_t t0 = micros();
+    nvs_handle_t h;
+    bool ok = nvs_open(SETTINGS_STORE_NAMESPACE, NVS_READWRITE, &h) == ESP_OK;
+    if (ok) {
+        for (uint8_t i = 0; i < n && ok; i++) ok = nvs_set_i32(h, pending[i].key, pending[i].value) == ESP_OK;
+        ok = ok && nvs_commit(h) == ESP_OK;
+        nvs_close(h);
+    }
+    uint32_t us = micros() - t0;
+
+    portENTER_CRITICAL(&s_mux);
+    if (ok) {
+        s_stats.commits++;
+        s_stats.keysWritten += n;
+    } else {
+        s_stats.failures++;
+        // Mark them dirty again unless a newer set already did
+        for (uint8_t i = 0; i < n; i++) {
+            Entry *e = find(pending[i].key);
+            if (e && !e->dirty) {
+                e->dirty = true;
+                s_stats.dirty++;
+            }
+        }
+    }
+    s_stats.lastCommitUs = us;
+    if (us > s_stats.maxCommitUs) s_stats.maxCommitUs = us;
+    s_stats.generation++;
+    SettingsStoreStats stats = s_stats;
+    portEXIT_CRITICAL(&s_mux);
+    xSemaphoreGive(s_commit_lock);
+
+    Serial.printf("[Settings] %s %u key(s) in %lu us (commits=%lu sets=%lu max=%lu us)\n",
+                  ok ? "Committed" : "Commit failed for", n, (unsigned long)us, (unsigned long)stats.commits,
+                  (unsigned long)stats.sets, (unsigned long)stats.maxCommitUs);
+    return ok;
+}
+
+void settings_store_invalidate() {
+    if (s_timer) esp_timer_stop(s_timer);
+    portENTER_CRITICAL(&s_mux);
+    s_count = 0;
+    s_stats.dirty = 0;
+    s_stats.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+SettingsStoreStats settings_store_stats() {
+    portENTER_CRITICAL(&s_mux);
+    SettingsStoreStats stats = s_stats;
+    portEXIT_CRITICAL(&s_mux);
+    return stats;
+}
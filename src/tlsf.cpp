@@ -0,0 +1,300 @@
+/**
+ * @file tlsf.cpp
+ * @brief Implements the TLSF allocator.
+ *
+ * Sizes below TLSF_SMALL (128 bytes) map to first level 0 with one class per
+ * 8-byte step. Larger sizes map to first level fls(size) - 6 and second
+ * level by the next TLSF_SL_LOG2 bits. A search rounds the request up to the
+ * next class boundary first, so any block in the class found is big enough.
+ */
+#include "tlsf.h"
+#include <string.h>
+
+#define TLSF_SMALL      (1U << (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2))
+#define TLSF_MAX_BLOCK  ((1UL << TLSF_FL_MAX) - TLSF_ALIGN)
+
+static const size_t HDR = sizeof(size_t) + sizeof(void *);     // Block::size and Block::prevPhys
+static const size_t MIN_PAYLOAD = 2 * sizeof(void *);
+
+static inline size_t align_up(size_t v) {
+    return (v + TLSF_ALIGN - 1) & ~(size_t)(TLSF_ALIGN - 1);
+}
+
+static inline size_t align_down(size_t v) {
+    return v & ~(size_t)(TLSF_ALIGN - 1);
+}
+
+static inline int fls32(uint32_t v) {
+    return 31 - __builtin_clz(v);
+}
+
+static inline int ffs32(uint32_t v) {
+    return __builtin_ctz(v);
+}
+
+// Request size to payload size
+static inline size_t adjust(size_t size) {
+    size_t a = align_up(size);
+    return a < MIN_PAYLOAD ? align_up(MIN_PAYLOAD) : a;
+}
+
+// Added to a request before mapping so the class found only holds blocks that fit
+static inline size_t search_round(size_t size) {
+    return size >= TLSF_SMALL ? ((size_t)1 << (fls32((uint32_t)size) - TLSF_SL_LOG2)) - 1 : 0;
+}
+
+Tlsf::Tlsf() {
+    memset(m_slMap, 0, sizeof(m_slMap));
+    memset(m_heads, 0, sizeof(m_heads));
+}
+
+Tlsf::Block *Tlsf::nextPhys(const Block *b) {
+    return (Block *)((uint8_t *)b + HDR + blockSize(b));
+}
+
+void Tlsf::mapping(size_t size, int *fl, int *sl) {
+    if (size < TLSF_SMALL) {
+        *fl = 0;
+        *sl = (int)(size >> TLSF_ALIGN_LOG2);
+    } else {
+        int f = fls32((uint32_t)size);
+        *sl = (int)(size >> (f - TLSF_SL_LOG2)) - (int)TLSF_SL_COUNT;
+        *fl = f - (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2) + 1;
+    }
+}
+
+void Tlsf::insert(Block *b) {
+    int fl, sl;
+    mapping(blockSize(b), &fl, &sl);
+    Block *head = m_heads[fl][sl];
+    b->nextFree = head;
+    b->prevFree = nullptr;
+    if (head) head->prevFree = b;
+    m_heads[fl][sl] = b;
+    m_slMap[fl] |= 1UL << sl;
+    m_flMap |= 1UL << fl;
+    m_free += blockSize(b);
+    m_freeBlocks++;
+}
+
+void Tlsf::remove(Block *b) {
+    int fl, sl;
+    mapping(blockSize(b), &fl, &sl);
+    if (b->prevFree) b->prevFree->nextFree = b->nextFree;
+    else m_heads[fl][sl] = b->nextFree;
+    if (b->nextFree) b->nextFree->prevFree = b->prevFree;
+    if (!m_heads[fl][sl]) {
+        m_slMap[fl] &= ~(1UL << sl);
+        if (!m_slMap[fl]) m_flMap &= ~(1UL << fl);
+    }
+    m_free -= blockSize(b);
+    m_freeBlocks--;
+}
+
+Tlsf::Block *Tlsf::find(size_t size) {
+    size += search_round(size);
+    if (size > TLSF_MAX_BLOCK) return nullptr;
+    int fl, sl;
+    mapping(size, &fl, &sl);
+    uint32_t slMap = m_slMap[fl] & (~0UL << sl);
+    if (!slMap) {
+        uint32_t flMap = m_flMap & (~0UL << (fl + 1));
+        if (!flMap) return nullptr;
+        fl = ffs32(flMap);
+        slMap = m_slMap[fl];
+    }
+    return m_heads[fl][ffs32(slMap)];
+}
+
+// Cut @p b down to @p size payload bytes; the rest becomes a free block
+void Tlsf::split(Block *b, size_t size) {
+    size_t have = blockSize(b);
+    if (have < size + HDR + align_up(MIN_PAYLOAD)) return;
+    Block *rest = (Block *)((uint8_t *)b + HDR + size);
+    rest->size = (have - size - HDR) | 1;
+    rest->prevPhys = b;
+    nextPhys(rest)->prevPhys = rest;
+    b->size = size | (b->size & 1);
+    m_blocks++;
+    mergeNext(rest);
+    insert(rest);
+}
+
+Tlsf::Block *Tlsf::mergePrev(Block *b) {
+    Block *prev = b->prevPhys;
+    if (!prev || !isFree(prev)) return b;
+    remove(prev);
+    prev->size = (blockSize(prev) + HDR + blockSize(b)) | 1;
+    nextPhys(prev)->prevPhys = prev;
+    m_blocks--;
+    return prev;
+}
+
+void Tlsf::mergeNext(Block *b) {
+    Block *next = nextPhys(b);
+    if (!isFree(next)) return;
+    remove(next);
+    b->size = (blockSize(b) + HDR + blockSize(next)) | (b->size & 1);
+    nextPhys(b)->prevPhys = b;
+    m_blocks--;
+}
+
+bool Tlsf::addPool(void *mem, size_t bytes) {
+    if (!mem || m_poolCount >= TLSF_MAX_POOLS) return false;
+    uintptr_t start = (uintptr_t)mem;
+    uintptr_t aligned = (start + TLSF_ALIGN - 1) & ~(uintptr_t)(TLSF_ALIGN - 1);
+    if (bytes < aligned - start + 2 * HDR + align_up(MIN_PAYLOAD)) return false;
+    size_t size = align_down(bytes - (aligned - start) - 2 * HDR);
+    if (size > TLSF_MAX_BLOCK) size = TLSF_MAX_BLOCK;
+
+    Block *first = (Block *)aligned;
+    first->size = size | 1;
+    first->prevPhys = nullptr;
+    Block *sentinel = nextPhys(first);
+    sentinel->size = 0;
+    sentinel->prevPhys = first;
+    insert(first);
+    m_pools[m_poolCount++] = {first, size};
+    m_total += size;
+    m_blocks++;
+    return true;
+}
+
+size_t Tlsf::poolBytesFor(size_t size) {
+    size_t a = adjust(size);
+    return align_up(a + search_round(a)) + 2 * HDR + TLSF_ALIGN;
+}
+
+void *Tlsf::malloc(size_t size) {
+    if (size == 0 || size > TLSF_MAX_BLOCK) return nullptr;
+    size_t a = adjust(size);
+    Block *b = find(a);
+    if (!b) return nullptr;
+    remove(b);
+    b->size &= ~(size_t)1;
+    split(b, a);
+    m_used += blockSize(b);
+    if (m_used > m_peak) m_peak = m_used;
+    return (uint8_t *)b + HDR;
+}
+
+void Tlsf::free(void *ptr) {
+    if (!ptr) return;
+    Block *b = (Block *)((uint8_t *)ptr - HDR);
+    m_used -= blockSize(b);
+    b->size |= 1;
+    b = mergePrev(b);
+    mergeNext(b);
+    insert(b);
+}
+
+void *Tlsf::realloc(void *ptr, size_t size) {
+    if (!ptr) return malloc(size);
+    if (size == 0) {
+        free(ptr);
+        return nullptr;
+    }
+    if (size > TLSF_MAX_BLOCK) return nullptr;
+    size_t a = adjust(size);
+    Block *b = (Block *)((uint8_t *)ptr - HDR);
+    size_t have = blockSize(b);
+
+    // Shrink, or grow into a free neighbour, without moving
+    if (a > have) {
+        Block *next = nextPhys(b);
+        if (isFree(next) && have + HDR + blockSize(next) >= a) {
+            remove(next);
+            b->size = have + HDR + blockSize(next);
+            nextPhys(b)->prevPhys = b;
+            m_blocks--;
+        }
+    }
+    if (a <= blockSize(b)) {
+        m_used -= have;
+        split(b, a);
+        m_used += blockSize(b);
+        if (m_used > m_peak) m_peak = m_used;
+        return ptr;
+    }
+
+    void *q = malloc(size);
+    if (q) {
+        memcpy(q, ptr, have);
+        free(ptr);
+    }
+    return q;
+}
+
+size_t Tlsf::largestFree() const {
+    if (!m_flMap) return 0;
+    // Every block in the highest non-empty class is bigger than any below
+    // it, so only that one list is walked
+    int fl = fls32(m_flMap);
+    int sl = fls32(m_slMap[fl]);
+    size_t largest = 0;
+    for (const Block *b = m_heads[fl][sl]; b; b = b->nextFree) {
+        if (blockSize(b) > largest) largest = blockSize(b);
+    }
+    return largest;
+}
+
+TlsfStats Tlsf::stats() const {
+    TlsfStats st = {};
+    st.totalBytes = m_total;
+    st.usedBytes = m_used;
+    st.freeBytes = m_free;
+    st.largestFree = largestFree();
+    st.peakUsed = m_peak;
+    st.freeBlocks = m_freeBlocks;
+    st.usedBlocks = m_blocks - m_freeBlocks;
+    st.pools = m_poolCount;
+    st.fragPct = st.freeBytes ? (uint8_t)(100 - st.largestFree * 100 / st.freeBytes) : 0;
+    return st;
+}
+
+bool Tlsf::check() const {
+    uint32_t walkedFree = 0, walkedBlocks = 0;
+    size_t walkedUsed = 0, walkedFreeBytes = 0, walkedLargest = 0, total = 0;
+    for (uint8_t p = 0; p < m_poolCount; p++) {
+        const Block *prev = nullptr;
+        size_t bytes = 0;
+        const Block *b = m_pools[p].first;
+        for (; blockSize(b) || isFree(b); b = nextPhys(b)) {
+            if (b->prevPhys != prev) return false;
+            if (prev && isFree(prev) && isFree(b)) return false;   // should have merged
+            if (blockSize(b) & (TLSF_ALIGN - 1)) return false;
+            if (isFree(b)) {
+                walkedFree++;
+                walkedFreeBytes += blockSize(b);
+                if (blockSize(b) > walkedLargest) walkedLargest = blockSize(b);
+            } else {
+                walkedUsed += blockSize(b);
+            }
+            walkedBlocks++;
+            bytes += HDR + blockSize(b);
+            prev = b;
+        }
+        if (b->prevPhys != prev || bytes != m_pools[p].bytes + HDR) return false;
+        total += m_pools[p].bytes;
+    }
+    if (walkedUsed != m_used || walkedFreeBytes != m_free || walkedFree != m_freeBlocks) return false;
+    if (walkedBlocks != m_blocks || total != m_total || walkedLargest != largestFree()) return false;
+
+    uint32_t listedFree = 0;
+    for (int fl = 0; fl < (int)TLSF_FL_COUNT; fl++) {
+        if (!(m_flMap & (1UL << fl)) != !m_slMap[fl]) return false;
+        for (int sl = 0; sl < (int)TLSF_SL_COUNT; sl++) {
+            const Block *head = m_heads[fl][sl];
+            if (!(m_slMap[fl] & (1UL << sl)) != !head) return false;
+            const Block *prevFree = nullptr;
+            for (const Block *b = head; b; b = b->nextFree) {
+                int f, s;
+                mapping(blockSize(b), &f, &s);
+                if (!isFree(b) || f != fl || s != sl || b->prevFree != prevFree) return false;
+                prevFree = b;
+                listedFree++;
+            }
+        }
+    }
+    return listedFree == walkedFree;
+}
@@ -0,0 +1,305 @@
+/**
+ * @file vfs.cpp
+ * @brief Implements the unified /sd + /flash file layer.
+ */
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <string.h>
+#include "vfs.h"
+#include "dir_cache.h"
+#include "sd_space.h"
+
+static bool s_flashMounted = false;
+
+bool vfs_mount_flash() {
+    if (s_flashMounted) return true;
+    uint32_t t0 = millis();
+    s_flashMounted = LittleFS.begin(true, "/littlefs", 4, VFS_FLASH_LABEL);
+    if (s_flashMounted) {
+        Serial.printf("[VFS] Flash mounted in %lu ms (%u / %u bytes used)\n", (unsigned long)(millis() - t0),
+                      (unsigned)LittleFS.usedBytes(), (unsigned)LittleFS.totalBytes());
+    } else {
+        Serial.println("[VFS] Failed to mount flash file system");
+    }
+    return s_flashMounted;
+}
+
+static const char *match_prefix(const char *path, const char *prefix) {
+    size_t n = strlen(prefix);
+    if (strncmp(path, prefix, n) != 0) return nullptr;
+    if (path[n] != '\0' && path[n] != '/') return nullptr;
+    return path + n;
+}
+
+VfsMedium vfs_resolve(const char *path, char *local) {
+    if (!path) return VFS_NONE;
+    VfsMedium medium = VFS_NONE;
+    const char *rest = match_prefix(path, VFS_SD_PREFIX);
+    if (rest) {
+        medium = VFS_SD;
+    } else if ((rest = match_prefix(path, VFS_FLASH_PREFIX)) != nullptr) {
+        medium = VFS_FLASH;
+    } else {
+        return VFS_NONE;
+    }
+    if (*rest == '\0') rest = "/";
+    if (strlen(rest) >= VFS_PATH_LEN) return VFS_NONE;
+    strcpy(local, rest);
+    if (medium == VFS_FLASH && !vfs_mount_flash()) return VFS_NONE;
+    return medium;
+}
+
+// --- VfsFile ---
+
+bool VfsFile::open(const char *path, uint8_t mode) {
+    close();
+    VfsMedium medium = vfs_resolve(path, m_path);
+    if (medium == VFS_NONE) return false;
+
+    m_mode = mode;
+    m_error = false;
+    m_pos = m_len = 0;
+    m_startSize = 0;
+
+    if (medium == VFS_SD) {
+        SdLock lock;
+        if (mode & VFS_READ) {
+            if (!m_sd.open(m_path, O_RDONLY)) return false;
+        } else {
+            if (!m_sd.open(m_path, O_WRONLY | O_CREAT)) return false;
+            m_startSize = m_sd.fileSize();
+            bool ok = (mode & VFS_APPEND) ? m_sd.seekEnd() : m_sd.truncate(0);
+            if (!ok) {
+                m_sd.close();
+                return false;
+            }
+        }
+    } else {
+        const char *fmode = (mode & VFS_READ) ? "r" : ((mode & VFS_APPEND) ? "a" : "w");
+        m_flash = LittleFS.open(m_path, fmode, !(mode & VFS_READ));
+        if (!m_flash) return false;
+    }
+    m_medium = medium;
+    return true;
+}
+
+bool VfsFile::drain() {
+    if (m_pos == 0 || (m_mode & VFS_READ)) return !m_error;
+    size_t n;
+    if (m_medium == VFS_SD) {
+        SdLock lock;
+        n = m_sd.write(m_buf, m_pos);
+    } else {
+        n = m_flash.write(m_buf, m_pos);
+    }
+    if (n != m_pos) m_error = true;
+    m_pos = 0;
+    return !m_error;
+}
+
+bool VfsFile::fill() {
+    int n;
+    if (m_medium == VFS_SD) {
+        SdLock lock;
+        n = m_sd.read(m_buf, sizeof(m_buf));
+    } else {
+        n = m_flash.read(m_buf, sizeof(m_buf));
+    }
+    if (n < 0) {
+        m_error = true;
+        n = 0;
+    }
+    m_pos = 0;
+    m_len = (uint16_t)n;
+    return n > 0;
+}
+
+bool VfsFile::flush() {
+    if (!isOpen()) return false;
+    if (!drain()) return false;
+    if (m_medium == VFS_SD) {
+        SdLock lock;
+        return m_sd.sync();
+    }
+    m_flash.flush();
+    return true;
+}
+
+bool VfsFile::close() {
+    if (!isOpen()) return false;
+    bool ok = drain();
+    if (m_medium == VFS_SD) {
+        SdLock lock;
+        uint32_t endSize = m_sd.fileSize();
+        ok = m_sd.close() && ok;
+        if (!(m_mode & VFS_READ)) {
+            dir_cache_note_write(m_path);
+            sd_space_note_file(m_startSize, endSize);
+        }
+    } else {
+        m_flash.close();
+    }
+    m_medium = VFS_NONE;
+    return ok;
+}
+
+int VfsFile::read(void *buf, size_t len) {
+    if (!isOpen() || !(m_mode & VFS_READ)) return -1;
+    uint8_t *out = (uint8_t *)buf;
+    size_t done = 0;
+    while (done < len) {
+        if (m_pos < m_len) {
+            size_t n = m_len - m_pos;
+            if (n > len - done) n = len - done;
+            memcpy(out + done, m_buf + m_pos, n);
+            m_pos += n;
+            done += n;
+        } else if (len - done >= sizeof(m_buf)) {
+            // Large reads bypass the buffer
+            int n;
+            if (m_medium == VFS_SD) {
+                SdLock lock;
+                n = m_sd.read(out + done, len - done);
+            } else {
+                n = m_flash.read(out + done, len - done);
+            }
+            if (n <= 0) break;
+            done += n;
+        } else if (!fill()) {
+            break;
+        }
+    }
+    return m_error && done == 0 ? -1 : (int)done;
+}
+
+int VfsFile::readLine(char *line, size_t maxLen) {
+    if (!isOpen() || !(m_mode & VFS_READ) || maxLen == 0) return -1;
+    size_t n = 0;
+    bool any = false;
+    while (true) {
+        if (m_pos >= m_len && !fill()) break;
+        any = true;
+        char c = (char)m_buf[m_pos++];
+        if (c == '\n') break;
+        if (n + 1 < maxLen) line[n++] = c;
+    }
+    if (n > 0 && line[n - 1] == '\r') n--;
+    line[n] = '\0';
+    return any ? (int)n : -1;
+}
+
+size_t VfsFile::write(const void *buf, size_t len) {
+    if (!isOpen() || (m_mode & VFS_READ)) return 0;
+    const uint8_t *in = (const uint8_t *)buf;
+    size_t done = 0;
+    while (done < len) {
+        size_t n = sizeof(m_buf) - m_pos;
+        if (n > len - done) n = len - done;
+        memcpy(m_buf + m_pos, in + done, n);
+        m_pos += n;
+        done += n;
+        if (m_pos == sizeof(m_buf) && !drain()) return done - n;
+    }
+    return done;
+}
+
+size_t VfsFile::print(const char *text) {
+    return write(text, strlen(text));
+}
+
+uint32_t VfsFile::size() {
+    if (!isOpen()) return 0;
+    uint32_t pending = (m_mode & VFS_READ) ? 0 : m_pos;
+    if (m_medium == VFS_SD) {
+        SdLock lock;
+        return m_sd.fileSize() + pending;
+    }
+    return m_flash.size() + pending;
+}
+
+// --- Whole-file helpers and namespace operations ---
+
+int vfs_read_all(const char *path, char *buf, size_t maxLen) {
+    VfsFile f;
+    if (maxLen == 0 || !f.open(path, VFS_READ)) return -1;
+    if (f.size() > maxLen - 1) return -1;
+    int n = f.read(buf, maxLen - 1);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+bool vfs_write_all(const char *path, const void *data, size_t len) {
+    VfsFile f;
+    if (!f.open(path, VFS_WRITE)) return false;
+    bool ok = f.write(data, len) == len;
+    return f.close() && ok;
+}
+
+bool vfs_exists(const char *path) {
+    char local[VFS_PATH_LEN];
+    switch (vfs_resolve(path, local)) {
+        case VFS_SD: {
+            SdLock lock;
+            return sd.exists(local);
+        }
+        case VFS_FLASH:
+            return LittleFS.exists(local);
+        default:
+            return false;
+    }
+}
+
+bool vfs_remove(const char *path) {
+    char local[VFS_PATH_LEN];
+    switch (vfs_resolve(path, local)) {
+        case VFS_SD: {
+            SdLock lock;
+            SdFile f;
+            uint32_t size = 0;
+            if (f.open(local, O_RDONLY)) {
+                size = f.fileSize();
+                f.close();
+            }
+            if (!sd.remove(local)) return false;
+            dir_cache_note_write(local);
+            sd_space_note_file(size, 0);
+            return true;
+        }
+        case VFS_FLASH:
+            return LittleFS.remove(local);
+        default:
+            return false;
+    }
+}
+
+bool vfs_mkdir(const char *path) {
+    char local[VFS_PATH_LEN];
+    switch (vfs_resolve(path, local)) {
+        case VFS_SD: {
+            SdLock lock;
+            if (sd.exists(local)) return true;
+            if (!sd.mkdir(local, true)) return false;
+            dir_cache_note_write(local);
+            sd_space_note_clusters(1);
+            return true;
+        }
+        case VFS_FLASH:
+            return LittleFS.exists(local) || LittleFS.mkdir(local);
+        default:
+            return false;
+    }
+}
+
+bool vfs_rename(const char *from, const char *to) {
+    char localFrom[VFS_PATH_LEN], localTo[VFS_PATH_LEN];
+    VfsMedium medium = vfs_resolve(from, localFrom);
+    if (medium == VFS_NONE || vfs_resolve(to, localTo) != medium) return false;
+    if (medium == VFS_FLASH) return LittleFS.rename(localFrom, localTo);
+
+    SdLock lock;
+    if (!sd.rename(localFrom, localTo)) return false;
+    dir_cache_note_write(localFrom);
+    dir_cache_note_write(localTo);
+    return true;
+}
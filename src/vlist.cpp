@@ -0,0 +1,158 @@
+/**
+ * @file vlist.cpp
+ * @brief Implements the virtualized, recycled LVGL list.
+ *
+ * Rows are assigned to entries by index modulo the pool size, so scrolling by
+ * one row rebinds exactly one row. LVGL 8 coordinates are limited to 13 bits,
+ * so the scrollable content only spans a window of entries; the window is
+ * re-centred around the viewport whenever a scroll ends.
+ */
+#include <stdlib.h>
+#include "vlist.h"
+
+#define VLIST_MAX_CONTENT_PX 8000   // Stay below LV_COORD_MAX
+
+struct VList {
+    lv_obj_t *cont;
+    lv_obj_t *spacer;       ///< Invisible child that gives the window its height
+    lv_obj_t **rows;
+    uint16_t poolSize;
+    lv_coord_t rowH;
+    uint32_t count;
+    uint32_t base;          ///< Entry index at content y = 0
+    uint32_t windowRows;    ///< Entries covered by the scrollable content
+    vlist_bind_cb_t bind;
+    void *user;
+};
+
+static VList *get_vlist(lv_obj_t *list) {
+    return (VList *)lv_obj_get_user_data(list);
+}
+
+static void layout_rows(VList *vl, bool force) {
+    lv_coord_t sy = lv_obj_get_scroll_y(vl->cont);
+    int32_t first = (int32_t)vl->base + sy / vl->rowH - VLIST_MARGIN_ROWS;
+    if (first < 0) first = 0;
+
+    for (uint16_t k = 0; k < vl->poolSize; k++) {
+        uint32_t idx = first + k;
+        lv_obj_t *row = vl->rows[idx % vl->poolSize];
+        if (idx >= vl->count || idx < vl->base || idx >= vl->base + vl->windowRows) {
+            lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
+            lv_obj_set_user_data(row, NULL);
+            continue;
+        }
+        lv_obj_clear_flag(row, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_set_y(row, (lv_coord_t)((idx - vl->base) * vl->rowH));
+        if (force || vlist_row_index(row) != idx) {
+            lv_obj_set_user_data(row, (void *)(uintptr_t)(idx + 1));
+            vl->bind(row, idx, vl->user);
+        }
+    }
+}
+
+static void recenter(VList *vl) {
+    if (vl->count <= vl->windowRows) return;
+    lv_coord_t sy = lv_obj_get_scroll_y(vl->cont);
+    int32_t top = (int32_t)vl->base + sy / vl->rowH;
+    int32_t newBase = top - (int32_t)vl->windowRows / 2;
+    int32_t maxBase = (int32_t)(vl->count - vl->windowRows);
+    if (newBase < 0) newBase = 0;
+    if (newBase > maxBase) newBase = maxBase;
+    if ((uint32_t)newBase == vl->base) return;
+
+    lv_coord_t newY = sy + (lv_coord_t)(((int32_t)vl->base - newBase) * vl->rowH);
+    vl->base = newBase;
+    lv_obj_scroll_to_y(vl->cont, newY, LV_ANIM_OFF);
+    layout_rows(vl, false);
+}
+
+static void vlist_event_cb(lv_event_t *e) {
+    lv_obj_t *cont = lv_event_get_target(e);
+    VList *vl = get_vlist(cont);
+    if (!vl) return;
+    switch (lv_event_get_code(e)) {
+        case LV_EVENT_SCROLL:
+            layout_rows(vl, false);
+            break;
+        case LV_EVENT_SCROLL_END:
+            recenter(vl);
+            break;
+        case LV_EVENT_DELETE:
+            lv_obj_set_user_data(cont, NULL);
+            free(vl->rows);
+            free(vl);
+            break;
+        default:
+            break;
+    }
+}
+
+lv_obj_t *vlist_create(lv_obj_t *parent, lv_coord_t w, lv_coord_t h, lv_coord_t row_h,
+                       vlist_bind_cb_t bind, lv_event_cb_t click_cb, void *user) {
+    lv_obj_t *cont = lv_list_create(parent);
+    lv_obj_set_size(cont, w, h);
+    lv_obj_set_style_layout(cont, 0, 0);  // Rows are placed by hand, not by flex
+
+    VList *vl = (VList *)calloc(1, sizeof(VList));
+    uint16_t pool = h / row_h + 1 + 2 * VLIST_MARGIN_ROWS;
+    lv_obj_t **rows = (lv_obj_t **)calloc(pool, sizeof(lv_obj_t *));
+    if (!vl || !rows) {
+        free(vl);
+        free(rows);
+        return cont;  // Behaves as an empty list
+    }
+    vl->cont = cont;
+    vl->rows = rows;
+    vl->poolSize = pool;
+    vl->rowH = row_h;
+    vl->bind = bind;
+    vl->user = user;
+
+    vl->spacer = lv_obj_create(cont);
+    lv_obj_remove_style_all(vl->spacer);
+    lv_obj_clear_flag(vl->spacer, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_set_size(vl->spacer, 1, 0);
+
+    for (uint16_t k = 0; k < pool; k++) {
+        lv_obj_t *row = lv_list_add_btn(cont, LV_SYMBOL_FILE, "");
+        lv_obj_set_size(row, lv_pct(100), row_h);
+        lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_event_cb(row, click_cb, LV_EVENT_CLICKED, user);
+        rows[k] = row;
+    }
+
+    lv_obj_set_user_data(cont, vl);
+    lv_obj_add_event_cb(cont, vlist_event_cb, LV_EVENT_ALL, NULL);
+    return cont;
+}
+
+void vlist_set_count(lv_obj_t *list, uint32_t count) {
+    VList *vl = get_vlist(list);
+    if (!vl) return;
+    vl->count = count;
+    vl->windowRows = VLIST_MAX_CONTENT_PX / vl->rowH;
+    if (vl->windowRows > count) vl->windowRows = count;
+    if (vl->base + vl->windowRows > count) vl->base = count - vl->windowRows;
+    lv_obj_set_height(vl->spacer, (lv_coord_t)(vl->windowRows * vl->rowH));
+    lv_obj_update_layout(list);
+    layout_rows(vl, false);
+}
+
+void vlist_refresh(lv_obj_t *list) {
+    VList *vl = get_vlist(list);
+    if (vl) layout_rows(vl, true);
+}
+
+uint32_t vlist_row_index(lv_obj_t *row) {
+    uintptr_t v = (uintptr_t)lv_obj_get_user_data(row);
+    return v ? (uint32_t)(v - 1) : UINT32_MAX;
+}
+
+void vlist_set_long_press_cb(lv_obj_t *list, lv_event_cb_t cb) {
+    VList *vl = get_vlist(list);
+    if (!vl) return;
+    for (uint16_t k = 0; k < vl->poolSize; k++) {
+        lv_obj_add_event_cb(vl->rows[k], cb, LV_EVENT_LONG_PRESSED, vl->user);
+    }
+}
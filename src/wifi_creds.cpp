@@ -0,0 +1,288 @@
+/**
+ * @file wifi_creds.cpp
+ * @brief Implements the indexed WiFi credential store.
+ *
+ * NVS layout in WIFI_CREDS_NAMESPACE:
+ * - "ver"  u8, written only once the legacy CSV was imported (or the mounted
+ *          card had none); until then the import is retried on every mount
+ * - "idx"  blob of IndexEntry, sorted by hash
+ * - "n<slot>" one Record per network
+ *
+ * Different SSIDs may share a hash, so every hash hit is confirmed against
+ * the SSID in the record before it counts.
+ */
+#include "wifi_creds.h"
+#include <Arduino.h>
+#include <nvs.h>
+#include "sd_mount.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define CREDS_VERSION   2   // 1 was also written when the import had failed
+#define KEY_VER         "ver"
+#define KEY_INDEX       "idx"
+
+struct IndexEntry {
+    uint32_t hash;
+    uint8_t slot;
+    uint8_t reserved[3];
+};
+
+struct Record {
+    char ssid[WIFI_CREDS_SSID_LEN];
+    char password[WIFI_CREDS_PASS_LEN];
+};
+
+static IndexEntry s_index[WIFI_CREDS_MAX];
+static uint8_t s_count = 0;
+static bool s_loaded = false;
+static bool s_importPending = false;
+static uint32_t s_importGen = 0;       // Mount generation of the last import attempt
+static SemaphoreHandle_t s_lock = NULL;
+
+// FNV-1a; SSIDs are at most 32 arbitrary bytes
+static uint32_t ssid_hash(const char *ssid) {
+    uint32_t h = 2166136261UL;
+    for (uint8_t i = 0; i < WIFI_CREDS_SSID_LEN - 1 && ssid[i]; i++) {
+        h ^= (uint8_t)ssid[i];
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+static uint8_t lower_bound(uint32_t hash) {
+    uint8_t lo = 0, hi = s_count;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        if (s_index[mid].hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void record_key(char *key, uint8_t slot) {
+    snprintf(key, 8, "n%u", slot);
+}
+
+static bool read_record(nvs_handle_t h, uint8_t slot, Record *rec) {
+    char key[8];
+    record_key(key, slot);
+    size_t len = sizeof(*rec);
+    return nvs_get_blob(h, key, rec, &len) == ESP_OK && len == sizeof(*rec);
+}
+
+// Index position of @p ssid, or -1; @p rec receives its record. Caller holds s_lock.
+static int find(nvs_handle_t h, const char *ssid, Record *rec) {
+    uint32_t hash = ssid_hash(ssid);
+    for (uint8_t i = lower_bound(hash); i < s_count && s_index[i].hash == hash; i++) {
+        if (read_record(h, s_index[i].slot, rec) && strncmp(rec->ssid, ssid, sizeof(rec->ssid)) == 0) return i;
+    }
+    return -1;
+}
+
+static int free_slot() {
+    uint64_t used = 0;
+    for (uint8_t i = 0; i < s_count; i++) used |= 1ULL << s_index[i].slot;
+    for (uint8_t slot = 0; slot < WIFI_CREDS_MAX; slot++) {
+        if (!(used & (1ULL << slot))) return slot;
+    }
+    return -1;
+}
+
+// Write the record and update the RAM index; the caller saves the index. Caller holds s_lock.
+static bool put(nvs_handle_t h, const char *ssid, const char *password) {
+    Record rec;
+    int pos = find(h, ssid, &rec);
+    if (pos >= 0 && strncmp(rec.password, password, sizeof(rec.password)) == 0) return true;
+
+    int slot = pos >= 0 ? s_index[pos].slot : free_slot();
+    if (slot < 0) {
+        Serial.printf("[WiFiCreds] Store full, not saving %s\n", ssid);
+        return false;
+    }
+    memset(&rec, 0, sizeof(rec));
+    strlcpy(rec.ssid, ssid, sizeof(rec.ssid));
+    strlcpy(rec.password, password, sizeof(rec.password));
+    char key[8];
+    record_key(key, slot);
+    if (nvs_set_blob(h, key, &rec, sizeof(rec)) != ESP_OK) return false;
+
+    if (pos < 0) {
+        uint32_t hash = ssid_hash(ssid);
+        uint8_t at = lower_bound(hash);
+        memmove(&s_index[at + 1], &s_index[at], (s_count - at) * sizeof(IndexEntry));
+        memset(&s_index[at], 0, sizeof(IndexEntry));
+        s_index[at].hash = hash;
+        s_index[at].slot = slot;
+        s_count++;
+    }
+    return true;
+}
+
+static bool save_index(nvs_handle_t h) {
+    esp_err_t err = s_count ? nvs_set_blob(h, KEY_INDEX, s_index, s_count * sizeof(IndexEntry))
+                            : nvs_erase_key(h, KEY_INDEX);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) return false;
+    return nvs_commit(h) == ESP_OK;
+}
+
+// The CSV lives on the card, which mounts after the WiFi task starts
+static bool import_due() {
+    if (!s_importPending) return false;
+    SdMountStatus st = sd_mount_status();
+    return st.state == SD_MOUNT_MOUNTED && st.generation != s_importGen;
+}
+
+// Import "ssid,password" lines once per mount until it succeeds. Caller holds s_lock.
+static void import_legacy() {
+    s_importGen = sd_mount_status().generation;
+    nvs_handle_t h;
+    if (nvs_open(WIFI_CREDS_NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return;
+    VfsFile f;
+    bool present = f.open(WIFI_CREDS_LEGACY_CSV, VFS_READ);  // A mounted card without one is done too
+    char line[WIFI_CREDS_SSID_LEN + WIFI_CREDS_PASS_LEN + 1];
+    uint8_t imported = 0;
+    while (present && f.readLine(line, sizeof(line)) >= 0) {
+        char *comma = strchr(line, ',');
+        if (!comma || comma == line) continue;
+        *comma = '\0';
+        Record rec;
+        if (find(h, line, &rec) >= 0) continue;   // Saved since; newer than the CSV
+        if (put(h, line, comma + 1)) imported++;
+    }
+    bool ok = save_index(h) && nvs_set_u8(h, KEY_VER, CREDS_VERSION) == ESP_OK && nvs_commit(h) == ESP_OK;
+    nvs_close(h);
+    if (ok) s_importPending = false;
+    if (present) {
+        Serial.printf("[WiFiCreds] Imported %u network(s) from %s%s\n", imported, WIFI_CREDS_LEGACY_CSV,
+                      ok ? "" : " (NVS save failed, retried on the next mount)");
+    }
+}
+
+bool wifi_creds_begin() {
+    if (s_loaded && !import_due()) return true;
+    if (!s_lock) s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!s_loaded) {
+        nvs_handle_t h;
+        uint8_t ver = 0;
+        s_count = 0;
+        if (nvs_open(WIFI_CREDS_NAMESPACE, NVS_READONLY, &h) == ESP_OK) {
+            // Networks saved before the import are kept; the record layout never changed
+            size_t len = sizeof(s_index);
+            nvs_get_u8(h, KEY_VER, &ver);
+            if (nvs_get_blob(h, KEY_INDEX, s_index, &len) == ESP_OK) s_count = len / sizeof(IndexEntry);
+            nvs_close(h);
+        }
+        s_importPending = ver != CREDS_VERSION;
+        s_importGen = 0;
+        s_loaded = true;
+        Serial.printf("[WiFiCreds] %u known network(s)%s\n", s_count, s_importPending ? ", CSV import pending" : "");
+    }
+    if (import_due()) import_legacy();
+    xSemaphoreGive(s_lock);
+    return true;
+}
+
+bool wifi_creds_lookup(const char *ssid, char *password, size_t maxLen) {
+    if (!ssid || !wifi_creds_begin()) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool found = false;
+    nvs_handle_t h;
+    if (s_count && nvs_open(WIFI_CREDS_NAMESPACE, NVS_READONLY, &h) == ESP_OK) {
+        Record rec;
+        found = find(h, ssid, &rec) >= 0;
+        if (found) strlcpy(password, rec.password, maxLen);
+        nvs_close(h);
+    }
+    xSemaphoreGive(s_lock);
+    return found;
+}
+
+bool wifi_creds_save(const char *ssid, const char *password) {
+    if (!ssid || !ssid[0] || !password || !wifi_creds_begin()) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    nvs_handle_t h;
+    bool ok = nvs_open(WIFI_CREDS_NAMESPACE, NVS_READWRITE, &h) == ESP_OK;
+    if (ok) {
+        ok = put(h, ssid, password) && save_index(h);
+        nvs_close(h);
+    }
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+bool wifi_creds_forget(const char *ssid) {
+    if (!ssid || !wifi_creds_begin()) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    nvs_handle_t h;
+    bool ok = nvs_open(WIFI_CREDS_NAMESPACE, NVS_READWRITE, &h) == ESP_OK;
+    if (ok) {
+        Record rec;
+        int pos = find(h, ssid, &rec);
+        ok = pos >= 0;
+        if (ok) {
+            char key[8];
+            record_key(key, s_index[pos].slot);
+            nvs_erase_key(h, key);
+            memmove(&s_index[pos], &s_index[pos + 1], (s_count - pos - 1) * sizeof(IndexEntry));
+            s_count--;
+            ok = save_index(h);
+        }
+        nvs_close(h);
+    }
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+void wifi_creds_invalidate() {
+    if (!s_lock) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_loaded = false;
+    xSemaphoreGive(s_lock);
+}
+
+uint8_t wifi_creds_count() {
+    wifi_creds_begin();
+    return s_count;
+}
+
+int wifi_creds_pick(const WifiScanEntry *aps, int count) {
+    if (!aps || count <= 0 || !wifi_creds_begin()) return -1;
+    uint32_t t0 = micros();
+    if (count > 64) count = 64;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    // Hash hits only need the RAM index; NVS is read just to confirm the winner
+    uint64_t candidates = 0;
+    for (int i = 0; i < count; i++) {
+        if (!aps[i].ssid || !aps[i].ssid[0]) continue;
+        uint32_t hash = ssid_hash(aps[i].ssid);
+        uint8_t pos = lower_bound(hash);
+        if (pos < s_count && s_index[pos].hash == hash) candidates |= 1ULL << i;
+    }
+    int best = -1;
+    nvs_handle_t h;
+    if (candidates && nvs_open(WIFI_CREDS_NAMESPACE, NVS_READONLY, &h) == ESP_OK) {
+        while (candidates && best < 0) {
+            int strongest = -1;
+            for (int i = 0; i < count; i++) {
+                if ((candidates >> i) & 1 && (strongest < 0 || aps[i].rssi > aps[strongest].rssi)) strongest = i;
+            }
+            Record rec;
+            if (find(h, aps[strongest].ssid, &rec) >= 0) best = strongest;
+            candidates &= ~(1ULL << strongest);
+        }
+        nvs_close(h);
+    }
+    xSemaphoreGive(s_lock);
+
+    if (best >= 0) {
+        Serial.printf("[WiFiCreds] Picked %s (%ld dBm) of %d APs in %lu us\n", aps[best].ssid,
+                      (long)aps[best].rssi, count, (unsigned long)(micros() - t0));
+    } else {
+        Serial.printf("[WiFiCreds] None of %d APs is known (%lu us)\n", count, (unsigned long)(micros() - t0));
+    }
+    return best;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file wifi_lease.cpp
+ * @brief Implements the RTC + NVS copy of the last good connection.
+ *
+ * The RTC copy is in a no-init section: it keeps its contents across
+ * software resets but holds garbage after power-up, so it carries a magic
+ * and a CRC and is only trusted when both match.
+ */
+#include "wifi_lease.h"
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <nvs.h>
+#include <rom/crc.h>
+
+#define RTC_MAGIC  0x57464C53UL  // "WFLS"
+#define KEY_LEASE  "lease"
+
+struct RtcLease {
+    uint32_t magic;
+    WifiLease lease;
+    uint32_t crc;
+};
+
+RTC_NOINIT_ATTR static RtcLease s_rtc;
+
+static uint32_t lease_crc(const WifiLease &lease) {
+    return crc32_le(0, (const uint8_t *)&lease, sizeof(lease));
+}
+
+static bool rtc_valid() {
+    return s_rtc.magic == RTC_MAGIC && s_rtc.crc == lease_crc(s_rtc.lease);
+}
+
+static bool nvs_load(WifiLease *lease) {
+    nvs_handle_t h;
+    if (nvs_open(WIFI_LEASE_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return false;
+    size_t len = sizeof(*lease);
+    bool ok = nvs_get_blob(h, KEY_LEASE, lease, &len) == ESP_OK && len == sizeof(*lease);
+    nvs_close(h);
+    return ok;
+}
+
+bool wifi_lease_load(WifiLease *lease) {
+    if (rtc_valid()) {
+        *lease = s_rtc.lease;
+        return true;
+    }
+    if (!nvs_load(lease)) return false;
+    // Seed RTC so the next software reset skips NVS
+    s_rtc.lease = *lease;
+    s_rtc.crc = lease_crc(*lease);
+    s_rtc.magic = RTC_MAGIC;
+    return true;
+}
+
+void wifi_lease_store(const WifiLease &lease) {
+    bool same = rtc_valid() && memcmp(&s_rtc.lease, &lease, sizeof(lease)) == 0;
+    if (!same) {
+        // RTC may be stale or cold; compare against what NVS actually holds
+        WifiLease stored;
+        same = nvs_load(&stored) && memcmp(&stored, &lease, sizeof(lease)) == 0;
+    }
+    s_rtc.lease = lease;
+    s_rtc.crc = lease_crc(lease);
+    s_rtc.magic = RTC_MAGIC;
+    if (same) return;
+
+    nvs_handle_t h;
+    bool ok = nvs_open(WIFI_LEASE_NAMESPACE, NVS_READWRITE, &h) == ESP_OK;
+    if (ok) {
+        ok = nvs_set_blob(h, KEY_LEASE, &lease, sizeof(lease)) == ESP_OK && nvs_commit(h) == ESP_OK;
+        nvs_close(h);
+    }
+    if (!ok) s_rtc.magic = 0;   // so the next store retries NVS
+    Serial.printf("[WiFiLease] Saved %s ch %u%s\n", lease.ssid, lease.channel, ok ? "" : " (NVS write failed)");
+}
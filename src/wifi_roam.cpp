@@ -0,0 +1,206 @@
+/**
+ * @file wifi_roam.cpp
+ * @brief Implements the roaming monitor.
+ *
+ * RSSI is smoothed with an EWMA (1/4 weight, kept in 1/16 dBm) so a single
+ * bad sample never triggers a scan. Known channels start with the channel
+ * of the current AP plus whatever the WiFi list has seen; if only one is
+ * known, the first roam scan covers the whole band and learns the rest.
+ */
+#include "wifi_roam.h"
+#include "wifi_scan.h"
+#include "WIFI_utils.h"
+#include <Arduino.h>
+#include <WiFi.h>
+
+static WifiRoamStats s_stats = {};
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Link state, only touched by the polling task
+static bool s_linked = false;
+static char s_ssid[WIFI_CREDS_SSID_LEN];
+static uint8_t s_bssid[6];
+static int32_t s_rssi16 = 0;
+static uint8_t s_channels[WIFI_ROAM_MAX_CHANNELS];
+static uint8_t s_channelCount = 0;
+static bool s_tried = false;
+static uint32_t s_lastTryMs = 0;
+
+static void add_channel(uint8_t ch) {
+    if (ch == 0) return;
+    for (uint8_t i = 0; i < s_channelCount; i++) {
+        if (s_channels[i] == ch) return;
+    }
+    if (s_channelCount < WIFI_ROAM_MAX_CHANNELS) s_channels[s_channelCount++] = ch;
+}
+
+static void learn_cached_channels() {
+    static WifiScanResult results[WIFI_SCAN_MAX_RESULTS];
+    size_t n = wifi_scan_results(results, WIFI_SCAN_MAX_RESULTS);
+    for (size_t i = 0; i < n; i++) {
+        if (strcmp(results[i].ssid, s_ssid) == 0) add_channel(results[i].channel);
+    }
+}
+
+static void format_bssid(char *out, size_t len, const uint8_t *bssid) {
+    snprintf(out, len, "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4],
+             bssid[5]);
+}
+
+// Strongest other AP of the current network on the known channels
+static bool find_candidate(uint8_t *bssid, uint8_t *channel, int8_t *rssi) {
+    bool full = s_channelCount < 2;
+    uint8_t passes = full ? 1 : s_channelCount;
+    uint8_t scanChannels[WIFI_ROAM_MAX_CHANNELS];
+    memcpy(scanChannels, s_channels, sizeof(scanChannels));
+    bool found = false;
+
+    // try_roam() holds the scan lock
+    for (uint8_t p = 0; p < passes; p++) {
+        int n = WiFi.scanNetworks(false, false, false, WIFI_SCAN_MS_PER_CHANNEL, full ? 0 : scanChannels[p]);
+        if (n < 0) continue;
+        for (int i = 0; i < n; i++) {
+            if (strcmp(WiFi.SSID(i).c_str(), s_ssid) != 0) continue;
+            add_channel((uint8_t)WiFi.channel(i));
+            const uint8_t *ap = WiFi.BSSID(i);
+            if (memcmp(ap, s_bssid, sizeof(s_bssid)) == 0) continue;
+            int8_t r = (int8_t)WiFi.RSSI(i);
+            if (found && r <= *rssi) continue;
+            memcpy(bssid, ap, 6);
+            *channel = (uint8_t)WiFi.channel(i);
+            *rssi = r;
+            found = true;
+        }
+        WiFi.scanDelete();
+    }
+    return found;
+}
+
+// Returns false if another scan was running, so nothing was tried
+static bool try_roam(int8_t current, uint32_t publishMs) {
+    WifiScanLock lock(0);   // Held until the join is done: no scan while associating
+    if (!lock.held()) return false;
+    Serial.printf("[WiFiRoam] Link degraded (%d dBm, publish %lu ms), scanning\n", current,
+                  (unsigned long)publishMs);
+
+    portENTER_CRITICAL(&s_mux);
+    s_stats.scans++;
+    s_stats.generation++;
+    portEXIT_CRITICAL(&s_mux);
+
+    uint8_t bssid[6];
+    uint8_t channel = 0;
+    int8_t rssi = 0;
+    uint32_t scanStart = millis();
+    bool found = find_candidate(bssid, &channel, &rssi);
+    uint32_t scanMs = millis() - scanStart;
+    if (!found || rssi < current + WIFI_ROAM_MARGIN_DB) {
+        Serial.printf("[WiFiRoam] %s at %d dBm, no AP %d dB better (scan %lu ms, %u channel(s))\n", s_ssid, current,
+                      WIFI_ROAM_MARGIN_DB, (unsigned long)scanMs, s_channelCount);
+        return true;
+    }
+
+    char from[18], to[18];
+    format_bssid(from, sizeof(from), s_bssid);
+    format_bssid(to, sizeof(to), bssid);
+    uint32_t roamStart = millis();
+    bool ok = roamToAccessPoint(bssid, channel);
+    uint32_t roamMs = millis() - roamStart;
+
+    portENTER_CRITICAL(&s_mux);
+    if (ok) {
+        s_stats.roams++;
+        s_stats.lastRoamMs = roamMs;
+        s_stats.lastRoamFrom = current;
+        s_stats.lastRoamTo = rssi;
+    } else {
+        s_stats.roamFailures++;
+    }
+    s_stats.generation++;
+    portEXIT_CRITICAL(&s_mux);
+    Serial.printf("[WiFiRoam] %s %s (%d dBm) -> %s ch %u (%d dBm) in %lu ms (scan %lu ms)\n",
+                  ok ? "Roamed" : "Roam failed", from, current, to, channel, rssi, (unsigned long)roamMs,
+                  (unsigned long)scanMs);
+    return true;
+}
+
+void wifi_roam_poll() {
+    const uint8_t *bssid = WiFi.status() == WL_CONNECTED ? WiFi.BSSID() : nullptr;
+    if (!bssid) {
+        if (s_linked) {
+            s_linked = false;
+            portENTER_CRITICAL(&s_mux);
+            s_stats.disconnects++;
+            s_stats.rssi = 0;
+            s_stats.generation++;
+            portEXIT_CRITICAL(&s_mux);
+            Serial.printf("[WiFiRoam] Link to %s lost\n", s_ssid);
+        }
+        return;
+    }
+
+    int8_t rssi = (int8_t)WiFi.RSSI();
+    bool fresh = !s_linked || memcmp(bssid, s_bssid, sizeof(s_bssid)) != 0;
+    if (fresh) {
+        // New association (reconnect or roam): restart smoothing, keep channels of the same network
+        String ssid = WiFi.SSID();
+        if (strcmp(ssid.c_str(), s_ssid) != 0) {
+            strlcpy(s_ssid, ssid.c_str(), sizeof(s_ssid));
+            s_channelCount = 0;
+        }
+        memcpy(s_bssid, bssid, sizeof(s_bssid));
+        add_channel((uint8_t)WiFi.channel());
+        learn_cached_channels();
+        s_rssi16 = rssi * 16;
+        s_linked = true;
+    } else {
+        s_rssi16 += (rssi * 16 - s_rssi16) / 4;
+    }
+    int8_t smoothed = (int8_t)(s_rssi16 / 16);
+
+    portENTER_CRITICAL(&s_mux);
+    if (fresh) s_stats.publishMs = 0;   // latency measured through the old AP
+    s_stats.rssi = smoothed;
+    s_stats.channels = s_channelCount;
+    s_stats.generation++;
+    uint32_t publishMs = s_stats.publishMs;
+    portEXIT_CRITICAL(&s_mux);
+
+    bool weak = smoothed < WIFI_ROAM_RSSI_TRIGGER;
+    bool slow = publishMs > WIFI_ROAM_LATENCY_TRIGGER_MS;
+    if (!weak && !slow) return;
+    if (s_tried && millis() - s_lastTryMs < WIFI_ROAM_HOLDOFF_MS) return;
+    // Another scan holds the lock: retry on the next sample
+    if (!try_roam(smoothed, publishMs)) return;
+    s_tried = true;
+    s_lastTryMs = millis();
+}
+
+void wifi_roam_note_publish(uint32_t ms, bool ok) {
+    portENTER_CRITICAL(&s_mux);
+    s_stats.publishes++;
+    if (!ok) s_stats.publishFailures++;
+    if (s_stats.publishMs == 0) {
+        s_stats.publishMs = ms;
+    } else {
+        s_stats.publishMs = (uint32_t)((int32_t)s_stats.publishMs + ((int32_t)ms - (int32_t)s_stats.publishMs) / 4);
+    }
+    s_stats.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void wifi_roam_note_connect(uint32_t ms, bool ok) {
+    portENTER_CRITICAL(&s_mux);
+    s_stats.connects++;
+    if (!ok) s_stats.connectFailures++;
+    s_stats.lastConnectMs = ms;
+    s_stats.generation++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+WifiRoamStats wifi_roam_stats() {
+    portENTER_CRITICAL(&s_mux);
+    WifiRoamStats st = s_stats;
+    portEXIT_CRITICAL(&s_mux);
+    return st;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file wifi_scan.cpp
+ * @brief Implements the background channel-by-channel scan and its cache.
+ *
+ * Each pass is a "round". Networks seen in the current round replace what
+ * an older round recorded; within a round the strongest AP wins. Networks
+ * not seen at all in a completed round are dropped, so the list shows old
+ * results while a rescan runs and converges to the new ones.
+ *
+ * The scan lock is taken per channel, so a connect or roam scan waits for at
+ * most one channel dwell rather than the whole band.
+ */
+#include "wifi_scan.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static WifiScanResult s_results[WIFI_SCAN_MAX_RESULTS];
+static uint32_t s_seen[WIFI_SCAN_MAX_RESULTS];     ///< Round each result was last seen in
+static uint8_t s_count = 0;
+static uint32_t s_round = 0;
+static uint32_t s_generation = 0;
+static uint32_t s_doneMs = 0;
+static bool s_done = false;                         ///< At least one round completed
+static uint32_t s_ttlMs = WIFI_SCAN_DEFAULT_TTL_MS;
+static volatile bool s_running = false;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static SemaphoreHandle_t scan_mutex() {
+    static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+    return mutex;
+}
+
+bool wifi_scan_lock(uint32_t timeoutMs) {
+    TickType_t ticks = timeoutMs == WIFI_SCAN_LOCK_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    return xSemaphoreTake(scan_mutex(), ticks) == pdTRUE;
+}
+
+void wifi_scan_unlock() {
+    xSemaphoreGive(scan_mutex());
+}
+
+// Caller holds s_mux
+static bool merge(const WifiScanResult &r, uint32_t round) {
+    for (uint8_t i = 0; i < s_count; i++) {
+        if (strcmp(s_results[i].ssid, r.ssid) != 0) continue;
+        if (s_seen[i] == round && r.rssi <= s_results[i].rssi) return false;
+        s_results[i] = r;
+        s_seen[i] = round;
+        return true;
+    }
+    if (s_count >= WIFI_SCAN_MAX_RESULTS) return false;
+    s_results[s_count] = r;
+    s_seen[s_count] = round;
+    s_count++;
+    return true;
+}
+
+// Caller holds s_mux
+static void prune(uint32_t round) {
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < s_count; i++) {
+        if (s_seen[i] != round) continue;
+        s_results[kept] = s_results[i];
+        s_seen[kept] = s_seen[i];
+        kept++;
+    }
+    s_count = kept;
+}
+
+static void scan_task(void *pvParameters) {
+    portENTER_CRITICAL(&s_mux);
+    uint32_t round = ++s_round;
+    portEXIT_CRITICAL(&s_mux);
+
+    uint32_t t0 = millis();
+    uint32_t firstMs = 0;
+    int failed = 0;
+    for (uint8_t ch = 1; ch <= WIFI_SCAN_CHANNELS; ch++) {
+        WifiScanLock lock;
+        int n = WiFi.scanNetworks(false, false, false, WIFI_SCAN_MS_PER_CHANNEL, ch);
+        if (n < 0) {
+            failed++;
+            continue;
+        }
+        bool changed = false;
+        for (int i = 0; i < n; i++) {
+            WifiScanResult r;
+            memset(&r, 0, sizeof(r));
+            strlcpy(r.ssid, WiFi.SSID(i).c_str(), sizeof(r.ssid));
+            if (!r.ssid[0]) continue;
+            r.rssi = (int8_t)WiFi.RSSI(i);
+            r.channel = (uint8_t)WiFi.channel(i);
+            memcpy(r.bssid, WiFi.BSSID(i), sizeof(r.bssid));
+            r.secure = WiFi.encryptionType(i) != WIFI_AUTH_OPEN;
+            portENTER_CRITICAL(&s_mux);
+            changed |= merge(r, round);
+            portEXIT_CRITICAL(&s_mux);
+        }
+        WiFi.scanDelete();
+        if (changed) {
+            if (!firstMs) firstMs = millis() - t0;
+            portENTER_CRITICAL(&s_mux);
+            s_generation++;
+            portEXIT_CRITICAL(&s_mux);
+        }
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    if (failed < WIFI_SCAN_CHANNELS) {
+        prune(round);
+        s_done = true;
+        s_doneMs = millis();
+    }
+    uint8_t count = s_count;
+    s_generation++;
+    portEXIT_CRITICAL(&s_mux);
+    Serial.printf("[WiFiScan] %u networks in %lu ms (first after %lu ms, %d channel(s) failed)\n", count,
+                  (unsigned long)(millis() - t0), (unsigned long)firstMs, failed);
+    s_running = false;
+    vTaskDelete(NULL);
+}
+
+bool wifi_scan_start(bool force) {
+    if (s_running) return true;
+    if (!force && wifi_scan_fresh()) return true;
+    if (WiFi.getMode() == WIFI_OFF) return false;
+    s_running = true;
+    if (xTaskCreatePinnedToCore(scan_task, "WiFiScan", 4096, NULL, 1, NULL, 1) != pdPASS) {
+        s_running = false;
+        return false;
+    }
+    return true;
+}
+
+bool wifi_scan_busy() {
+    return s_running;
+}
+
+uint32_t wifi_scan_generation() {
+    portENTER_CRITICAL(&s_mux);
+    uint32_t gen = s_generation;
+    portEXIT_CRITICAL(&s_mux);
+    return gen;
+}
+
+size_t wifi_scan_results(WifiScanResult *out, size_t max) {
+    portENTER_CRITICAL(&s_mux);
+    size_t n = s_count < max ? s_count : max;
+    memcpy(out, s_results, n * sizeof(WifiScanResult));
+    portEXIT_CRITICAL(&s_mux);
+    // Strongest first; the list is short
+    for (size_t i = 1; i < n; i++) {
+        WifiScanResult r = out[i];
+        size_t j = i;
+        for (; j > 0 && out[j - 1].rssi < r.rssi; j--) out[j] = out[j - 1];
+        out[j] = r;
+    }
+    return n;
+}
+
+bool wifi_scan_fresh() {
+    portENTER_CRITICAL(&s_mux);
+    bool fresh = s_done && millis() - s_doneMs < s_ttlMs;
+    portEXIT_CRITICAL(&s_mux);
+    return fresh;
+}
+
+void wifi_scan_set_ttl(uint32_t ms) {
+    portENTER_CRITICAL(&s_mux);
+    s_ttlMs = ms;
+    portEXIT_CRITICAL(&s_mux);
+}
@@ -0,0 +1,139 @@
+/**
+ * @file alloc_trace_replay.cpp
+ * @brief Host replay of a session under the allocation tracer.
+ *
+ * Explorer listings, WiFi scan rows and MQTT publishes are replayed with
+ * their real scopes after a warm-up and alloc_trace_mark(). One scan in a
+ * hundred leaks a row on purpose.
+ * - Per-tag counters must match what the replay left live, and the
+ *   since-mark report must name the leaking scope.
+ * - A block noted with alloc_trace_note_alloc() must be charged to the
+ *   caller's scope and go away with alloc_trace_note_free().
+ * - Leaving a scope must restore the tag of the one around it.
+ *
+ *   make -C test/host run
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "alloc_trace.h"
+#include "entry_store.h"
+#include "check.h"
+
+#define WARMUP_ROUNDS  50
+#define REPLAY_ROUNDS  20000
+#define LEAK_EVERY     100
+
+static std::vector<char *> s_leaked;
+static void *volatile s_sink;   // Keeps the compiler from dropping a malloc()/free() pair
+static std::string s_report;
+
+static void collect(const char *line, void *) {
+    s_report += line;
+}
+
+static void list_dir(EntryStore &store, int n) {
+    ALLOC_SCOPE(ALLOC_TAG_EXPLORER);
+    store.clear();
+    char name[32];
+    for (int i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "file_%d.txt", i);
+        store.add(name, i, 0, 0, 0);
+    }
+}
+
+static void wifi_rows(int n, bool leak) {
+    ALLOC_SCOPE(ALLOC_TAG_WIFI);
+    char *rows[16];
+    for (int i = 0; i < n; i++) rows[i] = strdup("MyNetwork");
+    for (int i = 0; i < n; i++) {
+        if (leak && i == 0) s_leaked.push_back(rows[i]);   // Reserved up front; no allocation here
+        else free(rows[i]);
+    }
+}
+
+static void publish() {
+    ALLOC_SCOPE(ALLOC_TAG_MQTT);
+    std::string topic = "cyd/devices/abcdef/events/heartbeat";
+    for (int i = 0; i < 10; i++) topic += "x";
+    void *p = calloc(4, 64);
+    p = realloc(p, 1024);
+    free(p);
+}
+
+static void note_region() {
+    ALLOC_SCOPE(ALLOC_TAG_UI);
+    static uint8_t region[4096];
+    AllocTagStats before = alloc_trace_tag_stats(ALLOC_TAG_UI);
+    alloc_trace_note_alloc(region, sizeof(region));
+    AllocTagStats noted = alloc_trace_tag_stats(ALLOC_TAG_UI);
+    CHECK(noted.liveBytes == before.liveBytes + sizeof(region));
+    CHECK(noted.liveBlocks == before.liveBlocks + 1);
+    alloc_trace_note_free(region);
+    AllocTagStats after = alloc_trace_tag_stats(ALLOC_TAG_UI);
+    CHECK(after.liveBytes == before.liveBytes);
+    CHECK(after.liveBlocks == before.liveBlocks);
+}
+
+static void nested_scopes() {
+    AllocTagStats other0 = alloc_trace_tag_stats(ALLOC_TAG_OTHER);
+    AllocTagStats ui0 = alloc_trace_tag_stats(ALLOC_TAG_UI);
+    AllocTagStats sd0 = alloc_trace_tag_stats(ALLOC_TAG_SD);
+    {
+        ALLOC_SCOPE(ALLOC_TAG_UI);
+        {
+            ALLOC_SCOPE(ALLOC_TAG_SD);
+        }
+        s_sink = malloc(40);    // Charged to UI again
+        free(s_sink);
+    }
+    s_sink = malloc(24);        // Outside any scope
+    free(s_sink);
+    CHECK(alloc_trace_tag_stats(ALLOC_TAG_UI).allocs == ui0.allocs + 1);
+    CHECK(alloc_trace_tag_stats(ALLOC_TAG_SD).allocs == sd0.allocs);
+    CHECK(alloc_trace_tag_stats(ALLOC_TAG_OTHER).allocs == other0.allocs + 1);
+}
+
+int main() {
+    s_leaked.reserve(REPLAY_ROUNDS / LEAK_EVERY);
+    s_report.reserve(8192);
+    EntryStore store;
+    for (int i = 0; i < WARMUP_ROUNDS; i++) {
+        list_dir(store, 40);
+        wifi_rows(8, false);
+        publish();
+    }
+    alloc_trace_mark();
+    for (int i = 0; i < REPLAY_ROUNDS; i++) {
+        list_dir(store, rand() % 80);
+        wifi_rows(8, i % LEAK_EVERY == 0);
+        publish();
+    }
+
+    AllocTagStats wifi = alloc_trace_tag_stats(ALLOC_TAG_WIFI);
+    CHECK(wifi.liveBlocks == s_leaked.size());
+    CHECK(wifi.liveBytes == s_leaked.size() * sizeof("MyNetwork"));
+    AllocTagStats mqtt = alloc_trace_tag_stats(ALLOC_TAG_MQTT);
+    CHECK(mqtt.liveBlocks == 0);
+    CHECK(mqtt.allocs > 0);
+
+    alloc_trace_report(collect, nullptr, true);
+    fputs(s_report.c_str(), stdout);
+    CHECK(s_report.find("wifi_rows") != std::string::npos);
+
+    store.release();
+    CHECK(alloc_trace_tag_stats(ALLOC_TAG_EXPLORER).liveBlocks == 0);
+
+    note_region();
+    nested_scopes();
+
+    for (char *p : s_leaked) free(p);
+    CHECK(alloc_trace_tag_stats(ALLOC_TAG_WIFI).liveBlocks == 0);
+
+    return check_done("alloc_trace_replay");
+}
@@ -0,0 +1,82 @@
+/**
+ * @file app_catalog_bench.cpp
+ * @brief Host benchmark of launcher open time over generated app catalogs.
+ *
+ * Mounts a blank FAT32 image through a BlockCache, as the firmware mounts
+ * the card, and creates the 10, 100 and 500-app trees the settings screen's
+ * "Launcher open test" uses. Each size is then timed from a cold cache at
+ * the 20 MHz SPI latency preset, so the times include the modelled card.
+ * - app_catalog_bench_run() must index every app.
+ * - Loading the index must beat rebuilding it.
+ *
+ * Needs SdFat (see the Makefile); skipped without it.
+ *
+ *   make -C test/host run SDFAT=<SdFat>/src
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "SD_utils.h"
+#include "app_catalog.h"
+#include "block_cache.h"
+#include "file_block_device.h"
+#include "check.h"
+#include "fat_image.h"
+
+#define VOL_SECTORS      540000     // 4 KB clusters; enough of them to be FAT32
+#define CLUSTER_SECTORS  8
+
+static const uint16_t s_sizes[] = {10, 100, 500};
+
+static bool build_image(int fd) {
+    FatImage img(fd, VOL_SECTORS, CLUSTER_SECTORS);
+    DirBuilder root;
+    return img.alloc(1) == 2 && root.write(img, 2) && img.finish();
+}
+
+int main() {
+    char path[] = "/tmp/app_catalogXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || ftruncate(fd, FatImage::imageBytes(VOL_SECTORS)) != 0 || !build_image(fd) || close(fd) != 0) {
+        perror("image");
+        return 1;
+    }
+
+    FileBlockDevice dev;
+    if (!dev.open(path)) return 1;
+    BlockCache cache;
+    CHECK(cache.begin(&dev, SD_CACHE_SECTORS));
+    CHECK(file_block_device_mount(&cache));
+
+    Serial.quiet = true;
+    for (uint16_t apps : s_sizes) CHECK(app_catalog_bench_prepare(apps, UINT16_MAX) == 0);
+    cache.end();
+
+    for (uint16_t apps : s_sizes) {
+        // Cold, as after a mount
+        CHECK(cache.begin(&dev, SD_CACHE_SECTORS));
+        CHECK(file_block_device_mount(&cache));
+        dev.setLatency(FILE_BLOCK_LATENCY_SPI_20MHZ);
+        dev.resetStats();
+        AppCatalogBench r;
+        CHECK(app_catalog_bench_run(apps, r));
+        BlockDeviceStats st = dev.stats();
+        dev.setLatency(FILE_BLOCK_LATENCY_NONE);
+        cache.end();
+
+        CHECK(r.indexed == apps);
+        CHECK(r.warmMs < r.coldMs);
+        printf("[CatalogBench] %3u apps: legacy walk %4lu ms, cold rebuild %5lu ms, warm load %3lu ms "
+               "(%lu card reads)\n",
+               apps, (unsigned long)r.legacyMs, (unsigned long)r.coldMs, (unsigned long)r.warmMs,
+               (unsigned long)st.readCalls);
+    }
+    Serial.quiet = false;
+
+    dev.end();
+    unlink(path);
+    return check_done("app_catalog_bench");
+}
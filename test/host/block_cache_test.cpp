@@ -0,0 +1,152 @@
+/**
+ * @file block_cache_test.cpp
+ * @brief Host check and measurement of BlockCache over an image file.
+ *
+ * - Random reads and writes of every size through the cache must match a
+ *   reference copy, on read-back and in the image after syncDevice().
+ * - discard() must not write a single sector.
+ * - A FAT-style directory walk (link lookups in one FAT sector, then the
+ *   directory sectors one at a time) is replayed raw and through the cache
+ *   at the 20 MHz SPI latency preset, cold and warm, and the card commands
+ *   and modelled time of each are printed.
+ *
+ *   make -C test/host run
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "block_cache.h"
+#include "file_block_device.h"
+#include "check.h"
+
+#define IMAGE_SECTORS  8192
+#define FAT_START      32
+#define DATA_START     2048
+#define CLUSTER_SECTORS 8
+
+static uint32_t next_random(uint32_t &state) {
+    state = state * 1103515245u + 12345u;
+    return state >> 8;
+}
+
+static void check_random_io(FileBlockDevice &file, FsBlockDevice &raw) {
+    static uint8_t ref[IMAGE_SECTORS][512];
+    static uint8_t buf[16 * 512];
+    for (uint32_t s = 0; s < IMAGE_SECTORS; s++) CHECK(raw.readSector(s, ref[s]));
+
+    BlockCache cache;
+    CHECK(cache.begin(&raw, 16));
+    uint32_t state = 42;
+    for (int op = 0; op < 20000; op++) {
+        uint32_t ns = 1 + next_random(state) % 12;
+        // Mostly a hot range, like FAT and directory sectors
+        uint32_t span = (op & 3) ? 64 : IMAGE_SECTORS;
+        uint32_t sector = next_random(state) % (span - ns);
+        if (next_random(state) & 1) {
+            for (uint32_t k = 0; k < ns * 512; k++) buf[k] = (uint8_t)next_random(state);
+            CHECK(cache.writeSectors(sector, buf, ns));
+            for (uint32_t k = 0; k < ns; k++) memcpy(ref[sector + k], buf + k * 512, 512);
+        } else {
+            CHECK(cache.readSectors(sector, buf, ns));
+            for (uint32_t k = 0; k < ns; k++) {
+                if (memcmp(ref[sector + k], buf + k * 512, 512) != 0) {
+                    printf("FAIL op %d: sector %lu differs on read-back\n", op, (unsigned long)(sector + k));
+                    s_failures++;
+                    return;
+                }
+            }
+        }
+    }
+    CHECK(cache.syncDevice());
+    for (uint32_t s = 0; s < IMAGE_SECTORS; s++) {
+        CHECK(file.readSector(s, buf));
+        if (memcmp(ref[s], buf, 512) != 0) {
+            printf("FAIL sector %lu differs in the image after sync\n", (unsigned long)s);
+            s_failures++;
+            break;
+        }
+    }
+    cache.end();
+}
+
+static void check_discard(FileBlockDevice &file, FsBlockDevice &raw) {
+    uint8_t buf[512];
+    memset(buf, 0xA5, sizeof(buf));
+    BlockCache cache;
+    CHECK(cache.begin(&raw));
+    for (uint32_t s = 100; s < 100 + SD_CACHE_WRITE_BATCH - 1; s++) CHECK(cache.writeSector(s, buf));
+    file.resetStats();
+    CHECK(cache.discard() == SD_CACHE_WRITE_BATCH - 1);
+    CHECK(!cache.active());
+    CHECK(file.stats().writeCalls == 0);
+    cache.end();
+    CHECK(file.stats().writeCalls == 0);
+}
+
+// List @p dirs directories of @p clusters clusters each, scattered over the data area
+static void walk(FsBlockDevice &dev, uint32_t dirs, uint32_t clusters) {
+    uint8_t buf[512];
+    for (uint32_t d = 0; d < dirs; d++) {
+        for (uint32_t c = 0; c < clusters; c++) {
+            uint32_t cluster = 2 + d * 37 + c * 5;
+            dev.readSector(FAT_START + cluster / 128, buf);  // Next link
+            uint32_t first = DATA_START + (cluster - 2) * CLUSTER_SECTORS;
+            for (uint32_t s = 0; s < CLUSTER_SECTORS; s++) dev.readSector(first + s, buf);
+        }
+    }
+}
+
+static void measure_walk(FileBlockDevice &file, FsBlockDevice &raw) {
+    static const uint32_t dirs = 6, clusters = 3;
+    file.setLatency(FILE_BLOCK_LATENCY_SPI_20MHZ);
+
+    file.resetStats();
+    walk(raw, dirs, clusters);
+    BlockDeviceStats uncached = file.stats();
+
+    BlockCache cache;
+    CHECK(cache.begin(&raw, SD_CACHE_SECTORS));
+    file.resetStats();
+    walk(cache, 1, clusters);    // Cold: the first listing after mount
+    BlockDeviceStats cold = file.stats();
+    file.resetStats();
+    walk(cache, 1, clusters);    // Warm: listing it again
+    BlockDeviceStats warm = file.stats();
+    cache.end();
+    file.resetStats();
+    walk(raw, 1, clusters);
+    BlockDeviceStats one = file.stats();
+    file.setLatency(FILE_BLOCK_LATENCY_NONE);
+
+    printf("[SdCache] %lu dirs x %lu clusters raw: %lu commands, %lu us modelled\n", (unsigned long)dirs,
+           (unsigned long)clusters, (unsigned long)uncached.readCalls, (unsigned long)uncached.injectedUs);
+    printf("[SdCache] one dir raw %lu cmds %lu us; cached cold %lu cmds %lu us, warm %lu cmds %lu us\n",
+           (unsigned long)one.readCalls, (unsigned long)one.injectedUs, (unsigned long)cold.readCalls,
+           (unsigned long)cold.injectedUs, (unsigned long)warm.readCalls, (unsigned long)warm.injectedUs);
+    CHECK(cold.injectedUs < one.injectedUs);
+    CHECK(warm.readCalls == 0);
+}
+
+int main() {
+    char path[] = "/tmp/block_cacheXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || ftruncate(fd, (off_t)IMAGE_SECTORS * 512) != 0 || close(fd) != 0) {
+        perror("image");
+        return 1;
+    }
+    FileBlockDevice file;
+    if (!file.open(path)) return 1;
+    FsBlockDevice &raw = file;
+
+    check_random_io(file, raw);
+    check_discard(file, raw);
+    measure_walk(file, raw);
+
+    file.end();
+    unlink(path);
+    return check_done("block_cache_test");
+}
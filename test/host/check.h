@@ -0,0 +1,34 @@
+/**
+ * @file check.h
+ * @brief Failure counter and CHECK() shared by the host tests.
+ *
+ * A failed CHECK() prints the condition and carries on, so one run lists
+ * every failure. main() ends with `return check_done("name");`, which
+ * prints "name: OK" or "name: FAILED" and gives the exit status that
+ * `make -C test/host run` stops on.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_CHECK_H
+#define HOST_CHECK_H
+
+#include <cstdio>
+
+static int s_failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);           \
+            s_failures++;                                                    \
+        }                                                                    \
+    } while (0)
+
+static inline int check_done(const char *name) {
+    printf("%s: %s\n", name, s_failures ? "FAILED" : "OK");
+    return s_failures ? 1 : 0;
+}
+
+#endif // HOST_CHECK_H
@@ -0,0 +1,131 @@
+/**
+ * @file entry_view_bench.cpp
+ * @brief Host benchmark and check of EntryStore/EntryView.
+ *
+ * Builds a synthetic listing, then times indexing, each sort order and a
+ * filter typed one key at a time. Every result is checked against a brute
+ * force pass, and a listing over ENTRY_VIEW_MAX must come back truncated.
+ *
+ *   make -C test/host run
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include "entry_view.h"
+#include "check.h"
+
+static uint64_t now_us() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t fill(EntryStore &store, uint32_t count) {
+    static const char *stems[] = {"LOG", "log", "data", "IMG", "app", "Backup", "sensor", "trace"};
+    char name[32];
+    uint32_t seed = 12345;
+    for (uint32_t i = 0; i < count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        snprintf(name, sizeof(name), "%s_%05lu.txt", stems[(seed >> 16) & 7],
+                 (unsigned long)((seed >> 8) % 100000));
+        uint8_t flags = (seed & 0x1F) == 0 ? ENTRY_DIR : 0;
+        if (!store.add(name, seed % 1000000, flags, (uint16_t)(seed >> 7), (uint16_t)(seed >> 3))) return i;
+    }
+    return count;
+}
+
+// -1, 0 or 1 as a sort by @p key would place a before b (ties on the index excluded)
+static int compare(const EntryStore &store, EntrySortKey key, uint32_t a, uint32_t b) {
+    const EntryRec &ra = store.rec(a);
+    const EntryRec &rb = store.rec(b);
+    bool da = ra.flags & ENTRY_DIR, db = rb.flags & ENTRY_DIR;
+    if (da != db) return da ? -1 : 1;
+    if (key == ENTRY_SORT_SIZE && ra.size != rb.size) return ra.size > rb.size ? -1 : 1;
+    if (key == ENTRY_SORT_DATE) {
+        uint32_t ta = ((uint32_t)ra.date << 16) | ra.time;
+        uint32_t tb = ((uint32_t)rb.date << 16) | rb.time;
+        if (ta != tb) return ta > tb ? -1 : 1;
+    }
+    int c = strcasecmp(store.name(a), store.name(b));
+    return c < 0 ? -1 : c > 0;
+}
+
+static uint32_t brute_matches(const EntryStore &store, uint32_t n, const char *prefix) {
+    size_t len = strlen(prefix);
+    uint32_t hits = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (strncasecmp(store.name(i), prefix, len) == 0) hits++;
+    }
+    return hits;
+}
+
+static void bench(uint32_t count) {
+    static const char *const keyNames[ENTRY_SORT_COUNT] = {"none", "name", "size", "date"};
+    EntryStore store;
+    EntryView view;
+
+    uint64_t t0 = now_us();
+    uint32_t n = fill(store, count);
+    uint64_t buildUs = now_us() - t0;
+    CHECK(n == count);
+
+    t0 = now_us();
+    view.reset(&store);
+    bool complete = view.sync();
+    uint64_t syncUs = now_us() - t0;
+    CHECK(complete && !view.truncated());
+    CHECK(view.total() == n && view.count() == n);
+
+    printf("[EntryView] %lu entries: build %lu us, index %lu us, %u bytes + %u view\n", (unsigned long)n,
+           (unsigned long)buildUs, (unsigned long)syncUs, (unsigned)store.footprint(),
+           (unsigned)(view.total() * 2 * sizeof(uint16_t)));
+
+    for (int k = ENTRY_SORT_NAME; k < ENTRY_SORT_COUNT; k++) {
+        t0 = now_us();
+        view.sort((EntrySortKey)k);
+        uint64_t us = now_us() - t0;
+        for (uint32_t i = 1; i < view.count(); i++) {
+            if (compare(store, (EntrySortKey)k, view.at(i - 1), view.at(i)) > 0) {
+                printf("FAIL sort %s out of order at %lu\n", keyNames[k], (unsigned long)i);
+                s_failures++;
+                break;
+            }
+        }
+        printf("[EntryView] sort %s %lu us\n", keyNames[k], (unsigned long)us);
+    }
+
+    // Type "log_1" one key at a time, then clear it again
+    static const char *typed[] = {"l", "lo", "log", "log_", "log_1", ""};
+    for (size_t i = 0; i < sizeof(typed) / sizeof(typed[0]); i++) {
+        t0 = now_us();
+        view.setFilter(typed[i]);
+        uint64_t us = now_us() - t0;
+        CHECK(view.count() == brute_matches(store, n, typed[i]));
+        printf("[EntryView] filter \"%s\": %lu matches in %lu us\n", typed[i], (unsigned long)view.count(),
+               (unsigned long)us);
+    }
+}
+
+static void check_truncated() {
+    EntryStore store;
+    EntryView view;
+    uint32_t n = fill(store, ENTRY_VIEW_MAX + 100);
+    CHECK(n == ENTRY_VIEW_MAX + 100);
+    view.reset(&store);
+    CHECK(!view.sync());
+    CHECK(view.truncated());
+    CHECK(view.total() == ENTRY_VIEW_MAX);
+    view.reset(&store);
+    CHECK(!view.truncated());
+}
+
+int main() {
+    static const uint32_t sizes[] = {500, 5000, 50000};
+    for (uint32_t count : sizes) bench(count);
+    check_truncated();
+    return check_done("entry_view_bench");
+}
@@ -0,0 +1,204 @@
+/**
+ * @file fat_image.h
+ * @brief Writes small FAT32 card images for the host tests that mount SdFat.
+ *
+ * The image has an MBR with one FAT32 partition at FAT_IMAGE_PART_START, as
+ * SD card formatters lay it out. Directories are built entry by entry with
+ * DirBuilder, long names included, and files are written cluster by
+ * cluster; FatImage::finish() then writes the boot sectors and both FATs.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_FAT_IMAGE_H
+#define HOST_FAT_IMAGE_H
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+#define FAT_IMAGE_PART_START  2048      ///< First sector of the partition
+#define FAT_IMAGE_RESERVED    32        ///< Reserved sectors before the first FAT
+
+/**
+ * @class FatImage
+ * @brief Lays out one FAT32 volume in an image file.
+ *
+ * The volume needs at least 65525 clusters for SdFat to take it as FAT32.
+ */
+class FatImage {
+public:
+    FatImage(int fd, uint32_t volSectors, uint8_t clusterSectors = 1)
+        : m_fd(fd), m_volSectors(volSectors), m_clusterSectors(clusterSectors) {
+        m_fatSectors = (((volSectors - FAT_IMAGE_RESERVED) / clusterSectors + 2) * 4 + 511) / 512;
+        m_fat.assign(m_fatSectors * 128, 0);
+        m_fat[0] = 0x0FFFFFF8;
+        m_fat[1] = 0x0FFFFFFF;
+    }
+
+    /// Image file size for a volume of @p volSectors sectors
+    static off_t imageBytes(uint32_t volSectors) { return (off_t)(FAT_IMAGE_PART_START + volSectors) * 512; }
+
+    uint32_t clusterBytes() const { return m_clusterSectors * 512U; }
+
+    // Chain of @p n contiguous clusters; returns the first
+    uint32_t alloc(uint32_t n) {
+        uint32_t first = m_next;
+        for (uint32_t i = 0; i < n; i++) m_fat[first + i] = i + 1 < n ? first + i + 1 : 0x0FFFFFFF;
+        m_next += n;
+        return first;
+    }
+
+    uint32_t next() const { return m_next; }
+
+    bool writeCluster(uint32_t cluster, const void *data, size_t len) {
+        off_t at = ((off_t)dataStart() + (off_t)(cluster - 2) * m_clusterSectors) * 512;
+        return len <= clusterBytes() && pwrite(m_fd, data, len, at) == (ssize_t)len;
+    }
+
+    // Root directory is cluster 2; alloc() it before anything else
+    bool finish() {
+        uint8_t s[512] = {};
+        // MBR with one FAT32 (LBA) partition
+        s[446 + 4] = 0x0C;
+        put32(s + 446 + 8, FAT_IMAGE_PART_START);
+        put32(s + 446 + 12, m_volSectors);
+        s[510] = 0x55;
+        s[511] = 0xAA;
+        if (!writeSector(0, s)) return false;
+
+        memset(s, 0, sizeof(s));
+        s[0] = 0xEB; s[1] = 0x58; s[2] = 0x90;
+        memcpy(s + 3, "MSWIN4.1", 8);
+        put16(s + 11, 512);
+        s[13] = m_clusterSectors;
+        put16(s + 14, FAT_IMAGE_RESERVED);
+        s[16] = 2;                      // FATs
+        s[21] = 0xF8;
+        put16(s + 24, 63);
+        put16(s + 26, 255);
+        put32(s + 28, FAT_IMAGE_PART_START);
+        put32(s + 32, m_volSectors);
+        put32(s + 36, m_fatSectors);
+        put32(s + 44, 2);               // Root directory cluster
+        put16(s + 48, 1);               // FSInfo sector
+        put16(s + 50, 6);               // Backup boot sector
+        s[64] = 0x80;
+        s[66] = 0x29;
+        put32(s + 67, 0x20250601);
+        memcpy(s + 71, "CYDOS TEST ", 11);
+        memcpy(s + 82, "FAT32   ", 8);
+        s[510] = 0x55;
+        s[511] = 0xAA;
+        if (!writeSector(FAT_IMAGE_PART_START, s) || !writeSector(FAT_IMAGE_PART_START + 6, s)) return false;
+
+        memset(s, 0, sizeof(s));
+        put32(s, 0x41615252);
+        put32(s + 484, 0x61417272);
+        put32(s + 488, 0xFFFFFFFF);     // Free count unknown
+        put32(s + 492, m_next);
+        put32(s + 508, 0xAA550000);
+        if (!writeSector(FAT_IMAGE_PART_START + 1, s) || !writeSector(FAT_IMAGE_PART_START + 7, s)) return false;
+
+        size_t len = m_fat.size() * 4;
+        std::vector<uint8_t> raw(len);
+        for (size_t i = 0; i < m_fat.size(); i++) put32(&raw[i * 4], m_fat[i]);
+        for (uint32_t f = 0; f < 2; f++) {
+            off_t at = ((off_t)FAT_IMAGE_PART_START + FAT_IMAGE_RESERVED + f * m_fatSectors) * 512;
+            if (pwrite(m_fd, raw.data(), len, at) != (ssize_t)len) return false;
+        }
+        return true;
+    }
+
+    static void put16(uint8_t *p, uint16_t v) {
+        p[0] = v & 0xFF;
+        p[1] = v >> 8;
+    }
+
+    static void put32(uint8_t *p, uint32_t v) {
+        for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+    }
+
+private:
+    uint32_t dataStart() const { return FAT_IMAGE_PART_START + FAT_IMAGE_RESERVED + 2 * m_fatSectors; }
+
+    bool writeSector(uint32_t sector, const uint8_t *s) {
+        return pwrite(m_fd, s, 512, (off_t)sector * 512) == 512;
+    }
+
+    int m_fd;
+    uint32_t m_volSectors;
+    uint8_t m_clusterSectors;
+    uint32_t m_fatSectors;
+    std::vector<uint32_t> m_fat;
+    uint32_t m_next = 2;
+};
+
+/**
+ * @class DirBuilder
+ * @brief Collects 32-byte directory entries, long-name slots included.
+ */
+class DirBuilder {
+public:
+    void add(const char *shortName, uint8_t attr, uint32_t cluster, uint32_t size, uint16_t date,
+             const char *longName = nullptr) {
+        if (longName) addLongName(longName, shortName);
+        uint8_t e[32] = {};
+        memcpy(e, shortName, 11);
+        e[11] = attr;
+        FatImage::put16(e + 16, date);          // Created
+        FatImage::put16(e + 20, cluster >> 16);
+        FatImage::put16(e + 22, 0x6000);        // 12:00:00
+        FatImage::put16(e + 24, date);          // Modified
+        FatImage::put16(e + 26, cluster & 0xFFFF);
+        FatImage::put32(e + 28, size);
+        m_bytes.insert(m_bytes.end(), e, e + 32);
+    }
+
+    // Clusters needed, counting the end-of-directory entry
+    uint32_t clusters(const FatImage &img) const {
+        return (uint32_t)(m_bytes.size() + 32 + img.clusterBytes() - 1) / img.clusterBytes();
+    }
+
+    bool write(FatImage &img, uint32_t first) const {
+        uint32_t n = clusters(img), bytes = img.clusterBytes();
+        std::vector<uint8_t> data(n * bytes, 0);
+        memcpy(data.data(), m_bytes.data(), m_bytes.size());
+        for (uint32_t i = 0; i < n; i++) {
+            if (!img.writeCluster(first + i, &data[i * bytes], bytes)) return false;
+        }
+        return true;
+    }
+
+private:
+    void addLongName(const char *longName, const char *shortName) {
+        uint8_t sum = 0;
+        for (int i = 0; i < 11; i++) sum = (uint8_t)(((sum & 1) << 7) + (sum >> 1) + (uint8_t)shortName[i]);
+        static const uint8_t offs[13] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+        size_t len = strlen(longName);
+        int slots = (int)(len + 12) / 13;
+        for (int n = slots; n >= 1; n--) {
+            uint8_t e[32] = {};
+            e[0] = (uint8_t)(n | (n == slots ? 0x40 : 0));
+            e[11] = 0x0F;
+            e[13] = sum;
+            for (int k = 0; k < 13; k++) {
+                size_t c = (size_t)(n - 1) * 13 + k;
+                uint16_t ch = c < len ? (uint8_t)longName[c] : (c == len ? 0x0000 : 0xFFFF);
+                FatImage::put16(e + offs[k], ch);
+            }
+            m_bytes.insert(m_bytes.end(), e, e + 32);
+        }
+    }
+
+    std::vector<uint8_t> m_bytes;
+};
+
+// 8.3 name field: base padded to 8, extension to 3
+static inline void short_name(char out[12], const char *base, const char *ext) {
+    snprintf(out, 12, "%-8.8s%-3.3s", base, ext);
+}
+
+#endif // HOST_FAT_IMAGE_H
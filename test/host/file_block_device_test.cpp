@@ -0,0 +1,103 @@
+/**
+ * @file file_block_device_test.cpp
+ * @brief Host driver for FileBlockDevice.
+ *
+ * Creates a scratch image, then checks sector round trips, range and
+ * read-only rejection, the stats counters and the latency model.
+ *
+ *   make -C test/host run
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "file_block_device.h"
+#include "check.h"
+
+#define IMAGE_SECTORS 256
+
+static void pattern(uint8_t *buf, uint32_t sector, size_t ns) {
+    for (size_t i = 0; i < ns * 512; i++) buf[i] = (uint8_t)(sector * 31 + i * 7);
+}
+
+static bool make_image(const char *path, size_t sectors) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    static const uint8_t zero[512] = {};
+    bool ok = true;
+    for (size_t i = 0; i < sectors && ok; i++) ok = fwrite(zero, 1, sizeof(zero), f) == sizeof(zero);
+    return fclose(f) == 0 && ok;
+}
+
+int main() {
+    char path[] = "/tmp/fbd_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    // Not a whole number of sectors
+    FILE *f = fopen(path, "wb");
+    fputs("short", f);
+    fclose(f);
+    FileBlockDevice dev;
+    CHECK(!dev.open(path));
+    CHECK(!dev.open("/nonexistent/card.img"));
+
+    CHECK(make_image(path, IMAGE_SECTORS));
+    CHECK(dev.open(path));
+    CHECK(dev.sectorCount() == IMAGE_SECTORS);
+
+    static uint8_t out[8 * 512], in[8 * 512];
+    pattern(out, 10, 8);
+    CHECK(dev.writeSectors(10, out, 8));
+    CHECK(dev.readSectors(10, in, 8));
+    CHECK(memcmp(in, out, sizeof(out)) == 0);
+    pattern(out, IMAGE_SECTORS - 1, 1);
+    CHECK(dev.writeSector(IMAGE_SECTORS - 1, out));
+    CHECK(dev.readSector(IMAGE_SECTORS - 1, in));
+    CHECK(memcmp(in, out, 512) == 0);
+    CHECK(dev.syncDevice());
+
+    // Past the end
+    CHECK(!dev.readSectors(IMAGE_SECTORS - 4, in, 8));
+    CHECK(!dev.writeSector(IMAGE_SECTORS, out));
+
+    const BlockDeviceStats &st = dev.stats();
+    CHECK(st.readCalls == 2 && st.sectorsRead == 9);
+    CHECK(st.writeCalls == 2 && st.sectorsWritten == 9);
+    CHECK(st.syncCalls == 1 && st.injectedUs == 0);
+
+    // Latency: 16 single-sector reads at the 20 MHz preset
+    BlockLatency lat = FILE_BLOCK_LATENCY_SPI_20MHZ;
+    dev.setLatency(lat);
+    dev.resetStats();
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t s = 0; s < 16; s++) CHECK(dev.readSector(s, in));
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+    uint64_t model = 16ull * (lat.commandUs + lat.readSectorUs);
+    CHECK(dev.stats().injectedUs == model);
+    CHECK(us >= model);
+    printf("[FileBlockDevice] 16 reads at SPI_20MHZ: model %lu us, took %lu us\n", (unsigned long)model,
+           (unsigned long)us);
+
+    // Read-only keeps the image as it is
+    dev.setLatency(FILE_BLOCK_LATENCY_NONE);
+    CHECK(dev.open(path, true));
+    pattern(out, 10, 1);
+    CHECK(!dev.writeSector(10, in));
+    CHECK(dev.readSector(10, in));
+    CHECK(memcmp(in, out, 512) == 0);
+    CHECK(dev.syncDevice());
+    dev.end();
+    CHECK(!dev.readSector(0, in));
+
+    unlink(path);
+    return check_done("file_block_device_test");
+}
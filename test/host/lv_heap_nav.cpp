@@ -0,0 +1,153 @@
+/**
+ * @file lv_heap_nav.cpp
+ * @brief Host replay of screen navigation through the LVGL heap.
+ *
+ * Each cycle builds a screen the way LVGL does (objects, styles, label
+ * text that is set again and grows) through lv_heap_malloc/realloc, then
+ * cleans it with lv_heap_free. A few blocks outlive their screen, as
+ * toasts, message boxes and cached icons do. The image viewer's draw
+ * buffer does not fit the initial pool, so the heap has to grow.
+ * - The heap must grow, only while warming up, and no request may fail.
+ * - After every clean, fragmentation and the largest free block must stay
+ *   within fixed bounds, and neither may be worse in the last quarter of
+ *   the run than in the first.
+ *
+ *   make -C test/host run
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <Arduino.h>
+#include "lv_heap.h"
+#include "check.h"
+
+#define CYCLES           20000
+#define PERSIST_MAX      8
+// After a clean only the kept blocks are in use. fragPct counts free bytes
+// across pools, and a block never spans two, so with the grown pool its floor
+// is that pool's share of the free memory.
+#define FRAG_MAX_PCT     60
+#define LARGEST_MIN      (LV_HEAP_INITIAL_SIZE * 2 / 3)
+
+/**
+ * @struct ScreenProfile
+ * @brief What building one screen allocates.
+ */
+struct ScreenProfile {
+    const char *name;
+    uint16_t objects;       ///< Widgets, give or take a quarter
+    uint16_t textMax;       ///< Longest label text
+    uint32_t buffer;        ///< One large block (draw buffer, text page), 0 for none
+};
+
+static const ScreenProfile s_profiles[] = {
+    {"launcher", 60, 24, 0},
+    {"explorer", 90, 40, 0},
+    {"settings", 70, 32, 0},
+    {"connectivity", 50, 32, 0},
+    {"text viewer", 25, 200, 4096},
+    {"image viewer", 15, 16, 240 * 80 * 2},
+};
+#define PROFILE_COUNT (sizeof(s_profiles) / sizeof(s_profiles[0]))
+
+static uint32_t s_rng = 4242;
+
+static uint32_t rnd() {
+    s_rng = s_rng * 1664525 + 1013904223;
+    return s_rng >> 8;
+}
+
+struct Quarter {
+    uint8_t worstFrag;
+    size_t minLargest;
+};
+
+static std::vector<void *> s_screen;
+static std::vector<void *> s_persist;
+static uint32_t s_nulls = 0;
+
+static void keep(void *p) {
+    if (!p) {
+        s_nulls++;
+        return;
+    }
+    // Now and then a block outlives its screen
+    if (s_persist.size() < PERSIST_MAX && rnd() % 200 == 0) s_persist.push_back(p);
+    else s_screen.push_back(p);
+}
+
+static void build(const ScreenProfile &sp) {
+    lv_heap_screen(sp.name);
+    if (sp.buffer) keep(lv_heap_malloc(sp.buffer));
+    uint32_t n = sp.objects * 3 / 4 + rnd() % (sp.objects / 2 + 1);
+    for (uint32_t i = 0; i < n; i++) {
+        keep(lv_heap_malloc(64 + rnd() % 64));                    // lv_obj_t and its class data
+        if (rnd() % 3 == 0) keep(lv_heap_malloc(24 + rnd() % 24));   // Local style
+        if (rnd() % 2 == 0) {
+            void *text = lv_heap_malloc(8 + rnd() % sp.textMax);
+            if (text && rnd() % 5 == 0) {
+                void *longer = lv_heap_realloc(text, sp.textMax + rnd() % sp.textMax);   // Text set again
+                if (longer) text = longer;
+            }
+            keep(text);
+        }
+    }
+}
+
+static void clean() {
+    for (void *p : s_screen) lv_heap_free(p);
+    s_screen.clear();
+    if (!s_persist.empty() && rnd() % 100 == 0) {
+        size_t k = rnd() % s_persist.size();
+        lv_heap_free(s_persist[k]);
+        s_persist[k] = s_persist.back();
+        s_persist.pop_back();
+    }
+}
+
+int main() {
+    Quarter q[4];
+    for (Quarter &x : q) x = {0, SIZE_MAX};
+    uint32_t overFrag = 0, underLargest = 0, warmGrows = 0;
+    size_t cur = 0;
+
+    Serial.quiet = true;    // lv_heap_screen() logs every visit
+    for (uint32_t c = 0; c < CYCLES; c++) {
+        cur = cur == 0 ? 1 + rnd() % (PROFILE_COUNT - 1) : 0;   // Out from the launcher and back
+        build(s_profiles[cur]);
+        clean();
+
+        TlsfStats st = lv_heap_stats().heap;
+        if (st.fragPct > FRAG_MAX_PCT) overFrag++;
+        if (st.largestFree < LARGEST_MIN) underLargest++;
+        Quarter &x = q[c * 4 / CYCLES];
+        if (st.fragPct > x.worstFrag) x.worstFrag = st.fragPct;
+        if (st.largestFree < x.minLargest) x.minLargest = st.largestFree;
+        if (c == CYCLES / 4) warmGrows = lv_heap_stats().grows;
+    }
+    Serial.quiet = false;
+
+    LvHeapStats hs = lv_heap_stats();
+    printf("[LvHeap] %d cycles: %u grow(s), %u pool(s), %u failures, %zu blocks kept\n", CYCLES,
+           (unsigned)hs.grows, hs.heap.pools, (unsigned)hs.failures, s_persist.size());
+    for (int i = 0; i < 4; i++) {
+        printf("[LvHeap] quarter %d after clean: worst frag %u%%, smallest largest-free %zu\n", i + 1,
+               q[i].worstFrag, q[i].minLargest);
+    }
+    CHECK(hs.grows > 0);
+    CHECK(hs.grows == warmGrows);
+    CHECK(hs.heap.pools > 1);
+    CHECK(hs.failures == 0);
+    CHECK(s_nulls == 0);
+    CHECK(overFrag == 0);
+    CHECK(underLargest == 0);
+    CHECK(q[3].worstFrag <= q[0].worstFrag);
+    CHECK(q[3].minLargest >= q[0].minLargest);
+
+    for (void *p : s_persist) lv_heap_free(p);
+    CHECK(lv_heap_stats().heap.usedBytes == 0);
+    return check_done("lv_heap_nav");
+}
@@ -0,0 +1,230 @@
+/**
+ * @file sd_bench_host.cpp
+ * @brief Host entry point for sd_bench_device() over a card image.
+ *
+ * Runs the benchmark core against FileBlockDevice at each latency preset,
+ * so changes to the transfer pattern can be judged off-device, and checks
+ * that a corrupted read-back is counted as an error.
+ *
+ * It also times the file job's copy pattern, FILE_JOB_CHUNK reads and
+ * writes taking turns under one bus lock, with one buffer and with two (a
+ * reader thread filling the next chunk while the current one is written).
+ * Both copies must arrive intact.
+ *
+ *   make -C test/host run
+ *   test/host/build/sd_bench_host card.img     # an existing image instead
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include "file_block_device.h"
+#include "file_jobs.h"
+#include "sd_bench.h"
+#include "check.h"
+
+#define IMAGE_SECTORS     (SD_BENCH_FILE_BYTES / 512)
+#define SCRATCH_SECTORS   2048   ///< 1 MB, so the slow presets finish quickly
+#define CHUNK_SECTORS     (FILE_JOB_CHUNK / 512)
+
+/**
+ * @class ImageBenchIo
+ * @brief SdBenchIo over a FileBlockDevice; can flip a bit in every Nth read.
+ */
+class ImageBenchIo : public SdBenchIo {
+public:
+    explicit ImageBenchIo(FileBlockDevice &dev) : m_dev(dev) {}
+    void corruptEvery(uint32_t n) { m_corruptEvery = n; }
+    bool readSectors(uint32_t sector, uint8_t *dst, size_t ns) override {
+        if (!m_dev.readSectors(sector, dst, ns)) return false;
+        if (m_corruptEvery && ++m_reads % m_corruptEvery == 0) dst[17] ^= 0x04;
+        return true;
+    }
+    bool writeSectors(uint32_t sector, const uint8_t *src, size_t ns) override {
+        return m_dev.writeSectors(sector, src, ns);
+    }
+    bool syncDevice() override { return m_dev.syncDevice(); }
+
+private:
+    FileBlockDevice &m_dev;
+    uint32_t m_corruptEvery = 0;
+    uint32_t m_reads = 0;
+};
+
+// The SD lock: one SPI bus, one transfer at a time
+static std::mutex s_bus;
+
+static bool copy_one_buffer(FileBlockDevice &dev, uint32_t src, uint32_t dst, uint32_t chunks) {
+    static uint8_t buf[FILE_JOB_CHUNK];
+    bool ok = true;
+    for (uint32_t k = 0; k < chunks && ok; k++) {
+        {
+            std::lock_guard<std::mutex> bus(s_bus);
+            ok = dev.readSectors(src + k * CHUNK_SECTORS, buf, CHUNK_SECTORS);
+        }
+        if (ok) {
+            std::lock_guard<std::mutex> bus(s_bus);
+            ok = dev.writeSectors(dst + k * CHUNK_SECTORS, buf, CHUNK_SECTORS);
+        }
+    }
+    return ok;
+}
+
+static bool copy_two_buffers(FileBlockDevice &dev, uint32_t src, uint32_t dst, uint32_t chunks) {
+    static uint8_t buf[2][FILE_JOB_CHUNK];
+    std::mutex m;
+    std::condition_variable cv;
+    uint32_t filled = 0, written = 0;
+    bool readOk = true;
+
+    std::thread reader([&] {
+        for (uint32_t k = 0; k < chunks; k++) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&] { return k - written < 2; });
+            }
+            bool ok;
+            {
+                std::lock_guard<std::mutex> bus(s_bus);
+                ok = dev.readSectors(src + k * CHUNK_SECTORS, buf[k % 2], CHUNK_SECTORS);
+            }
+            std::lock_guard<std::mutex> lock(m);
+            readOk = readOk && ok;
+            filled = k + 1;
+            cv.notify_all();
+        }
+    });
+
+    bool ok = true;
+    for (uint32_t k = 0; k < chunks; k++) {
+        {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&] { return filled > k; });
+        }
+        {
+            std::lock_guard<std::mutex> bus(s_bus);
+            ok = dev.writeSectors(dst + k * CHUNK_SECTORS, buf[k % 2], CHUNK_SECTORS) && ok;
+        }
+        std::lock_guard<std::mutex> lock(m);
+        written = k + 1;
+        cv.notify_all();
+    }
+    reader.join();
+    return ok && readOk;
+}
+
+static bool same_sectors(FileBlockDevice &dev, uint32_t a, uint32_t b, uint32_t count) {
+    static uint8_t x[512], y[512];
+    for (uint32_t s = 0; s < count; s++) {
+        if (!dev.readSectors(a + s, x, 1) || !dev.readSectors(b + s, y, 1) || memcmp(x, y, 512) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Half the scratch range is copied onto the other half at the 20 MHz preset
+static void measure_copy(FileBlockDevice &dev, uint32_t first, uint32_t count, uint32_t boundKBs) {
+    uint32_t chunks = count / 2 / CHUNK_SECTORS;
+    uint32_t src = first, dst = first + chunks * CHUNK_SECTORS;
+    static uint8_t pattern[512];
+    for (uint32_t s = 0; s < chunks * CHUNK_SECTORS; s++) {
+        for (uint32_t i = 0; i < sizeof(pattern); i++) pattern[i] = (uint8_t)(s * 7 + i);
+        CHECK(dev.writeSectors(src + s, pattern, 1));
+    }
+
+    typedef bool (*copy_fn)(FileBlockDevice &, uint32_t, uint32_t, uint32_t);
+    static const struct {
+        const char *name;
+        copy_fn copy;
+    } variants[] = {{"one buffer", copy_one_buffer}, {"two buffers", copy_two_buffers}};
+    uint64_t bytes = (uint64_t)chunks * FILE_JOB_CHUNK;
+    for (const auto &v : variants) {
+        CHECK(dev.writeSectors(dst, pattern, 1));     // Nothing left from the last variant at the start
+        dev.setLatency(FILE_BLOCK_LATENCY_SPI_20MHZ);
+        auto t0 = std::chrono::steady_clock::now();
+        CHECK(v.copy(dev, src, dst, chunks));
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+        dev.setLatency(FILE_BLOCK_LATENCY_NONE);
+        CHECK(same_sectors(dev, src, dst, chunks * CHUNK_SECTORS));
+        uint32_t kbs = us ? (uint32_t)(bytes * 1000000 / 1024 / us) : 0;
+        printf("[SdBench] copy %lu KB in %lu KB chunks, %s: %lu KB/s (%lu%% of the %lu KB/s bound)\n",
+               (unsigned long)(bytes / 1024), (unsigned long)(FILE_JOB_CHUNK / 1024), v.name,
+               (unsigned long)kbs, (unsigned long)(boundKBs ? kbs * 100 / boundKBs : 0), (unsigned long)boundKBs);
+    }
+}
+
+static bool make_image(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fseek(f, (long)IMAGE_SECTORS * 512 - 1, SEEK_SET) == 0 && fputc(0, f) == 0;
+    return fclose(f) == 0 && ok;
+}
+
+int main(int argc, char **argv) {
+    char tmp[] = "/tmp/sd_benchXXXXXX";
+    const char *path = argc > 1 ? argv[1] : nullptr;
+    if (!path) {
+        int fd = mkstemp(tmp);
+        if (fd < 0 || close(fd) != 0 || !make_image(tmp)) {
+            perror("image");
+            return 1;
+        }
+        path = tmp;
+    }
+
+    FileBlockDevice dev;
+    if (!dev.open(path)) return 1;
+    uint32_t first = dev.sectorCount() > SCRATCH_SECTORS ? dev.sectorCount() - SCRATCH_SECTORS : 0;
+    uint32_t count = dev.sectorCount() - first;
+
+    static const struct {
+        const char *name;
+        BlockLatency latency;
+    } presets[] = {
+        {"none", FILE_BLOCK_LATENCY_NONE},
+        {"spi-20mhz", FILE_BLOCK_LATENCY_SPI_20MHZ},
+        {"slow-card", FILE_BLOCK_LATENCY_SLOW_CARD},
+    };
+
+    ImageBenchIo io(dev);
+    uint32_t boundKBs = 0;
+    for (const auto &p : presets) {
+        dev.setLatency(p.latency);
+        dev.resetStats();
+        SdBenchResult r = {};
+        bool ok = sd_bench_device(&io, first, count, r);
+        printf("[SdBench] %s, %lu commands, %lu us injected:\n", p.name,
+               (unsigned long)(dev.stats().readCalls + dev.stats().writeCalls),
+               (unsigned long)dev.stats().injectedUs);
+        sd_bench_print(r);
+        CHECK(ok);
+        // As run_bench() computes it: each byte is read and written on one bus
+        uint32_t sum = r.seqReadKBs + r.seqWriteKBs;
+        if (strcmp(p.name, "spi-20mhz") == 0 && sum) {
+            boundKBs = (uint32_t)((uint64_t)r.seqReadKBs * r.seqWriteKBs / sum);
+        }
+    }
+    dev.setLatency(FILE_BLOCK_LATENCY_NONE);
+    measure_copy(dev, first, count, boundKBs);
+
+    // Bad data on read-back has to fail the run
+    dev.setLatency(FILE_BLOCK_LATENCY_NONE);
+    io.corruptEvery(5);
+    SdBenchResult bad = {};
+    if (sd_bench_device(&io, first, count, bad) || bad.errors == 0) {
+        printf("FAIL corrupted reads not detected\n");
+        s_failures++;
+    }
+
+    dev.end();
+    if (path == tmp) unlink(tmp);
+    return check_done("sd_bench_host");
+}
@@ -0,0 +1,273 @@
+/**
+ * @file sd_image_test.cpp
+ * @brief Host test of the SD_utils and vfs paths on a generated FAT32 image.
+ *
+ * Builds a partitioned FAT32 image with a 1,000-entry directory (8.3 and
+ * long names, a few subdirectories and hidden files) and a 1 MB file, then
+ * mounts it through file_block_device_mount() on the real SdFat, the way
+ * the firmware mounts the card: volume on a BlockCache over the device.
+ * - list_files_in_dir() (both overloads) and list_files_page() must return
+ *   every entry in directory order with the right name, type and flags.
+ * - dir_cursor_seek() to entry N, forwards or back, must land on the entry
+ *   enumeration delivers as the Nth, and list_files_page() must return the
+ *   same page for an arbitrary first entry as a full listing has there.
+ * - VfsFile must stream the 1 MB file back byte for byte.
+ * - Both are repeated raw and cached at the 20 MHz SPI latency preset, and
+ *   the card commands and modelled time of each are printed.
+ *
+ * Needs SdFat (see the Makefile); skipped without it.
+ *
+ *   make -C test/host run SDFAT=<SdFat>/src
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "SD_utils.h"
+#include "block_cache.h"
+#include "file_block_device.h"
+#include "vfs.h"
+#include "check.h"
+#include "fat_image.h"
+
+#define VOL_SECTORS     80000       // Enough 512-byte clusters to be FAT32
+#define DIR_ENTRIES     1000
+#define STREAM_BYTES    (1024U * 1024U)
+#define PAGE_ENTRIES    64
+
+struct Expected {
+    std::string name;
+    uint8_t flags;
+    uint16_t date;
+};
+
+static uint8_t stream_byte(uint32_t k) {
+    return (uint8_t)((k * 131u) ^ (k >> 9));
+}
+
+static bool build_image(int fd, std::vector<Expected> &expected) {
+    FatImage img(fd, VOL_SECTORS);
+    uint32_t root = img.alloc(1);
+    uint32_t subdirs = img.alloc(DIR_ENTRIES / 100);
+
+    // /BIG comes next; its clusters are known once its entries are
+    uint32_t big = img.next();
+    DirBuilder bigDir;
+    char sn[12], base[16], name[40];
+    short_name(sn, ".", "");
+    bigDir.add(sn, 0x10, big, 0, 0);
+    short_name(sn, "..", "");
+    bigDir.add(sn, 0x10, 0, 0, 0);
+    for (uint32_t i = 0; i < DIR_ENTRIES; i++) {
+        Expected e;
+        e.flags = 0;
+        e.date = (uint16_t)(((2024 - 1980) << 9) | (5 << 5) | (1 + i % 28));
+        uint8_t hidden = 0;
+        if (i % 250 == 7) {
+            hidden = 0x02;
+            e.flags |= ENTRY_HIDDEN;
+        }
+        if (i % 100 == 50) {
+            snprintf(base, sizeof(base), "DIR_%04u", (unsigned)i);
+            short_name(sn, base, "");
+            bigDir.add(sn, 0x10 | hidden, subdirs + i / 100, 0, e.date);
+            e.name = base;
+            e.flags |= ENTRY_DIR;
+        } else if (i % 2 == 0) {
+            snprintf(base, sizeof(base), "F%04u", (unsigned)i);
+            short_name(sn, base, "TXT");
+            bigDir.add(sn, 0x20 | hidden, 0, 0, e.date);
+            e.name = std::string(base) + ".TXT";
+        } else {
+            snprintf(base, sizeof(base), "E%04u~1", (unsigned)i);
+            short_name(sn, base, "TXT");
+            snprintf(name, sizeof(name), "entry_%04u_long_name.txt", (unsigned)i);
+            bigDir.add(sn, 0x20 | hidden, 0, 0, e.date, name);
+            e.name = name;
+        }
+        expected.push_back(e);
+    }
+    if (img.alloc(bigDir.clusters(img)) != big || !bigDir.write(img, big)) return false;
+
+    for (uint32_t d = 0; d < DIR_ENTRIES / 100; d++) {
+        DirBuilder sub;
+        short_name(sn, ".", "");
+        sub.add(sn, 0x10, subdirs + d, 0, 0);
+        short_name(sn, "..", "");
+        sub.add(sn, 0x10, big, 0, 0);
+        if (!sub.write(img, subdirs + d)) return false;
+    }
+
+    uint32_t stream = img.alloc(STREAM_BYTES / 512);
+    uint8_t sector[512];
+    for (uint32_t c = 0; c < STREAM_BYTES / 512; c++) {
+        for (uint32_t k = 0; k < 512; k++) sector[k] = stream_byte(c * 512 + k);
+        if (!img.writeCluster(stream + c, sector, sizeof(sector))) return false;
+    }
+
+    DirBuilder rootDir;
+    uint16_t date = (uint16_t)(((2025 - 1980) << 9) | (6 << 5) | 1);
+    short_name(sn, "BIG", "");
+    rootDir.add(sn, 0x10, big, 0, date);
+    short_name(sn, "STREAM", "BIN");
+    rootDir.add(sn, 0x20, stream, STREAM_BYTES, date);
+    return rootDir.clusters(img) == 1 && rootDir.write(img, root) && img.finish();
+}
+
+// --- Checks --------------------------------------------------------------
+
+static void check_listing(const std::vector<Expected> &expected) {
+    SdFile dir;
+    CHECK(open_dir(dir, "/big"));
+
+    EntryStore store;
+    CHECK(list_files_in_dir(dir, store) == DIR_ENTRIES);
+    uint32_t bad = 0;
+    for (uint32_t i = 0; i < store.count() && i < expected.size(); i++) {
+        const Expected &e = expected[i];
+        if (e.name != store.name(i) || store.rec(i).flags != e.flags || store.rec(i).date != e.date) bad++;
+    }
+    CHECK(bad == 0);
+
+    std::vector<FileInfo> files = list_files_in_dir(dir);
+    CHECK(files.size() == DIR_ENTRIES);
+    bad = 0;
+    for (size_t i = 0; i < files.size() && i < expected.size(); i++) {
+        if (expected[i].name != files[i].name || files[i].size != 0) bad++;
+    }
+    CHECK(bad == 0);
+
+    EntryStore paged;
+    DirCursor cursor;
+    uint32_t pages = 0;
+    while (!cursor.done && pages <= DIR_ENTRIES / PAGE_ENTRIES + 1) {
+        list_files_page(dir, cursor, paged.count(), PAGE_ENTRIES, paged);
+        pages++;
+    }
+    CHECK(cursor.done);
+    CHECK(cursor.index == DIR_ENTRIES);
+    CHECK(paged.count() == DIR_ENTRIES);
+    bad = 0;
+    for (uint32_t i = 0; i < paged.count() && i < store.count(); i++) {
+        if (strcmp(paged.name(i), store.name(i)) != 0 || paged.rec(i).flags != store.rec(i).flags) bad++;
+    }
+    CHECK(bad == 0);
+    dir.close();
+}
+
+static bool name_at(const DirEntryInfo &info, void *ctx) {
+    *(std::string *)ctx = info.name;
+    return false;
+}
+
+static void check_seek() {
+    SdFile dir;
+    CHECK(open_dir(dir, "/big"));
+    EntryStore all;
+    CHECK(list_files_in_dir(dir, all) == DIR_ENTRIES);
+
+    // Forwards, backwards, the same index twice, the first and the last
+    static const uint32_t targets[] = {0, 1, 499, 999, 640, 640, 3, 0, 998, 200};
+    DirCursor cursor;
+    std::string name;
+    uint32_t bad = 0;
+    for (uint32_t n : targets) {
+        CHECK(dir_cursor_seek(dir, cursor, n));
+        CHECK(cursor.index == n);
+        name.clear();
+        if (dir_enumerate(dir, cursor, 1, 0, name_at, &name) != 1 || name != all.name(n)) bad++;
+    }
+    CHECK(bad == 0);
+
+    // Exactly at the end is fine; past it is not
+    CHECK(dir_cursor_seek(dir, cursor, DIR_ENTRIES));
+    CHECK(!dir_cursor_seek(dir, cursor, DIR_ENTRIES + 1));
+    CHECK(cursor.done);
+
+    EntryStore page;
+    CHECK(list_files_page(dir, cursor, 640, PAGE_ENTRIES, page) == PAGE_ENTRIES);
+    CHECK(list_files_page(dir, cursor, 128, PAGE_ENTRIES, page) == PAGE_ENTRIES);
+    bad = 0;
+    for (uint32_t i = 0; i < page.count(); i++) {
+        uint32_t n = (i < PAGE_ENTRIES ? 640 : 128 - PAGE_ENTRIES) + i;
+        if (strcmp(page.name(i), all.name(n)) != 0) bad++;
+    }
+    CHECK(bad == 0);
+    CHECK(list_files_page(dir, cursor, DIR_ENTRIES + 5, PAGE_ENTRIES, page) == 0);
+    dir.close();
+}
+
+static void check_stream() {
+    VfsFile f;
+    CHECK(f.open("/sd/stream.bin", VFS_READ));
+    CHECK(f.size() == STREAM_BYTES);
+    static uint8_t buf[4096];
+    uint32_t total = 0, bad = 0;
+    int n;
+    while ((n = f.read(buf, sizeof(buf))) > 0) {
+        for (int j = 0; j < n; j++) {
+            if (buf[j] != stream_byte(total + j)) bad++;
+        }
+        total += n;
+    }
+    CHECK(n == 0);
+    CHECK(total == STREAM_BYTES);
+    CHECK(bad == 0);
+    CHECK(f.close());
+}
+
+// Lists /BIG and streams the file on @p vol at the SPI latency preset
+static void measure(FileBlockDevice &dev, FsBlockDevice *vol, const char *label,
+                    const std::vector<Expected> &expected) {
+    CHECK(file_block_device_mount(vol));
+    dev.setLatency(FILE_BLOCK_LATENCY_SPI_20MHZ);
+    Serial.quiet = true;
+    dev.resetStats();
+    check_listing(expected);
+    BlockDeviceStats list = dev.stats();
+    dev.resetStats();
+    check_stream();
+    BlockDeviceStats stream = dev.stats();
+    Serial.quiet = false;
+    dev.setLatency(FILE_BLOCK_LATENCY_NONE);
+    printf("[SdImage] %s: 3 listings of %u entries %lu cmds %lu us, 1 MB stream %lu cmds %lu us (modelled)\n",
+           label, DIR_ENTRIES, (unsigned long)list.readCalls, (unsigned long)list.injectedUs,
+           (unsigned long)stream.readCalls, (unsigned long)stream.injectedUs);
+}
+
+int main() {
+    char path[] = "/tmp/sd_imageXXXXXX";
+    int fd = mkstemp(path);
+    std::vector<Expected> expected;
+    if (fd < 0 || ftruncate(fd, FatImage::imageBytes(VOL_SECTORS)) != 0 ||
+        !build_image(fd, expected) || close(fd) != 0) {
+        perror("image");
+        return 1;
+    }
+
+    FileBlockDevice dev;
+    if (!dev.open(path)) return 1;
+
+    // As the firmware mounts the card: volume on the sector cache
+    BlockCache cache;
+    CHECK(cache.begin(&dev, SD_CACHE_SECTORS));
+    CHECK(file_block_device_mount(&cache));
+    check_listing(expected);
+    check_seek();
+    check_stream();
+    cache.end();
+
+    measure(dev, &dev, "raw", expected);
+    CHECK(cache.begin(&dev, SD_CACHE_SECTORS));   // Cold, as after a mount
+    measure(dev, &cache, "cached", expected);
+    cache.end();
+
+    dev.end();
+    unlink(path);
+    return check_done("sd_image_test");
+}
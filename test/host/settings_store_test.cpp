@@ -0,0 +1,146 @@
+/**
+ * @file settings_store_test.cpp
+ * @brief Host check of the write-behind settings cache.
+ *
+ * NVS is an in-memory map that counts commits and can be made to fail; the
+ * quiet-period timer is fired by hand.
+ * - A key set before NVS has it must be written, even when the value
+ *   equals the default an earlier get() cached.
+ * - Setting the value NVS already holds must not commit.
+ * - A burst of sets is one commit; a failed commit is retried.
+ *
+ *   make -C test/host run
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <map>
+#include <string>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <nvs.h>
+#include "settings_store.h"
+#include "check.h"
+
+// --- Stand-ins -----------------------------------------------------------
+
+static std::map<std::string, int32_t> s_nvs;    // One namespace is enough here
+static uint32_t s_nvsCommits = 0;
+static bool s_nvsFail = false;
+
+esp_err_t nvs_open(const char *, nvs_open_mode_t mode, nvs_handle_t *out) {
+    if (mode == NVS_READONLY && s_nvs.empty()) return ESP_ERR_NVS_NOT_FOUND;
+    *out = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t) {}
+
+esp_err_t nvs_commit(nvs_handle_t) {
+    if (s_nvsFail) return ESP_FAIL;
+    s_nvsCommits++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t, const char *key, int32_t *out) {
+    auto it = s_nvs.find(key);
+    if (it == s_nvs.end()) return ESP_ERR_NVS_NOT_FOUND;
+    *out = it->second;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t, const char *key, int32_t value) {
+    if (s_nvsFail) return ESP_FAIL;
+    s_nvs[key] = value;
+    return ESP_OK;
+}
+
+struct host_esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    bool armed;
+};
+
+static host_esp_timer s_timer;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+    s_timer = {args->callback, args->arg, false};
+    *out = &s_timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t) {
+    timer->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    timer->armed = false;
+    return ESP_OK;
+}
+
+// The quiet period ran out
+static void fire_timer() {
+    if (!s_timer.armed) return;
+    s_timer.armed = false;
+    s_timer.callback(s_timer.arg);
+}
+
+// --- Checks --------------------------------------------------------------
+
+static void check_new_key() {
+    CHECK(settings_store_set_i32("brightness", 180));
+    CHECK(settings_store_stats().dirty == 1);
+    fire_timer();
+    CHECK(s_nvs.count("brightness") && s_nvs["brightness"] == 180);
+
+    // The default a get() cached is not in NVS either
+    CHECK(settings_store_get_i32("volume", 50) == 50);
+    CHECK(settings_store_set_i32("volume", 50));
+    CHECK(settings_store_flush());
+    CHECK(s_nvs.count("volume") && s_nvs["volume"] == 50);
+}
+
+static void check_unchanged() {
+    uint32_t commits = s_nvsCommits;
+    CHECK(settings_store_set_i32("brightness", 180));
+    CHECK(settings_store_stats().dirty == 0);
+    fire_timer();
+    CHECK(settings_store_flush());
+    CHECK(s_nvsCommits == commits);
+
+    // After a restore the value comes from NVS again, still unchanged
+    s_nvs["timeout"] = 30;
+    settings_store_invalidate();
+    CHECK(settings_store_set_i32("timeout", 30));
+    CHECK(settings_store_flush());
+    CHECK(s_nvsCommits == commits);
+}
+
+static void check_burst_and_retry() {
+    uint32_t commits = s_nvsCommits;
+    for (int32_t v = 0; v <= 255; v += 5) CHECK(settings_store_set_i32("brightness", v));
+    fire_timer();
+    CHECK(s_nvsCommits == commits + 1);
+    CHECK(s_nvs["brightness"] == 255);
+
+    s_nvsFail = true;
+    CHECK(settings_store_set_i32("sleep", 1));
+    CHECK(!settings_store_flush());
+    CHECK(settings_store_stats().dirty == 1);
+    s_nvsFail = false;
+    CHECK(settings_store_flush());
+    CHECK(s_nvs.count("sleep") && s_nvs["sleep"] == 1);
+}
+
+int main() {
+    Serial.quiet = true;
+    check_new_key();
+    check_unchanged();
+    check_burst_and_retry();
+    Serial.quiet = false;
+    SettingsStoreStats st = settings_store_stats();
+    printf("%lu sets, %lu commits, %lu keys written, %lu failed\n", (unsigned long)st.sets,
+           (unsigned long)st.commits, (unsigned long)st.keysWritten, (unsigned long)st.failures);
+    return check_done("settings_store_test");
+}
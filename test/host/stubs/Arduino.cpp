@@ -0,0 +1,48 @@
+/**
+ * @file Arduino.cpp
+ * @brief Host definitions of the Arduino core calls declared in Arduino.h.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include "Arduino.h"
+#include <chrono>
+#include <cstdarg>
+
+HostSerial Serial;
+
+int HostSerial::printf(const char *fmt, ...) {
+    if (quiet) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vprintf(fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+void HostSerial::println(const char *text) {
+    if (!quiet) puts(text);
+}
+
+static const auto s_t0 = std::chrono::steady_clock::now();
+
+uint32_t micros() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now() - s_t0).count();
+}
+
+uint32_t millis() {
+    return micros() / 1000;
+}
+
+#ifdef HOST_NEEDS_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
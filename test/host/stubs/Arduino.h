@@ -0,0 +1,48 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the few Arduino core calls the host-built modules use.
+ *
+ * Serial, millis(), micros() and strlcpy() are in Arduino.cpp next to this
+ * file; set Serial.quiet to silence a noisy stretch of a test. SdFat's own
+ * sources are compiled with this header forced in (see the Makefile).
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_ARDUINO_H
+#define HOST_STUB_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+struct HostSerial {
+    bool quiet = false;
+    int printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    void println(const char *text);
+};
+extern HostSerial Serial;
+
+uint32_t millis();
+uint32_t micros();
+static inline void yield() {}
+
+#define SS 5    // Default VSPI chip select of the ESP32 core
+
+// glibc has strlcpy() from 2.38 on; the test defines it for older ones
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+#define HOST_NEEDS_STRLCPY 1
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
+
+typedef int esp_err_t;
+#define ESP_OK                 0
+#define ESP_FAIL               -1
+#define ESP_ERR_NVS_NOT_FOUND  0x1102
+
+#endif // HOST_STUB_ARDUINO_H
@@ -0,0 +1,29 @@
+/**
+ * @file FS.h
+ * @brief Host stand-in for the Arduino FS file handle vfs uses for flash.
+ *
+ * A File that never opens; host tests only touch /sd paths.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_FS_H
+#define HOST_STUB_FS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace fs {
+class File {
+public:
+    explicit operator bool() const { return false; }
+    size_t read(uint8_t *, size_t) { return 0; }
+    size_t write(const uint8_t *, size_t) { return 0; }
+    void flush() {}
+    void close() {}
+    size_t size() const { return 0; }
+};
+}
+
+#endif // HOST_STUB_FS_H
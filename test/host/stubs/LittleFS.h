@@ -0,0 +1,28 @@
+/**
+ * @file LittleFS.h
+ * @brief Host stand-in for the LittleFS calls in vfs.cpp: there is no flash.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_LITTLEFS_H
+#define HOST_STUB_LITTLEFS_H
+
+#include "FS.h"
+
+class HostLittleFS {
+public:
+    bool begin(bool, const char *, int, const char *) { return false; }
+    size_t usedBytes() { return 0; }
+    size_t totalBytes() { return 0; }
+    bool exists(const char *) { return false; }
+    bool remove(const char *) { return false; }
+    bool mkdir(const char *) { return false; }
+    bool rename(const char *, const char *) { return false; }
+    fs::File open(const char *, const char *, bool = false) { return fs::File(); }
+};
+
+static HostLittleFS LittleFS;
+
+#endif // HOST_STUB_LITTLEFS_H
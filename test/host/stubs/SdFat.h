@@ -0,0 +1,39 @@
+/**
+ * @file SdFat.h
+ * @brief Host stand-in for the part of SdFat that host-built modules see.
+ *
+ * The virtual block device interface that SdFat declares with
+ * USE_BLOCK_DEVICE_INTERFACE=1, plus empty SdFat/SdFile classes so headers
+ * such as SD_utils.h and vfs.h parse; nothing that needs the Arduino core.
+ * Tests that mount a FAT volume put the real SdFat ahead of this directory
+ * on the include path instead.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_SDFAT_H
+#define HOST_STUB_SDFAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class FsBlockDeviceInterface {
+public:
+    virtual ~FsBlockDeviceInterface() {}
+    virtual void end() {}
+    virtual bool isBusy() = 0;
+    virtual bool readSector(uint32_t sector, uint8_t *dst) = 0;
+    virtual bool readSectors(uint32_t sector, uint8_t *dst, size_t ns) = 0;
+    virtual uint32_t sectorCount() = 0;
+    virtual bool syncDevice() = 0;
+    virtual bool writeSector(uint32_t sector, const uint8_t *src) = 0;
+    virtual bool writeSectors(uint32_t sector, const uint8_t *src, size_t ns) = 0;
+};
+
+typedef FsBlockDeviceInterface FsBlockDevice;
+
+class SdFat {};
+class SdFile {};
+
+#endif // HOST_STUB_SDFAT_H
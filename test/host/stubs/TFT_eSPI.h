@@ -0,0 +1,14 @@
+/**
+ * @file TFT_eSPI.h
+ * @brief Host stand-in so modules that declare `extern TFT_eSPI tft` parse.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_TFT_ESPI_H
+#define HOST_STUB_TFT_ESPI_H
+
+class TFT_eSPI {};
+
+#endif // HOST_STUB_TFT_ESPI_H
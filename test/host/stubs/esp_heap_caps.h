@@ -0,0 +1,22 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief Host stand-in: heap_caps_malloc() is plain malloc().
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_ESP_HEAP_CAPS_H
+#define HOST_STUB_ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT      (1 << 2)
+#define MALLOC_CAP_INTERNAL  (1 << 11)
+#define MALLOC_CAP_SPIRAM    (1 << 10)
+
+static inline void *heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+static inline void heap_caps_free(void *ptr) { free(ptr); }
+
+#endif // HOST_STUB_ESP_HEAP_CAPS_H
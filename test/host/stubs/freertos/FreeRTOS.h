@@ -0,0 +1,19 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in: the host tests are single-threaded.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_FREERTOS_H
+#define HOST_STUB_FREERTOS_H
+
+#define portMAX_DELAY 0xFFFFFFFFu
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux)  ((void)(mux))
+
+#endif // HOST_STUB_FREERTOS_H
@@ -0,0 +1,28 @@
+/**
+ * @file semphr.h
+ * @brief Host stand-in: mutexes that never block (single-threaded tests).
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_SEMPHR_H
+#define HOST_STUB_SEMPHR_H
+
+typedef void *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    static int mutex;
+    return &mutex;
+}
+static inline int xSemaphoreTake(SemaphoreHandle_t, unsigned) { return 1; }
+static inline int xSemaphoreGive(SemaphoreHandle_t) { return 1; }
+
+static inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    static int mutex;
+    return &mutex;
+}
+static inline int xSemaphoreTakeRecursive(SemaphoreHandle_t, unsigned) { return 1; }
+static inline int xSemaphoreGiveRecursive(SemaphoreHandle_t) { return 1; }
+
+#endif // HOST_STUB_SEMPHR_H
@@ -0,0 +1,28 @@
+/**
+ * @file nvs.h
+ * @brief Host stand-in for the NVS calls the stores use; each test keeps the data.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_NVS_H
+#define HOST_STUB_NVS_H
+
+#include "Arduino.h"
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out);
+void nvs_close(nvs_handle_t h);
+esp_err_t nvs_commit(nvs_handle_t h);
+esp_err_t nvs_erase_key(nvs_handle_t h, const char *key);
+esp_err_t nvs_get_u8(nvs_handle_t h, const char *key, uint8_t *out);
+esp_err_t nvs_set_u8(nvs_handle_t h, const char *key, uint8_t value);
+esp_err_t nvs_get_i32(nvs_handle_t h, const char *key, int32_t *out);
+esp_err_t nvs_set_i32(nvs_handle_t h, const char *key, int32_t value);
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len);
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *data, size_t len);
+
+#endif // HOST_STUB_NVS_H
@@ -0,0 +1,26 @@
+/**
+ * @file crc.h
+ * @brief Host stand-in for the ROM CRC32 routine.
+ *
+ * Same CRC-32 (reflected, 0xEDB88320) as the ROM's crc32_le(), which
+ * inverts on the way in and out, so crc32_le(0, ...) matches zlib.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+
+#ifndef HOST_STUB_ROM_CRC_H
+#define HOST_STUB_ROM_CRC_H
+
+#include <stdint.h>
+
+static inline uint32_t crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320UL & (0U - (crc & 1)));
+    }
+    return ~crc;
+}
+
+#endif // HOST_STUB_ROM_CRC_H
@@ -0,0 +1,16 @@
+/**
+ * @file sdfat_host.cpp
+ * @brief Chip-select hooks the real SdFat needs outside the Arduino core.
+ *
+ * With SPI_DRIVER_SELECT=3 SdFat leaves these to the application. Host
+ * tests mount images through file_block_device_mount() and never start
+ * the SPI card, so they do nothing.
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <SdFat.h>
+
+void sdCsInit(SdCsPin_t) {}
+
+void sdCsWrite(SdCsPin_t, bool) {}
@@ -0,0 +1,143 @@
+/**
+ * @file tlsf_stress.cpp
+ * @brief Host stress test of the TLSF allocator behind the LVGL heap.
+ *
+ * - Random malloc, realloc and free of LVGL-like sizes over a pool the size
+ *   of LV_HEAP_INITIAL_SIZE, with more pools added part way as lv_heap
+ *   grows. Tlsf::check() runs after every step and every payload carries a
+ *   pattern that must survive until it is freed.
+ * - Freeing everything must merge each pool back into one free block.
+ * - The time of one stats() call, which lv_heap takes with interrupts off,
+ *   is printed at the fullest point.
+ *
+ *   make -C test/host run
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "tlsf.h"
+#include "check.h"
+
+#define POOL_BYTES   (48U * 1024U)
+#define GROW_BYTES   (16U * 1024U)
+#define GROWN_POOLS  3
+#define STEPS        200000
+#define LIVE_MAX     300
+
+struct Live {
+    uint8_t *ptr;
+    size_t size;
+    uint8_t fill;
+};
+
+static uint32_t s_rng = 12345;
+
+static uint32_t rnd() {
+    s_rng = s_rng * 1664525 + 1013904223;
+    return s_rng >> 8;
+}
+
+// Mostly small objects and styles, sometimes label text or an image buffer
+static size_t random_size() {
+    static const size_t sizes[] = {8, 16, 24, 40, 64, 96, 128, 200, 300, 512, 1024, 4096};
+    return sizes[rnd() % (sizeof(sizes) / sizeof(sizes[0]))] + rnd() % 16;
+}
+
+static bool intact(const Live &l) {
+    for (size_t i = 0; i < l.size; i++) {
+        if (l.ptr[i] != l.fill) return false;
+    }
+    return true;
+}
+
+int main() {
+    static uint8_t pool[POOL_BYTES] __attribute__((aligned(TLSF_ALIGN)));
+    static uint8_t grown[GROWN_POOLS][GROW_BYTES];
+    Tlsf heap;
+    CHECK(heap.addPool(pool, sizeof(pool)));
+    CHECK(heap.check());
+    size_t firstPool = heap.stats().largestFree;
+
+    std::vector<Live> live;
+    uint32_t fails = 0, corrupt = 0, badChecks = 0;
+    int pools = 1;
+    double statsNs = 0;
+    size_t fullest = 0;
+
+    for (int step = 0; step < STEPS; step++) {
+        // Odd pool offsets exercise the alignment in addPool()
+        if (pools <= GROWN_POOLS && step == pools * STEPS / (GROWN_POOLS + 1)) {
+            CHECK(heap.addPool(grown[pools - 1] + pools, GROW_BYTES - pools));
+            pools++;
+        }
+
+        uint32_t op = rnd() % 8;
+        if (live.size() < LIVE_MAX && (op < 4 || live.empty())) {
+            size_t size = random_size();
+            uint8_t *p = (uint8_t *)heap.malloc(size);
+            if (p) {
+                CHECK(((uintptr_t)p & (TLSF_ALIGN - 1)) == 0);
+                Live l = {p, size, (uint8_t)rnd()};
+                memset(p, l.fill, size);
+                live.push_back(l);
+            } else {
+                fails++;
+            }
+        } else if (op < 6) {
+            Live &l = live[rnd() % live.size()];
+            size_t size = 1 + rnd() % 700;
+            uint8_t *p = (uint8_t *)heap.realloc(l.ptr, size);
+            if (p) {
+                size_t kept = size < l.size ? size : l.size;
+                Live moved = {p, kept, l.fill};
+                if (!intact(moved)) corrupt++;
+                l.ptr = p;
+                l.size = size;
+                memset(p, l.fill, size);
+            } else {
+                fails++;     // The block is left as it was
+            }
+        } else {
+            size_t k = rnd() % live.size();
+            if (!intact(live[k])) corrupt++;
+            heap.free(live[k].ptr);
+            live[k] = live.back();
+            live.pop_back();
+        }
+        if (!heap.check()) badChecks++;
+
+        if (heap.usedBytes() > fullest) {
+            fullest = heap.usedBytes();
+            auto t0 = std::chrono::steady_clock::now();
+            TlsfStats st = heap.stats();
+            auto t1 = std::chrono::steady_clock::now();
+            statsNs = std::chrono::duration<double, std::nano>(t1 - t0).count();
+            CHECK(st.usedBytes == heap.usedBytes());
+        }
+    }
+    CHECK(corrupt == 0);
+    CHECK(badChecks == 0);
+
+    TlsfStats busy = heap.stats();
+    printf("%d steps, %d pools: %u failed requests, %zu blocks live, frag %u%%, stats() %.0f ns at %zu used\n",
+           STEPS, pools, (unsigned)fails, live.size(), busy.fragPct, statsNs, fullest);
+
+    for (const Live &l : live) {
+        if (!intact(l)) corrupt++;
+        heap.free(l.ptr);
+    }
+    CHECK(corrupt == 0);
+    CHECK(heap.check());
+    TlsfStats empty = heap.stats();
+    CHECK(empty.usedBytes == 0);
+    CHECK(empty.usedBlocks == 0);
+    CHECK(empty.freeBlocks == (uint32_t)pools);
+    CHECK(empty.freeBytes == empty.totalBytes);
+    CHECK(empty.largestFree == firstPool);
+
+    return check_done("tlsf_stress");
+}
@@ -0,0 +1,247 @@
+/**
+ * @file wifi_creds_test.cpp
+ * @brief Host check and benchmark of the WiFi credential store.
+ *
+ * NVS, the VFS and the mount state are in-memory stand-ins, so the legacy
+ * CSV import can be driven through boot orders the device sees:
+ * - the WiFi task saves the provisioned network before the card mounts;
+ * - the card mounts later, with or without a CSV;
+ * - a store written by the first version, which marked the import done
+ *   even when the card was not mounted.
+ * Lookups are then timed against the old String scan of the CSV.
+ *
+ *   make -C test/host run
+ *
+ * @version 1.0
+ * @date 2025-06-01
+ */
+#include <map>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <nvs.h>
+#include "sd_mount.h"
+#include "wifi_creds.h"
+#include "check.h"
+
+// --- Stand-ins -----------------------------------------------------------
+
+static std::map<std::string, std::vector<uint8_t>> s_nvs;   // One namespace is enough here
+
+esp_err_t nvs_open(const char *, nvs_open_mode_t mode, nvs_handle_t *out) {
+    if (mode == NVS_READONLY && s_nvs.empty()) return ESP_ERR_NVS_NOT_FOUND;
+    *out = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t) {}
+
+esp_err_t nvs_commit(nvs_handle_t) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t, const char *key) {
+    return s_nvs.erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t, const char *key, void *out, size_t *len) {
+    auto it = s_nvs.find(key);
+    if (it == s_nvs.end()) return ESP_ERR_NVS_NOT_FOUND;
+    if (*len < it->second.size()) return ESP_FAIL;
+    *len = it->second.size();
+    memcpy(out, it->second.data(), *len);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t, const char *key, const void *data, size_t len) {
+    s_nvs[key].assign((const uint8_t *)data, (const uint8_t *)data + len);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t h, const char *key, uint8_t *out) {
+    size_t len = 1;
+    return nvs_get_blob(h, key, out, &len);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t h, const char *key, uint8_t value) {
+    return nvs_set_blob(h, key, &value, 1);
+}
+
+static std::map<std::string, std::string> s_files;
+static SdMountStatus s_mount = {};
+
+SdMountStatus sd_mount_status() {
+    return s_mount;
+}
+
+static void card_mounted(bool mounted) {
+    s_mount.state = mounted ? SD_MOUNT_MOUNTED : SD_MOUNT_NO_CARD;
+    s_mount.generation += 2;
+}
+
+// VfsFile over s_files: m_path holds the name, m_startSize the read offset
+bool VfsFile::open(const char *path, uint8_t mode) {
+    close();
+    if (mode != VFS_READ || s_mount.state != SD_MOUNT_MOUNTED || !s_files.count(path)) return false;
+    strlcpy(m_path, path, sizeof(m_path));
+    m_startSize = 0;
+    m_medium = VFS_SD;
+    return true;
+}
+
+bool VfsFile::close() {
+    m_medium = VFS_NONE;
+    return true;
+}
+
+int VfsFile::readLine(char *line, size_t maxLen) {
+    const std::string &data = s_files[m_path];
+    if (m_medium == VFS_NONE || m_startSize >= data.size()) return -1;
+    size_t end = data.find('\n', m_startSize);
+    if (end == std::string::npos) end = data.size();
+    std::string text = data.substr(m_startSize, end - m_startSize);
+    if (!text.empty() && text.back() == '\r') text.pop_back();
+    m_startSize = (uint32_t)end + 1;
+    strlcpy(line, text.c_str(), maxLen);
+    return (int)strlen(line);
+}
+
+// --- Checks --------------------------------------------------------------
+
+static bool has(const char *ssid, const char *password) {
+    char pw[WIFI_CREDS_PASS_LEN];
+    return wifi_creds_lookup(ssid, pw, sizeof(pw)) && strcmp(pw, password) == 0;
+}
+
+// A fresh boot: NVS as it is, card not mounted yet
+static void reboot() {
+    card_mounted(false);
+    wifi_creds_invalidate();
+}
+
+static void check_import_waits_for_mount() {
+    s_nvs.clear();
+    s_files[WIFI_CREDS_LEGACY_CSV] = "Home,old\nOffice,office-pw\r\n,nameless\nbroken line\nLab,lab-pw";
+    reboot();
+
+    // main.cpp saves the provisioned network before the card is up
+    CHECK(wifi_creds_save("Home", "new"));
+    CHECK(wifi_creds_count() == 1);
+    CHECK(!has("Office", "office-pw"));
+    CHECK(!s_nvs.count("ver"));
+
+    card_mounted(true);
+    CHECK(wifi_creds_begin());
+    CHECK(wifi_creds_count() == 3);
+    CHECK(has("Home", "new"));             // Saved since, so newer than the CSV
+    CHECK(has("Office", "office-pw"));
+    CHECK(has("Lab", "lab-pw"));
+    CHECK(s_nvs.count("ver"));
+
+    // Done for good: a later CSV is not read again, on this mount or after a reboot
+    s_files[WIFI_CREDS_LEGACY_CSV] += "\nExtra,x";
+    card_mounted(true);
+    CHECK(wifi_creds_count() == 3);
+    reboot();
+    card_mounted(true);
+    CHECK(wifi_creds_count() == 3);
+}
+
+static void check_no_csv() {
+    s_nvs.clear();
+    s_files.clear();
+    reboot();
+    CHECK(wifi_creds_save("Home", "pw"));
+    card_mounted(true);
+    CHECK(wifi_creds_count() == 1);
+    CHECK(s_nvs.count("ver"));             // A mounted card without a CSV counts as imported
+    s_files[WIFI_CREDS_LEGACY_CSV] = "Late,x";
+    reboot();
+    card_mounted(true);
+    CHECK(wifi_creds_count() == 1);
+}
+
+static void check_first_version_store() {
+    // Version 1 wrote "ver" on the first save even though the import had failed
+    s_nvs.clear();
+    s_files[WIFI_CREDS_LEGACY_CSV] = "Home,old\nOffice,office-pw";
+    reboot();
+    CHECK(wifi_creds_save("Home", "new"));
+    uint8_t one = 1;
+    s_nvs["ver"].assign(&one, &one + 1);
+
+    reboot();
+    CHECK(wifi_creds_count() == 1);
+    card_mounted(true);
+    CHECK(wifi_creds_count() == 2);
+    CHECK(has("Home", "new"));
+    CHECK(has("Office", "office-pw"));
+}
+
+// Old path: the whole CSV in one string, split line by line with substr()
+static bool legacy_lookup(const std::string &content, const char *ssid, char *password, size_t maxLen) {
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t end = content.find('\n', start);
+        if (end == std::string::npos) end = content.size();
+        std::string line = content.substr(start, end - start);
+        size_t sep = line.find(',');
+        if (sep != std::string::npos && line.substr(0, sep) == ssid) {
+            strlcpy(password, line.substr(sep + 1).c_str(), maxLen);
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+static void bench() {
+    s_nvs.clear();
+    s_files.clear();
+    reboot();
+    card_mounted(true);
+    std::vector<std::string> ssids;
+    std::string csv;
+    for (int i = 0; i < WIFI_CREDS_MAX; i++) {
+        ssids.push_back("Plant-Floor-AP-" + std::to_string(i * 37));
+        std::string pw = "secretpass" + std::to_string(i);
+        CHECK(wifi_creds_save(ssids[i].c_str(), pw.c_str()));
+        csv += ssids[i] + "," + pw + "\n";
+    }
+    CHECK(wifi_creds_count() == WIFI_CREDS_MAX);
+
+    const int rounds = 200000;
+    char pw[WIFI_CREDS_PASS_LEN];
+    int hits = 0;
+    uint32_t t0 = micros();
+    for (int r = 0; r < rounds; r++) hits += wifi_creds_lookup(ssids[r % WIFI_CREDS_MAX].c_str(), pw, sizeof(pw));
+    double storeNs = (micros() - t0) * 1000.0 / rounds;
+    t0 = micros();
+    for (int r = 0; r < rounds / 10; r++) hits += legacy_lookup(csv, ssids[r % WIFI_CREDS_MAX].c_str(), pw, sizeof(pw));
+    double legacyNs = (micros() - t0) * 1000.0 / (rounds / 10);
+    CHECK(hits == rounds + rounds / 10);
+
+    // 20 scanned APs, three of them known
+    std::vector<std::string> scan;
+    WifiScanEntry aps[20];
+    for (int i = 0; i < 20; i++) scan.push_back(i % 7 == 0 ? ssids[i] : "Neighbour-" + std::to_string(i));
+    for (int i = 0; i < 20; i++) aps[i] = {scan[i].c_str(), -40 - i * 2};
+    Serial.quiet = true;
+    int best = -1;
+    t0 = micros();
+    for (int r = 0; r < rounds; r++) best = wifi_creds_pick(aps, 20);
+    double pickNs = (micros() - t0) * 1000.0 / rounds;
+    Serial.quiet = false;
+    CHECK(best == 0);
+
+    printf("[WiFiCreds] %d networks: store lookup %.0f ns, legacy CSV scan %.0f ns, pick of 20 APs %.0f ns\n",
+           WIFI_CREDS_MAX, storeNs, legacyNs, pickNs);
+}
+
+int main() {
+    check_import_waits_for_mount();
+    check_no_csv();
+    check_first_version_store();
+    bench();
+    return check_done("wifi_creds_test");
+}